@@ -6,15 +6,33 @@
 
 #pragma once
 
+#include "sl3/array.hpp"
+#include "sl3/arrow.hpp"
+#include "sl3/busy.hpp"
+#include "sl3/cancellation.hpp"
+#include "sl3/changes.hpp"
+#include "sl3/checkpoint.hpp"
+#include "sl3/collation.hpp"
 #include "sl3/columns.hpp"
 #include "sl3/command.hpp"
 #include "sl3/config.hpp"
 #include "sl3/container.hpp"
+#include "sl3/csv.hpp"
 #include "sl3/database.hpp"
 #include "sl3/dataset.hpp"
 #include "sl3/dbvalue.hpp"
 #include "sl3/dbvalues.hpp"
 #include "sl3/error.hpp"
+#include "sl3/function.hpp"
+#include "sl3/iostats.hpp"
+#include "sl3/json.hpp"
+#include "sl3/memdb.hpp"
+#include "sl3/paramview.hpp"
+#include "sl3/readpool.hpp"
+#include "sl3/resultcache.hpp"
 #include "sl3/rowcallback.hpp"
+#include "sl3/slowio.hpp"
+#include "sl3/snapshot.hpp"
 #include "sl3/types.hpp"
 #include "sl3/value.hpp"
+#include "sl3/vtab.hpp"
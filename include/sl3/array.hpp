@@ -0,0 +1,138 @@
+/******************************************************************************
+ ------------- Copyright (c) 2009-2023 H a r a l d  A c h i t z ---------------
+ ---------- < h a r a l d dot a c h i t z at g m a i l dot c o m > ------------
+ ---- This Source Code Form is subject to the terms of the Mozilla Public -----
+ ---- License, v. 2.0. If a copy of the MPL was not distributed with this -----
+ ---------- file, You can obtain one at http://mozilla.org/MPL/2.0/. ----------
+ ******************************************************************************/
+
+#ifndef SL3_ARRAY_HPP_
+#define SL3_ARRAY_HPP_
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <sl3/config.hpp>
+#include <sl3/types.hpp>
+
+namespace sl3
+{
+  /**
+   * \brief A list of values bound as one table valued parameter
+   *
+   * The values are used in SQL through the sl3_array table valued
+   * function, which every Database provides:
+   *
+   * \code
+   *  auto cmd = db.prepare ("SELECT * FROM t WHERE id IN sl3_array (?);");
+   *  std::vector<int64_t> ids = {1, 2, 3};
+   *  cmd.bindArray (0, ids);
+   *  auto rows = cmd.select ();
+   * \endcode
+   *
+   * One prepared statement serves lists of any size.
+   * Integers and reals are not copied, they must outlive the execution of
+   * the Command.
+   * For texts, only the views are stored, the characters must outlive the
+   * execution of the Command.
+   */
+  class LIBSL3_API ArrayParameter
+  {
+  public:
+    /**
+     * \brief Integer values
+     * \param data first value
+     * \param size number of values
+     */
+    ArrayParameter (const int64_t* data, std::size_t size) noexcept;
+
+    /**
+     * \brief Real values
+     * \param data first value
+     * \param size number of values
+     */
+    ArrayParameter (const double* data, std::size_t size) noexcept;
+
+    /**
+     * \brief Text values
+     * \param texts views to the texts
+     */
+    ArrayParameter (std::vector<std::string_view> texts) noexcept;
+
+    /**
+     * \brief Integer values
+     * \param values the values
+     */
+    ArrayParameter (const std::vector<int64_t>& values) noexcept;
+
+    /**
+     * \brief Real values
+     * \param values the values
+     */
+    ArrayParameter (const std::vector<double>& values) noexcept;
+
+    /**
+     * \brief Text values
+     * \param values the values
+     */
+    ArrayParameter (const std::vector<std::string>& values);
+
+    /// temporary values would be dangling
+    ArrayParameter (std::vector<int64_t>&&) = delete;
+    /// temporary values would be dangling
+    ArrayParameter (std::vector<double>&&) = delete;
+    /// temporary values would be dangling
+    ArrayParameter (std::vector<std::string>&&) = delete;
+
+    /**
+     * \brief Value type
+     * \return Type::Int, Type::Real or Type::Text
+     */
+    Type
+    getType () const noexcept
+    {
+      return _type;
+    }
+
+    /**
+     * \brief Number of values
+     * \return the size
+     */
+    std::size_t
+    size () const noexcept
+    {
+      return _size;
+    }
+
+    /// \cond HIDDEN_SYMBOLS
+    const int64_t*
+    ints () const noexcept
+    {
+      return static_cast<const int64_t*> (_data);
+    }
+
+    const double*
+    reals () const noexcept
+    {
+      return static_cast<const double*> (_data);
+    }
+
+    const std::string_view*
+    texts () const noexcept
+    {
+      return _texts.data ();
+    }
+    /// \endcond
+
+  private:
+    Type                          _type;
+    const void*                   _data;
+    std::size_t                   _size;
+    std::vector<std::string_view> _texts;
+  };
+}
+
+#endif
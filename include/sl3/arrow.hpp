@@ -0,0 +1,284 @@
+/******************************************************************************
+ ------------- Copyright (c) 2009-2023 H a r a l d  A c h i t z ---------------
+ ---------- < h a r a l d dot a c h i t z at g m a i l dot c o m > ------------
+ ---- This Source Code Form is subject to the terms of the Mozilla Public -----
+ ---- License, v. 2.0. If a copy of the MPL was not distributed with this -----
+ ---------- file, You can obtain one at http://mozilla.org/MPL/2.0/. ----------
+ ******************************************************************************/
+
+#ifndef SL3_ARROW_HPP_
+#define SL3_ARROW_HPP_
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <vector>
+
+#include <sl3/command.hpp>
+#include <sl3/config.hpp>
+#include <sl3/dataset.hpp>
+#include <sl3/rowcallback.hpp>
+#include <sl3/types.hpp>
+
+// The Arrow C data interface, a stable ABI.
+// Definitions as in https://arrow.apache.org/docs/format/CDataInterface.html
+// so that no Arrow headers or libraries are needed.
+#ifndef ARROW_C_DATA_INTERFACE
+#define ARROW_C_DATA_INTERFACE
+
+#define ARROW_FLAG_DICTIONARY_ORDERED 1
+#define ARROW_FLAG_NULLABLE 2
+#define ARROW_FLAG_MAP_KEYS_SORTED 4
+
+extern "C"
+{
+  struct ArrowSchema
+  {
+    // Array type description
+    const char* format;
+    const char* name;
+    const char* metadata;
+    int64_t     flags;
+    int64_t     n_children;
+    struct ArrowSchema** children;
+    struct ArrowSchema*  dictionary;
+
+    // Release callback
+    void (*release) (struct ArrowSchema*);
+    // Opaque producer-specific data
+    void* private_data;
+  };
+
+  struct ArrowArray
+  {
+    // Array data description
+    int64_t              length;
+    int64_t              null_count;
+    int64_t              offset;
+    int64_t              n_buffers;
+    int64_t              n_children;
+    const void**         buffers;
+    struct ArrowArray**  children;
+    struct ArrowArray*   dictionary;
+
+    // Release callback
+    void (*release) (struct ArrowArray*);
+    // Opaque producer-specific data
+    void* private_data;
+  };
+}
+
+#endif // ARROW_C_DATA_INTERFACE
+
+namespace sl3
+{
+  namespace internal
+  {
+    class ArrowBatch;
+  }
+
+  /**
+   * \brief Receives an exported record batch
+   *
+   * The schema is a struct ("+s") with one child per column, the batch a
+   * struct array with one child array per column.
+   * The callback takes the ownership of both, and moves them, for
+   * example into arrow::ImportRecordBatch.
+   * If a release callback is still set when the callback returns,
+   * the structure is released by the exporter.
+   *
+   * Return false to stop the export.
+   */
+  using ArrowBatchCallback
+      = std::function<bool (ArrowSchema* schema, ArrowArray* batch)>;
+
+  /// default number of rows in an exported record batch
+  constexpr std::size_t defaultArrowBatchSize = 65536;
+
+  /**
+   * \brief A RowCallback that exports a query result as Arrow record batches
+   *
+   * Values are copied directly from the sqlite statement into the
+   * column buffers of the batch, which are handed over without a copy.
+   *
+   * Each column gets one Arrow type per result:
+   * Type::Int is int64 ("l"), Type::Real is float64 ("g"),
+   * Type::Text is utf8 ("u") and Type::Blob is binary ("z").
+   * For a Type::Variant column, or if no types are given, the type is
+   * taken from the declared column type, via the sqlite affinity rules,
+   * or, for expressions, from the storage type of the first row, utf8
+   * if that is Null.
+   * Values of other storage types are converted by sqlite.
+   *
+   * A batch ends early if its text or binary data would not fit 32 bit
+   * offsets.
+   *
+   * \code
+   *  ArrowExporter arrow{[&] (ArrowSchema* schema, ArrowArray* batch) {
+   *    batches.push_back (*arrow::ImportRecordBatch (batch, schema));
+   *    return true;
+   *  }};
+   *  db.execute ("SELECT * FROM t;", arrow);
+   * \endcode
+   */
+  class LIBSL3_API ArrowExporter : public RowCallback
+  {
+  public:
+    /**
+     * \brief Constructor
+     *
+     * \param callback receives the batches
+     * \param batchSize maximum rows per batch, at least 1
+     * \param types optional column types, one per result column
+     */
+    explicit ArrowExporter (ArrowBatchCallback callback,
+                            std::size_t batchSize = defaultArrowBatchSize,
+                            Types       types     = {});
+
+    ~ArrowExporter () override;
+
+    ArrowExporter (const ArrowExporter&)            = delete;
+    ArrowExporter& operator= (const ArrowExporter&) = delete;
+
+    /**
+     * \brief Exported rows
+     * \return number of rows exported so far
+     */
+    std::size_t rows () const noexcept;
+
+    /**
+     * \brief Exported batches
+     * \return number of batches exported so far
+     */
+    std::size_t batches () const noexcept;
+
+  protected:
+    /// starts a new result, column types are taken from the first row
+    void onStart () override;
+
+    /**
+     * \brief Append a row to the current batch
+     *
+     * \throw sl3::ErrTypeMisMatch if types were given and their size is
+     * not the column count
+     * \param columns the current row
+     * \return false if the batch callback wants to stop
+     */
+    bool onRow (Columns columns) override;
+
+    /// exports the last, partial, batch
+    void onEnd () override;
+
+  private:
+    bool emit ();
+
+    ArrowBatchCallback                   _callback;
+    std::size_t                          _batchSize;
+    Types                                _types;
+    std::unique_ptr<internal::ArrowBatch> _batch;
+    bool                                 _stopped = false;
+    std::size_t                          _rows    = 0;
+    std::size_t                          _batches = 0;
+  };
+
+  /**
+   * \brief Export a Dataset as Arrow record batches
+   *
+   * Types are as for ArrowExporter, a Type::Variant field is int64 if it
+   * has only integers, float64 if it has integers and reals, utf8 for
+   * text, binary for blobs or blobs and text, and utf8 if all values are
+   * Null.
+   *
+   * \throw sl3::ErrTypeMisMatch if a Type::Variant field has numbers
+   * and text or blobs, or if rows have different sizes
+   * \param ds the Dataset
+   * \param callback receives the batches, see ArrowBatchCallback
+   * \param batchSize maximum rows per batch, at least 1
+   * \return number of exported rows
+   */
+  LIBSL3_API std::size_t
+  exportArrow (const Dataset&            ds,
+               const ArrowBatchCallback& callback,
+               std::size_t               batchSize = defaultArrowBatchSize);
+
+  /**
+   * \brief Insert Arrow record batches via a command
+   *
+   * Binds the values of each row of a batch, without a copy, to the
+   * parameters of a command, like an INSERT, and executes it.
+   * Column buffers are read directly, one bind per value.
+   *
+   * Supported column formats are null ("n"), boolean ("b"),
+   * signed and unsigned integers up to 64 bit ("c", "C", "s", "S", "i",
+   * "I", "l", "L"), float32 and float64 ("f", "g"), utf8 and binary,
+   * also with 64 bit offsets ("u", "U", "z", "Z").
+   *
+   * The top level struct array is a record batch, it has no nulls.
+   * The importer does not take the ownership of schema or batches.
+   *
+   * \code
+   *  auto          cmd = db.prepare ("INSERT INTO t VALUES (?, ?);");
+   *  ArrowImporter arrow{cmd, &schema};
+   *  auto          trans = db.beginTransaction ();
+   *  arrow.insert (&batch);
+   *  trans.commit ();
+   * \endcode
+   */
+  class LIBSL3_API ArrowImporter
+  {
+  public:
+    /**
+     * \brief Constructor
+     *
+     * \throw sl3::ErrTypeMisMatch if the schema is not a struct with one
+     * child of a supported format per parameter of cmd
+     * \param cmd the command, must live as long as the importer
+     * \param schema the schema of the batches to insert
+     */
+    ArrowImporter (Command& cmd, const ArrowSchema* schema);
+
+    ArrowImporter (const ArrowImporter&)            = delete;
+    ArrowImporter& operator= (const ArrowImporter&) = delete;
+
+    /**
+     * \brief Insert all rows of a batch
+     *
+     * Consider a transaction around the import.
+     *
+     * \throw sl3::ErrTypeMisMatch if the batch does not fit the schema
+     * \throw sl3::ErrOutOfRange for an unsigned 64 bit value that does
+     * not fit into an int64_t
+     * \throw sl3::SQLite3Error if executing the command fails
+     * \param batch a struct array of the schema
+     * \return number of inserted rows
+     */
+    std::size_t insert (const ArrowArray* batch);
+
+  private:
+    enum class Kind
+    {
+      Null,
+      Bool,
+      Int8,
+      UInt8,
+      Int16,
+      UInt16,
+      Int32,
+      UInt32,
+      Int64,
+      UInt64,
+      Float,
+      Double,
+      Text,
+      LargeText,
+      Binary,
+      LargeBinary
+    };
+
+    Command&          _cmd;
+    std::vector<Kind> _kinds;
+  };
+}
+
+#endif
@@ -0,0 +1,118 @@
+/******************************************************************************
+ ------------- Copyright (c) 2009-2023 H a r a l d  A c h i t z ---------------
+ ---------- < h a r a l d dot a c h i t z at g m a i l dot c o m > ------------
+ ---- This Source Code Form is subject to the terms of the Mozilla Public -----
+ ---- License, v. 2.0. If a copy of the MPL was not distributed with this -----
+ ---------- file, You can obtain one at http://mozilla.org/MPL/2.0/. ----------
+ ******************************************************************************/
+
+#ifndef SL3_BUSY_HPP_
+#define SL3_BUSY_HPP_
+
+#include <chrono>
+#include <cstdint>
+#include <functional>
+
+#include <sl3/config.hpp>
+
+namespace sl3
+{
+  class Database;
+
+  /**
+   * \brief Lock contention counters of a Database
+   *
+   * \sa Database::busyStats
+   */
+  struct BusyStats
+  {
+    /// lock attempts that found the database locked
+    uint64_t contentions = 0;
+    /// retries after waiting
+    uint64_t retries = 0;
+    /// contentions given up, they failed with SQLITE_BUSY
+    uint64_t failures = 0;
+    /// time spent waiting for locks
+    std::chrono::nanoseconds waited{0};
+  };
+
+  /**
+   * \brief Custom busy handler
+   *
+   * Called when a lock attempt finds the database locked, with the
+   * number of previous calls for the same lock attempt.
+   * The handler waits, and returns true to retry, or returns false to
+   * give up, the statement fails with SQLITE_BUSY.
+   *
+   * The handler runs inside sqlite and must not use the connection.
+   * An exception counts as false.
+   */
+  using BusyHandler = std::function<bool (int retries)>;
+
+  /**
+   * \brief How a Database waits for locks of other connections
+   *
+   * \sa Database::setBusyPolicy
+   */
+  class LIBSL3_API BusyPolicy
+  {
+  public:
+    /**
+     * \brief No waiting, the default of sqlite
+     *
+     * Lock attempts fail immediately with SQLITE_BUSY.
+     */
+    BusyPolicy () = default;
+
+    /**
+     * \brief Wait up to timeout, like sqlite3_busy_timeout
+     *
+     * Retries with delays that grow from 1 to 100 milliseconds.
+     *
+     * \param timeout the maximum wait per lock attempt
+     * \throw sl3::ErrOutOfRange if timeout is negative
+     * \return the policy
+     */
+    static BusyPolicy timeout (std::chrono::milliseconds timeout);
+
+    /**
+     * \brief Wait up to timeout with exponential backoff and jitter
+     *
+     * The n-th retry waits initial * 2^n, at most maximum, reduced by a
+     * random part of up to jitter of that delay, so that competing
+     * connections do not retry in lockstep.
+     *
+     * \param timeout the maximum wait per lock attempt
+     * \param initial the first delay
+     * \param maximum the longest delay
+     * \param jitter random part of a delay, from 0 to 1
+     * \throw sl3::ErrOutOfRange if a duration is negative, initial is 0,
+     * maximum is less than initial or jitter is not between 0 and 1
+     * \return the policy
+     */
+    static BusyPolicy
+    backoff (std::chrono::milliseconds timeout,
+             std::chrono::microseconds initial = std::chrono::milliseconds{1},
+             std::chrono::microseconds maximum
+             = std::chrono::milliseconds{100},
+             double jitter = 0.5);
+
+    /**
+     * \brief Use a custom handler
+     *
+     * \param handler decides if a lock attempt is retried
+     * \throw sl3::ErrOutOfRange if handler is empty
+     * \return the policy
+     */
+    static BusyPolicy custom (BusyHandler handler);
+
+  private:
+    friend class Database;
+
+    explicit BusyPolicy (BusyHandler handler);
+
+    BusyHandler _handler;
+  };
+}
+
+#endif
@@ -0,0 +1,62 @@
+/******************************************************************************
+ ------------- Copyright (c) 2009-2023 H a r a l d  A c h i t z ---------------
+ ---------- < h a r a l d dot a c h i t z at g m a i l dot c o m > ------------
+ ---- This Source Code Form is subject to the terms of the Mozilla Public -----
+ ---- License, v. 2.0. If a copy of the MPL was not distributed with this -----
+ ---------- file, You can obtain one at http://mozilla.org/MPL/2.0/. ----------
+ ******************************************************************************/
+
+#ifndef SL3_CANCELLATION_HPP_
+#define SL3_CANCELLATION_HPP_
+
+#include <memory>
+
+#include <sl3/config.hpp>
+
+namespace sl3
+{
+  class Database;
+
+  namespace internal
+  {
+    class CancelState;
+  }
+
+  /**
+   * \brief Thread safe flag to cancel running statements
+   *
+   * Copies share the same flag. A token is passed to
+   * Database::limitExecution, and cancel, called from any thread,
+   * interrupts the statements that run under that limit, they fail
+   * with ErrInterrupted.
+   *
+   * A cancelled token stays cancelled.
+   */
+  class LIBSL3_API CancellationToken
+  {
+  public:
+    /**
+     * \brief Create a token that is not cancelled
+     */
+    CancellationToken ();
+
+    /**
+     * \brief Cancel the statements that run with this token
+     *
+     * Can be called from any thread.
+     */
+    void cancel () noexcept;
+
+    /**
+     * \brief If cancel was called
+     * \return true if cancelled
+     */
+    bool isCancelled () const noexcept;
+
+  private:
+    friend class Database;
+    std::shared_ptr<internal::CancelState> _state;
+  };
+}
+
+#endif
@@ -0,0 +1,112 @@
+/******************************************************************************
+ ------------- Copyright (c) 2009-2023 H a r a l d  A c h i t z ---------------
+ ---------- < h a r a l d dot a c h i t z at g m a i l dot c o m > ------------
+ ---- This Source Code Form is subject to the terms of the Mozilla Public -----
+ ---- License, v. 2.0. If a copy of the MPL was not distributed with this -----
+ ---------- file, You can obtain one at http://mozilla.org/MPL/2.0/. ----------
+ ******************************************************************************/
+
+#ifndef SL3_CHANGES_HPP_
+#define SL3_CHANGES_HPP_
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+#include <sl3/config.hpp>
+
+namespace sl3
+{
+  /**
+   * \brief Kind of a row change
+   */
+  enum class ChangeOp
+  {
+    Insert, //!< a row was inserted
+    Update, //!< a row was updated
+    Delete  //!< a row was deleted
+  };
+
+  /**
+   * \brief A changed row
+   */
+  struct RowChange
+  {
+    ChangeOp op;    ///< kind of the change
+    int64_t  rowid; ///< rowid of the changed row
+  };
+
+  /**
+   * \brief The changed rows of one table
+   */
+  struct TableChanges
+  {
+    std::string            database; ///< database name, like main or temp
+    std::string            table;    ///< table name
+    std::vector<RowChange> rows;     ///< changed rows, in order
+  };
+
+  /**
+   * \brief The changes of a committed transaction, grouped by table
+   *
+   * May contain rows that were rolled back to a savepoint, or that were
+   * changed by a statement that failed within the transaction.
+   * sqlite does not report such partial rollbacks.
+   */
+  using ChangeBatch = std::vector<TableChanges>;
+
+  /**
+   * \brief Identifies a hook registered at a Database
+   */
+  using HookId = std::size_t;
+
+  /**
+   * \brief Receives the changes of each committed transaction
+   *
+   * Called from the commit hook of sqlite, after the commit handlers
+   * agreed, but before the commit is durable, a commit can still fail
+   * afterwards, for example with an I/O error.
+   * The handler must not use the connection. Exceptions are ignored,
+   * an observer can not turn a commit into a rollback.
+   */
+  using ChangeHandler = std::function<void (const ChangeBatch&)>;
+
+  /**
+   * \brief Called when a transaction commits
+   *
+   * Returning false turns the commit into a rollback.
+   */
+  using CommitHandler = std::function<bool ()>;
+
+  /**
+   * \brief Called when a transaction rolls back
+   */
+  using RollbackHandler = std::function<void ()>;
+
+  /**
+   * \brief Called after a commit in WAL mode
+   *
+   * Gets the database name and the number of pages in the write ahead log.
+   */
+  using WalHandler = std::function<void (const std::string& database,
+                                         int                pages)>;
+
+  /**
+   * \brief Authorizes actions while a statement is prepared
+   *
+   * Gets the action code and the arguments of sqlite3_set_authorizer,
+   * the database name and the inner most trigger or view, arguments can
+   * be null. Returns SQLITE_OK, SQLITE_DENY or SQLITE_IGNORE.
+   *
+   * \sa https://www.sqlite.org/c3ref/set_authorizer.html
+   */
+  using Authorizer = std::function<int (int         action,
+                                        const char* arg1,
+                                        const char* arg2,
+                                        const char* database,
+                                        const char* trigger)>;
+}
+
+#endif
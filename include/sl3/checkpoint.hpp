@@ -0,0 +1,162 @@
+/******************************************************************************
+ ------------- Copyright (c) 2009-2023 H a r a l d  A c h i t z ---------------
+ ---------- < h a r a l d dot a c h i t z at g m a i l dot c o m > ------------
+ ---- This Source Code Form is subject to the terms of the Mozilla Public -----
+ ---- License, v. 2.0. If a copy of the MPL was not distributed with this -----
+ ---------- file, You can obtain one at http://mozilla.org/MPL/2.0/. ----------
+ ******************************************************************************/
+
+#ifndef SL3_CHECKPOINT_HPP_
+#define SL3_CHECKPOINT_HPP_
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+#include <sl3/config.hpp>
+
+namespace sl3
+{
+  class Database;
+
+  namespace internal
+  {
+    class CheckpointState;
+  }
+
+  /**
+   * \brief Modes of sqlite3_wal_checkpoint_v2
+   */
+  enum class CheckpointMode
+  {
+    Passive,  ///< copy what is possible, without waiting
+    Full,     ///< wait for writers, then copy all frames
+    Restart,  ///< like Full, and wait until readers do not use the WAL
+    Truncate, ///< like Restart, and truncate the WAL file
+  };
+
+  /**
+   * \brief Result of Database::checkpoint
+   */
+  struct CheckpointResult
+  {
+    /// frames in the WAL
+    int walFrames = 0;
+    /// frames of the WAL that are checkpointed
+    int checkpointed = 0;
+    /// if a Full, Restart or Truncate checkpoint could not complete
+    bool busy = false;
+  };
+
+  /**
+   * \brief When a CheckpointScheduler checkpoints
+   */
+  struct CheckpointPolicy
+  {
+    /// checkpoint when this many frames are not checkpointed
+    int walPages = 1000;
+    /// mode of these checkpoints
+    CheckpointMode mode = CheckpointMode::Passive;
+
+    /// checkpoint when there was no commit for this time, 0 to disable
+    std::chrono::milliseconds idle{1000};
+    /// mode of idle checkpoints
+    CheckpointMode idleMode = CheckpointMode::Truncate;
+
+    /// escalate when readers keep this many frames from a checkpoint
+    int readerLagPages = 4000;
+    /// escalate when the WAL has this many frames
+    int maxWalPages = 10000;
+    /// mode of escalated checkpoints
+    CheckpointMode lagMode = CheckpointMode::Restart;
+
+    /// how long Full, Restart and Truncate checkpoints wait for locks
+    std::chrono::milliseconds lockTimeout{1000};
+  };
+
+  /**
+   * \brief Counters of a CheckpointScheduler
+   */
+  struct CheckpointStats
+  {
+    uint64_t checkpoints  = 0; ///< checkpoints run
+    uint64_t escalations  = 0; ///< checkpoints with CheckpointPolicy::lagMode
+    uint64_t busy         = 0; ///< checkpoints that could not complete
+    uint64_t failures     = 0; ///< checkpoints that failed with an error
+    uint64_t framesCopied = 0; ///< frames copied into the database
+    int      walFrames    = 0; ///< frames in the WAL after the last run
+    int      readerLag    = 0; ///< frames not checkpointed after the last run
+    std::chrono::nanoseconds total{0};   ///< time of all checkpoints
+    std::chrono::nanoseconds last{0};    ///< time of the last checkpoint
+    std::chrono::nanoseconds longest{0}; ///< time of the longest checkpoint
+  };
+
+  /**
+   * \brief Runs the WAL checkpoints of a database in the background
+   *
+   * Instead of the auto checkpoint, that runs in the writer that crosses
+   * 1000 WAL pages, a background thread with its own connection
+   * checkpoints, so commits do not absorb checkpoint stalls.
+   *
+   * The scheduler learns about commits of the database it was created
+   * with via its WAL hook, commits of other connections are seen at the
+   * next commit of that database or when it is idle.
+   * While the scheduler exists, the database has no auto checkpoint,
+   * the database must outlive the scheduler.
+   *
+   * \code
+   *  sl3::Database db{"data.db"};
+   *  db.execute ("PRAGMA journal_mode = WAL;");
+   *  sl3::CheckpointScheduler checkpoints{db};
+   *  ...
+   *  const auto stats = checkpoints.stats ();
+   * \endcode
+   */
+  class LIBSL3_API CheckpointScheduler
+  {
+  public:
+    /**
+     * \brief Constructor, starts the background thread
+     *
+     * \param db a database in WAL mode
+     * \param policy when to checkpoint
+     * \throw sl3::ErrNoConnection if db has no file, like an in memory
+     * database
+     * \throw sl3::ErrOutOfRange if a policy value is negative or
+     * walPages is 0
+     * \throw sl3::SQLite3Error if the connection can not be opened
+     */
+    explicit CheckpointScheduler (Database&        db,
+                                  CheckpointPolicy policy = CheckpointPolicy{});
+
+    CheckpointScheduler (const CheckpointScheduler&)            = delete;
+    CheckpointScheduler& operator= (const CheckpointScheduler&) = delete;
+    CheckpointScheduler& operator= (CheckpointScheduler&&)      = delete;
+
+    /**
+     * \brief Move constructor
+     */
+    CheckpointScheduler (CheckpointScheduler&&) noexcept;
+
+    /**
+     * \brief Destructor
+     *
+     * Stops the background thread and restores the auto checkpoint.
+     */
+    ~CheckpointScheduler ();
+
+    /**
+     * \brief Get the counters
+     * \return a copy of the counters
+     */
+    CheckpointStats stats () const;
+
+  private:
+    Database*                                  _db;
+    std::size_t                                _hook;
+    std::unique_ptr<internal::CheckpointState> _state;
+  };
+}
+
+#endif
@@ -0,0 +1,125 @@
+/******************************************************************************
+ ------------- Copyright (c) 2009-2023 H a r a l d  A c h i t z ---------------
+ ---------- < h a r a l d dot a c h i t z at g m a i l dot c o m > ------------
+ ---- This Source Code Form is subject to the terms of the Mozilla Public -----
+ ---- License, v. 2.0. If a copy of the MPL was not distributed with this -----
+ ---------- file, You can obtain one at http://mozilla.org/MPL/2.0/. ----------
+ ******************************************************************************/
+
+#ifndef SL3_COLLATION_HPP_
+#define SL3_COLLATION_HPP_
+
+#include <cstddef>
+#include <string_view>
+#include <type_traits>
+
+#include <sl3/config.hpp>
+
+namespace sl3
+{
+  /**
+   * \brief Comparators for Database::createCollation
+   *
+   * All comparators return a negative value, zero or a positive value
+   * if the first text is less, equal or greater than the second, and
+   * define a consistent order, as required for indexes.
+   */
+  namespace collation
+  {
+    /**
+     * \brief Natural order, numbers in texts compare by their value
+     *
+     * Runs of ASCII digits compare numerically, so "file9" sorts before
+     * "file10", everything else compares byte-wise.
+     * Texts that differ only by leading zeros compare byte-wise.
+     *
+     * \param a first text
+     * \param b second text
+     * \return comparison result
+     */
+    LIBSL3_API int natural (std::string_view a, std::string_view b) noexcept;
+
+    /**
+     * \brief ASCII case-insensitive order
+     *
+     * A to Z compare like a to z, other bytes compare byte-wise.
+     *
+     * \param a first text
+     * \param b second text
+     * \return comparison result
+     */
+    LIBSL3_API int asciiNoCase (std::string_view a,
+                                std::string_view b) noexcept;
+
+    /**
+     * \brief Byte-wise order of a prefix
+     *
+     * Only the first length bytes compare, texts with the same prefix
+     * are equal.
+     */
+    struct LIBSL3_API Prefix
+    {
+      /// number of bytes that compare
+      std::size_t length;
+
+      /**
+       * \brief compare the prefixes
+       * \param a first text
+       * \param b second text
+       * \return comparison result
+       */
+      int operator() (std::string_view a, std::string_view b) const noexcept;
+    };
+  }
+
+  /// \cond HIDDEN_SYMBOLS
+  namespace internal
+  {
+    /**
+     * \internal
+     * \brief Adapts a comparator callable to the sqlite collation callback
+     *
+     * The callable returns an int like strcmp, or a bool for less than.
+     */
+    template <typename Fn> struct CollationFunction
+    {
+      static int
+      compare (const Fn& fn, std::string_view a, std::string_view b)
+      {
+        using R = decltype (fn (a, b));
+        if constexpr (std::is_same_v<R, bool>)
+          return fn (a, b) ? -1 : (fn (b, a) ? 1 : 0);
+        else
+          return static_cast<int> (fn (a, b));
+      }
+
+      static int
+      call (void* data, int na, const void* a, int nb, const void* b)
+      {
+        try
+          {
+            return compare (
+                *static_cast<const Fn*> (data),
+                std::string_view{static_cast<const char*> (a),
+                                 static_cast<std::size_t> (na)},
+                std::string_view{static_cast<const char*> (b),
+                                 static_cast<std::size_t> (nb)});
+          }
+        catch (...) // LCOV_EXCL_LINE
+          {
+            // can not be reported from here
+            return 0; // LCOV_EXCL_LINE
+          }
+      }
+
+      static void
+      destroy (void* data)
+      {
+        delete static_cast<Fn*> (data);
+      }
+    };
+  }
+  /// \endcond
+}
+
+#endif
@@ -9,12 +9,20 @@
 #ifndef SL3_SQLCOMMAND_HPP
 #define SL3_SQLCOMMAND_HPP
 
+#include <cstdint>
+#include <map>
 #include <memory>
 #include <string>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+#include <vector>
 
+#include <sl3/array.hpp>
 #include <sl3/config.hpp>
 #include <sl3/dataset.hpp>
 #include <sl3/dbvalue.hpp>
+#include <sl3/paramview.hpp>
 #include <sl3/rowcallback.hpp>
 
 struct sqlite3;
@@ -28,6 +36,58 @@ namespace sl3
     class Connection;
   }
 
+  /**
+   * \brief A typed handle to a named parameter of a Command
+   *
+   * Created by Command::parameter, it holds the parameter index that was
+   * resolved once, so Command::bind with a handle needs no name lookup.
+   * The value type is checked at compile time.
+   *
+   * \code
+   *  auto cmd  = db.prepare ("SELECT * FROM t WHERE id = :id;");
+   *  auto id   = cmd.parameter<int64_t> (":id");
+   *  cmd.bind (id, 42);
+   *  auto rows = cmd.select ();
+   * \endcode
+   *
+   * A handle is only valid for the command that created it.
+   *
+   * \tparam T the value type, one of int64_t, double, std::string or Blob
+   */
+  template <typename T> class ParameterHandle
+  {
+    static_assert (std::is_same<T, int64_t>::value
+                       || std::is_same<T, double>::value
+                       || std::is_same<T, std::string>::value
+                       || std::is_same<T, Blob>::value,
+                   "parameter type must be int64_t, double, std::string"
+                   " or Blob");
+
+  public:
+    /// the value type
+    using value_type = T;
+
+    /**
+     * \brief The parameter index, like for Command::getParameter
+     * \return the index
+     */
+    int
+    index () const noexcept
+    {
+      return _index;
+    }
+
+  private:
+    friend class Command;
+
+    explicit ParameterHandle (int index) noexcept
+    : _index (index)
+    {
+    }
+
+    int _index;
+  };
+
   /**
    * \brief A compiled SQL command
    *
@@ -39,6 +99,9 @@ namespace sl3
   class LIBSL3_API Command
   {
     friend class Database;
+    friend class ArrowImporter;
+    friend class CsvReader;
+    friend class ResultCache;
     using Connection = std::shared_ptr<internal::Connection>;
 
     Command (Connection connection, const std::string& sql);
@@ -165,6 +228,39 @@ namespace sl3
      */
     void execute (Callback cb, const DbValues& parameters = {});
 
+    /**
+     * \brief Execute the command with borrowed parameters
+     *
+     * Binds all parameters from the view, texts and blobs without a
+     * copy, for this execution only. getParameters is not changed.
+     *
+     * \throw sl3::ErrTypeMisMatch if the number of values differs from
+     * the number of parameters
+     * \param parameters the parameter values
+     */
+    void execute (const ParamView& parameters);
+
+    /**
+     * \brief Execute the command with borrowed parameters and a callback
+     *
+     * \throw sl3::ErrTypeMisMatch if the number of values differs from
+     * the number of parameters
+     * \param cb a callback
+     * \param parameters the parameter values
+     */
+    void execute (Callback cb, const ParamView& parameters);
+
+    /**
+     * \brief Run the command with borrowed parameters and get the result
+     *
+     * \throw sl3::ErrTypeMisMatch if the number of values differs from
+     * the number of parameters, or if types are invalid
+     * \param parameters the parameter values
+     * \param types Types the Dataset shall use
+     * \return A Dataset containing the query result
+     */
+    Dataset select (const ParamView& parameters, const Types& types = {});
+
     /**
      * \brief Parameters of command.
      *
@@ -231,12 +327,149 @@ namespace sl3
      *
      * \return list of names
      */
-    std::vector<std::string> getParameterNames () const;
+    const std::vector<std::string>& getParameterNames () const;
+
+    /**
+     * \brief Index of a named parameter
+     *
+     * The names are resolved once when the command is prepared.
+     * A name includes its prefix, like \c :id, \c \@id or \c $id.
+     *
+     * \param name the parameter name
+     * \throw sl3::ErrOutOfRange if there is no parameter with this name
+     * \return the index, like for getParameter
+     */
+    int getParameterIndex (std::string_view name) const;
+
+    /**
+     * \brief get a named Parameter
+     * \param name the parameter name, including its prefix
+     * \throw sl3::ErrOutOfRange if there is no parameter with this name
+     * \return reference to the parameter
+     */
+    DbValue& getParameter (std::string_view name);
+
+    /**
+     * \brief get a named Parameter
+     * \param name the parameter name, including its prefix
+     * \throw sl3::ErrOutOfRange if there is no parameter with this name
+     * \return const reference to the parameter
+     */
+    const DbValue& getParameter (std::string_view name) const;
+
+    /**
+     * \brief Set the value of a named parameter
+     *
+     * Same as assigning the value to getParameter(name).
+     *
+     * \code
+     *  cmd.bind (":id", 42);
+     * \endcode
+     *
+     * \tparam T a type that can be assigned to a DbValue
+     * \param name the parameter name, including its prefix
+     * \param value the new value
+     * \throw sl3::ErrOutOfRange if there is no parameter with this name
+     * \throw sl3::ErrTypeMisMatch if the value does not fit the parameter
+     */
+    template <typename T>
+    void
+    bind (std::string_view name, const T& value)
+    {
+      getParameter (name) = value;
+    }
+
+    /**
+     * \brief Typed handle to a named parameter
+     *
+     * \tparam T the value type, one of int64_t, double, std::string or Blob
+     * \param name the parameter name, including its prefix
+     * \throw sl3::ErrOutOfRange if there is no parameter with this name
+     * \throw sl3::ErrTypeMisMatch if the parameter can not hold a T
+     * \return a handle for bind
+     */
+    template <typename T>
+    ParameterHandle<T>
+    parameter (std::string_view name) const
+    {
+      const int idx = getParameterIndex (name);
+      ensureParameterType (idx, typeOf<T> ());
+      return ParameterHandle<T>{idx};
+    }
+
+    /**
+     * \brief Set the value of a parameter by its handle
+     *
+     * \param handle a handle from parameter
+     * \param value the new value
+     * \throw sl3::ErrOutOfRange if the handle is not from this command
+     */
+    template <typename T>
+    void
+    bind (const ParameterHandle<T>&                     handle,
+          const typename ParameterHandle<T>::value_type& value)
+    {
+      getParameter (handle.index ()).set (value);
+    }
+
+    /**
+     * \brief Bind a list of values to a parameter
+     *
+     * The parameter is used as argument of the sl3_array table valued
+     * function, for example
+     * \code
+     *   SELECT * FROM t WHERE id IN sl3_array (?);
+     * \endcode
+     * so that one prepared statement serves lists of any length.
+     *
+     * The list is bound on each execution, instead of the value in
+     * getParameters, until clearArrays is called.
+     * The values are not copied and must outlive the executions.
+     *
+     * \throw sl3::ErrOutOfRange if idx is not a valid parameter index
+     * \param idx parameter index, like for getParameter
+     * \param values the list
+     */
+    void bindArray (int idx, ArrayParameter values);
+
+    /**
+     * \brief Remove all lists bound with bindArray
+     */
+    void clearArrays () noexcept;
 
   private:
-    Connection    _connection;
-    sqlite3_stmt* _stmt;
-    DbValues      _parameters;
+    /// steps through the bound statement, resets it afterwards
+    void run (const Callback& callback);
+
+    /// a callback that appends the rows to ds
+    static Callback fillDataset (Dataset& ds);
+
+    template <typename T>
+    static constexpr Type
+    typeOf () noexcept
+    {
+      if constexpr (std::is_same<T, int64_t>::value)
+        return Type::Int;
+      else if constexpr (std::is_same<T, double>::value)
+        return Type::Real;
+      else if constexpr (std::is_same<T, std::string>::value)
+        return Type::Text;
+      else
+        return Type::Blob;
+    }
+
+    /// throws ErrTypeMisMatch if the parameter at idx can not hold type
+    void ensureParameterType (int idx, Type type) const;
+
+    using ParameterIndex = std::map<std::string, int, std::less<>>;
+
+    Connection               _connection;
+    sqlite3_stmt*            _stmt;
+    DbValues                 _parameters;
+    std::vector<std::string> _parameterNames;
+    ParameterIndex           _parameterIndex;
+
+    std::vector<std::pair<std::size_t, ArrayParameter>> _arrays;
   };
 
   // Branch coverage for that is a nightmare,
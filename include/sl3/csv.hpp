@@ -0,0 +1,243 @@
+/******************************************************************************
+ ------------- Copyright (c) 2009-2023 H a r a l d  A c h i t z ---------------
+ ---------- < h a r a l d dot a c h i t z at g m a i l dot c o m > ------------
+ ---- This Source Code Form is subject to the terms of the Mozilla Public -----
+ ---- License, v. 2.0. If a copy of the MPL was not distributed with this -----
+ ---------- file, You can obtain one at http://mozilla.org/MPL/2.0/. ----------
+ ******************************************************************************/
+
+#ifndef SL3_CSV_HPP_
+#define SL3_CSV_HPP_
+
+#include <cstddef>
+#include <iosfwd>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <sl3/command.hpp>
+#include <sl3/config.hpp>
+#include <sl3/rowcallback.hpp>
+
+namespace sl3
+{
+  namespace internal
+  {
+    class BufferedOutput;
+  }
+
+  /**
+   * \brief Format of CSV data for CsvReader and CsvWriter
+   */
+  struct CsvFormat
+  {
+    char delimiter = ','; ///< field separator
+    char quote     = '"'; ///< quote character, doubled inside quotes
+    bool header    = true; ///< the first record has the field names
+    /**
+     * \brief Null handling
+     *
+     * If true, an unquoted empty field is a Null value, and the writer
+     * writes Null as empty field and an empty text as "".
+     * Otherwise empty fields are empty text.
+     */
+    bool emptyIsNull = true;
+  };
+
+  /**
+   * \brief Streaming CSV parser
+   *
+   * Reads the input in large blocks and parses it in place.
+   * Fields of the current record are views into the block buffer, valid
+   * until the next call of next().
+   *
+   * Records end at \\n, a \\r before it is removed. Quoted fields can
+   * contain delimiters, line breaks and doubled quote characters.
+   * Empty lines are skipped.
+   *
+   * \code
+   *  std::ifstream in{"data.csv", std::ios::binary};
+   *  CsvReader     csv{in};
+   *  auto          cmd = db.prepare ("INSERT INTO t VALUES (?, ?, ?);");
+   *  auto          trans = db.beginTransaction ();
+   *  csv.importInto (cmd);
+   *  trans.commit ();
+   * \endcode
+   */
+  class LIBSL3_API CsvReader
+  {
+  public:
+    /**
+     * \brief Constructor
+     *
+     * Reads the header record if the format has one.
+     *
+     * \param in input stream, should be opened in binary mode
+     * \param format the CSV format
+     * \param blockSize initial size of the read buffer, grows if a
+     * record does not fit
+     */
+    explicit CsvReader (std::istream& in,
+                        CsvFormat     format    = {},
+                        std::size_t   blockSize = std::size_t{1} << 20);
+
+    CsvReader (const CsvReader&)            = delete;
+    CsvReader& operator= (const CsvReader&) = delete;
+
+    /**
+     * \brief Parse the next record
+     *
+     * \throw sl3::ErrTypeMisMatch for an unterminated quoted field
+     * \return false if there are no more records
+     */
+    bool next ();
+
+    /**
+     * \brief Field count of the current record
+     * \return number of fields
+     */
+    std::size_t size () const noexcept;
+
+    /**
+     * \brief Access a field of the current record, unchecked
+     *
+     * \param idx field index
+     * \return view to the field content
+     */
+    std::string_view operator[] (std::size_t idx) const noexcept;
+
+    /**
+     * \brief Check if a field is Null
+     *
+     * \param idx field index
+     * \return true for an unquoted empty field if CsvFormat::emptyIsNull
+     */
+    bool isNull (std::size_t idx) const noexcept;
+
+    /**
+     * \brief The field names of the header record
+     * \return the names, empty if the format has no header
+     */
+    const std::vector<std::string>& header () const noexcept;
+
+    /**
+     * \brief Line number where the current record starts, 1 based
+     * \return line number
+     */
+    std::size_t line () const noexcept;
+
+    /**
+     * \brief Insert all remaining records via a command
+     *
+     * Binds the fields of each record as text, without a copy, to the
+     * parameters of cmd and executes it.
+     * Consider a transaction around the import.
+     *
+     * \throw sl3::ErrTypeMisMatch if a record has not as many fields as
+     * cmd has parameters
+     * \throw sl3::SQLite3Error if executing the command fails
+     * \param cmd a command, like an INSERT, with one parameter per field
+     * \return number of imported records
+     */
+    std::size_t importInto (Command& cmd);
+
+  private:
+    struct Field
+    {
+      const char* data;
+      std::size_t size;
+      bool        null;
+    };
+
+    bool        fill ();
+    const char* findRecordEnd (const char* first) const;
+    void        parseRecord (char* first, char* last);
+
+    std::istream&            _in;
+    CsvFormat                _format;
+    std::vector<char>        _buffer;
+    std::size_t              _pos = 0;
+    std::size_t              _end = 0;
+    bool                     _eof = false;
+    std::size_t              _line     = 0;
+    std::size_t              _nextLine = 1;
+    std::vector<Field>       _fields;
+    std::vector<std::string> _header;
+  };
+
+  /**
+   * \brief A RowCallback that writes a query result as CSV
+   *
+   * Values are formatted directly from the sqlite statement, numbers via
+   * std::to_chars, into a buffer. Full buffers are written by a
+   * background thread while the next buffer is filled.
+   * Blobs are written as hex digits.
+   *
+   * The header is written with the first row, if the format has one.
+   *
+   * \code
+   *  std::ofstream out{"data.csv", std::ios::binary};
+   *  CsvWriter     csv{out};
+   *  db.execute ("SELECT * FROM t;", csv);
+   * \endcode
+   */
+  class LIBSL3_API CsvWriter : public RowCallback
+  {
+  public:
+    /**
+     * \brief Constructor
+     * \param out output stream
+     * \param format the CSV format
+     * \param bufferSize size of each of the 2 output buffers
+     */
+    explicit CsvWriter (std::ostream& out,
+                        CsvFormat     format     = {},
+                        std::size_t   bufferSize = std::size_t{1} << 20);
+
+    /**
+     * \brief Destructor
+     *
+     * Writes buffered data, errors are ignored, call flush to see them.
+     */
+    ~CsvWriter () override;
+
+    CsvWriter (const CsvWriter&)            = delete;
+    CsvWriter& operator= (const CsvWriter&) = delete;
+
+    /**
+     * \brief Write all buffered data to the stream
+     *
+     * \throw sl3::ErrUnexpected if writing to the stream failed
+     */
+    void flush ();
+
+    /**
+     * \brief Written rows
+     * \return number of rows written so far, without the header
+     */
+    std::size_t rows () const noexcept;
+
+  protected:
+    /// starts a new result, the next row writes the header
+    void onStart () override;
+
+    /**
+     * \brief Write a row
+     * \param columns the current row
+     * \return true
+     */
+    bool onRow (Columns columns) override;
+
+    /// flushes the buffered data
+    void onEnd () override;
+
+  private:
+    CsvFormat                                _format;
+    std::unique_ptr<internal::BufferedOutput> _out;
+    bool                                     _headerDone = false;
+    std::size_t                              _rows       = 0;
+  };
+}
+
+#endif
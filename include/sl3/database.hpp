@@ -9,13 +9,22 @@
 #ifndef SL3_DATABASE_HPP_
 #define SL3_DATABASE_HPP_
 
+#include <chrono>
 #include <memory>
 #include <string>
 
+#include <sl3/busy.hpp>
+#include <sl3/cancellation.hpp>
+#include <sl3/changes.hpp>
+#include <sl3/checkpoint.hpp>
+#include <sl3/collation.hpp>
 #include <sl3/command.hpp>
 #include <sl3/config.hpp>
 #include <sl3/dataset.hpp>
 #include <sl3/dbvalue.hpp>
+#include <sl3/function.hpp>
+#include <sl3/iostats.hpp>
+#include <sl3/vtab.hpp>
 
 struct sqlite3;
 
@@ -41,6 +50,8 @@ namespace sl3
    */
   class LIBSL3_API Database
   {
+    friend class ResultCache;
+
   public:
     Database (const Database&)            = delete;
     Database& operator= (const Database&) = delete;
@@ -70,6 +81,20 @@ namespace sl3
      */
     explicit Database (const std::string& name, int openFlags = 0);
 
+    /**
+     * \brief Constructor, opens the database with a VFS
+     *
+     * Like Database (const std::string&, int), the database is opened
+     * with the sqlite VFS vfs, for example ioStatsVfs or a slowIoVfs.
+     *
+     * \param name database name
+     * \param openFlags sqlite open flags, 0 for the defaults
+     * \param vfs name of a registered VFS, empty for the default VFS
+     *
+     * \throw sl3::SQLite3Error if the database can not be opened
+     */
+    Database (const std::string& name, int openFlags, const std::string& vfs);
+
     /**
      * \brief Destructor.
      */
@@ -270,6 +295,86 @@ namespace sl3
      */
     int64_t getLastInsertRowid ();
 
+    /**
+     * \brief Returns the file name of the main database
+     *
+     * \return the absolute file name, or an empty string for an in memory
+     * or temporary database
+     */
+    std::string getFileName ();
+
+    /**
+     * \brief I/O counters of this connection
+     *
+     * The counters of the reads, writes and syncs of the main database
+     * file, its journal and WAL, if the database was opened with
+     * ioStatsVfs or a slowIoVfs, otherwise all counters are zero.
+     *
+     * \throw sl3::ErrNoConnection if the database is closed
+     * \return a copy of the counters
+     */
+    IoStats ioStats ();
+
+    /**
+     * \brief Set the I/O counters of this connection to zero
+     *
+     * \throw sl3::ErrNoConnection if the database is closed
+     */
+    void resetIoStats ();
+
+    /**
+     * \brief Set how this connection waits for locks
+     *
+     * The policy applies to all statements of the connection, including
+     * BEGIN and COMMIT. Lock contention is counted, see busyStats, from
+     * the first call on, also with the default policy that does not wait.
+     *
+     * A busy_timeout pragma replaces the policy and stops the counting.
+     *
+     * \code
+     *  db.setBusyPolicy (sl3::BusyPolicy::backoff (
+     *      std::chrono::seconds{2}, std::chrono::milliseconds{1}));
+     * \endcode
+     *
+     * \param policy the busy policy
+     * \throw sl3::ErrNoConnection if the database is closed
+     */
+    void setBusyPolicy (BusyPolicy policy);
+
+    /**
+     * \brief Get the lock contention counters of this connection
+     *
+     * Counters are collected after setBusyPolicy was called.
+     *
+     * \throw sl3::ErrNoConnection if the database is closed
+     * \return a copy of the counters
+     */
+    BusyStats busyStats ();
+
+    /**
+     * \brief Set the lock contention counters to zero
+     *
+     * \throw sl3::ErrNoConnection if the database is closed
+     */
+    void resetBusyStats ();
+
+    /**
+     * \brief Checkpoint the write ahead log
+     *
+     * Calls sqlite3_wal_checkpoint_v2. Full, Restart and Truncate wait
+     * for locks via the busy policy.
+     *
+     * \param mode the checkpoint mode
+     * \param schema the database, like main, or an attached database
+     * \throw sl3::ErrNoConnection if the database is closed
+     * \throw sl3::SQLite3Error if the checkpoint fails, not for busy
+     * \return the WAL frames and the checkpointed frames, -1 if the
+     * database is not in WAL mode
+     */
+    CheckpointResult
+    checkpoint (CheckpointMode     mode   = CheckpointMode::Passive,
+                const std::string& schema = "main");
+
     /**
      * \brief Transaction Guard
      *
@@ -313,6 +418,446 @@ namespace sl3
      */
     Transaction beginTransaction ();
 
+    /**
+     * \brief Execution limit guard
+     *
+     * While an instance exists, statements of the connection are
+     * interrupted when the deadline passes or the token is cancelled,
+     * they fail with ErrInterrupted.
+     * Limits can be nested, all of them apply.
+     *
+     * \sa limitExecution
+     */
+    class LIBSL3_API ExecutionLimit
+    {
+      std::shared_ptr<internal::Connection> _connection;
+      std::size_t                           _id = 0;
+
+      ExecutionLimit (Database&                              db,
+                      std::chrono::steady_clock::time_point  deadline,
+                      std::shared_ptr<internal::CancelState> token,
+                      int                                    steps);
+      friend class Database;
+
+    public:
+      ExecutionLimit (const ExecutionLimit&)            = delete;
+      ExecutionLimit& operator= (const ExecutionLimit&) = delete;
+      ExecutionLimit& operator= (ExecutionLimit&&)      = delete;
+
+      /** \brief Move constructor
+       *  An ExecutionLimit is movable.
+       */
+      ExecutionLimit (ExecutionLimit&&) noexcept;
+
+      /** \brief Destructor
+       *
+       * Removes the limit.
+       */
+      ~ExecutionLimit ();
+    };
+
+    /**
+     * \brief Limit the execution time of statements
+     *
+     * Installs a sqlite progress handler that checks the deadline and
+     * the token every steps virtual machine instructions, and interrupts
+     * the running statement when the deadline passed or the token is
+     * cancelled. A cancelled token also calls sqlite3_interrupt.
+     *
+     * Fewer steps react faster, but cost more time while executing.
+     * Interrupted statements throw ErrInterrupted, an open transaction
+     * might be rolled back, see sqlite3_interrupt.
+     *
+     * \code
+     *  auto limit = db.limitExecution (std::chrono::milliseconds{200});
+     *  db.execute ("SELECT ...", callback); // ErrInterrupted after 200ms
+     * \endcode
+     *
+     * \param deadline when statements are interrupted
+     * \param token cancels statements
+     * \param steps virtual machine instructions between checks
+     *
+     * \throw sl3::ErrNoConnection if the database is closed
+     * \throw sl3::ErrOutOfRange if steps is not positive
+     * \return the guard, the limit applies while it exists
+     */
+    ExecutionLimit
+    limitExecution (std::chrono::steady_clock::time_point deadline,
+                    const CancellationToken& token = CancellationToken{},
+                    int                      steps = 1000);
+
+    /**
+     * \brief Limit the execution time of statements
+     *
+     * Like limitExecution with a deadline of now plus timeout.
+     *
+     * \param timeout time until statements are interrupted
+     * \param token cancels statements
+     * \param steps virtual machine instructions between checks
+     *
+     * \throw sl3::ErrNoConnection if the database is closed
+     * \throw sl3::ErrOutOfRange if steps is not positive
+     * \return the guard, the limit applies while it exists
+     */
+    ExecutionLimit
+    limitExecution (std::chrono::steady_clock::duration timeout,
+                    const CancellationToken& token = CancellationToken{},
+                    int                      steps = 1000);
+
+    /**
+     * \brief Cancel statements via a token
+     *
+     * Like limitExecution without a deadline.
+     *
+     * \param token cancels statements
+     * \param steps virtual machine instructions between checks
+     *
+     * \throw sl3::ErrNoConnection if the database is closed
+     * \throw sl3::ErrOutOfRange if steps is not positive
+     * \return the guard, the limit applies while it exists
+     */
+    ExecutionLimit limitExecution (const CancellationToken& token,
+                                   int                      steps = 1000);
+
+    /**
+     * \brief Register a handler for the changes of committed transactions
+     *
+     * The rows that are inserted, updated or deleted via this connection
+     * are collected per transaction, grouped by table, and passed to the
+     * handler in one call when the transaction commits.
+     * The changes of a rolled back transaction are dropped.
+     *
+     * Changes sqlite does not report per row are not included,
+     * like a DELETE without WHERE or changes of WITHOUT ROWID tables.
+     * The batch may contain rows that were rolled back to a savepoint,
+     * or rows of a statement that failed within the transaction,
+     * sqlite does not report such partial rollbacks.
+     *
+     * The handler runs from the commit hook, before the commit is
+     * durable, and must not use this connection. Exceptions of the
+     * handler are ignored, the transaction commits anyway.
+     *
+     * \throw sl3::ErrNoConnection if the database is closed
+     * \param handler the handler
+     * \return id for removeHook
+     */
+    HookId onChanges (ChangeHandler handler);
+
+    /**
+     * \brief Register a handler that is called when a transaction commits
+     *
+     * If a handler returns false, or throws, the commit is turned into
+     * a rollback, and the statement fails with
+     * SQLITE_CONSTRAINT_COMMITHOOK.
+     * The handler must not use this connection.
+     *
+     * \throw sl3::ErrNoConnection if the database is closed
+     * \param handler the handler
+     * \return id for removeHook
+     */
+    HookId onCommit (CommitHandler handler);
+
+    /**
+     * \brief Register a handler that is called when a transaction rolls back
+     *
+     * The handler must not use this connection.
+     *
+     * \throw sl3::ErrNoConnection if the database is closed
+     * \param handler the handler
+     * \return id for removeHook
+     */
+    HookId onRollback (RollbackHandler handler);
+
+    /**
+     * \brief Register a handler that is called after a commit in WAL mode
+     *
+     * sqlite implements the auto checkpoint via the same hook, so while
+     * a WAL handler is registered, there are no automatic checkpoints.
+     * When the last WAL handler is removed, the auto checkpoint that was
+     * set before the first handler was registered is restored.
+     *
+     * \throw sl3::ErrNoConnection if the database is closed
+     * \param handler the handler
+     * \return id for removeHook
+     */
+    HookId onWal (WalHandler handler);
+
+    /**
+     * \brief Set the authorizer of this connection
+     *
+     * The authorizer is called while statements are prepared, and can
+     * deny actions, for example reading a table. An empty authorizer
+     * removes it. If it throws, the action is denied.
+     *
+     * Use this instead of sqlite3_set_authorizer, other parts of sl3, like
+     * ResultCache, share the authorizer of the connection.
+     *
+     * \throw sl3::ErrNoConnection if the database is closed
+     * \param authorizer the authorizer
+     */
+    void setAuthorizer (Authorizer authorizer);
+
+    /**
+     * \brief Remove a registered handler
+     *
+     * Unknown ids are ignored. Handlers must not remove handlers.
+     *
+     * \param id the id returned when the handler was registered
+     */
+    void removeHook (HookId id);
+
+    /**
+     * \brief Register a C++ callable as scalar SQL function
+     *
+     * The number of arguments and their decoding are deduced from the
+     * signature of the callable, results are written directly to sqlite.
+     *
+     * Supported argument types are integral and floating point types,
+     * std::string_view, valid during the call, std::string, Blob,
+     * DbValue, and std::optional of them.
+     * Arguments are converted like sqlite converts values.
+     * If an argument is Null and its type is not DbValue or std::optional,
+     * the result is Null and the callable is not called.
+     *
+     * Supported result types are integral and floating point types,
+     * std::string, std::string_view, const char*, Blob, DbValue, Value
+     * and std::optional of them, an empty optional gives Null.
+     *
+     * An exception thrown by the callable makes the SQL statement fail
+     * with the exception message.
+     *
+     * \code
+     *  db.createFunction ("score", [] (int64_t hits, std::string_view tag) {
+     *    return tag == "top" ? hits * 2.0 : hits * 1.0;
+     *  });
+     *  db.select ("SELECT * FROM docs ORDER BY score (hits, tag) DESC;");
+     * \endcode
+     *
+     * \throw sl3::ErrNoConnection if the database is closed
+     * \throw sl3::SQLite3Error if sqlite refuses the function
+     * \param name SQL name of the function
+     * \param fn the callable, copied or moved into the database
+     * \param options function flags
+     */
+    template <typename Fn>
+    void
+    createFunction (const std::string& name,
+                    Fn                 fn,
+                    FunctionOptions    options = {})
+    {
+      using Function = internal::ScalarFunction<Fn>;
+      registerFunction (name,
+                        Function::arity,
+                        options,
+                        new Fn (std::move (fn)),
+                        &Function::call,
+                        &Function::destroy);
+    }
+
+    /**
+     * \brief Register a class as aggregate SQL function
+     *
+     * Each group of the query gets a copy of prototype, rows are passed
+     * to its step member function, and the result is taken from
+     * final (), or if State has no final member function, from value ().
+     * The number of arguments and their decoding are deduced from the
+     * signature of step, see createFunction for the supported argument
+     * and result types.
+     * Rows with a Null argument for a type that can not hold Null are
+     * skipped.
+     *
+     * The state lives in the aggregate context memory of sqlite, it must
+     * be copyable and not be aligned to more than 8 bytes.
+     *
+     * \code
+     *  struct WeightedAvg
+     *  {
+     *    double sum = 0, weights = 0;
+     *    void step (double val, double weight)
+     *    {
+     *      sum += val * weight;
+     *      weights += weight;
+     *    }
+     *    std::optional<double> value () const
+     *    {
+     *      return weights ? std::optional{sum / weights} : std::nullopt;
+     *    }
+     *  };
+     *  db.createAggregate<WeightedAvg> ("wavg");
+     * \endcode
+     *
+     * \throw sl3::ErrNoConnection if the database is closed
+     * \throw sl3::SQLite3Error if sqlite refuses the function
+     * \param name SQL name of the function
+     * \param prototype initial state of each group
+     * \param options function flags
+     */
+    template <typename State>
+    void
+    createAggregate (const std::string& name,
+                     State              prototype = State{},
+                     FunctionOptions    options   = {})
+    {
+      using Function = internal::AggregateFunction<State>;
+      registerAggregate (name,
+                         Function::arity,
+                         options,
+                         new State (std::move (prototype)),
+                         &Function::step,
+                         &Function::final,
+                         nullptr,
+                         nullptr,
+                         &Function::destroy);
+    }
+
+    /**
+     * \brief Register a class as aggregate window function
+     *
+     * Like createAggregate, and State needs additionally an inverse member
+     * function, with the same arguments as step, that removes a row from
+     * the window, and a value member function that returns the current
+     * result.
+     *
+     * \throw sl3::ErrNoConnection if the database is closed
+     * \throw sl3::SQLite3Error if sqlite refuses the function
+     * \param name SQL name of the function
+     * \param prototype initial state of each group
+     * \param options function flags
+     */
+    template <typename State>
+    void
+    createWindowFunction (const std::string& name,
+                          State              prototype = State{},
+                          FunctionOptions    options   = {})
+    {
+      using Function = internal::AggregateFunction<State>;
+      registerAggregate (name,
+                         Function::arity,
+                         options,
+                         new State (std::move (prototype)),
+                         &Function::step,
+                         &Function::final,
+                         &Function::value,
+                         &Function::inverse,
+                         &Function::destroy);
+    }
+
+    /**
+     * \brief Register a C++ comparator as SQL collation
+     *
+     * The comparator is called with two std::string_view and returns an
+     * int like strcmp, or a bool if the first is less than the second.
+     * It must define a consistent order, and must not throw.
+     * The collation can be used in ORDER BY, comparisons and indexes,
+     * sl3::collation has some ready to use comparators.
+     *
+     * \code
+     *  db.createCollation ("natsort", sl3::collation::natural);
+     *  db.select ("SELECT name FROM files ORDER BY name COLLATE natsort;");
+     * \endcode
+     *
+     * \throw sl3::ErrNoConnection if the database is closed
+     * \throw sl3::SQLite3Error if sqlite refuses the collation
+     * \param name SQL name of the collation
+     * \param fn the comparator, copied or moved into the database
+     */
+    template <typename Fn>
+    void
+    createCollation (const std::string& name, Fn fn)
+    {
+      using Collation = internal::CollationFunction<Fn>;
+      registerCollation (
+          name, new Fn (std::move (fn)), &Collation::call, &Collation::destroy);
+    }
+
+    /**
+     * \brief Expose a Dataset as read only SQL table
+     *
+     * The table is an eponymous virtual table, it can be used by its name
+     * without CREATE VIRTUAL TABLE, values are read from the Dataset
+     * without a copy.
+     * Equality constraints on a field with a single field index of the
+     * Dataset, and range constraints on a field with an ordered index,
+     * are looked up in the index, see Dataset::createIndex.
+     * Text constraints with another collation than BINARY scan all rows.
+     * Fields that a row of an untyped Dataset does not have are Null.
+     *
+     * The Dataset must not change and must outlive the table, which exists
+     * until the database closes or the name is registered again.
+     *
+     * \code
+     *  ds.createIndex ({0}, sl3::IndexType::Ordered);
+     *  db.createVirtualTable ("prices", ds);
+     *  db.select ("SELECT * FROM orders JOIN prices USING (id);");
+     * \endcode
+     *
+     * \throw sl3::ErrNoConnection if the database is closed
+     * \throw sl3::SQLite3Error if sqlite refuses the table
+     * \param name table name
+     * \param ds the data
+     */
+    void createVirtualTable (const std::string& name, const Dataset& ds);
+
+    /**
+     * \brief Expose a shared Dataset as read only SQL table
+     *
+     * Like createVirtualTable (const std::string&, const Dataset&),
+     * the table keeps the Dataset alive, for example a result of a
+     * ResultCache.
+     *
+     * \throw sl3::ErrNoConnection if the database is closed
+     * \throw sl3::SQLite3Error if sqlite refuses the table
+     * \param name table name
+     * \param ds the data
+     */
+    void createVirtualTable (const std::string&             name,
+                             std::shared_ptr<const Dataset> ds);
+
+    /// temporary data would be dangling
+    void createVirtualTable (const std::string&, const Dataset&&) = delete;
+
+    /**
+     * \brief Expose a range of structs as read only SQL table
+     *
+     * Like createVirtualTable (const std::string&, const Dataset&),
+     * rows is a random access range, like a std::vector, and columns
+     * describe how to get the values of a row, see tableColumn.
+     * Indexed columns get an ordered index when the table is created.
+     *
+     * The rows must not change and must outlive the table.
+     *
+     * \code
+     *  struct Price
+     *  {
+     *    int64_t id;
+     *    double  value;
+     *  };
+     *  std::vector<Price> prices = load ();
+     *  db.createVirtualTable ("prices",
+     *                         prices,
+     *                         {sl3::tableColumn ("id", &Price::id, true),
+     *                          sl3::tableColumn ("value", &Price::value)});
+     * \endcode
+     *
+     * \throw sl3::ErrNoConnection if the database is closed
+     * \throw sl3::SQLite3Error if sqlite refuses the table
+     * \param name table name
+     * \param rows the data
+     * \param columns column descriptions
+     */
+    template <typename Rows>
+    void
+    createVirtualTable (
+        const std::string&                                               name,
+        const Rows&                                                      rows,
+        std::vector<TableColumn<typename internal::RowOf<Rows>::type>> columns)
+    {
+      using Row = typename internal::RowOf<Rows>::type;
+      registerTable (name,
+                     std::make_unique<internal::RowsSource<Rows, Row>> (
+                         rows, std::move (columns)));
+    }
+
   protected:
     /**
      * \brief Access the underlying sqlite3 database.
@@ -327,6 +872,40 @@ namespace sl3
     sqlite3* db ();
 
   private:
+    void registerTable (const std::string&                    name,
+                        std::unique_ptr<internal::TableSource> source);
+
+    using FunctionCall = void (*) (sqlite3_context*, int, sqlite3_value**);
+
+    using FunctionFinal = void (*) (sqlite3_context*);
+
+    // takes ownership of data, destroy is called also on failure
+    void registerFunction (const std::string&     name,
+                           int                    nArgs,
+                           const FunctionOptions& options,
+                           void*                  data,
+                           FunctionCall           call,
+                           void (*destroy) (void*));
+
+    using CollationCall = int (*) (void*, int, const void*, int, const void*);
+
+    // takes ownership of data, destroy is called also on failure
+    void registerCollation (const std::string& name,
+                            void*              data,
+                            CollationCall      call,
+                            void (*destroy) (void*));
+
+    // takes ownership of data, destroy is called also on failure
+    void registerAggregate (const std::string&     name,
+                            int                    nArgs,
+                            const FunctionOptions& options,
+                            void*                  data,
+                            FunctionCall           step,
+                            FunctionFinal          final,
+                            FunctionFinal          value,
+                            FunctionCall           inverse,
+                            void (*destroy) (void*));
+
     /**
      * \brief Define internal::Connection type.
      *
@@ -9,7 +9,13 @@
 #ifndef SL3_DATASET_HPP_
 #define SL3_DATASET_HPP_
 
+#include <cstddef>
+#include <cstdint>
+#include <deque>
 #include <map>
+#include <memory>
+#include <string>
+#include <unordered_map>
 #include <vector>
 
 #include <sl3/config.hpp>
@@ -19,6 +25,335 @@
 
 namespace sl3
 {
+  /**
+   * \brief Sort direction for Dataset::orderBy
+   */
+  enum class SortOrder
+  {
+    Ascending,  //!< smallest value first
+    Descending  //!< biggest value first
+  };
+
+  /**
+   * \brief Position of Null values for Dataset::orderBy
+   *
+   * The position of Null values does not depend on the SortOrder.
+   */
+  enum class NullsOrder
+  {
+    First, //!< Null values before all other values
+    Last   //!< Null values after all other values
+  };
+
+  /**
+   * \brief A sort criteria for Dataset::orderBy
+   */
+  struct SortKey
+  {
+    std::size_t index;                       ///< field index
+    SortOrder   order = SortOrder::Ascending; ///< sort direction
+    NullsOrder  nulls = NullsOrder::First;    ///< where Null values go
+  };
+
+  /**
+   * \brief Options for Dataset::orderBy
+   */
+  struct SortOptions
+  {
+    /**
+     * \brief Partial sort
+     *
+     * If not 0, only the first limit rows are guaranteed to be in order,
+     * the order of the remaining rows is unspecified.
+     */
+    std::size_t limit = 0;
+
+    /**
+     * \brief Number of threads to use
+     *
+     * 0 uses the hardware concurrency. Multiple threads are only used for
+     * large datasets, small datasets are always sorted in the calling
+     * thread.
+     */
+    std::size_t threads = 0;
+  };
+
+  /**
+   * \brief Cached position and type of a Dataset field
+   *
+   * Looking up a field by name once and using the handle for each row
+   * costs the same as positional access.
+   *
+   * \see Dataset::column
+   */
+  class ColumnHandle
+  {
+  public:
+    /**
+     * \brief Constructor
+     * \param index field index
+     * \param type field type
+     */
+    constexpr ColumnHandle (std::size_t index, Type type) noexcept
+    : _index (index)
+    , _type (type)
+    {
+    }
+
+    /**
+     * \brief field index
+     * \return the index of the field in a row
+     */
+    constexpr std::size_t
+    index () const noexcept
+    {
+      return _index;
+    }
+
+    /**
+     * \brief field type
+     * \return the Type of the field in the Dataset
+     */
+    constexpr Type
+    type () const noexcept
+    {
+      return _type;
+    }
+
+    /**
+     * \brief Unchecked access to the field of a row
+     *
+     * Behavior is undefined if the row has not the layout of the Dataset
+     * this handle was created from.
+     * \param row a row of the Dataset
+     * \return reference to the field value
+     */
+    const DbValue&
+    operator() (const DbValues& row) const
+    {
+      return row[_index];
+    }
+
+  private:
+    std::size_t _index;
+    Type        _type;
+  };
+
+  namespace internal
+  {
+    template <typename T> struct FieldAccess;
+
+    template <> struct FieldAccess<int64_t>
+    {
+      static constexpr Type type = Type::Int;
+      static const int64_t&
+      get (const DbValue& v)
+      {
+        return v.getInt ();
+      }
+    };
+
+    template <> struct FieldAccess<double>
+    {
+      static constexpr Type type = Type::Real;
+      static const double&
+      get (const DbValue& v)
+      {
+        return v.getReal ();
+      }
+    };
+
+    template <> struct FieldAccess<std::string>
+    {
+      static constexpr Type type = Type::Text;
+      static const std::string&
+      get (const DbValue& v)
+      {
+        return v.getText ();
+      }
+    };
+
+    template <> struct FieldAccess<Blob>
+    {
+      static constexpr Type type = Type::Blob;
+      static const Blob&
+      get (const DbValue& v)
+      {
+        return v.getBlob ();
+      }
+    };
+  }
+
+  /**
+   * \brief Typed access to a Dataset field
+   *
+   * T is one of int64_t, double, std::string or Blob.
+   * The field type is checked once, when the FieldRef is created.
+   *
+   * \code
+   *  auto name = ds.field<std::string> ("name");
+   *  for (const auto& row : ds)
+   *    std::cout << name.get (row, "-") << "\n";
+   * \endcode
+   *
+   * \see Dataset::field
+   */
+  template <typename T> class FieldRef
+  {
+    using Access = internal::FieldAccess<T>;
+
+  public:
+    /**
+     * \brief Constructor
+     *
+     * \throw sl3::ErrTypeMisMatch if the field is neither Type::Variant
+     * nor has the type of T
+     * \param column the field
+     */
+    explicit FieldRef (ColumnHandle column)
+    : _column (column)
+    {
+      if (column.type () != Type::Variant && column.type () != Access::type)
+        throw ErrTypeMisMatch (typeName (column.type ()) + " != "
+                               + typeName (Access::type));
+    }
+
+    /**
+     * \brief the accessed field
+     * \return the ColumnHandle of the field
+     */
+    ColumnHandle
+    column () const noexcept
+    {
+      return _column;
+    }
+
+    /**
+     * \brief check the field of a row for Null
+     * \param row a row of the Dataset
+     * \return true if the field value is Null
+     */
+    bool
+    isNull (const DbValues& row) const
+    {
+      return _column (row).isNull ();
+    }
+
+    /**
+     * \brief Value access
+     * \throw sl3::ErrNullValueAccess if the value is null.
+     * \throw sl3::ErrTypeMisMatch if a Variant field has an other type
+     * \param row a row of the Dataset
+     * \return reference to the value
+     */
+    const T&
+    get (const DbValues& row) const
+    {
+      return Access::get (_column (row));
+    }
+
+    /**
+     * \brief Value access with default for a Null value.
+     * \throw sl3::ErrTypeMisMatch if a Variant field has an other type
+     * \param row a row of the Dataset
+     * \param defval returned if the value is Null
+     * \return the value or defval
+     */
+    T
+    get (const DbValues& row, const T& defval) const
+    {
+      const DbValue& v = _column (row);
+      return v.isNull () ? defval : Access::get (v);
+    }
+
+  private:
+    ColumnHandle _column;
+  };
+
+  /**
+   * \brief Kind of a Dataset index
+   *
+   * \see Dataset::createIndex
+   */
+  enum class IndexType
+  {
+    Hash,   //!< equality lookups in constant time
+    Ordered //!< equality, prefix and range lookups in logarithmic time
+  };
+
+  /**
+   * \brief Row numbers returned by Dataset index lookups
+   *
+   * A view into the index, valid until the index is dropped.
+   */
+  class RowRange
+  {
+  public:
+    /// iterator type
+    using const_iterator = const std::size_t*;
+
+    /**
+     * \brief Constructor
+     * \param first first row number
+     * \param last end of the row numbers
+     */
+    constexpr RowRange (const std::size_t* first = nullptr,
+                        const std::size_t* last  = nullptr) noexcept
+    : _first (first)
+    , _last (last)
+    {
+    }
+
+    /// \return begin of the row numbers
+    constexpr const_iterator
+    begin () const noexcept
+    {
+      return _first;
+    }
+
+    /// \return end of the row numbers
+    constexpr const_iterator
+    end () const noexcept
+    {
+      return _last;
+    }
+
+    /// \return number of rows
+    constexpr std::size_t
+    size () const noexcept
+    {
+      return static_cast<std::size_t> (_last - _first);
+    }
+
+    /// \return true if no rows are in the range
+    constexpr bool
+    empty () const noexcept
+    {
+      return _first == _last;
+    }
+
+    /**
+     * \brief unchecked access
+     * \param i position in the range
+     * \return row number
+     */
+    constexpr std::size_t
+    operator[] (std::size_t i) const noexcept
+    {
+      return _first[i];
+    }
+
+  private:
+    const std::size_t* _first;
+    const std::size_t* _last;
+  };
+
+  namespace internal
+  {
+    class RowIndex;
+    class VirtualTable;
+  }
+
   /**
    * \brief A utility for processing query results.
    *
@@ -47,6 +382,9 @@ namespace sl3
   class LIBSL3_API Dataset final : public Container<std::vector<DbValues>>
   {
     friend class Command;
+    friend class ChunkedDataset;
+    friend class DatasetView;
+    friend class internal::VirtualTable;
 
   public:
     /**
@@ -81,7 +419,11 @@ namespace sl3
         std::is_nothrow_move_constructible<Container<DbValues>>::value
         && std::is_nothrow_move_constructible<Types>::value
         && std::is_nothrow_move_constructible<
-            std::vector<std::string>>::value);
+            std::vector<std::string>>::value
+        && std::is_nothrow_move_constructible<
+            std::unordered_map<std::string, std::size_t>>::value
+        && std::is_nothrow_move_constructible<
+            std::vector<std::shared_ptr<const internal::RowIndex>>>::value);
     //  = default; no mscv does not like it
 
     /**
@@ -132,6 +474,21 @@ namespace sl3
      */
     void merge (const Dataset& other);
 
+    /**
+     * \brief Merge another Dataset by moving its rows.
+     *
+     * Like merge(const Dataset&), but rows are moved instead of copied.
+     * If the actual Dataset is empty, the rows of other are taken over
+     * as a whole.
+     * other has no rows afterwards.
+     *
+     * \throw sl3::ErrTypeMisMatch if field names types are not equal or
+     * size differs.
+     *
+     * \param other Dataset which shall be moved into this one.
+     */
+    void merge (Dataset&& other);
+
     /**
      * \brief Merge DbValues.
      *
@@ -144,9 +501,30 @@ namespace sl3
      */
     void merge (const DbValues& row);
 
+    /**
+     * \brief Merge DbValues by moving them.
+     *
+     * \copydetails merge(const DbValues&)
+     */
+    void merge (DbValues&& row);
+
+    /**
+     * \brief Reserve space for rows
+     *
+     * Avoids reallocations when the number of rows that will be merged
+     * is known.
+     *
+     * \param rows number of rows the Dataset can hold without reallocation
+     */
+    void reserve (std::size_t rows);
+
     /**
      * \brief Get the index of a field by name
      *
+     * The lookup uses a hash map that is built once when the Dataset
+     * is filled. If a name is used by multiple fields, the first
+     * field is returned.
+     *
      * \throw sl3::OutOfRange if name is not found
      * \param name field
      * name
@@ -154,6 +532,47 @@ namespace sl3
      */
     std::size_t getIndex (const std::string& name) const;
 
+    /**
+     * \brief Field names
+     *
+     * \return the names of the fields, empty if the Dataset was not
+     * created by a query
+     */
+    const std::vector<std::string>& getNames () const noexcept;
+
+    /**
+     * \brief Field types
+     *
+     * \return the types of the fields, empty if the Dataset was created
+     * without types and has no rows yet
+     */
+    const Types& getTypes () const noexcept;
+
+    /**
+     * \brief Get a reusable handle for a field
+     *
+     * \throw sl3::ErrOutOfRange if name is not found
+     * \param name field name
+     * \return ColumnHandle with index and type of the field
+     */
+    ColumnHandle column (const std::string& name) const;
+
+    /**
+     * \brief Get a typed accessor for a field
+     *
+     * \throw sl3::ErrOutOfRange if name is not found
+     * \throw sl3::ErrTypeMisMatch if the field type is not Type::Variant
+     * and not the type of T
+     * \param name field name
+     * \return FieldRef for the field
+     */
+    template <typename T>
+    FieldRef<T>
+    field (const std::string& name) const
+    {
+      return FieldRef<T>{column (name)};
+    }
+
     /**
      * \brief Typedef for a relation function signature
      *
@@ -180,9 +599,230 @@ namespace sl3
      */
     void sort (const std::vector<size_t>& idxs, DbValueSort cmp = &dbval_lt);
 
+    /**
+     * \brief Sort the Dataset by given keys
+     *
+     * Sorts according to the sqlite rules, like dbval_lt, where each key
+     * can have its own direction and position for Null values.
+     *
+     * Instead of comparing DbValue objects, a normalized binary key is
+     * computed once per row, with a fast path for Type::Int and
+     * Type::Real fields. Row indexes are sorted, and the rows are moved
+     * only once into their final position.
+     *
+     * The sort is stable, rows with equal keys keep their relative order.
+     *
+     * \throw sl3::ErrOutOfRange if a given index is invalid
+     * \param keys sort criteria, the first key is the most significant one
+     * \param options to request a partial sort or the used threads
+     */
+    void orderBy (const std::vector<SortKey>& keys,
+                  const SortOptions&          options = {});
+
+    /**
+     * \brief Create an index on the given fields
+     *
+     * The index is built from the current rows, with multiple threads
+     * for large datasets.
+     * Values are compared like by dbval_eq and dbval_lt, for example
+     * 1 and 1.0 are the same key. Null values are keys as well.
+     *
+     * Indexes are dropped by merge, reset, sort and orderBy.
+     * Changing rows through the non const access of the Dataset does not
+     * update the indexes, call dropIndexes and create them again.
+     *
+     * Creating an index that exists already does nothing.
+     *
+     * \throw sl3::ErrOutOfRange if fields is empty or a field index is
+     * invalid
+     * \param fields the field indexes that build the key
+     * \param type kind of the index
+     * \param threads number of threads, 0 for hardware concurrency
+     */
+    void createIndex (const std::vector<std::size_t>& fields,
+                      IndexType                       type    = IndexType::Hash,
+                      std::size_t                     threads = 0);
+
+    /**
+     * \brief Check if an index exists
+     * \param fields the field indexes of the key
+     * \param type kind of the index
+     * \return true if an index of given type exists for fields
+     */
+    bool hasIndex (const std::vector<std::size_t>& fields,
+                   IndexType                       type) const noexcept;
+
+    /**
+     * \brief Remove all indexes
+     */
+    void dropIndexes () noexcept;
+
+    /**
+     * \brief Find all rows with the given key
+     *
+     * Uses a hash index on fields if the key has a value for each field,
+     * otherwise an ordered index which also supports a key for only the
+     * first fields.
+     *
+     * \throw sl3::ErrOutOfRange if no index exists for fields
+     * \throw sl3::ErrTypeMisMatch if the key size does not fit
+     * \param fields the field indexes of an existing index
+     * \param key the values to find
+     * \return numbers of the matching rows, in key order and rows with
+     * equal keys in ascending order
+     */
+    RowRange equalRange (const std::vector<std::size_t>& fields,
+                         const DbValues&                 key) const;
+
+    /**
+     * \brief Find the first row with the given key
+     *
+     * \copydetails equalRange
+     * \return the first matching row, or nullptr if there is none
+     */
+    const DbValues* find (const std::vector<std::size_t>& fields,
+                          const DbValues&                 key) const;
+
+    /**
+     * \brief Find the rows with keys in [lower, upper)
+     *
+     * Needs an ordered index on fields. lower and upper can have values for
+     * only the first fields.
+     *
+     * \throw sl3::ErrOutOfRange if no ordered index exists for fields
+     * \throw sl3::ErrTypeMisMatch if a key size does not fit
+     * \param fields the field indexes of an existing ordered index
+     * \param lower smallest key in the range
+     * \param upper first key after the range
+     * \return numbers of the matching rows, in key order
+     */
+    RowRange range (const std::vector<std::size_t>& fields,
+                    const DbValues&                 lower,
+                    const DbValues&                 upper) const;
+
+  private:
+    void applyOrder (const std::vector<std::size_t>& order);
+
+    const internal::RowIndex*
+    findIndex (const std::vector<std::size_t>& fields,
+               IndexType                       type) const noexcept;
+
+    void setNames (std::vector<std::string> names);
+
+    Types                                        _fieldtypes;
+    std::vector<std::string>                     _names;
+    std::unordered_map<std::string, std::size_t> _nameIndex;
+    std::vector<std::shared_ptr<const internal::RowIndex>> _indexes;
+  };
+
+  /**
+   * \brief A Dataset like result container with chunked row storage.
+   *
+   * Rows are stored in a std::deque, so appending rows never moves the
+   * already loaded rows, and references to rows stay valid while rows
+   * are appended.
+   * This is useful for large results, or to collect the results of many
+   * queries, without a reallocation of all rows.
+   *
+   * A ChunkedDataset is a RowCallback, pass it to Database::execute or
+   * Command::execute to load the result.
+   *
+   * \code
+   *  ChunkedDataset rows;
+   *  db.execute ("SELECT * FROM shard1;", rows);
+   *  db.execute ("SELECT * FROM shard2;", rows);
+   *  Dataset ds = std::move (rows).toDataset ();
+   * \endcode
+   *
+   * Field types, names and validation are the same as for a Dataset.
+   */
+  class LIBSL3_API ChunkedDataset final
+      : public Container<std::deque<DbValues>>,
+        public RowCallback
+  {
+  public:
+    /**
+     * \brief Constructor
+     *
+     * All fields will be Variant, field count will be detected.
+     */
+    ChunkedDataset () noexcept;
+
+    /**
+     * \brief Constructor with field types
+     *
+     * \param types Types the fields must satisfy
+     */
+    ChunkedDataset (Types types);
+
+    /**
+     * \brief Clear all states.
+     *
+     * Removes loaded data, keeps the field types.
+     */
+    void reset ();
+
+    /**
+     * \brief Clear all states and set new field types
+     *
+     * \param types new Types requirement
+     */
+    void reset (const Types& types);
+
+    /**
+     * \brief Merge another ChunkedDataset by moving its rows
+     *
+     * \throw sl3::ErrTypeMisMatch if field names or types are not equal
+     * \param other has no rows afterwards
+     */
+    void merge (ChunkedDataset&& other);
+
+    /**
+     * \brief Merge a Dataset by moving its rows
+     *
+     * \throw sl3::ErrTypeMisMatch if field names or types are not equal
+     * \param other has no rows afterwards
+     */
+    void merge (Dataset&& other);
+
+    /**
+     * \brief Merge a row by moving it
+     *
+     * \throw sl3::ErrTypeMisMatch if size or types do not fit
+     * \param row the row to append
+     */
+    void merge (DbValues&& row);
+
+    /**
+     * \brief Get the index of a field by name
+     *
+     * \throw sl3::ErrOutOfRange if name is not found
+     * \param name field name
+     * \return field index
+     */
+    std::size_t getIndex (const std::string& name) const;
+
+    /**
+     * \brief Move all rows into a Dataset
+     *
+     * The actual instance is empty afterwards.
+     *
+     * \return a Dataset with the rows, field names and types
+     */
+    Dataset toDataset () &&;
+
+  protected:
+    /**
+     * \brief Appends a row of a query result
+     * \param columns the current row
+     * \return true
+     */
+    bool onRow (Columns columns) override;
+
   private:
-    Types                    _fieldtypes;
-    std::vector<std::string> _names;
+    Types                                        _fieldtypes;
+    std::vector<std::string>                     _names;
+    std::unordered_map<std::string, std::size_t> _nameIndex;
   };
 }
 
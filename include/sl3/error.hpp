@@ -33,6 +33,7 @@ namespace sl3
     OutOfRange      = 5, ///< index op out of range
     TypeMisMatch    = 6, ///< type cast problem
     NullValueAccess = 7, ///< accessing a value that is Null
+    Interrupted     = 8, ///< a statement was interrupted
     UNEXPECTED      = 99 ///< for everything that happens unexpected
   };
 
@@ -50,6 +51,7 @@ namespace sl3
            : ec == ErrCode::OutOfRange      ? "OutOfRange"
            : ec == ErrCode::TypeMisMatch    ? "TypeMisMatch"
            : ec == ErrCode::NullValueAccess ? "NullValueAccess"
+           : ec == ErrCode::Interrupted     ? "Interrupted"
            : ec == ErrCode::UNEXPECTED      ? "UNEXPECTED"
                                             : "NA";
   }
@@ -121,6 +123,9 @@ namespace sl3
   /// thrown in case of accessing a Null value field/parameter
   using ErrNullValueAccess = ErrType<ErrCode::NullValueAccess>;
 
+  /// thrown if sqlite interrupted a statement, like at a deadline
+  using ErrInterrupted = ErrType<ErrCode::Interrupted>;
+
   /// thrown if something unexpected happened, mostly used by test tools and in
   /// debug mode
   using ErrUnexpected = ErrType<ErrCode::UNEXPECTED>;
@@ -130,6 +135,7 @@ namespace sl3
   extern template class ErrType<ErrCode::OutOfRange>;
   extern template class ErrType<ErrCode::TypeMisMatch>;
   extern template class ErrType<ErrCode::NullValueAccess>;
+  extern template class ErrType<ErrCode::Interrupted>;
   extern template class ErrType<ErrCode::UNEXPECTED>;
 #endif
 
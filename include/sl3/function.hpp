@@ -0,0 +1,555 @@
+/******************************************************************************
+ ------------- Copyright (c) 2009-2023 H a r a l d  A c h i t z ---------------
+ ---------- < h a r a l d dot a c h i t z at g m a i l dot c o m > ------------
+ ---- This Source Code Form is subject to the terms of the Mozilla Public -----
+ ---- License, v. 2.0. If a copy of the MPL was not distributed with this -----
+ ---------- file, You can obtain one at http://mozilla.org/MPL/2.0/. ----------
+ ******************************************************************************/
+
+#ifndef SL3_FUNCTION_HPP_
+#define SL3_FUNCTION_HPP_
+
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <new>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+#include <sl3/config.hpp>
+#include <sl3/dbvalue.hpp>
+#include <sl3/types.hpp>
+#include <sl3/value.hpp>
+
+struct sqlite3_context;
+struct sqlite3_value;
+
+namespace sl3
+{
+  /**
+   * \brief Flags of a user defined SQL function
+   *
+   * \sa https://www.sqlite.org/c3ref/c_deterministic.html
+   */
+  struct FunctionOptions
+  {
+    /// same arguments always give the same result, SQLITE_DETERMINISTIC
+    bool deterministic = false;
+    /// no side effects, usable in views and triggers, SQLITE_INNOCUOUS
+    bool innocuous = false;
+    /// only usable from top level SQL, SQLITE_DIRECTONLY
+    bool directOnly = false;
+  };
+
+  /// \cond HIDDEN_SYMBOLS
+  namespace internal
+  {
+    // access to sqlite3_value and sqlite3_context without sqlite3.h
+
+    LIBSL3_API bool             isNull (sqlite3_value* v) noexcept;
+    LIBSL3_API int64_t          toInt (sqlite3_value* v) noexcept;
+    LIBSL3_API double           toReal (sqlite3_value* v) noexcept;
+    LIBSL3_API std::string_view toText (sqlite3_value* v) noexcept;
+    LIBSL3_API Blob             toBlob (sqlite3_value* v);
+    LIBSL3_API DbValue          toValue (sqlite3_value* v);
+
+    LIBSL3_API void* userData (sqlite3_context* ctx) noexcept;
+    LIBSL3_API void* aggregateContext (sqlite3_context* ctx,
+                                       std::size_t      bytes) noexcept;
+    LIBSL3_API void  setNoMemory (sqlite3_context* ctx) noexcept;
+    LIBSL3_API void  setNull (sqlite3_context* ctx) noexcept;
+    LIBSL3_API void  setInt (sqlite3_context* ctx, int64_t val) noexcept;
+    LIBSL3_API void  setReal (sqlite3_context* ctx, double val) noexcept;
+    LIBSL3_API void  setText (sqlite3_context* ctx, std::string_view val);
+    LIBSL3_API void  setBlob (sqlite3_context* ctx, const Blob& val);
+    LIBSL3_API void  setValue (sqlite3_context* ctx, const Value& val);
+    LIBSL3_API void  setError (sqlite3_context* ctx, const char* msg);
+
+    /**
+     * \internal
+     * \brief Reads a function argument as T
+     *
+     * Specialized for the supported argument types.
+     * Arguments are converted like sqlite converts values,
+     * nullable types accept Null values.
+     */
+    template <typename T, typename = void>
+    struct FunctionArg;
+
+    template <typename T>
+    struct FunctionArg<
+        T,
+        std::enable_if_t<std::is_integral_v<T> && !std::is_same_v<T, bool>>>
+    {
+      static constexpr bool nullable = false;
+      static T
+      get (sqlite3_value* v)
+      {
+        return static_cast<T> (toInt (v));
+      }
+    };
+
+    template <>
+    struct FunctionArg<bool>
+    {
+      static constexpr bool nullable = false;
+      static bool
+      get (sqlite3_value* v)
+      {
+        return toInt (v) != 0;
+      }
+    };
+
+    template <typename T>
+    struct FunctionArg<T, std::enable_if_t<std::is_floating_point_v<T>>>
+    {
+      static constexpr bool nullable = false;
+      static T
+      get (sqlite3_value* v)
+      {
+        return static_cast<T> (toReal (v));
+      }
+    };
+
+    template <>
+    struct FunctionArg<std::string_view>
+    {
+      static constexpr bool nullable = false;
+      static std::string_view
+      get (sqlite3_value* v)
+      {
+        return toText (v);
+      }
+    };
+
+    template <>
+    struct FunctionArg<std::string>
+    {
+      static constexpr bool nullable = false;
+      static std::string
+      get (sqlite3_value* v)
+      {
+        return std::string{toText (v)};
+      }
+    };
+
+    template <>
+    struct FunctionArg<Blob>
+    {
+      static constexpr bool nullable = false;
+      static Blob
+      get (sqlite3_value* v)
+      {
+        return toBlob (v);
+      }
+    };
+
+    template <>
+    struct FunctionArg<DbValue>
+    {
+      static constexpr bool nullable = true;
+      static DbValue
+      get (sqlite3_value* v)
+      {
+        return toValue (v);
+      }
+    };
+
+    template <typename T>
+    struct FunctionArg<std::optional<T>>
+    {
+      static constexpr bool nullable = true;
+      static std::optional<T>
+      get (sqlite3_value* v)
+      {
+        if (isNull (v))
+          return std::nullopt;
+        return FunctionArg<T>::get (v);
+      }
+    };
+
+    /**
+     * \internal
+     * \brief Writes a function result of type T
+     */
+    template <typename T, typename = void>
+    struct FunctionResult;
+
+    template <typename T>
+    struct FunctionResult<T, std::enable_if_t<std::is_integral_v<T>>>
+    {
+      static void
+      set (sqlite3_context* ctx, T val)
+      {
+        setInt (ctx, static_cast<int64_t> (val));
+      }
+    };
+
+    template <typename T>
+    struct FunctionResult<T, std::enable_if_t<std::is_floating_point_v<T>>>
+    {
+      static void
+      set (sqlite3_context* ctx, T val)
+      {
+        setReal (ctx, static_cast<double> (val));
+      }
+    };
+
+    template <typename T>
+    struct FunctionResult<
+        T,
+        std::enable_if_t<std::is_same_v<T, std::string>
+                         || std::is_same_v<T, std::string_view>
+                         || std::is_same_v<T, const char*>>>
+    {
+      static void
+      set (sqlite3_context* ctx, std::string_view val)
+      {
+        setText (ctx, val);
+      }
+    };
+
+    template <>
+    struct FunctionResult<Blob>
+    {
+      static void
+      set (sqlite3_context* ctx, const Blob& val)
+      {
+        setBlob (ctx, val);
+      }
+    };
+
+    template <>
+    struct FunctionResult<DbValue>
+    {
+      static void
+      set (sqlite3_context* ctx, const DbValue& val)
+      {
+        setValue (ctx, val.getValue ());
+      }
+    };
+
+    template <>
+    struct FunctionResult<Value>
+    {
+      static void
+      set (sqlite3_context* ctx, const Value& val)
+      {
+        setValue (ctx, val);
+      }
+    };
+
+    template <typename T>
+    struct FunctionResult<std::optional<T>>
+    {
+      static void
+      set (sqlite3_context* ctx, const std::optional<T>& val)
+      {
+        if (val)
+          FunctionResult<T>::set (ctx, *val);
+        else
+          setNull (ctx);
+      }
+    };
+
+    /**
+     * \internal
+     * \brief Result and argument types of a callable
+     */
+    template <typename F>
+    struct FunctionTraits : FunctionTraits<decltype (&F::operator())>
+    {
+    };
+
+    template <typename R, typename... A>
+    struct FunctionTraits<R (*) (A...)>
+    {
+      using Result = std::decay_t<R>;
+      using Args   = std::tuple<std::decay_t<A>...>;
+
+      static constexpr int arity = static_cast<int> (sizeof...(A));
+    };
+
+    template <typename R, typename... A>
+    struct FunctionTraits<R (*) (A...) noexcept>
+    : FunctionTraits<R (*) (A...)>
+    {
+    };
+
+    template <typename C, typename R, typename... A>
+    struct FunctionTraits<R (C::*) (A...)> : FunctionTraits<R (*) (A...)>
+    {
+    };
+
+    template <typename C, typename R, typename... A>
+    struct FunctionTraits<R (C::*) (A...) const>
+    : FunctionTraits<R (*) (A...)>
+    {
+    };
+
+    template <typename C, typename R, typename... A>
+    struct FunctionTraits<R (C::*) (A...) noexcept>
+    : FunctionTraits<R (*) (A...)>
+    {
+    };
+
+    template <typename C, typename R, typename... A>
+    struct FunctionTraits<R (C::*) (A...) const noexcept>
+    : FunctionTraits<R (*) (A...)>
+    {
+    };
+
+    /**
+     * \internal
+     * \brief Calls a callable with decoded arguments and writes the result
+     *
+     * If an argument that is not nullable is Null, the result is Null and
+     * the callable is not called.
+     * Exceptions become an SQL error with the exception message.
+     */
+    template <typename Fn>
+    struct ScalarFunction
+    {
+      using Traits = FunctionTraits<Fn>;
+      using Args   = typename Traits::Args;
+      using Result = typename Traits::Result;
+
+      static_assert (!std::is_void_v<Result>,
+                     "a SQL function must return a value");
+
+      static constexpr int arity = Traits::arity;
+
+      template <std::size_t... Is>
+      static void
+      invoke (Fn&                             fn,
+              sqlite3_context*                ctx,
+              [[maybe_unused]] sqlite3_value** argv,
+              std::index_sequence<Is...>)
+      {
+        if ((false || ...
+             || (!FunctionArg<std::tuple_element_t<Is, Args>>::nullable
+                 && isNull (argv[Is]))))
+          {
+            setNull (ctx);
+            return;
+          }
+
+        FunctionResult<Result>::set (
+            ctx, fn (FunctionArg<std::tuple_element_t<Is, Args>>::get (
+                     argv[Is])...));
+      }
+
+      static void
+      call (sqlite3_context* ctx, int, sqlite3_value** argv)
+      {
+        try
+          {
+            invoke (*static_cast<Fn*> (userData (ctx)),
+                    ctx,
+                    argv,
+                    std::make_index_sequence<std::tuple_size_v<Args>>{});
+          }
+        catch (const std::exception& e)
+          {
+            setError (ctx, e.what ());
+          }
+        catch (...)
+          {
+            setError (ctx, "unknown exception");
+          }
+      }
+
+      static void
+      destroy (void* fn)
+      {
+        delete static_cast<Fn*> (fn);
+      }
+    };
+
+    template <typename T, typename = void>
+    struct HasFinal : std::false_type
+    {
+    };
+
+    template <typename T>
+    struct HasFinal<T, std::void_t<decltype (std::declval<T&> ().final ())>>
+    : std::true_type
+    {
+    };
+
+    /**
+     * \internal
+     * \brief Runs an aggregate with a State object per group
+     *
+     * The State of a group is copied from the registered prototype into
+     * the memory of sqlite3_aggregate_context, when the group gets its
+     * first row, and destroyed in xFinal.
+     *
+     * Rows with a Null argument for a type that can not hold Null are
+     * skipped, like the built in aggregates skip Null values.
+     * Exceptions become an SQL error with the exception message.
+     */
+    template <typename State>
+    struct AggregateFunction
+    {
+      using Traits = FunctionTraits<decltype (&State::step)>;
+      using Args   = typename Traits::Args;
+
+      static constexpr int arity = Traits::arity;
+
+      // sqlite3_aggregate_context memory is 8 byte aligned
+      static_assert (alignof (State) <= 8,
+                     "the aggregate state can not be over aligned");
+
+      struct Slot
+      {
+        alignas (State) unsigned char storage[sizeof (State)];
+        bool constructed;
+      };
+
+      static State*
+      get (sqlite3_context* ctx)
+      {
+        // zeroed memory, so constructed is false the first time
+        auto slot = static_cast<Slot*> (aggregateContext (ctx, sizeof (Slot)));
+        if (slot == nullptr)
+          return nullptr;
+
+        if (!slot->constructed)
+          {
+            new (slot->storage)
+                State (*static_cast<const State*> (userData (ctx)));
+            slot->constructed = true;
+          }
+        return std::launder (reinterpret_cast<State*> (slot->storage));
+      }
+
+      template <typename Call, std::size_t... Is>
+      static void
+      apply (sqlite3_context*                ctx,
+             [[maybe_unused]] sqlite3_value** argv,
+             Call                            call,
+             std::index_sequence<Is...>)
+      {
+        if ((false || ...
+             || (!FunctionArg<std::tuple_element_t<Is, Args>>::nullable
+                 && isNull (argv[Is]))))
+          return;
+
+        State* state = get (ctx);
+        if (state == nullptr)
+          {
+            setNoMemory (ctx);
+            return;
+          }
+
+        call (*state,
+              FunctionArg<std::tuple_element_t<Is, Args>>::get (argv[Is])...);
+      }
+
+      template <typename Call>
+      static void
+      guarded (sqlite3_context* ctx, Call call)
+      {
+        try
+          {
+            call ();
+          }
+        catch (const std::exception& e)
+          {
+            setError (ctx, e.what ());
+          }
+        catch (...)
+          {
+            setError (ctx, "unknown exception");
+          }
+      }
+
+      static void
+      step (sqlite3_context* ctx, int, sqlite3_value** argv)
+      {
+        guarded (ctx, [&] () {
+          apply (
+              ctx,
+              argv,
+              [] (State& state, auto&&... args) {
+                state.step (std::forward<decltype (args)> (args)...);
+              },
+              std::make_index_sequence<std::tuple_size_v<Args>>{});
+        });
+      }
+
+      static void
+      inverse (sqlite3_context* ctx, int, sqlite3_value** argv)
+      {
+        guarded (ctx, [&] () {
+          apply (
+              ctx,
+              argv,
+              [] (State& state, auto&&... args) {
+                state.inverse (std::forward<decltype (args)> (args)...);
+              },
+              std::make_index_sequence<std::tuple_size_v<Args>>{});
+        });
+      }
+
+      static void
+      value (sqlite3_context* ctx)
+      {
+        guarded (ctx, [&] () {
+          State* state = get (ctx);
+          if (state == nullptr)
+            return setNoMemory (ctx);
+
+          using Result = std::decay_t<decltype (state->value ())>;
+          FunctionResult<Result>::set (ctx, state->value ());
+        });
+      }
+
+      static void
+      final (sqlite3_context* ctx)
+      {
+        guarded (ctx, [&] () {
+          State* state = get (ctx);
+          if (state == nullptr)
+            return setNoMemory (ctx);
+
+          // destroy the state also if the result throws
+          struct Destroy
+          {
+            State* state;
+            ~Destroy ()
+            {
+              state->~State ();
+              reinterpret_cast<Slot*> (state)->constructed = false;
+            }
+          } destroy{state};
+
+          if constexpr (HasFinal<State>::value)
+            {
+              using Result = std::decay_t<decltype (state->final ())>;
+              FunctionResult<Result>::set (ctx, state->final ());
+            }
+          else
+            {
+              using Result = std::decay_t<decltype (state->value ())>;
+              FunctionResult<Result>::set (ctx, state->value ());
+            }
+        });
+      }
+
+      static void
+      destroy (void* prototype)
+      {
+        delete static_cast<State*> (prototype);
+      }
+    };
+  }
+  /// \endcond
+}
+
+#endif
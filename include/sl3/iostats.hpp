@@ -0,0 +1,89 @@
+/******************************************************************************
+ ------------- Copyright (c) 2009-2023 H a r a l d  A c h i t z ---------------
+ ---------- < h a r a l d dot a c h i t z at g m a i l dot c o m > ------------
+ ---- This Source Code Form is subject to the terms of the Mozilla Public -----
+ ---- License, v. 2.0. If a copy of the MPL was not distributed with this -----
+ ---------- file, You can obtain one at http://mozilla.org/MPL/2.0/. ----------
+ ******************************************************************************/
+
+#ifndef SL3_IOSTATS_HPP_
+#define SL3_IOSTATS_HPP_
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#include <sl3/config.hpp>
+
+namespace sl3
+{
+  /**
+   * \brief Number of latency histogram buckets in IoCounters
+   *
+   * Bucket i counts calls that took less than 2^i microseconds,
+   * the last bucket counts all slower calls.
+   */
+  constexpr std::size_t ioLatencyBuckets = 24;
+
+  /**
+   * \brief Counters of one kind of file operation
+   */
+  struct IoCounters
+  {
+    /// number of calls
+    uint64_t calls = 0;
+    /// bytes read or written, 0 for sync
+    uint64_t bytes = 0;
+    /// time spent in the calls
+    uint64_t nanoseconds = 0;
+    /// latency histogram, see ioLatencyBuckets
+    std::array<uint64_t, ioLatencyBuckets> latency{};
+  };
+
+  /**
+   * \brief Counters of the operations on one kind of file
+   */
+  struct FileIoStats
+  {
+    IoCounters read;  ///< xRead calls
+    IoCounters write; ///< xWrite calls
+    IoCounters sync;  ///< xSync calls
+  };
+
+  /**
+   * \brief I/O counters of a Database, by file type
+   *
+   * Temporary files and statement journals have no name that links them
+   * to a connection, they are not counted.
+   *
+   * \sa Database::ioStats
+   */
+  struct IoStats
+  {
+    FileIoStats main;    ///< main database file
+    FileIoStats journal; ///< rollback journal
+    FileIoStats wal;     ///< write ahead log
+  };
+
+  /**
+   * \brief Name of the I/O statistics VFS
+   *
+   * Registers, on the first call, a pass through VFS over the default
+   * VFS, that counts reads, writes and syncs, with their bytes and
+   * latency, of the databases opened with it.
+   *
+   * \code
+   *  sl3::Database db{"data.db", 0, sl3::ioStatsVfs ()};
+   *  ...
+   *  const sl3::IoStats stats = db.ioStats ();
+   *  std::cout << stats.wal.sync.calls << " WAL syncs\n";
+   * \endcode
+   *
+   * \throw sl3::SQLite3Error if the VFS can not be registered
+   * \return the VFS name, for Database
+   */
+  LIBSL3_API const std::string& ioStatsVfs ();
+}
+
+#endif
@@ -0,0 +1,149 @@
+/******************************************************************************
+ ------------- Copyright (c) 2009-2023 H a r a l d  A c h i t z ---------------
+ ---------- < h a r a l d dot a c h i t z at g m a i l dot c o m > ------------
+ ---- This Source Code Form is subject to the terms of the Mozilla Public -----
+ ---- License, v. 2.0. If a copy of the MPL was not distributed with this -----
+ ---------- file, You can obtain one at http://mozilla.org/MPL/2.0/. ----------
+ ******************************************************************************/
+
+#ifndef SL3_JSON_HPP_
+#define SL3_JSON_HPP_
+
+#include <cstddef>
+#include <functional>
+#include <iosfwd>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <sl3/config.hpp>
+#include <sl3/rowcallback.hpp>
+
+namespace sl3
+{
+  namespace internal
+  {
+    class BufferedOutput;
+  }
+
+  /**
+   * \brief Layout of the JSON written by JsonWriter
+   */
+  struct JsonFormat
+  {
+    /**
+     * \brief Newline delimited JSON
+     *
+     * If true, each row is written as one line, (NDJSON, JSON Lines).
+     * Otherwise a result is written as one JSON array of rows.
+     */
+    bool lines = false;
+
+    /**
+     * \brief Row layout
+     *
+     * If true, a row is an object with the column names as keys,
+     * otherwise an array of the values.
+     */
+    bool objects = true;
+  };
+
+  /**
+   * \brief A RowCallback that writes a query result as JSON
+   *
+   * Values are written directly from the sqlite statement into a buffer,
+   * text is escaped in place, numbers are formatted via std::to_chars.
+   * Full buffers are passed to the output by a background thread while
+   * the next buffer is filled, so a large result streams with constant
+   * memory.
+   *
+   * Integers and reals are JSON numbers, infinite and NaN reals are null,
+   * text is a JSON string, blobs are base64 encoded strings.
+   * Text is expected to be valid UTF-8, it is not validated.
+   *
+   * \code
+   *  JsonWriter json{response.body ()};
+   *  db.execute ("SELECT id, name FROM t;", json);
+   *  // [{"id":1,"name":"one"},
+   *  // {"id":2,"name":"two"}]
+   * \endcode
+   */
+  class LIBSL3_API JsonWriter : public RowCallback
+  {
+  public:
+    /**
+     * \brief Receives the written data
+     *
+     * Called from a background thread, never concurrently.
+     * An exception is rethrown by the next write or flush.
+     */
+    using Sink = std::function<void (const char* data, std::size_t size)>;
+
+    /**
+     * \brief Constructor
+     * \param out output stream
+     * \param format the JSON layout
+     * \param bufferSize size of each of the 2 output buffers
+     */
+    explicit JsonWriter (std::ostream& out,
+                         JsonFormat    format     = {},
+                         std::size_t   bufferSize = std::size_t{1} << 16);
+
+    /**
+     * \brief Constructor
+     * \param sink receives the output
+     * \param format the JSON layout
+     * \param bufferSize size of each of the 2 output buffers
+     */
+    explicit JsonWriter (Sink        sink,
+                         JsonFormat  format     = {},
+                         std::size_t bufferSize = std::size_t{1} << 16);
+
+    /**
+     * \brief Destructor
+     *
+     * Writes buffered data, errors are ignored, call flush to see them.
+     */
+    ~JsonWriter () override;
+
+    JsonWriter (const JsonWriter&)            = delete;
+    JsonWriter& operator= (const JsonWriter&) = delete;
+
+    /**
+     * \brief Pass all buffered data to the output
+     *
+     * \throw sl3::ErrUnexpected if writing to the stream failed,
+     * or the exception of the sink
+     */
+    void flush ();
+
+    /**
+     * \brief Written rows
+     * \return number of rows written so far
+     */
+    std::size_t rows () const noexcept;
+
+  protected:
+    /// starts a new result
+    void onStart () override;
+
+    /**
+     * \brief Write a row
+     * \param columns the current row
+     * \return true
+     */
+    bool onRow (Columns columns) override;
+
+    /// ends the result and flushes the buffered data
+    void onEnd () override;
+
+  private:
+    JsonFormat                                _format;
+    std::unique_ptr<internal::BufferedOutput> _out;
+    std::vector<std::string>                  _keys;
+    std::size_t                               _resultRows = 0;
+    std::size_t                               _rows       = 0;
+  };
+}
+
+#endif
@@ -0,0 +1,122 @@
+/******************************************************************************
+ ------------- Copyright (c) 2009-2023 H a r a l d  A c h i t z ---------------
+ ---------- < h a r a l d dot a c h i t z at g m a i l dot c o m > ------------
+ ---- This Source Code Form is subject to the terms of the Mozilla Public -----
+ ---- License, v. 2.0. If a copy of the MPL was not distributed with this -----
+ ---------- file, You can obtain one at http://mozilla.org/MPL/2.0/. ----------
+ ******************************************************************************/
+
+#ifndef SL3_MEMDB_HPP_
+#define SL3_MEMDB_HPP_
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#include <sl3/config.hpp>
+#include <sl3/database.hpp>
+
+namespace sl3
+{
+  /**
+   * \brief A named in-memory database shared by connections of a process
+   *
+   * Database (":memory:") is private to one connection. A
+   * SharedMemoryDatabase is a named in-memory database of the sqlite memdb
+   * VFS, every connection opened with open, or with getUri, sees the same
+   * data, so threads can share an in-memory working set, each with its
+   * own connection.
+   *
+   * The database lives while any connection to it is open. The instance
+   * holds one connection, so the data exists at least as long as the
+   * instance, and connections from open keep it alive after that.
+   * When the last connection closes, the data is gone.
+   *
+   * Writers and readers lock like connections to a file, in rollback
+   * journal mode.
+   *
+   * \code
+   *  sl3::SharedMemoryDatabase cache{"prices"};
+   *  auto writer = cache.open ();
+   *  writer.execute ("CREATE TABLE p (id INTEGER PRIMARY KEY, v REAL);");
+   *  std::thread worker{[&cache] {
+   *    auto reader = cache.open ();
+   *    reader.select ("SELECT * FROM p;");
+   *  }};
+   * \endcode
+   */
+  class LIBSL3_API SharedMemoryDatabase
+  {
+  public:
+    /**
+     * \brief Create, or attach to, the shared in-memory database name
+     *
+     * If a database with this name exists in the process, because a
+     * connection to it is open, the instance uses it.
+     *
+     * \throw sl3::ErrOutOfRange if name is empty
+     * \throw sl3::SQLite3Error if sqlite can not open the database
+     * \param name the name, unique in the process
+     */
+    explicit SharedMemoryDatabase (std::string name);
+
+    SharedMemoryDatabase (const SharedMemoryDatabase&)            = delete;
+    SharedMemoryDatabase& operator= (const SharedMemoryDatabase&) = delete;
+    SharedMemoryDatabase& operator= (SharedMemoryDatabase&&)      = delete;
+
+    /// \brief Move constructor
+    SharedMemoryDatabase (SharedMemoryDatabase&&) noexcept = default;
+
+    /**
+     * \brief The name of the database
+     * \return the name given at construction
+     */
+    const std::string&
+    getName () const noexcept
+    {
+      return _name;
+    }
+
+    /**
+     * \brief The URI to open connections to the database
+     *
+     * For use with open flags that contain SQLITE_OPEN_URI,
+     * like the ReadPool default flags.
+     *
+     * \return a file: URI with the memdb VFS
+     */
+    const std::string&
+    getUri () const noexcept
+    {
+      return _uri;
+    }
+
+    /**
+     * \brief Open a new connection to the database
+     *
+     * Connections are independent and can be used in different threads.
+     *
+     * \param flags sqlite open flags, SQLITE_OPEN_URI is always added,
+     *  0 opens read and write
+     * \return the connection
+     */
+    Database open (int flags = 0) const;
+
+    /**
+     * \brief Memory used by the database
+     *
+     * The size of the database image, page count times page size.
+     * Pages on the free list are included, VACUUM releases them.
+     *
+     * \return bytes
+     */
+    std::int64_t memoryUsed ();
+
+  private:
+    std::string _name;
+    std::string _uri;
+    Database    _anchor;
+  };
+}
+
+#endif
@@ -0,0 +1,249 @@
+/******************************************************************************
+ ------------- Copyright (c) 2009-2023 H a r a l d  A c h i t z ---------------
+ ---------- < h a r a l d dot a c h i t z at g m a i l dot c o m > ------------
+ ---- This Source Code Form is subject to the terms of the Mozilla Public -----
+ ---- License, v. 2.0. If a copy of the MPL was not distributed with this -----
+ ---------- file, You can obtain one at http://mozilla.org/MPL/2.0/. ----------
+ ******************************************************************************/
+
+#ifndef SL3_PARAMVIEW_HPP_
+#define SL3_PARAMVIEW_HPP_
+
+#include <cstddef>
+#include <cstdint>
+#include <initializer_list>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <sl3/config.hpp>
+#include <sl3/types.hpp>
+
+namespace sl3
+{
+  /**
+   * \brief A view to bytes owned by the caller
+   *
+   * Like a std::span<const std::byte>, which is not available in C++17.
+   */
+  class LIBSL3_API BlobView
+  {
+  public:
+    /**
+     * \brief An empty view
+     */
+    BlobView () noexcept = default;
+
+    /**
+     * \brief View to size bytes at data
+     * \param data first byte, may be null if size is 0
+     * \param size number of bytes
+     */
+    BlobView (const void* data, std::size_t size) noexcept;
+
+    /**
+     * \brief View to the bytes of a Blob
+     * \param blob the blob
+     */
+    BlobView (const Blob& blob) noexcept;
+
+    /// temporary values would be dangling
+    BlobView (Blob&&) = delete;
+
+    /**
+     * \brief First byte
+     * \return pointer to the bytes, null for an empty default view
+     */
+    const std::byte*
+    data () const noexcept
+    {
+      return _data;
+    }
+
+    /**
+     * \brief Number of bytes
+     * \return the size
+     */
+    std::size_t
+    size () const noexcept
+    {
+      return _size;
+    }
+
+  private:
+    const std::byte* _data = nullptr;
+    std::size_t      _size = 0;
+  };
+
+  /**
+   * \brief One parameter value that borrows texts and blobs
+   *
+   * Integers and reals are stored, texts and blobs are views that are
+   * bound without a copy, the caller's data must outlive the execution.
+   */
+  class LIBSL3_API ParamValue
+  {
+  public:
+    /**
+     * \brief Null value
+     */
+    ParamValue () noexcept;
+
+    /**
+     * \brief Null value
+     */
+    ParamValue (std::nullptr_t) noexcept;
+
+    /**
+     * \brief Integer value
+     * \param value the value
+     */
+    ParamValue (int value) noexcept;
+
+    /**
+     * \brief Integer value
+     * \param value the value
+     */
+    ParamValue (int64_t value) noexcept;
+
+    /**
+     * \brief Real value
+     * \param value the value
+     */
+    ParamValue (double value) noexcept;
+
+    /**
+     * \brief Text value
+     * \param text view to the characters
+     */
+    ParamValue (std::string_view text) noexcept;
+
+    /**
+     * \brief Text value
+     * \param text zero terminated characters, not null
+     */
+    ParamValue (const char* text) noexcept;
+
+    /**
+     * \brief Text value
+     * \param text the text
+     */
+    ParamValue (const std::string& text) noexcept;
+
+    /**
+     * \brief Blob value
+     * \param blob view to the bytes
+     */
+    ParamValue (BlobView blob) noexcept;
+
+    /**
+     * \brief Blob value
+     * \param blob the blob
+     */
+    ParamValue (const Blob& blob) noexcept;
+
+    /// temporary values would be dangling
+    ParamValue (std::string&&) = delete;
+    /// temporary values would be dangling
+    ParamValue (Blob&&) = delete;
+
+    /**
+     * \brief Value type
+     * \return Type::Null, Type::Int, Type::Real, Type::Text or Type::Blob
+     */
+    Type
+    getType () const noexcept
+    {
+      return _type;
+    }
+
+    /// \cond HIDDEN_SYMBOLS
+    int64_t
+    getInt () const noexcept
+    {
+      return _int;
+    }
+
+    double
+    getReal () const noexcept
+    {
+      return _real;
+    }
+
+    std::string_view
+    getText () const noexcept
+    {
+      return {static_cast<const char*> (_data), _size};
+    }
+
+    BlobView
+    getBlob () const noexcept
+    {
+      return {_data, _size};
+    }
+    /// \endcond
+
+  private:
+    Type _type;
+    union
+    {
+      int64_t _int;
+      double  _real;
+    };
+    const void* _data = nullptr;
+    std::size_t _size = 0;
+  };
+
+  /**
+   * \brief A parameter set that borrows texts and blobs of the caller
+   *
+   * Passed to Command::execute or Command::select, it binds all
+   * parameters of a statement for that one execution, texts and blobs
+   * without copies. Empty texts and blobs are bound as empty values,
+   * not as Null.
+   *
+   * \code
+   *  std::string payload = load ();
+   *  auto cmd = db.prepare ("INSERT INTO docs (id, body) VALUES (?, ?);");
+   *  cmd.execute (sl3::ParamView{id, payload});
+   * \endcode
+   */
+  class LIBSL3_API ParamView
+  {
+  public:
+    /**
+     * \brief Constructor
+     * \param values the parameter values, in parameter order
+     */
+    ParamView (std::initializer_list<ParamValue> values);
+
+    /**
+     * \brief Constructor
+     * \param values the parameter values, in parameter order
+     */
+    explicit ParamView (std::vector<ParamValue> values) noexcept;
+
+    /**
+     * \brief Number of values
+     * \return the size
+     */
+    std::size_t
+    size () const noexcept
+    {
+      return _values.size ();
+    }
+
+    /**
+     * \brief Access a value
+     * \param idx index of the value
+     * \throw sl3::ErrOutOfRange if idx is not valid
+     * \return the value
+     */
+    const ParamValue& at (std::size_t idx) const;
+
+  private:
+    std::vector<ParamValue> _values;
+  };
+}
+
+#endif
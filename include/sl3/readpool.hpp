@@ -0,0 +1,191 @@
+/******************************************************************************
+ ------------- Copyright (c) 2009-2023 H a r a l d  A c h i t z ---------------
+ ---------- < h a r a l d dot a c h i t z at g m a i l dot c o m > ------------
+ ---- This Source Code Form is subject to the terms of the Mozilla Public -----
+ ---- License, v. 2.0. If a copy of the MPL was not distributed with this -----
+ ---------- file, You can obtain one at http://mozilla.org/MPL/2.0/. ----------
+ ******************************************************************************/
+
+#ifndef SL3_READPOOL_HPP_
+#define SL3_READPOOL_HPP_
+
+#include <chrono>
+#include <cstddef>
+#include <functional>
+#include <string>
+#include <vector>
+
+#include <sl3/busy.hpp>
+#include <sl3/columns.hpp>
+#include <sl3/config.hpp>
+#include <sl3/database.hpp>
+#include <sl3/dataset.hpp>
+#include <sl3/memdb.hpp>
+
+namespace sl3
+{
+  /**
+   * \brief How a parallel scan splits a query
+   *
+   * The integer key range of table, from min(key) to max(key), is split
+   * into partitions of equal width.
+   */
+  struct ScanPlan
+  {
+    std::string table;          ///< table that provides the key range
+    std::string key = "rowid";  ///< integer key column, rowid by default
+    std::size_t partitions = 0; ///< 0 for one partition per connection
+    bool        snapshot   = true; ///< all partitions see the same data
+  };
+
+  /**
+   * \brief A pool of read connections for parallel, range partitioned
+   * scans of one database file.
+   *
+   * The query of a scan must use the named parameters \c :first and
+   * \c :last, the inclusive key range of a partition, for example
+   *
+   * \code
+   *  ReadPool pool{"data.db"};
+   *  Dataset ds = pool.select (
+   *      "SELECT * FROM big WHERE rowid BETWEEN :first AND :last"
+   *      " ORDER BY rowid;",
+   *      ScanPlan{"big"});
+   * \endcode
+   *
+   * Each partition runs on its own connection and thread.
+   * Partitions are merged in key order, so an ORDER BY key of the query
+   * gives an ordered result.
+   *
+   * With ScanPlan::snapshot, which is the default, the read transactions of
+   * all connections are started while a write transaction is held on an
+   * additional connection, so no write can be committed in between and
+   * all partitions read the same state of the database.
+   * This works with WAL and rollback journals. In rollback journal mode
+   * writers are blocked until the scan has finished.
+   *
+   * All connections wait for locks of writers via a busy policy, by
+   * default up to 5 seconds, see setBusyPolicy.
+   *
+   * A ReadPool can not be used by multiple threads at the same time.
+   * In memory databases can not be shared, except via a memdb VFS or
+   * shared cache URI.
+   */
+  class LIBSL3_API ReadPool
+  {
+  public:
+    /**
+     * \brief Callback for parallel scans
+     *
+     * Called with the partition number and the current row.
+     * Different partitions call it concurrently from different threads,
+     * rows of one partition are passed in order by one thread.
+     * Returning false stops the current partition.
+     */
+    using PartitionCallback = std::function<bool (std::size_t, Columns)>;
+
+    /**
+     * \brief Constructor
+     *
+     * Opens the read connections.
+     *
+     * \throw sl3::SQLite3Error if a connection can not be opened
+     * \param name database file name or URI
+     * \param connections number of connections, 0 for hardware concurrency
+     * \param openFlags sqlite open flags for the read connections,
+     *  0 for read only and URI file names
+     */
+    explicit ReadPool (const std::string& name,
+                       std::size_t        connections = 0,
+                       int                openFlags   = 0);
+
+    /**
+     * \brief Constructor, uses the file of an open database
+     *
+     * \throw sl3::ErrNoConnection if db has no file, like an in memory
+     * database
+     * \param db an open database
+     * \param connections number of connections, 0 for hardware concurrency
+     */
+    explicit ReadPool (Database& db, std::size_t connections = 0);
+
+    /**
+     * \brief Constructor, uses a shared in-memory database
+     *
+     * The read connections keep the database alive.
+     *
+     * \param db the shared database
+     * \param connections number of connections, 0 for hardware concurrency
+     */
+    explicit ReadPool (const SharedMemoryDatabase& db,
+                       std::size_t                 connections = 0);
+
+    ReadPool (const ReadPool&)            = delete;
+    ReadPool& operator= (const ReadPool&) = delete;
+
+    /**
+     * \brief Move constructor
+     */
+    ReadPool (ReadPool&&) noexcept = default;
+
+    /**
+     * \brief Move assignment
+     * \return reference to this
+     */
+    ReadPool& operator= (ReadPool&&) noexcept = default;
+
+    /**
+     * \brief number of read connections
+     * \return connection count
+     */
+    std::size_t size () const noexcept;
+
+    /**
+     * \brief Set how the connections of scans wait for locks
+     *
+     * Applies to the read connections and to the connection that fences
+     * writers for ScanPlan::snapshot. Each connection gets a copy of the
+     * policy, a custom handler is called concurrently from scan threads.
+     *
+     * \param policy the busy policy
+     */
+    void setBusyPolicy (const BusyPolicy& policy);
+
+    /**
+     * \brief Run a range partitioned query
+     *
+     * \throw sl3::ErrTypeMisMatch if sql does not have exactly the
+     * parameters :first and :last
+     * \throw sl3::SQLite3Error or an exception of cb, from any partition
+     * \param sql query with :first and :last parameters
+     * \param plan how to split the query
+     * \param cb called for each row of each partition
+     */
+    void execute (const std::string& sql,
+                  const ScanPlan&    plan,
+                  PartitionCallback  cb);
+
+    /**
+     * \brief Run a range partitioned query and merge the results
+     *
+     * \throw sl3::ErrTypeMisMatch if sql does not have exactly the
+     * parameters :first and :last, or if types do not fit
+     * \throw sl3::SQLite3Error if a partition fails
+     * \param sql query with :first and :last parameters
+     * \param plan how to split the query
+     * \param types the types of the returned Dataset
+     * \return rows of all partitions, in partition order
+     */
+    Dataset select (const std::string& sql,
+                    const ScanPlan&    plan,
+                    const Types&       types = {});
+
+  private:
+    std::string           _name;
+    BusyPolicy            _busy;
+    std::vector<Database> _readers;
+  };
+
+}
+
+#endif
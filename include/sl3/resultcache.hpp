@@ -0,0 +1,147 @@
+/******************************************************************************
+ ------------- Copyright (c) 2009-2023 H a r a l d  A c h i t z ---------------
+ ---------- < h a r a l d dot a c h i t z at g m a i l dot c o m > ------------
+ ---- This Source Code Form is subject to the terms of the Mozilla Public -----
+ ---- License, v. 2.0. If a copy of the MPL was not distributed with this -----
+ ---------- file, You can obtain one at http://mozilla.org/MPL/2.0/. ----------
+ ******************************************************************************/
+
+#ifndef SL3_RESULTCACHE_HPP_
+#define SL3_RESULTCACHE_HPP_
+
+#include <cstddef>
+#include <memory>
+#include <string>
+
+#include <sl3/config.hpp>
+#include <sl3/database.hpp>
+#include <sl3/dataset.hpp>
+#include <sl3/dbvalues.hpp>
+#include <sl3/types.hpp>
+
+namespace sl3
+{
+  /**
+   * \brief Limits of a ResultCache
+   */
+  struct CacheOptions
+  {
+    /// upper bound of the estimated memory of all cached results
+    std::size_t maxBytes = std::size_t{64} << 20;
+    /// upper bound of the number of cached results
+    std::size_t maxEntries = 1024;
+  };
+
+  /**
+   * \brief Counters of a ResultCache
+   */
+  struct CacheStats
+  {
+    std::size_t hits          = 0; ///< results served from the cache
+    std::size_t misses        = 0; ///< results read from the database
+    std::size_t evictions     = 0; ///< entries removed for the limits
+    std::size_t invalidations = 0; ///< entries removed because of changes
+    std::size_t entries       = 0; ///< current number of entries
+    std::size_t bytes         = 0; ///< current estimated memory
+
+    /**
+     * \brief Ratio of hits to all selects
+     * \return hits / (hits + misses), 0 if there was no select
+     */
+    double
+    hitRatio () const noexcept
+    {
+      const auto total = hits + misses;
+      return total ? static_cast<double> (hits) / static_cast<double> (total)
+                   : 0.0;
+    }
+  };
+
+  /**
+   * \brief Caches query results of a Database
+   *
+   * Results are keyed by the SQL, the parameters and the wanted types,
+   * and shared as immutable Dataset.
+   * The least recently used results are evicted to stay within the
+   * CacheOptions limits.
+   *
+   * Entries are invalidated
+   *  - per table, when rows of a table the query reads are changed via
+   *    the database connection (sqlite3_update_hook),
+   *  - all, when another connection or process changed the database
+   *    (PRAGMA data_version), the schema changed, or the connection
+   *    changed rows the update hook does not report, like a DELETE
+   *    without WHERE or changes of WITHOUT ROWID tables.
+   *
+   * The tables a query reads are found via an authorizer when the query
+   * is prepared, including the tables behind views. An authorizer of the
+   * database must be set with Database::setAuthorizer, not with
+   * sqlite3_set_authorizer, which the cache would replace.
+   *
+   * Inside a transaction the cache is bypassed, so that uncommitted
+   * changes are never cached.
+   * Queries with results that change without a change of the data, like
+   * random () or date ('now'), should not use the cache.
+   *
+   * A ResultCache must not outlive its Database, and is, like the
+   * Database, not thread safe.
+   *
+   * \code
+   *  ResultCache cache{db};
+   *  auto        users = cache.select ("SELECT * FROM users WHERE team=?;",
+   *                                    parameters (42));
+   * \endcode
+   */
+  class LIBSL3_API ResultCache
+  {
+  public:
+    /**
+     * \brief Constructor
+     *
+     * \throw sl3::ErrNoConnection if the database is closed
+     * \param db the database
+     * \param options cache limits
+     */
+    explicit ResultCache (Database& db, CacheOptions options = {});
+
+    ~ResultCache ();
+
+    ResultCache (const ResultCache&)            = delete;
+    ResultCache& operator= (const ResultCache&) = delete;
+
+    /**
+     * \brief Get a query result, from the cache if possible
+     *
+     * \throw sl3::ErrNoConnection if the database is closed
+     * \throw sl3::SQLite3Error if the query fails
+     * \param sql the query
+     * \param parameters values for the parameters of the query
+     * \param types wanted field types, see Command::select
+     * \return the result
+     */
+    std::shared_ptr<const Dataset> select (const std::string& sql,
+                                           const DbValues&    parameters = {},
+                                           const Types&       types = {});
+
+    /// remove all entries
+    void invalidate ();
+
+    /**
+     * \brief Remove the entries that read a table
+     * \param table table name
+     */
+    void invalidate (const std::string& table);
+
+    /**
+     * \brief Get the counters
+     * \return the current counters
+     */
+    CacheStats stats () const;
+
+  private:
+    struct State;
+    std::unique_ptr<State> _state;
+  };
+}
+
+#endif
@@ -0,0 +1,78 @@
+/******************************************************************************
+ ------------- Copyright (c) 2009-2023 H a r a l d  A c h i t z ---------------
+ ---------- < h a r a l d dot a c h i t z at g m a i l dot c o m > ------------
+ ---- This Source Code Form is subject to the terms of the Mozilla Public -----
+ ---- License, v. 2.0. If a copy of the MPL was not distributed with this -----
+ ---------- file, You can obtain one at http://mozilla.org/MPL/2.0/. ----------
+ ******************************************************************************/
+
+#ifndef SL3_SLOWIO_HPP_
+#define SL3_SLOWIO_HPP_
+
+#include <chrono>
+#include <cstdint>
+#include <string>
+
+#include <sl3/config.hpp>
+
+namespace sl3
+{
+  /**
+   * \brief Delay added to one kind of file operation
+   *
+   * A call waits latency plus bytes / bytesPerSecond after the real
+   * operation returned.
+   */
+  struct IoLimit
+  {
+    /// fixed delay of each call
+    std::chrono::microseconds latency{0};
+    /// throughput limit, 0 for unlimited
+    uint64_t bytesPerSecond = 0;
+  };
+
+  /**
+   * \brief Delays of the operations of a slowIoVfs
+   */
+  struct IoLimits
+  {
+    IoLimit read;  ///< xRead calls
+    IoLimit write; ///< xWrite calls
+    IoLimit sync;  ///< xSync calls, these transfer no bytes
+  };
+
+  /**
+   * \brief Register a VFS that simulates slow storage
+   *
+   * Registers, or updates, a pass through VFS over the default VFS
+   * named name, that delays reads, writes and syncs of all files by
+   * the given limits. The delays are deterministic, a sleep after each
+   * real call, so slow disks, for example network storage, can be
+   * reproduced on any machine.
+   *
+   * Like the ioStatsVfs, the VFS counts the I/O of databases opened
+   * with it, Database::ioStats includes the injected delays.
+   *
+   * Updated limits apply to the next file operations, also of open
+   * databases.
+   *
+   * \code
+   *  sl3::IoLimits limits;
+   *  limits.write.latency        = std::chrono::milliseconds{2};
+   *  limits.write.bytesPerSecond = 50 * 1024 * 1024;
+   *  limits.sync.latency         = std::chrono::milliseconds{10};
+   *  sl3::Database db{"data.db", 0, sl3::slowIoVfs ("slowdisk", limits)};
+   * \endcode
+   *
+   * \param name the VFS name
+   * \param limits the delays
+   *
+   * \throw sl3::ErrOutOfRange if name is empty or used by another VFS
+   * \throw sl3::SQLite3Error if the VFS can not be registered
+   * \return name, for Database
+   */
+  LIBSL3_API std::string slowIoVfs (const std::string& name,
+                                    const IoLimits&    limits);
+}
+
+#endif
@@ -0,0 +1,203 @@
+/******************************************************************************
+ ------------- Copyright (c) 2009-2023 H a r a l d  A c h i t z ---------------
+ ---------- < h a r a l d dot a c h i t z at g m a i l dot c o m > ------------
+ ---- This Source Code Form is subject to the terms of the Mozilla Public -----
+ ---- License, v. 2.0. If a copy of the MPL was not distributed with this -----
+ ---------- file, You can obtain one at http://mozilla.org/MPL/2.0/. ----------
+ ******************************************************************************/
+
+#ifndef SL3_SNAPSHOT_HPP_
+#define SL3_SNAPSHOT_HPP_
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include <sl3/config.hpp>
+#include <sl3/dataset.hpp>
+#include <sl3/dbvalue.hpp>
+#include <sl3/types.hpp>
+
+namespace sl3
+{
+  /**
+   * \brief Write a Dataset into a binary snapshot file
+   *
+   * The snapshot is a header with the field names and types, followed by
+   * per field a storage type byte and a fixed width 8 byte slot per row,
+   * and a heap for names, text and blob data.
+   * Numbers are stored in host byte order, a snapshot can be opened on
+   * machines with the same byte order.
+   *
+   * An existing file is replaced.
+   *
+   * \throw sl3::ErrUnexpected if the file can not be written
+   * \throw sl3::ErrTypeMisMatch if rows have different sizes
+   * \param ds the Dataset
+   * \param path file name
+   */
+  LIBSL3_API void writeSnapshot (const Dataset& ds, const std::string& path);
+
+  /**
+   * \brief Read only view of a snapshot file written by writeSnapshot
+   *
+   * The file is memory mapped, opening it reads only the header.
+   * Numbers, text and blobs are accessed in place, without a copy,
+   * so multiple processes can share one snapshot via the page cache.
+   *
+   * Text and blob views are valid as long as the DatasetView exists.
+   *
+   * \code
+   *  writeSnapshot (db.select ("SELECT * FROM t;"), "t.snapshot");
+   *
+   *  // in any process
+   *  DatasetView view{"t.snapshot"};
+   *  for (std::size_t row = 0; row < view.size (); ++row)
+   *    use (view.getText (row, 1));
+   * \endcode
+   */
+  class LIBSL3_API DatasetView
+  {
+  public:
+    /**
+     * \brief Map a snapshot file
+     *
+     * \throw sl3::ErrUnexpected if the file can not be mapped or is not
+     * a valid snapshot
+     * \param path file name
+     */
+    explicit DatasetView (const std::string& path);
+
+    ~DatasetView ();
+
+    DatasetView (DatasetView&& other) noexcept;
+    DatasetView& operator= (DatasetView&& other) noexcept;
+
+    DatasetView (const DatasetView&)            = delete;
+    DatasetView& operator= (const DatasetView&) = delete;
+
+    /**
+     * \brief Number of rows
+     * \return rows
+     */
+    std::size_t size () const noexcept;
+
+    /**
+     * \brief Field names
+     * \return the names of the fields
+     */
+    const std::vector<std::string>& getNames () const noexcept;
+
+    /**
+     * \brief Field types
+     * \return the types of the fields
+     */
+    const Types& getTypes () const noexcept;
+
+    /**
+     * \brief Get the index of a field by name
+     *
+     * \throw sl3::ErrOutOfRange if name is not found
+     * \param name field name
+     * \return field index
+     */
+    std::size_t getIndex (const std::string& name) const;
+
+    /**
+     * \brief Storage type of a value
+     *
+     * \throw sl3::ErrOutOfRange if row or field are out of range
+     * \param row row index
+     * \param field field index
+     * \return the storage type, Type::Null for a Null value
+     */
+    Type getType (std::size_t row, std::size_t field) const;
+
+    /**
+     * \brief Check if a value is Null
+     *
+     * \throw sl3::ErrOutOfRange if row or field are out of range
+     * \param row row index
+     * \param field field index
+     * \return true if the value is Null
+     */
+    bool isNull (std::size_t row, std::size_t field) const;
+
+    /**
+     * \brief Get an integer value
+     *
+     * \throw sl3::ErrOutOfRange if row or field are out of range
+     * \throw sl3::ErrNullValueAccess if the value is Null
+     * \throw sl3::ErrTypeMisMatch if the value is not an integer
+     * \param row row index
+     * \param field field index
+     * \return the value
+     */
+    int64_t getInt (std::size_t row, std::size_t field) const;
+
+    /**
+     * \brief Get a real value
+     *
+     * \copydetails getInt
+     */
+    double getReal (std::size_t row, std::size_t field) const;
+
+    /**
+     * \brief Get a text value, without a copy
+     *
+     * \copydetails getInt
+     */
+    std::string_view getText (std::size_t row, std::size_t field) const;
+
+    /**
+     * \brief Get the bytes of a blob value, without a copy
+     *
+     * \copydetails getInt
+     */
+    std::string_view getBlob (std::size_t row, std::size_t field) const;
+
+    /**
+     * \brief Get a value as DbValue
+     *
+     * The DbValue has the type of the field and a copy of the value.
+     *
+     * \throw sl3::ErrOutOfRange if row or field are out of range
+     * \param row row index
+     * \param field field index
+     * \return the value
+     */
+    DbValue getValue (std::size_t row, std::size_t field) const;
+
+    /**
+     * \brief Copy the snapshot into a Dataset
+     * \return a Dataset with the names, types and rows of the snapshot
+     */
+    Dataset toDataset () const;
+
+  private:
+    struct Mapping;
+
+    const unsigned char* slot (std::size_t row,
+                               std::size_t field,
+                               Type        expected) const;
+    std::string_view     bytes (std::size_t row,
+                                std::size_t field,
+                                Type        expected) const;
+
+    std::unique_ptr<Mapping>                     _map;
+    std::size_t                                  _rows = 0;
+    std::vector<std::string>                     _names;
+    Types                                        _types;
+    std::unordered_map<std::string, std::size_t> _nameIndex;
+    std::vector<const unsigned char*>            _kinds;
+    std::vector<const unsigned char*>            _slots;
+    const unsigned char*                         _heap     = nullptr;
+    std::size_t                                  _heapSize = 0;
+  };
+}
+
+#endif
@@ -0,0 +1,275 @@
+/******************************************************************************
+ ------------- Copyright (c) 2009-2023 H a r a l d  A c h i t z ---------------
+ ---------- < h a r a l d dot a c h i t z at g m a i l dot c o m > ------------
+ ---- This Source Code Form is subject to the terms of the Mozilla Public -----
+ ---- License, v. 2.0. If a copy of the MPL was not distributed with this -----
+ ---------- file, You can obtain one at http://mozilla.org/MPL/2.0/. ----------
+ ******************************************************************************/
+
+#ifndef SL3_VTAB_HPP_
+#define SL3_VTAB_HPP_
+
+#include <cstddef>
+#include <functional>
+#include <iterator>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include <sl3/config.hpp>
+#include <sl3/dataset.hpp>
+#include <sl3/dbvalue.hpp>
+#include <sl3/function.hpp>
+#include <sl3/types.hpp>
+
+namespace sl3
+{
+  /**
+   * \brief Describes a column of a virtual table over a range of structs
+   *
+   * Create instances with tableColumn.
+   *
+   * \tparam Row the struct type
+   */
+  template <typename Row> struct TableColumn
+  {
+    /// column name
+    std::string name;
+    /// declared column type
+    Type type = Type::Variant;
+    /// if constraints on this column are looked up in an index
+    bool indexed = false;
+    /// writes the value of a row to a sqlite result
+    std::function<void (sqlite3_context*, const Row&)> result;
+    /// the value of a row, to build the index
+    std::function<DbValue (const Row&)> value;
+  };
+
+  /// \cond HIDDEN_SYMBOLS
+  namespace internal
+  {
+    template <typename T> struct ColumnType
+    {
+      static constexpr Type type
+          = std::is_integral_v<T>         ? Type::Int
+            : std::is_floating_point_v<T> ? Type::Real
+                                          : Type::Variant;
+    };
+
+    template <> struct ColumnType<std::string>
+    {
+      static constexpr Type type = Type::Text;
+    };
+
+    template <> struct ColumnType<std::string_view>
+    {
+      static constexpr Type type = Type::Text;
+    };
+
+    template <> struct ColumnType<Blob>
+    {
+      static constexpr Type type = Type::Blob;
+    };
+
+    template <typename T> struct ColumnType<std::optional<T>> : ColumnType<T>
+    {
+    };
+
+    template <typename Rows> struct RowOf
+    {
+      using type
+          = std::decay_t<decltype (*std::begin (std::declval<Rows&> ()))>;
+    };
+
+    template <typename T>
+    DbValue
+    toDbValue (const T& val)
+    {
+      if constexpr (std::is_same_v<T, bool>)
+        return DbValue{val ? 1 : 0};
+      else if constexpr (std::is_integral_v<T>)
+        return DbValue{static_cast<int64_t> (val)};
+      else if constexpr (std::is_floating_point_v<T>)
+        return DbValue{static_cast<double> (val)};
+      else if constexpr (std::is_same_v<T, std::string_view>)
+        return DbValue{std::string{val}};
+      else if constexpr (std::is_same_v<T, DbValue>)
+        return val;
+      else
+        return DbValue{val};
+    }
+
+    template <typename T>
+    DbValue
+    toDbValue (const std::optional<T>& val)
+    {
+      return val ? toDbValue (*val) : DbValue{ColumnType<T>::type};
+    }
+
+    /**
+     * \internal
+     * \brief The data of a virtual table
+     */
+    class LIBSL3_API TableSource
+    {
+    public:
+      TableSource ()                   = default;
+      TableSource (const TableSource&) = delete;
+      TableSource& operator= (const TableSource&) = delete;
+
+      virtual ~TableSource ();
+
+      /// column names
+      virtual std::vector<std::string> getNames () const = 0;
+
+      /// declared column types
+      virtual Types getTypes () const = 0;
+
+      /// number of rows
+      virtual std::size_t size () const = 0;
+
+      /// write a value to a sqlite result
+      virtual void
+      result (sqlite3_context* ctx, std::size_t row, std::size_t field) const
+          = 0;
+
+      /// a Dataset that has its own indexes, for lookups on its fields
+      virtual const Dataset*
+      dataset () const
+      {
+        return nullptr;
+      }
+
+      /// fields that get an index when the table is created
+      virtual std::vector<std::size_t>
+      indexedFields () const
+      {
+        return {};
+      }
+
+      /// value of an indexed field, to build the index
+      virtual DbValue
+      key (std::size_t, std::size_t) const
+      {
+        return DbValue{Type::Variant};
+      }
+    };
+
+    template <typename Rows, typename Row>
+    class RowsSource final : public TableSource
+    {
+    public:
+      RowsSource (const Rows& rows, std::vector<TableColumn<Row>> columns)
+      : _rows (rows)
+      , _columns (std::move (columns))
+      {
+      }
+
+      std::vector<std::string>
+      getNames () const override
+      {
+        std::vector<std::string> names;
+        for (const auto& column : _columns)
+          names.push_back (column.name);
+        return names;
+      }
+
+      Types
+      getTypes () const override
+      {
+        std::vector<Type> types;
+        for (const auto& column : _columns)
+          types.push_back (column.type);
+        return Types{std::move (types)};
+      }
+
+      std::size_t
+      size () const override
+      {
+        return static_cast<std::size_t> (std::size (_rows));
+      }
+
+      void
+      result (sqlite3_context* ctx,
+              std::size_t      row,
+              std::size_t      field) const override
+      {
+        _columns[field].result (ctx, _rows[row]);
+      }
+
+      std::vector<std::size_t>
+      indexedFields () const override
+      {
+        std::vector<std::size_t> fields;
+        for (std::size_t i = 0; i < _columns.size (); ++i)
+          if (_columns[i].indexed)
+            fields.push_back (i);
+        return fields;
+      }
+
+      DbValue
+      key (std::size_t row, std::size_t field) const override
+      {
+        return _columns[field].value (_rows[row]);
+      }
+
+    private:
+      const Rows&                   _rows;
+      std::vector<TableColumn<Row>> _columns;
+    };
+  }
+  /// \endcond
+
+  /**
+   * \brief Create a column description from a getter
+   *
+   * The getter returns the column value of a row, supported are the
+   * result types of Database::createFunction.
+   *
+   * \param name column name
+   * \param get callable that returns the value of a row
+   * \param indexed if constraints on this column are looked up in an index
+   * \return the column description
+   */
+  template <typename Row, typename Get>
+  TableColumn<Row>
+  tableColumn (std::string name, Get get, bool indexed = false)
+  {
+    using T = std::decay_t<decltype (get (std::declval<const Row&> ()))>;
+
+    TableColumn<Row> column;
+    column.name    = std::move (name);
+    column.type    = internal::ColumnType<T>::type;
+    column.indexed = indexed;
+    column.result  = [get] (sqlite3_context* ctx, const Row& row) {
+      internal::FunctionResult<T>::set (ctx, get (row));
+    };
+    column.value = [get] (const Row& row) {
+      return internal::toDbValue (get (row));
+    };
+    return column;
+  }
+
+  /**
+   * \brief Create a column description from a data member
+   *
+   * \param name column name
+   * \param member pointer to the data member
+   * \param indexed if constraints on this column are looked up in an index
+   * \return the column description
+   */
+  template <typename Row, typename T>
+  TableColumn<Row>
+  tableColumn (std::string name, T Row::*member, bool indexed = false)
+  {
+    return tableColumn<Row> (
+        std::move (name),
+        [member] (const Row& row) -> const T& { return row.*member; },
+        indexed);
+  }
+}
+
+#endif
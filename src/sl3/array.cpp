@@ -0,0 +1,257 @@
+/******************************************************************************
+ ------------- Copyright (c) 2009-2023 H a r a l d  A c h i t z ---------------
+ ---------- < h a r a l d dot a c h i t z at g m a i l dot c o m > ------------
+ ---- This Source Code Form is subject to the terms of the Mozilla Public -----
+ ---- License, v. 2.0. If a copy of the MPL was not distributed with this -----
+ ---------- file, You can obtain one at http://mozilla.org/MPL/2.0/. ----------
+ ******************************************************************************/
+
+#include <sl3/array.hpp>
+
+#include <sqlite3.h>
+
+#include <new>
+
+#include "arraymodule.hpp"
+
+namespace sl3
+{
+  ArrayParameter::ArrayParameter (const int64_t* data,
+                                  std::size_t    size) noexcept
+  : _type (Type::Int)
+  , _data (data)
+  , _size (size)
+  {
+  }
+
+  ArrayParameter::ArrayParameter (const double* data,
+                                  std::size_t   size) noexcept
+  : _type (Type::Real)
+  , _data (data)
+  , _size (size)
+  {
+  }
+
+  ArrayParameter::ArrayParameter (std::vector<std::string_view> texts) noexcept
+  : _type (Type::Text)
+  , _data (nullptr)
+  , _size (texts.size ())
+  , _texts (std::move (texts))
+  {
+  }
+
+  ArrayParameter::ArrayParameter (const std::vector<int64_t>& values) noexcept
+  : ArrayParameter (values.data (), values.size ())
+  {
+  }
+
+  ArrayParameter::ArrayParameter (const std::vector<double>& values) noexcept
+  : ArrayParameter (values.data (), values.size ())
+  {
+  }
+
+  ArrayParameter::ArrayParameter (const std::vector<std::string>& values)
+  : ArrayParameter (std::vector<std::string_view> (values.begin (),
+                                                   values.end ()))
+  {
+  }
+
+  namespace internal
+  {
+    namespace
+    {
+      /*
+       * eponymous table valued function
+       *   sl3_array (ptr) -> value
+       * ptr is a ArrayParameter bound with sqlite3_bind_pointer,
+       * no pointer, or a pointer of an other type, gives no rows
+       */
+      enum Column
+      {
+        ValueColumn,
+        PointerColumn
+      };
+
+      struct Cursor : sqlite3_vtab_cursor
+      {
+        const ArrayParameter* array = nullptr;
+        std::size_t           pos   = 0;
+      };
+
+      int
+      connect (sqlite3* db,
+               void*,
+               int,
+               const char* const*,
+               sqlite3_vtab** vtab,
+               char**)
+      {
+        const int rc = sqlite3_declare_vtab (
+            db, "CREATE TABLE x(value, pointer HIDDEN);");
+        if (rc != SQLITE_OK)
+          return rc;
+
+        *vtab = new (std::nothrow) sqlite3_vtab ();
+        if (*vtab == nullptr)
+          return SQLITE_NOMEM;
+        sqlite3_vtab_config (db, SQLITE_VTAB_INNOCUOUS);
+        return SQLITE_OK;
+      }
+
+      int
+      disconnect (sqlite3_vtab* vtab)
+      {
+        delete vtab;
+        return SQLITE_OK;
+      }
+
+      int
+      bestIndex (sqlite3_vtab*, sqlite3_index_info* info)
+      {
+        bool unusable = false;
+        for (int i = 0; i < info->nConstraint; ++i)
+          {
+            const auto& constraint = info->aConstraint[i];
+            if (constraint.iColumn != PointerColumn
+                || constraint.op != SQLITE_INDEX_CONSTRAINT_EQ)
+              continue;
+
+            if (!constraint.usable)
+              {
+                unusable = true;
+                continue;
+              }
+            info->aConstraintUsage[i].argvIndex = 1;
+            info->aConstraintUsage[i].omit      = 1;
+            info->idxNum                        = 1;
+            info->estimatedCost                 = 1.0;
+            info->estimatedRows                 = 100;
+            return SQLITE_OK;
+          }
+
+        // let the planner find an order where the pointer is known
+        if (unusable)
+          return SQLITE_CONSTRAINT;
+
+        info->idxNum        = 0;
+        info->estimatedCost = 1.0;
+        info->estimatedRows = 1;
+        return SQLITE_OK;
+      }
+
+      int
+      open (sqlite3_vtab*, sqlite3_vtab_cursor** cursor)
+      {
+        *cursor = new (std::nothrow) Cursor ();
+        return *cursor ? SQLITE_OK : SQLITE_NOMEM;
+      }
+
+      int
+      close (sqlite3_vtab_cursor* cursor)
+      {
+        delete static_cast<Cursor*> (cursor);
+        return SQLITE_OK;
+      }
+
+      int
+      filter (sqlite3_vtab_cursor* base,
+              int                  idxNum,
+              const char*,
+              int,
+              sqlite3_value** argv)
+      {
+        auto& cursor = *static_cast<Cursor*> (base);
+        cursor.pos   = 0;
+        cursor.array = idxNum == 1 ? static_cast<const ArrayParameter*> (
+                           sqlite3_value_pointer (argv[0], arrayPointerType))
+                                   : nullptr;
+        return SQLITE_OK;
+      }
+
+      int
+      next (sqlite3_vtab_cursor* base)
+      {
+        ++static_cast<Cursor*> (base)->pos;
+        return SQLITE_OK;
+      }
+
+      int
+      eof (sqlite3_vtab_cursor* base)
+      {
+        const auto& cursor = *static_cast<Cursor*> (base);
+        return cursor.array == nullptr || cursor.pos >= cursor.array->size ();
+      }
+
+      int
+      column (sqlite3_vtab_cursor* base, sqlite3_context* ctx, int field)
+      {
+        const auto& cursor = *static_cast<Cursor*> (base);
+        if (field != ValueColumn)
+          {
+            sqlite3_result_null (ctx);
+            return SQLITE_OK;
+          }
+
+        const ArrayParameter& array = *cursor.array;
+        switch (array.getType ())
+          {
+          case Type::Int:
+            sqlite3_result_int64 (ctx, array.ints ()[cursor.pos]);
+            break;
+
+          case Type::Real:
+            sqlite3_result_double (ctx, array.reals ()[cursor.pos]);
+            break;
+
+          default:
+            {
+              const std::string_view text = array.texts ()[cursor.pos];
+              sqlite3_result_text64 (ctx,
+                                     text.data () ? text.data () : "",
+                                     text.size (),
+                                     SQLITE_TRANSIENT,
+                                     SQLITE_UTF8);
+            }
+            break;
+          }
+        return SQLITE_OK;
+      }
+
+      int
+      rowid (sqlite3_vtab_cursor* base, sqlite3_int64* id)
+      {
+        *id = static_cast<sqlite3_int64> (static_cast<Cursor*> (base)->pos);
+        return SQLITE_OK;
+      }
+
+      const sqlite3_module*
+      arrayModule ()
+      {
+        static const sqlite3_module mod = [] () {
+          sqlite3_module m{};
+          m.iVersion    = 1;
+          m.xCreate     = nullptr; // eponymous only
+          m.xConnect    = &connect;
+          m.xBestIndex  = &bestIndex;
+          m.xDisconnect = &disconnect;
+          m.xDestroy    = &disconnect;
+          m.xOpen       = &open;
+          m.xClose      = &close;
+          m.xFilter     = &filter;
+          m.xNext       = &next;
+          m.xEof        = &eof;
+          m.xColumn     = &column;
+          m.xRowid      = &rowid;
+          return m;
+        }();
+        return &mod;
+      }
+    }
+
+    int
+    createArrayModule (sqlite3* db)
+    {
+      return sqlite3_create_module (db, "sl3_array", arrayModule (), nullptr);
+    }
+  }
+}
@@ -0,0 +1,15 @@
+#pragma once
+
+#include <sqlite3.h>
+
+namespace sl3
+{
+  namespace internal
+  {
+    /// pointer type name of ArrayParameter objects bound to statements
+    constexpr const char* arrayPointerType = "sl3_array";
+
+    /// register the sl3_array table valued function on a connection
+    int createArrayModule (sqlite3* db);
+  }
+}
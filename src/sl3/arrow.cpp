@@ -0,0 +1,899 @@
+/******************************************************************************
+ ------------- Copyright (c) 2009-2023 H a r a l d  A c h i t z ---------------
+ ---------- < h a r a l d dot a c h i t z at g m a i l dot c o m > ------------
+ ---- This Source Code Form is subject to the terms of the Mozilla Public -----
+ ---- License, v. 2.0. If a copy of the MPL was not distributed with this -----
+ ---------- file, You can obtain one at http://mozilla.org/MPL/2.0/. ----------
+ ******************************************************************************/
+
+#include <sl3/arrow.hpp>
+
+#include <sqlite3.h>
+
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+#include <limits>
+#include <string>
+
+#include <sl3/columns.hpp>
+#include <sl3/error.hpp>
+
+#include "connection.hpp"
+#include "utils.hpp"
+
+namespace sl3
+{
+  namespace
+  {
+    constexpr std::size_t maxOffset
+        = static_cast<std::size_t> (std::numeric_limits<int32_t>::max ());
+
+    // the Arrow format of a sl3 type
+    const char*
+    formatOf (Type type)
+    {
+      switch (type)
+        {
+        case Type::Int:
+          return "l";
+        case Type::Real:
+          return "g";
+        case Type::Blob:
+          return "z";
+        default:
+          return "u";
+        }
+    }
+
+    bool
+    isVarSize (Type type)
+    {
+      return type == Type::Text || type == Type::Blob;
+    }
+
+    // one column of a batch under construction
+    struct ColumnBuffers
+    {
+      Type                       type = Type::Text;
+      std::vector<unsigned char> validity;
+      int64_t                    nulls = 0;
+      std::vector<int64_t>       ints;
+      std::vector<double>        reals;
+      std::vector<int32_t>       offsets;
+      std::vector<char>          data;
+    };
+
+    // private_data of an exported array, the parent or a column
+    struct ArrayData
+    {
+      ColumnBuffers           column;
+      const void*             buffers[3] = {nullptr, nullptr, nullptr};
+      std::vector<ArrowArray>  children;
+      std::vector<ArrowArray*> childPtrs;
+    };
+
+    // private_data of an exported schema, the parent or a column
+    struct SchemaData
+    {
+      std::string               name;
+      std::vector<ArrowSchema>  children;
+      std::vector<ArrowSchema*> childPtrs;
+    };
+
+    void
+    releaseArray (ArrowArray* array)
+    {
+      auto* data = static_cast<ArrayData*> (array->private_data);
+      // children moved out by the consumer have release set to nullptr
+      for (ArrowArray* child : data->childPtrs)
+        if (child->release)
+          child->release (child);
+
+      delete data;
+      array->release = nullptr;
+    }
+
+    void
+    releaseSchema (ArrowSchema* schema)
+    {
+      auto* data = static_cast<SchemaData*> (schema->private_data);
+      for (ArrowSchema* child : data->childPtrs)
+        if (child->release)
+          child->release (child);
+
+      delete data;
+      schema->release = nullptr;
+    }
+
+    void
+    exportColumn (ColumnBuffers&& column, int64_t length, ArrowArray* out)
+    {
+      auto data    = std::make_unique<ArrayData> ();
+      data->column = std::move (column);
+      auto& col    = data->column;
+
+      data->buffers[0] = col.nulls > 0 ? col.validity.data () : nullptr;
+      if (isVarSize (col.type))
+        {
+          if (col.data.capacity () == 0) // no null pointer for empty data
+            col.data.reserve (1);
+          data->buffers[1] = col.offsets.data ();
+          data->buffers[2] = col.data.data ();
+        }
+      else if (col.type == Type::Int)
+        {
+          data->buffers[1] = col.ints.data ();
+        }
+      else
+        {
+          data->buffers[1] = col.reals.data ();
+        }
+
+      out->length     = length;
+      out->null_count = col.nulls;
+      out->offset     = 0;
+      out->n_buffers  = isVarSize (col.type) ? 3 : 2;
+      out->n_children = 0;
+      out->buffers    = data->buffers;
+      out->children   = nullptr;
+      out->dictionary = nullptr;
+      out->release    = &releaseArray;
+      out->private_data = data.release ();
+    }
+
+    void
+    exportSchema (const std::vector<std::string>& names,
+                  const std::vector<Type>&        types,
+                  ArrowSchema*                    out)
+    {
+      auto parent = std::make_unique<SchemaData> ();
+      parent->children.resize (types.size ());
+      for (std::size_t i = 0; i < types.size (); ++i)
+        {
+          auto data  = std::make_unique<SchemaData> ();
+          data->name = i < names.size () ? names[i] : std::string{};
+
+          ArrowSchema& child = parent->children[i];
+          child.format       = formatOf (types[i]);
+          child.name         = data->name.c_str ();
+          child.metadata     = nullptr;
+          child.flags        = ARROW_FLAG_NULLABLE;
+          child.n_children   = 0;
+          child.children     = nullptr;
+          child.dictionary   = nullptr;
+          child.release      = &releaseSchema;
+          child.private_data = data.release ();
+          parent->childPtrs.push_back (&child);
+        }
+
+      out->format       = "+s";
+      out->name         = "";
+      out->metadata     = nullptr;
+      out->flags        = 0;
+      out->n_children   = static_cast<int64_t> (types.size ());
+      out->children     = parent->childPtrs.data ();
+      out->dictionary   = nullptr;
+      out->release      = &releaseSchema;
+      out->private_data = parent.release ();
+    }
+
+    // Arrow type of a Type::Variant result column via the affinity rules,
+    // Type::Variant if the declared type does not tell
+    Type
+    declaredType (const char* decl)
+    {
+      if (!decl)
+        return Type::Variant;
+
+      std::string upper{decl};
+      for (char& c : upper)
+        c = static_cast<char> (std::toupper (static_cast<unsigned char> (c)));
+
+      const auto has = [&upper] (const char* part) {
+        return upper.find (part) != std::string::npos;
+      };
+
+      if (has ("INT"))
+        return Type::Int;
+      if (has ("CHAR") || has ("CLOB") || has ("TEXT"))
+        return Type::Text;
+      if (has ("BLOB"))
+        return Type::Blob;
+      if (has ("REAL") || has ("FLOA") || has ("DOUB"))
+        return Type::Real;
+
+      return Type::Variant;
+    }
+
+    Type
+    storageType (int sqliteType)
+    {
+      switch (sqliteType)
+        {
+        case SQLITE_INTEGER:
+          return Type::Int;
+        case SQLITE_FLOAT:
+          return Type::Real;
+        case SQLITE_BLOB:
+          return Type::Blob;
+        default:
+          return Type::Text;
+        }
+    }
+  }
+
+  namespace internal
+  {
+    /**
+     * \internal
+     * \brief Column buffers of a record batch under construction
+     */
+    class ArrowBatch
+    {
+    public:
+      ArrowBatch (std::vector<std::string> names,
+                  std::vector<Type>        types,
+                  std::size_t              reserve)
+      : _names (std::move (names))
+      , _types (std::move (types))
+      , _reserve (reserve)
+      {
+        restart ();
+      }
+
+      const std::vector<Type>&
+      types () const noexcept
+      {
+        return _types;
+      }
+
+      std::size_t
+      size () const noexcept
+      {
+        return _rows;
+      }
+
+      // true if bytes more text or binary data fit into column col
+      bool
+      fits (std::size_t col, std::size_t bytes) const noexcept
+      {
+        return _columns[col].data.size () + bytes <= maxOffset;
+      }
+
+      void
+      appendNull (std::size_t col)
+      {
+        ColumnBuffers& c = _columns[col];
+        if (c.validity.empty ())
+          c.validity.reserve (_reserve / 8 + 1);
+        c.validity.resize (_rows / 8 + 1, 0xFF);
+        c.validity[_rows / 8] &= static_cast<unsigned char> (
+            ~(1U << (_rows % 8)));
+        c.nulls += 1;
+
+        switch (c.type)
+          {
+          case Type::Int:
+            c.ints.push_back (0);
+            break;
+          case Type::Real:
+            c.reals.push_back (0.0);
+            break;
+          default:
+            c.offsets.push_back (c.offsets.back ());
+            break;
+          }
+      }
+
+      void
+      appendInt (std::size_t col, int64_t val)
+      {
+        _columns[col].ints.push_back (val);
+      }
+
+      void
+      appendReal (std::size_t col, double val)
+      {
+        _columns[col].reals.push_back (val);
+      }
+
+      void
+      appendBytes (std::size_t col, const void* data, std::size_t size)
+      {
+        ColumnBuffers& c     = _columns[col];
+        const auto*    bytes = static_cast<const char*> (data);
+        c.data.insert (c.data.end (), bytes, bytes + size);
+        c.offsets.push_back (static_cast<int32_t> (c.data.size ()));
+      }
+
+      void
+      endRow ()
+      {
+        _rows += 1;
+        for (auto& c : _columns)
+          if (!c.validity.empty ())
+            c.validity.resize (_rows / 8 + 1, 0xFF);
+      }
+
+      // hand the current rows over and start an empty batch
+      void
+      release (ArrowSchema* schema, ArrowArray* array)
+      {
+        exportSchema (_names, _types, schema);
+
+        auto parent = std::make_unique<ArrayData> ();
+        parent->children.resize (_columns.size ());
+        const auto length = static_cast<int64_t> (_rows);
+        for (std::size_t i = 0; i < _columns.size (); ++i)
+          {
+            exportColumn (
+                std::move (_columns[i]), length, &parent->children[i]);
+            parent->childPtrs.push_back (&parent->children[i]);
+          }
+
+        array->length     = length;
+        array->null_count = 0;
+        array->offset     = 0;
+        array->n_buffers  = 1;
+        array->n_children = static_cast<int64_t> (_columns.size ());
+        array->buffers    = parent->buffers;
+        array->children   = parent->childPtrs.data ();
+        array->dictionary = nullptr;
+        array->release    = &releaseArray;
+        array->private_data = parent.release ();
+
+        restart ();
+      }
+
+    private:
+      void
+      restart ()
+      {
+        _rows = 0;
+        _columns.assign (_types.size (), ColumnBuffers{});
+        for (std::size_t i = 0; i < _types.size (); ++i)
+          {
+            ColumnBuffers& c = _columns[i];
+            c.type           = _types[i];
+            switch (c.type)
+              {
+              case Type::Int:
+                c.ints.reserve (_reserve);
+                break;
+              case Type::Real:
+                c.reals.reserve (_reserve);
+                break;
+              default:
+                c.offsets.reserve (_reserve + 1);
+                c.offsets.push_back (0);
+                break;
+              }
+          }
+      }
+
+      std::vector<std::string>   _names;
+      std::vector<Type>          _types;
+      std::size_t                _reserve;
+      std::size_t                _rows = 0;
+      std::vector<ColumnBuffers> _columns;
+    };
+  }
+
+  namespace
+  {
+    // hand a batch to the callback, release what it did not take
+    bool
+    deliver (internal::ArrowBatch& batch, const ArrowBatchCallback& callback)
+    {
+      ArrowSchema schema{};
+      ArrowArray  array{};
+      batch.release (&schema, &array);
+
+      struct Guard
+      {
+        ArrowSchema& schema;
+        ArrowArray&  array;
+        ~Guard ()
+        {
+          if (schema.release)
+            schema.release (&schema);
+          if (array.release)
+            array.release (&array);
+        }
+      } guard{schema, array};
+
+      return callback (&schema, &array);
+    }
+
+    // upper bound for the initial capacity of column buffers
+    constexpr std::size_t maxReserve = 1U << 16;
+  }
+
+  ArrowExporter::ArrowExporter (ArrowBatchCallback callback,
+                                std::size_t        batchSize,
+                                Types              types)
+  : _callback (std::move (callback))
+  , _batchSize (std::max<std::size_t> (batchSize, 1))
+  , _types (std::move (types))
+  {
+  }
+
+  ArrowExporter::~ArrowExporter () = default;
+
+  std::size_t
+  ArrowExporter::rows () const noexcept
+  {
+    return _rows;
+  }
+
+  std::size_t
+  ArrowExporter::batches () const noexcept
+  {
+    return _batches;
+  }
+
+  void
+  ArrowExporter::onStart ()
+  {
+    _batch.reset ();
+    _stopped = false;
+  }
+
+  bool
+  ArrowExporter::onRow (Columns columns)
+  {
+    sqlite3_stmt* const stmt  = columns.get_stmt ();
+    const int           count = columns.count ();
+    const auto          cols  = as_size_t (count);
+
+    if (!_batch)
+      {
+        if (_types.size () > 0 && _types.size () != cols)
+          throw ErrTypeMisMatch ("Arrow export: "
+                                 + std::to_string (_types.size ())
+                                 + " types for "
+                                 + std::to_string (cols) + " columns");
+
+        std::vector<Type> types (cols, Type::Variant);
+        for (int i = 0; i < count; ++i)
+          {
+            const auto idx  = as_size_t (i);
+            Type       type = idx < _types.size () ? _types[idx]
+                                                   : Type::Variant;
+            if (type == Type::Variant)
+              type = declaredType (sqlite3_column_decltype (stmt, i));
+            if (type == Type::Variant)
+              type = storageType (sqlite3_column_type (stmt, i));
+            types[idx] = type;
+          }
+
+        _batch = std::make_unique<internal::ArrowBatch> (
+            columns.getNames (),
+            std::move (types),
+            std::min (_batchSize, maxReserve));
+      }
+
+    auto&       batch = *_batch;
+    const auto& types = batch.types ();
+
+    // a batch ends before the 32 bit offsets overflow
+    bool full = false;
+    for (int i = 0; i < count && !full; ++i)
+      {
+        const auto idx = as_size_t (i);
+        if (isVarSize (types[idx])
+            && sqlite3_column_type (stmt, i) != SQLITE_NULL)
+          {
+            // sqlite3_column_bytes after the conversion to the wanted type
+            if (types[idx] == Type::Text)
+              sqlite3_column_text (stmt, i);
+            else
+              sqlite3_column_blob (stmt, i);
+            const auto bytes = as_size_t (sqlite3_column_bytes (stmt, i));
+            full             = !batch.fits (idx, bytes);
+          }
+      }
+    if (full && batch.size () > 0 && !emit ())
+      return false;
+
+    for (int i = 0; i < count; ++i)
+      {
+        const auto idx = as_size_t (i);
+        if (sqlite3_column_type (stmt, i) == SQLITE_NULL)
+          {
+            batch.appendNull (idx);
+            continue;
+          }
+
+        switch (types[idx])
+          {
+          case Type::Int:
+            batch.appendInt (idx, sqlite3_column_int64 (stmt, i));
+            break;
+
+          case Type::Real:
+            batch.appendReal (idx, sqlite3_column_double (stmt, i));
+            break;
+
+          case Type::Blob:
+            {
+              const void* blob = sqlite3_column_blob (stmt, i);
+              batch.appendBytes (
+                  idx, blob, as_size_t (sqlite3_column_bytes (stmt, i)));
+              break;
+            }
+
+          default:
+            {
+              const void* text = sqlite3_column_text (stmt, i);
+              batch.appendBytes (
+                  idx, text, as_size_t (sqlite3_column_bytes (stmt, i)));
+              break;
+            }
+          }
+      }
+    batch.endRow ();
+    _rows += 1;
+
+    if (batch.size () >= _batchSize)
+      return emit ();
+
+    return true;
+  }
+
+  void
+  ArrowExporter::onEnd ()
+  {
+    if (_batch && _batch->size () > 0 && !_stopped)
+      emit ();
+  }
+
+  bool
+  ArrowExporter::emit ()
+  {
+    _batches += 1;
+    _stopped = !deliver (*_batch, _callback);
+    return !_stopped;
+  }
+
+  std::size_t
+  exportArrow (const Dataset&            ds,
+               const ArrowBatchCallback& callback,
+               std::size_t               batchSize)
+  {
+    if (ds.size () == 0)
+      return 0;
+
+    batchSize = std::max<std::size_t> (batchSize, 1);
+
+    const auto& first = ds[0];
+
+    // rows of an untyped Dataset can have different sizes
+    for (const auto& row : ds)
+      {
+        if (row.size () != first.size ())
+          throw ErrTypeMisMatch ("Arrow export: rows need "
+                                 + std::to_string (first.size ())
+                                 + " fields");
+      }
+
+    std::vector<Type> types (first.size (), Type::Variant);
+    for (std::size_t col = 0; col < first.size (); ++col)
+      {
+        types[col] = first[col].dbtype ();
+        if (types[col] != Type::Variant)
+          continue;
+
+        bool numbers = false, reals = false, text = false, blobs = false;
+        for (const auto& row : ds)
+          {
+            switch (row[col].type ())
+              {
+              case Type::Int:
+                numbers = true;
+                break;
+              case Type::Real:
+                numbers = reals = true;
+                break;
+              case Type::Text:
+                text = true;
+                break;
+              case Type::Blob:
+                blobs = true;
+                break;
+              default:
+                break;
+              }
+          }
+
+        if (numbers && (text || blobs))
+          throw ErrTypeMisMatch ("Arrow export: field "
+                                 + std::to_string (col)
+                                 + " has numbers and text or blobs");
+
+        types[col] = numbers ? (reals ? Type::Real : Type::Int)
+                             : (blobs ? Type::Blob : Type::Text);
+      }
+
+    internal::ArrowBatch batch{
+        ds.getNames (), types, std::min (batchSize, ds.size ())};
+
+    std::size_t exported = 0;
+    for (const auto& row : ds)
+      {
+        // a batch ends before the 32 bit offsets overflow
+        bool full = false;
+        for (std::size_t col = 0; col < types.size () && !full; ++col)
+          {
+            const DbValue& val = row[col];
+            if (isVarSize (types[col]) && !val.isNull ())
+              {
+                const Value& v    = val.getValue ();
+                const auto   size = v.getType () == Type::Text
+                                        ? v.text ().size ()
+                                        : v.blob ().size ();
+                full = !batch.fits (col, size);
+              }
+          }
+        if (full && batch.size () > 0 && !deliver (batch, callback))
+          return exported;
+
+        for (std::size_t col = 0; col < types.size (); ++col)
+          {
+            const DbValue& val = row[col];
+            if (val.isNull ())
+              {
+                batch.appendNull (col);
+                continue;
+              }
+
+            const Value& v = val.getValue ();
+            switch (types[col])
+              {
+              case Type::Int:
+                batch.appendInt (col, v.int64 ());
+                break;
+
+              case Type::Real:
+                batch.appendReal (col,
+                                  v.getType () == Type::Real
+                                      ? v.real ()
+                                      : static_cast<double> (v.int64 ()));
+                break;
+
+              default:
+                if (v.getType () == Type::Text)
+                  batch.appendBytes (col, v.text ().data (), v.text ().size ());
+                else
+                  batch.appendBytes (col, v.blob ().data (), v.blob ().size ());
+                break;
+              }
+          }
+        batch.endRow ();
+        exported += 1;
+
+        if (batch.size () >= batchSize && !deliver (batch, callback))
+          return exported;
+      }
+
+    if (batch.size () > 0)
+      deliver (batch, callback);
+
+    return exported;
+  }
+
+  ArrowImporter::ArrowImporter (Command& cmd, const ArrowSchema* schema)
+  : _cmd (cmd)
+  {
+    if (!schema || !schema->release || std::strcmp (schema->format, "+s") != 0)
+      throw ErrTypeMisMatch ("Arrow import: schema is not a struct");
+
+    const auto paramCount = _cmd._parameters.size ();
+    if (schema->n_children < 0
+        || static_cast<std::size_t> (schema->n_children) != paramCount)
+      throw ErrTypeMisMatch ("Arrow import: "
+                             + std::to_string (schema->n_children)
+                             + " columns for " + std::to_string (paramCount)
+                             + " parameters");
+
+    static const std::pair<const char*, Kind> formats[] = {
+        {"n", Kind::Null},      {"b", Kind::Bool},
+        {"c", Kind::Int8},      {"C", Kind::UInt8},
+        {"s", Kind::Int16},     {"S", Kind::UInt16},
+        {"i", Kind::Int32},     {"I", Kind::UInt32},
+        {"l", Kind::Int64},     {"L", Kind::UInt64},
+        {"f", Kind::Float},     {"g", Kind::Double},
+        {"u", Kind::Text},      {"U", Kind::LargeText},
+        {"z", Kind::Binary},    {"Z", Kind::LargeBinary},
+    };
+
+    for (std::size_t i = 0; i < paramCount; ++i)
+      {
+        const ArrowSchema* child = schema->children[i];
+        const auto         found = std::find_if (
+            std::begin (formats), std::end (formats), [child] (const auto& f) {
+              return std::strcmp (f.first, child->format) == 0;
+            });
+        if (found == std::end (formats) || child->dictionary)
+          throw ErrTypeMisMatch ("Arrow import: unsupported format "
+                                 + std::string{child->format}
+                                 + " of column " + std::to_string (i));
+        _kinds.push_back (found->second);
+      }
+  }
+
+  namespace
+  {
+    bool
+    bitSet (const void* bitmap, int64_t idx)
+    {
+      const auto* bytes = static_cast<const unsigned char*> (bitmap);
+      return (bytes[idx / 8] >> (idx % 8)) & 1;
+    }
+
+    template <typename T>
+    T
+    valueAt (const void* buffer, int64_t idx)
+    {
+      return static_cast<const T*> (buffer)[idx];
+    }
+
+    // [begin, end) of the bytes of a text or binary value
+    template <typename Offset>
+    std::pair<int64_t, int64_t>
+    bytesAt (const void* offsets, int64_t idx)
+    {
+      return {static_cast<int64_t> (valueAt<Offset> (offsets, idx)),
+              static_cast<int64_t> (valueAt<Offset> (offsets, idx + 1))};
+    }
+  }
+
+  std::size_t
+  ArrowImporter::insert (const ArrowArray* batch)
+  {
+    _cmd._connection->ensureValid ();
+
+    if (!batch || !batch->release || batch->n_children < 0
+        || static_cast<std::size_t> (batch->n_children) != _kinds.size ())
+      throw ErrTypeMisMatch ("Arrow import: batch does not fit the schema");
+
+    const int64_t rows = batch->length;
+    for (std::size_t i = 0; i < _kinds.size (); ++i)
+      {
+        const ArrowArray* child = batch->children[i];
+        const int64_t     buffers
+            = _kinds[i] == Kind::Null
+                  ? 0
+                  : (_kinds[i] >= Kind::Text ? 3 : 2);
+        if (child->n_buffers != buffers
+            || child->length < batch->offset + rows)
+          throw ErrTypeMisMatch ("Arrow import: column "
+                                 + std::to_string (i)
+                                 + " does not fit the schema");
+      }
+
+    sqlite3_stmt* const stmt = _cmd._stmt;
+    const auto          noop = [] (Columns) { return true; };
+
+    for (int64_t row = 0; row < rows; ++row)
+      {
+        for (std::size_t i = 0; i < _kinds.size (); ++i)
+          {
+            const ArrowArray* child = batch->children[i];
+            const int64_t     idx   = batch->offset + child->offset + row;
+            const int         nr    = as_int (i + 1);
+            const Kind        kind  = _kinds[i];
+            const void* const* buf  = child->buffers;
+
+            const bool null
+                = kind == Kind::Null
+                  || (child->null_count != 0 && buf[0]
+                      && !bitSet (buf[0], idx));
+
+            int     rc   = SQLITE_OK;
+            int64_t ival = 0;
+            switch (null ? Kind::Null : kind)
+              {
+              case Kind::Null:
+                rc = sqlite3_bind_null (stmt, nr);
+                break;
+
+              case Kind::Float:
+                rc = sqlite3_bind_double (
+                    stmt,
+                    nr,
+                    static_cast<double> (valueAt<float> (buf[1], idx)));
+                break;
+
+              case Kind::Double:
+                rc = sqlite3_bind_double (
+                    stmt, nr, valueAt<double> (buf[1], idx));
+                break;
+
+              case Kind::Text:
+              case Kind::LargeText:
+              case Kind::Binary:
+              case Kind::LargeBinary:
+                {
+                  const bool large
+                      = kind == Kind::LargeText || kind == Kind::LargeBinary;
+                  const auto range = large ? bytesAt<int64_t> (buf[1], idx)
+                                           : bytesAt<int32_t> (buf[1], idx);
+                  const auto* data = static_cast<const char*> (buf[2]);
+                  const auto  size = static_cast<sqlite3_uint64> (
+                      range.second - range.first);
+
+                  // a null pointer would bind Null, not an empty value
+                  if (kind == Kind::Text || kind == Kind::LargeText)
+                    rc = sqlite3_bind_text64 (stmt,
+                                              nr,
+                                              size ? data + range.first : "",
+                                              size,
+                                              SQLITE_STATIC,
+                                              SQLITE_UTF8);
+                  else if (size == 0)
+                    rc = sqlite3_bind_zeroblob (stmt, nr, 0);
+                  else
+                    rc = sqlite3_bind_blob64 (
+                        stmt, nr, data + range.first, size, SQLITE_STATIC);
+                  break;
+                }
+
+              case Kind::UInt64:
+                {
+                  const auto val = valueAt<uint64_t> (buf[1], idx);
+                  if (val > static_cast<uint64_t> (
+                          std::numeric_limits<int64_t>::max ()))
+                    throw ErrOutOfRange ("Arrow import: "
+                                         + std::to_string (val)
+                                         + " does not fit into int64_t");
+                  ival = static_cast<int64_t> (val);
+                  rc   = sqlite3_bind_int64 (stmt, nr, ival);
+                  break;
+                }
+
+              default:
+                {
+                  switch (kind)
+                    {
+                    case Kind::Bool:
+                      ival = bitSet (buf[1], idx);
+                      break;
+                    case Kind::Int8:
+                      ival = valueAt<int8_t> (buf[1], idx);
+                      break;
+                    case Kind::UInt8:
+                      ival = valueAt<uint8_t> (buf[1], idx);
+                      break;
+                    case Kind::Int16:
+                      ival = valueAt<int16_t> (buf[1], idx);
+                      break;
+                    case Kind::UInt16:
+                      ival = valueAt<uint16_t> (buf[1], idx);
+                      break;
+                    case Kind::Int32:
+                      ival = valueAt<int32_t> (buf[1], idx);
+                      break;
+                    case Kind::UInt32:
+                      ival = valueAt<uint32_t> (buf[1], idx);
+                      break;
+                    default:
+                      ival = valueAt<int64_t> (buf[1], idx);
+                      break;
+                    }
+                  rc = sqlite3_bind_int64 (stmt, nr, ival);
+                  break;
+                }
+              }
+            if (rc != SQLITE_OK)
+              throw SQLite3Error{rc, sqlite3_errstr (rc)}; // LCOV_EXCL_LINE
+          }
+
+        _cmd.run (noop);
+      }
+
+    sqlite3_clear_bindings (stmt);
+    return static_cast<std::size_t> (rows);
+  }
+}
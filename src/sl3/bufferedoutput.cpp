@@ -0,0 +1,97 @@
+/******************************************************************************
+ ------------- Copyright (c) 2009-2023 H a r a l d  A c h i t z ---------------
+ ---------- < h a r a l d dot a c h i t z at g m a i l dot c o m > ------------
+ ---- This Source Code Form is subject to the terms of the Mozilla Public -----
+ ---- License, v. 2.0. If a copy of the MPL was not distributed with this -----
+ ---------- file, You can obtain one at http://mozilla.org/MPL/2.0/. ----------
+ ******************************************************************************/
+
+#include "bufferedoutput.hpp"
+
+#include <utility>
+
+namespace sl3
+{
+  namespace internal
+  {
+    BufferedOutput::BufferedOutput (Sink sink, std::size_t bufferSize)
+    : _sink (std::move (sink))
+    , _capacity (bufferSize > 0 ? bufferSize : 1)
+    {
+      _fill.reserve (_capacity);
+      _spare.reserve (_capacity);
+      _thread = std::thread{[this] { run (); }};
+    }
+
+    BufferedOutput::~BufferedOutput ()
+    {
+      {
+        std::lock_guard<std::mutex> lock{_mtx};
+        _stop = true;
+      }
+      _cv.notify_all ();
+      _thread.join ();
+    }
+
+    void
+    BufferedOutput::waitIdle (std::unique_lock<std::mutex>& lock)
+    {
+      _cv.wait (lock, [this] { return !_pending; });
+      if (_error)
+        std::rethrow_exception (std::exchange (_error, nullptr));
+    }
+
+    void
+    BufferedOutput::swapBuffers ()
+    {
+      {
+        std::unique_lock<std::mutex> lock{_mtx};
+        waitIdle (lock);
+        _fill.swap (_spare);
+        _pending = true;
+      }
+      _cv.notify_all ();
+      _fill.clear ();
+    }
+
+    void
+    BufferedOutput::flush ()
+    {
+      if (!_fill.empty ())
+        swapBuffers ();
+
+      std::unique_lock<std::mutex> lock{_mtx};
+      waitIdle (lock);
+    }
+
+    void
+    BufferedOutput::run ()
+    {
+      std::unique_lock<std::mutex> lock{_mtx};
+      for (;;)
+        {
+          _cv.wait (lock, [this] { return _pending || _stop; });
+          if (!_pending)
+            return;
+
+          // the spare buffer belongs to this thread until pending is reset
+          lock.unlock ();
+          std::exception_ptr error;
+          try
+            {
+              _sink (_spare.data (), _spare.size ());
+            }
+          catch (...)
+            {
+              error = std::current_exception ();
+            }
+          _spare.clear ();
+          lock.lock ();
+
+          _error   = error;
+          _pending = false;
+          _cv.notify_all ();
+        }
+    }
+  }
+}
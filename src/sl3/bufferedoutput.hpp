@@ -0,0 +1,101 @@
+#pragma once
+
+#include <charconv>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <cstddef>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+
+namespace sl3
+{
+  namespace internal
+  {
+    /**
+     * \internal
+     * \brief Double buffered output
+     *
+     * Data is appended to a fill buffer. When it is full, it is swapped with
+     * a spare buffer which a background thread passes to the sink, while
+     * the caller continues to fill the other buffer.
+     *
+     * An exception of the sink is rethrown by the next append that needs a
+     * buffer swap, or by flush.
+     */
+    class BufferedOutput
+    {
+    public:
+      using Sink = std::function<void (const char*, std::size_t)>;
+
+      BufferedOutput (Sink sink, std::size_t bufferSize);
+      ~BufferedOutput ();
+
+      BufferedOutput (const BufferedOutput&)            = delete;
+      BufferedOutput& operator= (const BufferedOutput&) = delete;
+
+      void
+      append (std::string_view data)
+      {
+        if (_fill.size () + data.size () > _capacity)
+          swapBuffers ();
+        _fill.append (data.data (), data.size ());
+      }
+
+      void
+      append (char c)
+      {
+        if (_fill.size () == _capacity)
+          swapBuffers ();
+        _fill.push_back (c);
+      }
+
+      /// pass all data to the sink and wait for it
+      void flush ();
+
+    private:
+      void swapBuffers ();
+      void waitIdle (std::unique_lock<std::mutex>& lock);
+      void run ();
+
+      Sink        _sink;
+      std::size_t _capacity;
+      std::string _fill;
+      std::string _spare;
+
+      std::mutex              _mtx;
+      std::condition_variable _cv;
+      bool                    _pending = false;
+      bool                    _stop    = false;
+      std::exception_ptr      _error;
+      std::thread             _thread;
+    };
+
+    /// append the decimal representation of an integer
+    inline void
+    appendInt (BufferedOutput& out, int64_t val)
+    {
+      char buf[24];
+      auto res = std::to_chars (buf, buf + sizeof (buf), val);
+      out.append (std::string_view{buf, static_cast<std::size_t> (res.ptr - buf)});
+    }
+
+    /// append the shortest representation that reads back to the same value
+    inline void
+    appendReal (BufferedOutput& out, double val)
+    {
+      char buf[32];
+#if defined(__cpp_lib_to_chars) && __cpp_lib_to_chars >= 201611L
+      auto res = std::to_chars (buf, buf + sizeof (buf), val);
+      out.append (std::string_view{buf, static_cast<std::size_t> (res.ptr - buf)});
+#else
+      const int len = std::snprintf (buf, sizeof (buf), "%.17g", val);
+      out.append (std::string_view{buf, static_cast<std::size_t> (len)});
+#endif
+    }
+  }
+}
@@ -0,0 +1,205 @@
+/******************************************************************************
+ ------------- Copyright (c) 2009-2023 H a r a l d  A c h i t z ---------------
+ ---------- < h a r a l d dot a c h i t z at g m a i l dot c o m > ------------
+ ---- This Source Code Form is subject to the terms of the Mozilla Public -----
+ ---- License, v. 2.0. If a copy of the MPL was not distributed with this -----
+ ---------- file, You can obtain one at http://mozilla.org/MPL/2.0/. ----------
+ ******************************************************************************/
+
+#include <sl3/busy.hpp>
+
+#include <algorithm>
+#include <iterator>
+#include <random>
+#include <thread>
+
+#include <sl3/database.hpp>
+#include <sl3/error.hpp>
+
+#include "busyhandler.hpp"
+#include "connection.hpp"
+
+namespace sl3
+{
+  namespace
+  {
+    using Clock = std::chrono::steady_clock;
+    using std::chrono::microseconds;
+    using std::chrono::milliseconds;
+
+    // a handler that waits delay (retries) until the timeout of a lock
+    // attempt is reached
+    template <typename Delay>
+    BusyHandler
+    waitUntil (milliseconds timeout, Delay delay)
+    {
+      Clock::time_point start;
+      return [timeout, delay, start] (int retries) mutable {
+        if (retries == 0)
+          start = Clock::now ();
+
+        const auto left = timeout - (Clock::now () - start);
+        if (left <= Clock::duration::zero ())
+          return false;
+
+        std::this_thread::sleep_for (
+            std::min<Clock::duration> (delay (retries), left));
+        return true;
+      };
+    }
+  }
+
+  BusyPolicy::BusyPolicy (BusyHandler handler)
+  : _handler (std::move (handler))
+  {
+  }
+
+  BusyPolicy
+  BusyPolicy::timeout (milliseconds timeout)
+  {
+    if (timeout.count () < 0)
+      throw ErrOutOfRange{"negative timeout"};
+
+    // the delays of sqlite3_busy_timeout
+    static const milliseconds delays[]
+        = {milliseconds{1},
+           milliseconds{2},
+           milliseconds{5},
+           milliseconds{10},
+           milliseconds{15},
+           milliseconds{20},
+           milliseconds{25},
+           milliseconds{25},
+           milliseconds{25},
+           milliseconds{50},
+           milliseconds{50},
+           milliseconds{100}};
+
+    return BusyPolicy{waitUntil (timeout, [] (int retries) {
+      const auto last = static_cast<int> (std::size (delays)) - 1;
+      return delays[std::min (retries, last)];
+    })};
+  }
+
+  BusyPolicy
+  BusyPolicy::backoff (milliseconds timeout,
+                       microseconds initial,
+                       microseconds maximum,
+                       double       jitter)
+  {
+    if (timeout.count () < 0)
+      throw ErrOutOfRange{"negative timeout"};
+    if (initial.count () <= 0 || maximum < initial)
+      throw ErrOutOfRange{"invalid backoff delays"};
+    if (!(jitter >= 0.0 && jitter <= 1.0))
+      throw ErrOutOfRange{"jitter must be between 0 and 1"};
+
+    std::minstd_rand random{std::random_device{}()};
+    return BusyPolicy{waitUntil (
+        timeout, [initial, maximum, jitter, random] (int retries) mutable {
+          auto delay = initial;
+          for (int i = 0; i < retries && delay < maximum; ++i)
+            delay *= 2;
+          delay = std::min (delay, maximum);
+
+          std::uniform_real_distribution<double> part{0.0, jitter};
+          const auto reduce = static_cast<double> (delay.count ())
+                              * part (random);
+          return delay - microseconds{static_cast<int64_t> (reduce)};
+        })};
+  }
+
+  BusyPolicy
+  BusyPolicy::custom (BusyHandler handler)
+  {
+    if (!handler)
+      throw ErrOutOfRange{"empty busy handler"};
+
+    return BusyPolicy{std::move (handler)};
+  }
+
+  namespace internal
+  {
+    void
+    BusyState::set (sqlite3* db, BusyHandler handler)
+    {
+      _handler = std::move (handler);
+      sqlite3_busy_handler (db, &BusyState::call, this);
+    }
+
+    BusyStats
+    BusyState::get () const noexcept
+    {
+      BusyStats stats;
+      stats.contentions = _contentions.load (std::memory_order_relaxed);
+      stats.retries     = _retries.load (std::memory_order_relaxed);
+      stats.failures    = _failures.load (std::memory_order_relaxed);
+      stats.waited      = std::chrono::nanoseconds{
+          static_cast<int64_t> (_waited.load (std::memory_order_relaxed))};
+      return stats;
+    }
+
+    void
+    BusyState::reset () noexcept
+    {
+      _contentions.store (0, std::memory_order_relaxed);
+      _retries.store (0, std::memory_order_relaxed);
+      _failures.store (0, std::memory_order_relaxed);
+      _waited.store (0, std::memory_order_relaxed);
+    }
+
+    int
+    BusyState::call (void* self, int count)
+    {
+      auto& state = *static_cast<BusyState*> (self);
+      if (count == 0)
+        {
+          state._contentions.fetch_add (1, std::memory_order_relaxed);
+          state._last = Clock::now ();
+        }
+
+      bool retry = false;
+      try
+        {
+          retry = state._handler && state._handler (count);
+        }
+      catch (...)
+        {
+          retry = false;
+        }
+
+      // the wait includes the lock attempts between the calls
+      const auto now    = Clock::now ();
+      const auto waited = std::chrono::duration_cast<std::chrono::nanoseconds> (
+          now - state._last);
+      state._last = now;
+
+      state._waited.fetch_add (static_cast<uint64_t> (waited.count ()),
+                               std::memory_order_relaxed);
+      (retry ? state._retries : state._failures)
+          .fetch_add (1, std::memory_order_relaxed);
+      return retry ? 1 : 0;
+    }
+  }
+
+  void
+  Database::setBusyPolicy (BusyPolicy policy)
+  {
+    _connection->ensureValid ();
+    _connection->busy.set (_connection->db (), std::move (policy._handler));
+  }
+
+  BusyStats
+  Database::busyStats ()
+  {
+    _connection->ensureValid ();
+    return _connection->busy.get ();
+  }
+
+  void
+  Database::resetBusyStats ()
+  {
+    _connection->ensureValid ();
+    _connection->busy.reset ();
+  }
+}
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <sqlite3.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+#include <sl3/busy.hpp>
+
+namespace sl3
+{
+  namespace internal
+  {
+    /**
+     * \internal
+     * \brief The busy handler of a connection and its counters
+     */
+    class BusyState
+    {
+    public:
+      BusyState () = default;
+
+      BusyState (const BusyState&)            = delete;
+      BusyState& operator= (const BusyState&) = delete;
+
+      /// install handler, an empty handler never retries
+      void set (sqlite3* db, BusyHandler handler);
+
+      BusyStats get () const noexcept;
+
+      void reset () noexcept;
+
+    private:
+      static int call (void* self, int count);
+
+      BusyHandler                           _handler;
+      std::chrono::steady_clock::time_point _last;
+      std::atomic<uint64_t>                 _contentions{0};
+      std::atomic<uint64_t>                 _retries{0};
+      std::atomic<uint64_t>                 _failures{0};
+      std::atomic<uint64_t>                 _waited{0};
+    };
+  }
+}
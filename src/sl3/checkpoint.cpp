@@ -0,0 +1,251 @@
+/******************************************************************************
+ ------------- Copyright (c) 2009-2023 H a r a l d  A c h i t z ---------------
+ ---------- < h a r a l d dot a c h i t z at g m a i l dot c o m > ------------
+ ---- This Source Code Form is subject to the terms of the Mozilla Public -----
+ ---- License, v. 2.0. If a copy of the MPL was not distributed with this -----
+ ---------- file, You can obtain one at http://mozilla.org/MPL/2.0/. ----------
+ ******************************************************************************/
+
+#include <sl3/checkpoint.hpp>
+
+#include <sqlite3.h>
+
+#include <algorithm>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+#include <sl3/database.hpp>
+#include <sl3/error.hpp>
+
+#include "connection.hpp"
+
+namespace sl3
+{
+  namespace internal
+  {
+    /**
+     * \internal
+     * \brief The thread, connection and counters of a CheckpointScheduler
+     */
+    class CheckpointState
+    {
+      using Clock = std::chrono::steady_clock;
+
+    public:
+      CheckpointState (const std::string& file, const CheckpointPolicy& policy)
+      : _db (file)
+      , _policy (policy)
+      {
+        _db.setBusyPolicy (BusyPolicy::timeout (policy.lockTimeout));
+        // sqlite opens the WAL of a connection with its first read
+        _db.execute ("PRAGMA schema_version;");
+        _thread = std::thread{[this] { run (); }};
+      }
+
+      ~CheckpointState ()
+      {
+        {
+          std::lock_guard<std::mutex> lock{_mutex};
+          _stop = true;
+        }
+        _wake.notify_one ();
+        _thread.join ();
+      }
+
+      CheckpointState (const CheckpointState&)            = delete;
+      CheckpointState& operator= (const CheckpointState&) = delete;
+
+      // called by the WAL hook after a commit
+      void
+      commit (int pages)
+      {
+        {
+          std::lock_guard<std::mutex> lock{_mutex};
+          // the WAL restarted from the beginning
+          if (pages < _walFrames)
+            _checkpointed = 0;
+
+          _walFrames  = pages;
+          _fresh      = true;
+          _pending    = true;
+          _lastCommit = Clock::now ();
+        }
+        _wake.notify_one ();
+      }
+
+      CheckpointStats
+      stats () const
+      {
+        std::lock_guard<std::mutex> lock{_mutex};
+        return _stats;
+      }
+
+    private:
+      void
+      run ()
+      {
+        std::unique_lock<std::mutex> lock{_mutex};
+        const bool idleChecks = _policy.idle.count () > 0;
+        while (!_stop)
+          {
+            const bool due
+                = _fresh && _walFrames - _checkpointed >= _policy.walPages;
+            const bool idle = idleChecks && _pending
+                              && Clock::now () - _lastCommit >= _policy.idle;
+
+            if (due || idle)
+              {
+                _fresh   = false;
+                _pending = due;
+
+                const auto result = checkpoint (
+                    lock, due ? _policy.mode : _policy.idleMode, false);
+                if (result.walFrames - result.checkpointed
+                        >= _policy.readerLagPages
+                    || result.walFrames >= _policy.maxWalPages)
+                  checkpoint (lock, _policy.lagMode, true);
+              }
+            else if (idleChecks && _pending)
+              _wake.wait_until (lock, _lastCommit + _policy.idle);
+            else
+              _wake.wait (lock);
+          }
+      }
+
+      // runs a checkpoint without holding the lock
+      CheckpointResult
+      checkpoint (std::unique_lock<std::mutex>& lock,
+                  CheckpointMode                mode,
+                  bool                          escalated)
+      {
+        lock.unlock ();
+        CheckpointResult result;
+        bool             failed = false;
+        const auto       start  = Clock::now ();
+        try
+          {
+            result = _db.checkpoint (mode);
+          }
+        catch (const Error&)
+          {
+            failed = true;
+          }
+        const auto time = Clock::now () - start;
+        lock.lock ();
+
+        using std::chrono::duration_cast;
+        using std::chrono::nanoseconds;
+
+        _stats.checkpoints += 1;
+        _stats.escalations += escalated ? 1 : 0;
+        _stats.last    = duration_cast<nanoseconds> (time);
+        _stats.total  += _stats.last;
+        _stats.longest = std::max (_stats.longest, _stats.last);
+        if (failed)
+          {
+            _stats.failures += 1;
+            return result;
+          }
+        _stats.busy += result.busy ? 1 : 0;
+
+        // a smaller WAL was restarted by another connection
+        const int base = result.walFrames < _walFrames ? 0 : _checkpointed;
+        if (result.checkpointed > base)
+          _stats.framesCopied += static_cast<uint64_t> (
+              result.checkpointed - base);
+
+        _walFrames       = std::max (result.walFrames, 0);
+        _checkpointed    = std::max (result.checkpointed, 0);
+        _stats.walFrames = _walFrames;
+        _stats.readerLag = _walFrames - _checkpointed;
+        return result;
+      }
+
+      Database                _db;
+      const CheckpointPolicy  _policy;
+      mutable std::mutex      _mutex;
+      std::condition_variable _wake;
+      bool                    _stop         = false;
+      bool                    _fresh        = false;
+      bool                    _pending      = false;
+      int                     _walFrames    = 0;
+      int                     _checkpointed = 0;
+      Clock::time_point       _lastCommit;
+      CheckpointStats         _stats;
+      std::thread             _thread;
+    };
+
+    namespace
+    {
+      std::string
+      checkedFile (Database& db, const CheckpointPolicy& policy)
+      {
+        if (policy.walPages <= 0 || policy.readerLagPages < 0
+            || policy.maxWalPages < 0 || policy.idle.count () < 0
+            || policy.lockTimeout.count () < 0)
+          throw ErrOutOfRange{"invalid checkpoint policy"};
+
+        auto name = db.getFileName ();
+        if (name.empty ())
+          throw ErrNoConnection{"database has no file to checkpoint"};
+        return name;
+      }
+    }
+  }
+
+  CheckpointScheduler::CheckpointScheduler (Database&        db,
+                                            CheckpointPolicy policy)
+  : _db (&db)
+  , _hook (0)
+  , _state (std::make_unique<internal::CheckpointState> (
+        internal::checkedFile (db, policy), policy))
+  {
+    // a WAL handler also turns the auto checkpoint off
+    auto* state = _state.get ();
+    _hook       = db.onWal ([state] (const std::string& database, int pages) {
+      if (database == "main")
+        state->commit (pages);
+    });
+  }
+
+  CheckpointScheduler::CheckpointScheduler (
+      CheckpointScheduler&& other) noexcept = default;
+
+  CheckpointScheduler::~CheckpointScheduler ()
+  {
+    if (_state)
+      _db->removeHook (_hook);
+  }
+
+  CheckpointStats
+  CheckpointScheduler::stats () const
+  {
+    return _state ? _state->stats () : CheckpointStats{};
+  }
+
+  CheckpointResult
+  Database::checkpoint (CheckpointMode mode, const std::string& schema)
+  {
+    _connection->ensureValid ();
+
+    static const int modes[] = {SQLITE_CHECKPOINT_PASSIVE,
+                                SQLITE_CHECKPOINT_FULL,
+                                SQLITE_CHECKPOINT_RESTART,
+                                SQLITE_CHECKPOINT_TRUNCATE};
+
+    CheckpointResult result;
+    const int        rc
+        = sqlite3_wal_checkpoint_v2 (_connection->db (),
+                                     schema.c_str (),
+                                     modes[static_cast<std::size_t> (mode)],
+                                     &result.walFrames,
+                                     &result.checkpointed);
+    if ((rc & 0xff) == SQLITE_BUSY)
+      result.busy = true;
+    else if (rc != SQLITE_OK)
+      throw SQLite3Error{rc, sqlite3_errmsg (_connection->db ())};
+
+    return result;
+  }
+}
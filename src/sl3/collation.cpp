@@ -0,0 +1,146 @@
+/******************************************************************************
+ ------------- Copyright (c) 2009-2023 H a r a l d  A c h i t z ---------------
+ ---------- < h a r a l d dot a c h i t z at g m a i l dot c o m > ------------
+ ---- This Source Code Form is subject to the terms of the Mozilla Public -----
+ ---- License, v. 2.0. If a copy of the MPL was not distributed with this -----
+ ---------- file, You can obtain one at http://mozilla.org/MPL/2.0/. ----------
+ ******************************************************************************/
+
+#include <sl3/collation.hpp>
+
+#include <sqlite3.h>
+
+#include <algorithm>
+#include <cstring>
+
+#include <sl3/database.hpp>
+#include <sl3/error.hpp>
+
+#include "connection.hpp"
+
+namespace sl3
+{
+  namespace collation
+  {
+    namespace
+    {
+      bool
+      isDigit (char c) noexcept
+      {
+        return c >= '0' && c <= '9';
+      }
+
+      unsigned char
+      lower (char c) noexcept
+      {
+        const auto u = static_cast<unsigned char> (c);
+        return u >= 'A' && u <= 'Z' ? static_cast<unsigned char> (u + 32) : u;
+      }
+
+      int
+      bytes (std::string_view a, std::string_view b) noexcept
+      {
+        const auto n = std::min (a.size (), b.size ());
+        if (n > 0)
+          {
+            if (const int rc = std::memcmp (a.data (), b.data (), n))
+              return rc;
+          }
+        return a.size () < b.size () ? -1 : (a.size () > b.size () ? 1 : 0);
+      }
+    }
+
+    int
+    natural (std::string_view a, std::string_view b) noexcept
+    {
+      std::size_t i = 0;
+      std::size_t j = 0;
+      while (i < a.size () && j < b.size ())
+        {
+          if (isDigit (a[i]) && isDigit (b[j]))
+            {
+              // skip leading zeros, the longer number is greater,
+              // equal lengths compare digit by digit
+              while (i < a.size () && a[i] == '0')
+                ++i;
+              while (j < b.size () && b[j] == '0')
+                ++j;
+
+              std::size_t ei = i;
+              std::size_t ej = j;
+              while (ei < a.size () && isDigit (a[ei]))
+                ++ei;
+              while (ej < b.size () && isDigit (b[ej]))
+                ++ej;
+
+              if (ei - i != ej - j)
+                return ei - i < ej - j ? -1 : 1;
+              if (const int rc = a.compare (i, ei - i, b, j, ej - j))
+                return rc;
+
+              i = ei;
+              j = ej;
+              continue;
+            }
+
+          if (a[i] != b[j])
+            {
+              return static_cast<unsigned char> (a[i])
+                             < static_cast<unsigned char> (b[j])
+                         ? -1
+                         : 1;
+            }
+          ++i;
+          ++j;
+        }
+
+      if (i < a.size () || j < b.size ())
+        return i < a.size () ? 1 : -1;
+
+      // equal values, make the order total
+      return bytes (a, b);
+    }
+
+    int
+    asciiNoCase (std::string_view a, std::string_view b) noexcept
+    {
+      const auto n = std::min (a.size (), b.size ());
+      for (std::size_t i = 0; i < n; ++i)
+        {
+          const auto ca = lower (a[i]);
+          const auto cb = lower (b[i]);
+          if (ca != cb)
+            return ca < cb ? -1 : 1;
+        }
+      return a.size () < b.size () ? -1 : (a.size () > b.size () ? 1 : 0);
+    }
+
+    int
+    Prefix::operator() (std::string_view a, std::string_view b) const noexcept
+    {
+      return bytes (a.substr (0, length), b.substr (0, length));
+    }
+  }
+
+  void
+  Database::registerCollation (const std::string& name,
+                               void*              data,
+                               CollationCall      call,
+                               void (*destroy) (void*))
+  {
+    if (!_connection->isValid ())
+      {
+        destroy (data);
+        throw ErrNoConnection{};
+      }
+
+    // unlike other sqlite functions, destroy is not called on failure
+    const auto rc = sqlite3_create_collation_v2 (
+        _connection->db (), name.c_str (), SQLITE_UTF8, data, call, destroy);
+    if (rc != SQLITE_OK)
+      {
+        destroy (data);
+        throw SQLite3Error{rc, sqlite3_errmsg (_connection->db ())};
+      }
+  }
+}
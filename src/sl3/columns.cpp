@@ -98,8 +98,10 @@ namespace sl3
   DbValues
   Columns::getRow () const
   {
+    const int                colCount = count ();
     DbValues::container_type v;
-    for (int i = 0; i < count (); ++i)
+    v.reserve (as_size_t (colCount));
+    for (int i = 0; i < colCount; ++i)
       {
         v.push_back (getValue (i));
       }
@@ -114,8 +116,10 @@ namespace sl3
         throw ErrTypeMisMatch ("types.size () != getColumnCount ()");
       }
 
+    const int                colCount = count ();
     DbValues::container_type v;
-    for (int i = 0; i < count (); ++i)
+    v.reserve (as_size_t (colCount));
+    for (int i = 0; i < colCount; ++i)
       {
         v.push_back (getValue (i, types[as_size_t (i)]));
       }
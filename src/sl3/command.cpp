@@ -17,6 +17,7 @@
 #include <sl3/database.hpp>
 #include <sl3/error.hpp>
 
+#include "arraymodule.hpp"
 #include "utils.hpp"
 
 namespace sl3
@@ -54,8 +55,36 @@ namespace sl3
                            : DbValues ();
     }
 
+    std::vector<std::string>
+    createParameterNames (sqlite3_stmt* stmt)
+    {
+      const int paracount = sqlite3_bind_parameter_count (stmt);
+
+      std::vector<std::string> names;
+      names.reserve (as_size_t (paracount));
+      for (int i = 1; i <= paracount; ++i)
+        {
+          const char* name = sqlite3_bind_parameter_name (stmt, i);
+          names.emplace_back (name ? name : "");
+        }
+      return names;
+    }
+
+    template <typename Index>
+    Index
+    createParameterIndex (const std::vector<std::string>& names)
+    {
+      Index index;
+      for (std::size_t i = 0; i < names.size (); ++i)
+        {
+          if (!names[i].empty ())
+            index.emplace (names[i], as_int (i));
+        }
+      return index;
+    }
+
     void
-    bind (sqlite3_stmt* stmt, DbValues& parameters)
+    bindParameters (sqlite3_stmt* stmt, DbValues& parameters)
     {
       int curParaNr = 0;
       for (auto& val : parameters)
@@ -87,12 +116,16 @@ namespace sl3
               break;
 
             case Type::Blob:
-              rc = sqlite3_bind_blob (
-                  stmt,
-                  curParaNr,
-                  &(val.getBlob ()[0]),
-                  static_cast<int> (val.getBlob ().size ()),
-                  SQLITE_STATIC);
+              // an empty blob has no valid data pointer, and null data
+              // would bind Null
+              rc = val.getBlob ().empty ()
+                       ? sqlite3_bind_zeroblob (stmt, curParaNr, 0)
+                       : sqlite3_bind_blob (
+                           stmt,
+                           curParaNr,
+                           val.getBlob ().data (),
+                           static_cast<int> (val.getBlob ().size ()),
+                           SQLITE_STATIC);
 
               break;
 
@@ -109,12 +142,94 @@ namespace sl3
         }
     }
 
+    void
+    bindParameters (sqlite3_stmt* stmt, const ParamView& parameters)
+    {
+      const auto count = as_size_t (sqlite3_bind_parameter_count (stmt));
+      if (parameters.size () != count)
+        throw ErrTypeMisMatch ("parameter count");
+
+      for (std::size_t i = 0; i < count; ++i)
+        {
+          const ParamValue& val       = parameters.at (i);
+          const int         curParaNr = as_int (i + 1);
+
+          int rc;
+          switch (val.getType ())
+            {
+            case Type::Int:
+              rc = sqlite3_bind_int64 (stmt, curParaNr, val.getInt ());
+              break;
+
+            case Type::Real:
+              rc = sqlite3_bind_double (stmt, curParaNr, val.getReal ());
+              break;
+
+            case Type::Text:
+              {
+                // null data would bind Null
+                const auto text = val.getText ();
+                rc              = sqlite3_bind_text64 (
+                    stmt,
+                    curParaNr,
+                    text.empty () ? "" : text.data (),
+                    text.size (),
+                    SQLITE_STATIC,
+                    SQLITE_UTF8);
+                break;
+              }
+
+            case Type::Blob:
+              {
+                const auto blob = val.getBlob ();
+                rc              = blob.size () == 0
+                         ? sqlite3_bind_zeroblob (stmt, curParaNr, 0)
+                         : sqlite3_bind_blob64 (stmt,
+                                                curParaNr,
+                                                blob.data (),
+                                                blob.size (),
+                                                SQLITE_STATIC);
+                break;
+              }
+
+            default:
+              rc = sqlite3_bind_null (stmt, curParaNr);
+              break;
+            }
+
+          if (rc != SQLITE_OK)
+            throw sl3::SQLite3Error (rc, sqlite3_errstr (rc));
+        }
+    }
+
+    void
+    bindArrays (
+        sqlite3_stmt*                                              stmt,
+        const std::vector<std::pair<std::size_t, ArrayParameter>>& arrays)
+    {
+      for (const auto& array : arrays)
+        {
+          // the Command owns the ArrayParameter, no destructor needed
+          const auto rc = sqlite3_bind_pointer (
+              stmt,
+              as_int (array.first + 1),
+              const_cast<ArrayParameter*> (&array.second),
+              internal::arrayPointerType,
+              nullptr);
+
+          if (rc != SQLITE_OK)
+            throw sl3::SQLite3Error (rc, ""); // LCOV_EXCL_LINE
+        }
+    }
+
   } // ns
 
   Command::Command (Connection connection, const std::string& sql)
   : _connection (std::move (connection))
   , _stmt (createStmt (_connection->db (), sql))
   , _parameters (createParameters (_stmt))
+  , _parameterNames (createParameterNames (_stmt))
+  , _parameterIndex (createParameterIndex<ParameterIndex> (_parameterNames))
   {
   }
 
@@ -124,6 +239,8 @@ namespace sl3
   : _connection (std::move (connection))
   , _stmt (createStmt (_connection->db (), sql))
   , _parameters (std::move (parameters))
+  , _parameterNames (createParameterNames (_stmt))
+  , _parameterIndex (createParameterIndex<ParameterIndex> (_parameterNames))
   {
     const size_t paracount = as_size_t (sqlite3_bind_parameter_count (_stmt));
 
@@ -137,6 +254,9 @@ namespace sl3
   : _connection (std::move (other._connection))
   , _stmt (other._stmt)
   , _parameters (std::move (other._parameters))
+  , _parameterNames (std::move (other._parameterNames))
+  , _parameterIndex (std::move (other._parameterIndex))
+  , _arrays (std::move (other._arrays))
   { // clear stm so that d'tor ot other does no action
     other._stmt = nullptr;
   }
@@ -167,8 +287,23 @@ namespace sl3
   Dataset
   Command::select (const DbValues& parameters, const Types& types)
   {
-    Dataset  ds{types};
-    Callback fillds = [&ds] (Columns columns) -> bool {
+    Dataset ds{types};
+    execute (fillDataset (ds), parameters);
+    return ds;
+  }
+
+  Dataset
+  Command::select (const ParamView& parameters, const Types& types)
+  {
+    Dataset ds{types};
+    execute (fillDataset (ds), parameters);
+    return ds;
+  }
+
+  Command::Callback
+  Command::fillDataset (Dataset& ds)
+  {
+    return [&ds] (Columns columns) -> bool {
       if (ds._names.size () == 0)
         {
           const int typeCount = static_cast<int> (ds._fieldtypes.size ());
@@ -185,7 +320,7 @@ namespace sl3
               throw ErrTypeMisMatch (
                   "DbValuesTypeList.size != queryrow.getColumnCount()");
             }
-          ds._names = columns.getNames ();
+          ds.setNames (columns.getNames ());
         }
 
       // this will throw if a type does not match.
@@ -193,9 +328,6 @@ namespace sl3
 
       return true;
     };
-
-    execute (fillds, parameters);
-    return ds;
   }
 
   void
@@ -230,8 +362,36 @@ namespace sl3
     if (parameters.size () > 0)
       setParameters (parameters);
 
-    bind (_stmt, _parameters);
+    bindParameters (_stmt, _parameters);
+    bindArrays (_stmt, _arrays);
+    run (callback);
+  }
+
+  void
+  Command::execute (const ParamView& parameters)
+  {
+    execute ([] (Columns) -> bool { return true; }, parameters);
+  }
+
+  void
+  Command::execute (Callback callback, const ParamView& parameters)
+  {
+    _connection->ensureValid ();
+
+    // the borrowed values must not stay bound after this execution,
+    // also not if binding fails after some values were bound
+    using ClearGuard
+        = std::unique_ptr<sqlite3_stmt, decltype (&sqlite3_clear_bindings)>;
+    ClearGuard clearGuard (_stmt, &sqlite3_clear_bindings);
+    bindParameters (_stmt, parameters);
 
+    bindArrays (_stmt, _arrays);
+    run (callback);
+  }
+
+  void
+  Command::run (const Callback& callback)
+  {
     // use this to ensure a reset of _stmt
     using ResetGuard
         = std::unique_ptr<sqlite3_stmt, decltype (&sqlite3_reset)>;
@@ -258,6 +418,9 @@ namespace sl3
 
           default:
             {
+              if ((rc & 0xff) == SQLITE_INTERRUPT)
+                throw ErrInterrupted{_connection->interrupts.reason ()};
+
               auto         db = sqlite3_db_handle (_stmt);
               SQLite3Error sl3error (rc, sqlite3_errmsg (db));
               throw sl3error;
@@ -312,19 +475,64 @@ namespace sl3
     _parameters.swap (values);
   }
 
-  std::vector<std::string>
+  const std::vector<std::string>&
   Command::getParameterNames () const
   {
-    std::vector<std::string> names;
-    names.resize (_parameters.size ());
+    return _parameterNames;
+  }
 
-    for (unsigned int i = 0; i < _parameters.size (); ++i)
+  int
+  Command::getParameterIndex (std::string_view name) const
+  {
+    const auto pos = _parameterIndex.find (name);
+    if (pos == _parameterIndex.end ())
+      throw ErrOutOfRange ("no parameter " + std::string{name});
+
+    return pos->second;
+  }
+
+  DbValue&
+  Command::getParameter (std::string_view name)
+  {
+    return getParameter (getParameterIndex (name));
+  }
+
+  const DbValue&
+  Command::getParameter (std::string_view name) const
+  {
+    return getParameter (getParameterIndex (name));
+  }
+
+  void
+  Command::ensureParameterType (int idx, Type type) const
+  {
+    const Type current = getParameter (idx).dbtype ();
+    if (current != Type::Variant && current != type)
+      throw ErrTypeMisMatch (typeName (current) + "!=" + typeName (type));
+  }
+
+  void
+  Command::bindArray (int idx, ArrayParameter values)
+  {
+    if (idx < 0 || as_size_t (idx) >= _parameters.size ())
+      throw ErrOutOfRange ("no parameter " + std::to_string (idx));
+
+    const auto pos = as_size_t (idx);
+    for (auto& array : _arrays)
       {
-        const char* chrname
-            = sqlite3_bind_parameter_name (_stmt, as_int (i + 1));
-        names[i] = chrname ? chrname : "";
+        if (array.first == pos)
+          {
+            array.second = std::move (values);
+            return;
+          }
       }
-    return names;
+    _arrays.emplace_back (pos, std::move (values));
+  }
+
+  void
+  Command::clearArrays () noexcept
+  {
+    _arrays.clear ();
   }
 
 } // ns
@@ -11,6 +11,13 @@
 
 #include <sl3/database.hpp>
 
+#include <memory>
+
+#include "busyhandler.hpp"
+#include "hooks.hpp"
+#include "interrupt.hpp"
+#include "vfsshim.hpp"
+
 struct sqlite3;
 
 namespace sl3
@@ -43,6 +50,18 @@ namespace sl3
       ///  throw ErrNoConnection if not valid
       void ensureValid ();
 
+      /// the sqlite hooks of this connection
+      Hooks hooks;
+
+      /// I/O counters, if opened with the ioStatsVfs or a slowIoVfs
+      std::unique_ptr<IoStatsState> ioStats;
+
+      /// execution limits of Database::limitExecution
+      Interrupts interrupts;
+
+      /// the busy handler of Database::setBusyPolicy
+      BusyState busy;
+
     private:
       Connection (Connection&&) = default;
 
@@ -93,6 +112,8 @@ namespace sl3
       if (sl3db == nullptr)
         return;
 
+      interrupts.clear (sl3db);
+
       // total clean up to be sure nothing left.
       auto stm = sqlite3_next_stmt (sl3db, 0);
       while (stm != nullptr)
@@ -0,0 +1,451 @@
+/******************************************************************************
+ ------------- Copyright (c) 2009-2023 H a r a l d  A c h i t z ---------------
+ ---------- < h a r a l d dot a c h i t z at g m a i l dot c o m > ------------
+ ---- This Source Code Form is subject to the terms of the Mozilla Public -----
+ ---- License, v. 2.0. If a copy of the MPL was not distributed with this -----
+ ---------- file, You can obtain one at http://mozilla.org/MPL/2.0/. ----------
+ ******************************************************************************/
+
+#include <sl3/csv.hpp>
+
+#include <sqlite3.h>
+
+#include <algorithm>
+#include <cstring>
+#include <istream>
+#include <ostream>
+
+#include <sl3/error.hpp>
+
+#include "bufferedoutput.hpp"
+#include "connection.hpp"
+#include "utils.hpp"
+
+namespace sl3
+{
+  namespace
+  {
+    const char*
+    findChar (const char* first, const char* last, char c)
+    {
+      return first < last ? static_cast<const char*> (std::memchr (
+                 first, c, static_cast<std::size_t> (last - first)))
+                          : nullptr;
+    }
+
+    std::string
+    atLine (std::size_t line)
+    {
+      return "line " + std::to_string (line) + ": ";
+    }
+
+    void
+    appendHex (internal::BufferedOutput& out,
+               const unsigned char*      data,
+               std::size_t               size)
+    {
+      static const char digits[] = "0123456789ABCDEF";
+      for (std::size_t i = 0; i < size; ++i)
+        {
+          out.append (digits[data[i] >> 4]);
+          out.append (digits[data[i] & 0x0F]);
+        }
+    }
+
+    void
+    appendText (internal::BufferedOutput& out,
+                const CsvFormat&          format,
+                std::string_view          text)
+    {
+      if (text.empty ())
+        {
+          if (format.emptyIsNull)
+            {
+              out.append (format.quote);
+              out.append (format.quote);
+            }
+          return;
+        }
+
+      const char special[] = {format.delimiter, format.quote, '\n', '\r'};
+      if (text.find_first_of (std::string_view{special, sizeof (special)})
+          == std::string_view::npos)
+        {
+          out.append (text);
+          return;
+        }
+
+      out.append (format.quote);
+      const char* first = text.data ();
+      const char* last  = first + text.size ();
+      while (const char* q = findChar (first, last, format.quote))
+        {
+          out.append (std::string_view{
+              first, static_cast<std::size_t> (q - first + 1)});
+          out.append (format.quote);
+          first = q + 1;
+        }
+      out.append (
+          std::string_view{first, static_cast<std::size_t> (last - first)});
+      out.append (format.quote);
+    }
+  }
+
+  CsvReader::CsvReader (std::istream& in,
+                        CsvFormat     format,
+                        std::size_t   blockSize)
+  : _in (in)
+  , _format (format)
+  , _buffer (std::max<std::size_t> (blockSize, 16))
+  {
+    if (_format.header && next ())
+      {
+        _header.reserve (_fields.size ());
+        for (const auto& field : _fields)
+          _header.emplace_back (field.data, field.size);
+      }
+  }
+
+  bool
+  CsvReader::fill ()
+  {
+    if (_pos > 0)
+      {
+        std::copy (_buffer.begin () + static_cast<std::ptrdiff_t> (_pos),
+                   _buffer.begin () + static_cast<std::ptrdiff_t> (_end),
+                   _buffer.begin ());
+        _end -= _pos;
+        _pos = 0;
+      }
+    if (_end == _buffer.size ()) // a record does not fit
+      _buffer.resize (_buffer.size () * 2);
+
+    _in.read (_buffer.data () + _end,
+              static_cast<std::streamsize> (_buffer.size () - _end));
+    const auto got = static_cast<std::size_t> (_in.gcount ());
+    _end += got;
+    if (got == 0)
+      _eof = true;
+
+    return got > 0;
+  }
+
+  const char*
+  CsvReader::findRecordEnd (const char* first) const
+  {
+    const char* const last  = _buffer.data () + _end;
+    const char        quote = _format.quote;
+    const char*       pos   = first;
+
+    for (;;)
+      {
+        // outside of quotes, the next line break ends the record
+        const char* lf = findChar (pos, last, '\n');
+        const char* q  = findChar (pos, lf ? lf : last, quote);
+        while (q && q != first && q[-1] != _format.delimiter)
+          q = findChar (q + 1, lf ? lf : last, quote); // not a field start
+
+        if (!q)
+          return lf;
+
+        // inside quotes, a single quote ends the quoted field
+        pos = q + 1;
+        for (;;)
+          {
+            q = findChar (pos, last, quote);
+            if (!q || q + 1 == last)
+              return nullptr; // more data needed
+            if (q[1] != quote)
+              break;
+            pos = q + 2;
+          }
+        pos = q + 1;
+      }
+  }
+
+  void
+  CsvReader::parseRecord (char* first, char* last)
+  {
+    const char delim = _format.delimiter;
+    const char quote = _format.quote;
+
+    _fields.clear ();
+    char* pos = first;
+    for (;;)
+      {
+        if (pos < last && *pos == quote)
+          {
+            // unescape in place, the result is never longer
+            char* const start = pos;
+            char*       out   = pos;
+            const char* in    = pos + 1;
+            for (;;)
+              {
+                const char* q = findChar (in, last, quote);
+                if (!q)
+                  throw ErrTypeMisMatch (atLine (_line)
+                                         + "unterminated quoted field");
+
+                const auto n = static_cast<std::size_t> (q - in);
+                std::memmove (out, in, n);
+                out += n;
+                if (q + 1 < last && q[1] == quote)
+                  {
+                    *out++ = quote;
+                    in     = q + 2;
+                    continue;
+                  }
+                pos = first + (q + 1 - first);
+                break;
+              }
+            _fields.push_back (
+                Field{start, static_cast<std::size_t> (out - start), false});
+
+            if (pos < last && *pos == '\r' && pos + 1 == last)
+              pos = last;
+            if (pos == last)
+              return;
+            if (*pos != delim)
+              throw ErrTypeMisMatch (atLine (_line)
+                                     + "unexpected data after quoted field");
+            ++pos;
+            continue;
+          }
+
+        const char* d   = findChar (pos, last, delim);
+        const char* end = d ? d : last;
+        auto        n   = static_cast<std::size_t> (end - pos);
+        if (!d && n > 0 && pos[n - 1] == '\r')
+          --n;
+
+        _fields.push_back (Field{pos, n, n == 0 && _format.emptyIsNull});
+        if (!d)
+          return;
+        pos = first + (d + 1 - first);
+      }
+  }
+
+  bool
+  CsvReader::next ()
+  {
+    for (;;)
+      {
+        const char* data      = _buffer.data ();
+        const char* recordEnd = findRecordEnd (data + _pos);
+        if (!recordEnd)
+          {
+            if (!_eof)
+              {
+                fill ();
+                continue;
+              }
+            if (_pos == _end)
+              {
+                _fields.clear ();
+                return false;
+              }
+            recordEnd = data + _end; // last record without line break
+          }
+
+        char* first = _buffer.data () + _pos;
+        char* last  = _buffer.data () + (recordEnd - data);
+        _pos        = static_cast<std::size_t> (recordEnd - data)
+               + (recordEnd < data + _end ? 1 : 0);
+
+        _line = _nextLine;
+        _nextLine += static_cast<std::size_t> (std::count (first, last, '\n'))
+                     + 1;
+
+        if (first == last || (last - first == 1 && *first == '\r'))
+          continue; // empty line
+
+        parseRecord (first, last);
+        return true;
+      }
+  }
+
+  std::size_t
+  CsvReader::size () const noexcept
+  {
+    return _fields.size ();
+  }
+
+  std::string_view
+  CsvReader::operator[] (std::size_t idx) const noexcept
+  {
+    return std::string_view{_fields[idx].data, _fields[idx].size};
+  }
+
+  bool
+  CsvReader::isNull (std::size_t idx) const noexcept
+  {
+    return _fields[idx].null;
+  }
+
+  const std::vector<std::string>&
+  CsvReader::header () const noexcept
+  {
+    return _header;
+  }
+
+  std::size_t
+  CsvReader::line () const noexcept
+  {
+    return _line;
+  }
+
+  std::size_t
+  CsvReader::importInto (Command& cmd)
+  {
+    cmd._connection->ensureValid ();
+
+    sqlite3_stmt* const stmt       = cmd._stmt;
+    const std::size_t   paramCount = cmd._parameters.size ();
+    const auto          noop       = [] (Columns) { return true; };
+
+    std::size_t count = 0;
+    while (next ())
+      {
+        if (_fields.size () != paramCount)
+          throw ErrTypeMisMatch (atLine (_line)
+                                 + std::to_string (_fields.size ())
+                                 + " fields for "
+                                 + std::to_string (paramCount)
+                                 + " parameters");
+
+        for (std::size_t i = 0; i < paramCount; ++i)
+          {
+            const Field& field = _fields[i];
+            const int    nr    = as_int (i + 1);
+            // the buffer does not change until the next record
+            const int rc
+                = field.null ? sqlite3_bind_null (stmt, nr)
+                             : sqlite3_bind_text64 (stmt,
+                                                    nr,
+                                                    field.data,
+                                                    field.size,
+                                                    SQLITE_STATIC,
+                                                    SQLITE_UTF8);
+            if (rc != SQLITE_OK)
+              throw SQLite3Error{rc, sqlite3_errstr (rc)}; // LCOV_EXCL_LINE
+          }
+
+        cmd.run (noop);
+        ++count;
+      }
+
+    sqlite3_clear_bindings (stmt);
+    return count;
+  }
+
+  CsvWriter::CsvWriter (std::ostream& out,
+                        CsvFormat     format,
+                        std::size_t   bufferSize)
+  : _format (format)
+  , _out (std::make_unique<internal::BufferedOutput> (
+        [&out] (const char* data, std::size_t size) {
+          out.write (data, static_cast<std::streamsize> (size));
+          if (!out)
+            throw ErrUnexpected ("writing CSV output failed");
+        },
+        bufferSize))
+  {
+  }
+
+  CsvWriter::~CsvWriter ()
+  {
+    try
+      {
+        _out->flush ();
+      }
+    catch (...) // LCOV_EXCL_LINE
+      {         // a destructor can not report it
+      }
+  }
+
+  void
+  CsvWriter::flush ()
+  {
+    _out->flush ();
+  }
+
+  std::size_t
+  CsvWriter::rows () const noexcept
+  {
+    return _rows;
+  }
+
+  void
+  CsvWriter::onStart ()
+  {
+    _headerDone = !_format.header;
+  }
+
+  bool
+  CsvWriter::onRow (Columns columns)
+  {
+    sqlite3_stmt* const stmt  = columns.get_stmt ();
+    const int           count = columns.count ();
+    auto&               out   = *_out;
+
+    if (!_headerDone)
+      {
+        for (int i = 0; i < count; ++i)
+          {
+            if (i > 0)
+              out.append (_format.delimiter);
+            const char* name = sqlite3_column_name (stmt, i);
+            appendText (out, _format, name ? name : "");
+          }
+        out.append ('\n');
+        _headerDone = true;
+      }
+
+    for (int i = 0; i < count; ++i)
+      {
+        if (i > 0)
+          out.append (_format.delimiter);
+
+        switch (sqlite3_column_type (stmt, i))
+          {
+          case SQLITE_INTEGER:
+            appendInt (out, sqlite3_column_int64 (stmt, i));
+            break;
+
+          case SQLITE_FLOAT:
+            appendReal (out, sqlite3_column_double (stmt, i));
+            break;
+
+          case SQLITE_TEXT:
+            {
+              const auto* text = reinterpret_cast<const char*> (
+                  sqlite3_column_text (stmt, i));
+              const auto size = as_size_t (sqlite3_column_bytes (stmt, i));
+              appendText (out, _format, std::string_view{text, size});
+              break;
+            }
+
+          case SQLITE_BLOB:
+            {
+              const auto* blob = static_cast<const unsigned char*> (
+                  sqlite3_column_blob (stmt, i));
+              const auto size = as_size_t (sqlite3_column_bytes (stmt, i));
+              appendHex (out, blob, size);
+              break;
+            }
+
+          default: // SQLITE_NULL, an empty field
+            break;
+          }
+      }
+    out.append ('\n');
+    ++_rows;
+    return true;
+  }
+
+  void
+  CsvWriter::onEnd ()
+  {
+    _out->flush ();
+  }
+}
@@ -10,12 +10,14 @@
 
 #include <sqlite3.h>
 
+#include "arraymodule.hpp"
 #include "connection.hpp"
+#include "vfsshim.hpp"
 
 namespace
 {
   sqlite3*
-  opendb (const std::string& name, int openFlags)
+  opendb (const std::string& name, int openFlags, const std::string& vfs)
   {
     if (openFlags == 0)
       {
@@ -23,7 +25,10 @@ namespace
       }
 
     sqlite3* db    = nullptr;
-    auto     sl3rc = sqlite3_open_v2 (name.c_str (), &db, openFlags, nullptr);
+    auto     sl3rc = sqlite3_open_v2 (name.c_str (),
+                                  &db,
+                                  openFlags,
+                                  vfs.empty () ? nullptr : vfs.c_str ());
 
     if (sl3rc != SQLITE_OK)
       {
@@ -47,9 +52,28 @@ namespace sl3
   }
 
   Database::Database (const std::string& name, int flags)
-  : _connection{new internal::Connection{opendb (name, flags)}}
+  : Database (name, flags, std::string{})
   {
+  }
+
+  Database::Database (const std::string& name,
+                      int                flags,
+                      const std::string& vfs)
+  : _connection{new internal::Connection{nullptr}}
+  {
+    if (!vfs.empty () && internal::isShimVfs (vfs))
+      _connection->ioStats = std::make_unique<internal::IoStatsState> ();
+
+    {
+      internal::IoStatsScope scope{_connection->ioStats.get ()};
+      _connection->sl3db = opendb (name, flags, vfs);
+    }
+
     sqlite3_extended_result_codes (_connection->db (), true);
+
+    const auto rc = internal::createArrayModule (_connection->db ());
+    if (rc != SQLITE_OK) // LCOV_EXCL_BR_LINE
+      throw SQLite3Error{rc, "sl3_array module"}; // LCOV_EXCL_LINE
   }
 
   Database::Database (Database&& other) noexcept
@@ -97,6 +121,8 @@ namespace sl3
       {
         using scope_guard = std::unique_ptr<char, decltype (&sqlite3_free)>;
         scope_guard guard (dbMsg, &sqlite3_free);
+        if ((rc & 0xff) == SQLITE_INTERRUPT)
+          throw ErrInterrupted{_connection->interrupts.reason ()};
         throw SQLite3Error{rc, dbMsg};
       }
   }
@@ -193,12 +219,74 @@ namespace sl3
     return sqlite3_last_insert_rowid (_connection->db ());
   }
 
+  std::string
+  Database::getFileName ()
+  {
+    _connection->ensureValid ();
+    const char* name = sqlite3_db_filename (_connection->db (), "main");
+    return name ? std::string{name} : std::string{};
+  }
+
   sqlite3*
   Database::db ()
   {
     return _connection->db ();
   }
 
+  HookId
+  Database::onChanges (ChangeHandler handler)
+  {
+    _connection->ensureValid ();
+    auto& hooks = _connection->hooks;
+    auto  id    = hooks.newId ();
+    hooks.addChanges (_connection->db (), id, std::move (handler));
+    return id;
+  }
+
+  HookId
+  Database::onCommit (CommitHandler handler)
+  {
+    _connection->ensureValid ();
+    auto& hooks = _connection->hooks;
+    auto  id    = hooks.newId ();
+    hooks.addCommit (_connection->db (), id, std::move (handler));
+    return id;
+  }
+
+  HookId
+  Database::onRollback (RollbackHandler handler)
+  {
+    _connection->ensureValid ();
+    auto& hooks = _connection->hooks;
+    auto  id    = hooks.newId ();
+    hooks.addRollback (_connection->db (), id, std::move (handler));
+    return id;
+  }
+
+  HookId
+  Database::onWal (WalHandler handler)
+  {
+    _connection->ensureValid ();
+    auto& hooks = _connection->hooks;
+    auto  id    = hooks.newId ();
+    hooks.addWal (_connection->db (), id, std::move (handler));
+    return id;
+  }
+
+  void
+  Database::setAuthorizer (Authorizer authorizer)
+  {
+    _connection->ensureValid ();
+    _connection->hooks.setAuthorizer (_connection->db (),
+                                      std::move (authorizer));
+  }
+
+  void
+  Database::removeHook (HookId id)
+  {
+    _connection->hooks.remove (_connection->db (), id);
+  }
+
   auto
   Database::beginTransaction () -> Transaction
   {
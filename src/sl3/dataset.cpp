@@ -12,31 +12,274 @@
 
 #include <algorithm>
 #include <iterator>
+#include <numeric>
 #include <sl3/error.hpp>
 #include <stdexcept>
+#include <utility>
 
+#include "normkey.hpp"
+#include "parallel.hpp"
+#include "rowindex.hpp"
 #include "utils.hpp"
 
 namespace sl3
 {
+  namespace
+  {
+    using RowOrder = std::vector<std::size_t>;
+
+    RowOrder
+    identityOrder (std::size_t rows)
+    {
+      RowOrder order (rows);
+      std::iota (order.begin (), order.end (), std::size_t{0});
+      return order;
+    }
+
+    using NameIndex = std::unordered_map<std::string, std::size_t>;
+
+    NameIndex
+    nameIndexOf (const std::vector<std::string>& names)
+    {
+      NameIndex index;
+      index.reserve (names.size ());
+      for (std::size_t i = 0; i < names.size (); ++i)
+        index.emplace (names[i], i); // keeps the first of equal names
+      return index;
+    }
+
+    std::size_t
+    lookupName (const NameIndex& index, const std::string& name)
+    {
+      auto pos = index.find (name);
+      if (pos == index.end ())
+        throw ErrOutOfRange ("Field name " + name + " not found");
+
+      return pos->second;
+    }
+
+    void
+    ensureMergeable (const Types&                    types,
+                     const std::vector<std::string>& names,
+                     const Types&                    otherTypes,
+                     const std::vector<std::string>& otherNames)
+    {
+      if (!otherNames.empty ())
+        {
+          if (!names.empty () && names != otherNames)
+            throw ErrTypeMisMatch ();
+        }
+
+      if (types.size () != otherTypes.size ())
+        throw ErrTypeMisMatch ();
+
+      for (std::size_t i = 0; i < types.size (); ++i)
+        {
+          if (types[i] != Type::Variant)
+            {
+              if (types[i] != otherTypes[i])
+                throw ErrTypeMisMatch ();
+            }
+        }
+    }
+
+    void
+    ensureRowTypes (const Types& types, const DbValues& row)
+    {
+      if (types.size () > 0 && types.size () != row.size ())
+        {
+          throw ErrTypeMisMatch ();
+        }
+
+      for (std::size_t i = 0; i < types.size (); ++i)
+        {
+          if (types[i] != Type::Variant)
+            {
+              if (types[i] != row[i].dbtype ())
+                {
+                  throw ErrTypeMisMatch ();
+                }
+            }
+        }
+    }
+
+    // rows of an untyped Dataset can have different sizes,
+    // all of them must have the fields for unchecked access
+    void
+    ensureFieldIndexes (const Dataset&                  ds,
+                        const std::vector<std::size_t>& idxs)
+    {
+      if (idxs.empty () || ds.size () == 0)
+        return;
+
+      const auto widest = *std::max_element (idxs.begin (), idxs.end ());
+      for (const auto& row : ds)
+        {
+          if (!(widest < row.size ()))
+            throw ErrOutOfRange ("field index " + std::to_string (widest)
+                                 + " out of range");
+        }
+    }
+
+    // the key scheme that can be used for all values of a field
+    internal::KeyScheme
+    fieldKeyScheme (const Dataset& ds, std::size_t idx, Type fieldType)
+    {
+      if (fieldType != Type::Variant)
+        return internal::keySchemeFor (fieldType);
+
+      Type storage = Type::Null;
+      for (const auto& row : ds)
+        {
+          const Type t = row[idx].type ();
+          if (t == Type::Null)
+            continue;
+
+          if (storage == Type::Null)
+            storage = t;
+          else if (storage != t)
+            return internal::KeyScheme::Variant;
+        }
+      return internal::keySchemeFor (storage);
+    }
+
+    // single numeric key, sort (bits, row) pairs, nulls are kept apart
+    RowOrder
+    numericOrder (const Dataset&      ds,
+                  const SortKey&      key,
+                  internal::KeyScheme scheme,
+                  const SortOptions&  options)
+    {
+      using Keyed = std::pair<uint64_t, std::size_t>;
+      std::vector<Keyed> keyed;
+      RowOrder           nulls;
+      keyed.reserve (ds.size ());
+
+      for (std::size_t r = 0; r < ds.size (); ++r)
+        {
+          const Value& v = ds[r][key.index].getValue ();
+          if (v.isNull ())
+            {
+              nulls.push_back (r);
+              continue;
+            }
+
+          uint64_t bits = scheme == internal::KeyScheme::Int
+                              ? internal::intBits (v.int64 ())
+                              : internal::realBits (v.real ());
+          if (key.order == SortOrder::Descending)
+            bits = ~bits;
+
+          keyed.emplace_back (bits, r);
+        }
+
+      const bool nullsFirst = key.nulls == NullsOrder::First;
+
+      std::size_t sortCount = keyed.size ();
+      if (options.limit > 0)
+        {
+          const std::size_t before = nullsFirst ? nulls.size () : 0;
+          sortCount = options.limit > before ? options.limit - before : 0;
+          sortCount = std::min (sortCount, keyed.size ());
+        }
+
+      if (sortCount < keyed.size ())
+        {
+          using diff_t = std::vector<Keyed>::difference_type;
+          std::partial_sort (keyed.begin (),
+                             keyed.begin () + static_cast<diff_t> (sortCount),
+                             keyed.end ());
+        }
+      else
+        {
+          internal::parallelSort (keyed, std::less<Keyed>{}, options.threads);
+        }
+
+      RowOrder order;
+      order.reserve (ds.size ());
+      if (nullsFirst)
+        order.insert (order.end (), nulls.begin (), nulls.end ());
+      for (const auto& k : keyed)
+        order.push_back (k.second);
+      if (!nullsFirst)
+        order.insert (order.end (), nulls.begin (), nulls.end ());
+
+      return order;
+    }
+
+    // composite keys, encoded into memcmp comparable byte strings
+    RowOrder
+    normalizedOrder (const Dataset&                          ds,
+                     const std::vector<SortKey>&             keys,
+                     const std::vector<internal::KeyScheme>& schemes,
+                     const SortOptions&                      options)
+    {
+      const std::size_t rows    = ds.size ();
+      const std::size_t threads = internal::threadsFor (options.threads, rows);
+
+      const internal::RowKeys refs{
+          rows, threads, [&] (internal::KeyWriter& writer, std::size_t r) {
+            const auto& row = ds[r];
+            for (std::size_t k = 0; k < keys.size (); ++k)
+              {
+                writer.append (row[keys[k].index],
+                               schemes[k],
+                               keys[k].order,
+                               keys[k].nulls);
+              }
+          }};
+
+      auto less = [&refs] (std::size_t a, std::size_t b) {
+        const int c = internal::compareKeys (refs[a], refs[b]);
+        return c != 0 ? c < 0 : a < b;
+      };
+
+      RowOrder order = identityOrder (rows);
+      if (options.limit > 0 && options.limit < rows)
+        {
+          using diff_t = RowOrder::difference_type;
+          std::partial_sort (order.begin (),
+                             order.begin ()
+                                 + static_cast<diff_t> (options.limit),
+                             order.end (),
+                             less);
+        }
+      else
+        {
+          internal::parallelSort (order, less, threads);
+        }
+      return order;
+    }
+  }
+
   Dataset::Dataset () noexcept
   : _fieldtypes ()
   , _names ()
+  , _nameIndex ()
+  , _indexes ()
   {
   }
   Dataset::Dataset (Types types)
   : _fieldtypes (std::move (types))
   , _names ()
+  , _nameIndex ()
+  , _indexes ()
   {
   }
 
   Dataset::Dataset (Dataset&& other) noexcept (
       std::is_nothrow_move_constructible<Container<DbValues>>::value
       && std::is_nothrow_move_constructible<Types>::value
-      && std::is_nothrow_move_constructible<std::vector<std::string>>::value)
+      && std::is_nothrow_move_constructible<std::vector<std::string>>::value
+      && std::is_nothrow_move_constructible<
+          std::unordered_map<std::string, std::size_t>>::value
+      && std::is_nothrow_move_constructible<
+          std::vector<std::shared_ptr<const internal::RowIndex>>>::value)
   : Container<std::vector<DbValues>> (std::move (other))
   , _fieldtypes (std::move (other._fieldtypes))
   , _names (std::move (other._names))
+  , _nameIndex (std::move (other._nameIndex))
+  , _indexes (std::move (other._indexes))
   {
   }
 
@@ -44,6 +287,8 @@ namespace sl3
   Dataset::reset ()
   {
     _names.clear ();
+    _nameIndex.clear ();
+    _indexes.clear ();
     _cont.clear ();
   }
 
@@ -57,58 +302,88 @@ namespace sl3
   void
   Dataset::merge (const Dataset& other)
   {
-    if (!other._names.empty ())
-      {
-        if (!_names.empty () && _names != other._names)
-          throw ErrTypeMisMatch ();
-      }
-
-    if (_fieldtypes.size () != other._fieldtypes.size ())
-      throw ErrTypeMisMatch ();
-
-    for (std::size_t i = 0; i < _fieldtypes.size (); ++i)
-      {
-        if (_fieldtypes[i] != Type::Variant)
-          {
-            if (_fieldtypes[i] != other._fieldtypes[i])
-              throw ErrTypeMisMatch ();
-          }
-      }
+    ensureMergeable (_fieldtypes, _names, other._fieldtypes, other._names);
 
+    _indexes.clear ();
     _cont.insert (_cont.end (), other._cont.begin (), other._cont.end ());
   }
 
   void
-  Dataset::merge (const DbValues& row)
+  Dataset::merge (Dataset&& other)
   {
-    if (_fieldtypes.size () > 0 && _fieldtypes.size () != row.size ())
+    ensureMergeable (_fieldtypes, _names, other._fieldtypes, other._names);
+
+    _indexes.clear ();
+    if (_cont.empty ())
       {
-        throw ErrTypeMisMatch ();
+        _cont.swap (other._cont);
       }
-
-    for (std::size_t i = 0; i < _fieldtypes.size (); ++i)
+    else
       {
-        if (_fieldtypes[i] != Type::Variant)
-          {
-            if (_fieldtypes[i] != row[i].dbtype ())
-              {
-                throw ErrTypeMisMatch ();
-              }
-          }
+        _cont.reserve (_cont.size () + other._cont.size ());
+        std::move (
+            other._cont.begin (), other._cont.end (), std::back_inserter (_cont));
       }
+    other._cont.clear ();
+    other._indexes.clear ();
+  }
 
+  void
+  Dataset::merge (const DbValues& row)
+  {
+    ensureRowTypes (_fieldtypes, row);
+
+    _indexes.clear ();
     _cont.push_back (DbValues (row));
   }
 
+  void
+  Dataset::merge (DbValues&& row)
+  {
+    ensureRowTypes (_fieldtypes, row);
+
+    _indexes.clear ();
+    _cont.push_back (std::move (row));
+  }
+
+  void
+  Dataset::reserve (std::size_t rows)
+  {
+    _cont.reserve (rows);
+  }
+
   size_t
   Dataset::getIndex (const std::string& name) const
   {
-    using namespace std;
-    auto pos = find (_names.begin (), _names.end (), name);
-    if (pos == _names.end ())
-      throw ErrOutOfRange ("Field name " + name + " not found");
+    return lookupName (_nameIndex, name);
+  }
+
+  const std::vector<std::string>&
+  Dataset::getNames () const noexcept
+  {
+    return _names;
+  }
+
+  const Types&
+  Dataset::getTypes () const noexcept
+  {
+    return _fieldtypes;
+  }
+
+  ColumnHandle
+  Dataset::column (const std::string& name) const
+  {
+    const auto idx = getIndex (name);
+    return ColumnHandle{idx,
+                        idx < _fieldtypes.size () ? _fieldtypes[idx]
+                                                  : Type::Variant};
+  }
 
-    return as_size_t (distance (_names.begin (), pos));
+  void
+  Dataset::setNames (std::vector<std::string> names)
+  {
+    _nameIndex = nameIndexOf (names);
+    _names     = std::move (names);
   }
 
   void
@@ -116,17 +391,252 @@ namespace sl3
   {
     ASSERT_EXCEPT (cmp, ErrNullValueAccess);
 
-    auto lessValues = [&] (const DbValues& a, const DbValues& b) -> bool {
+    ensureFieldIndexes (*this, idxs);
+
+    // indexes are valid, no need for checked access while sorting
+    auto lessRows = [&] (std::size_t ia, std::size_t ib) -> bool {
+      const DbValues& a = _cont[ia];
+      const DbValues& b = _cont[ib];
       for (auto cur : idxs)
         {
-          if (cmp (a.at (cur), b.at (cur)))
+          if (cmp (a[cur], b[cur]))
             return true;
-          else if (cmp (b.at (cur), a.at (cur)))
+          else if (cmp (b[cur], a[cur]))
             return false;
         }
       return false;
     };
 
-    std::sort (begin (), end (), lessValues);
+    RowOrder order = identityOrder (_cont.size ());
+    std::sort (order.begin (), order.end (), lessRows);
+    applyOrder (order);
+  }
+
+  void
+  Dataset::orderBy (const std::vector<SortKey>& keys,
+                    const SortOptions&          options)
+  {
+    std::vector<std::size_t> idxs;
+    idxs.reserve (keys.size ());
+    for (const auto& key : keys)
+      idxs.push_back (key.index);
+    ensureFieldIndexes (*this, idxs);
+
+    if (_cont.size () < 2 || keys.empty ())
+      return;
+
+    std::vector<internal::KeyScheme> schemes;
+    schemes.reserve (keys.size ());
+    for (const auto& key : keys)
+      {
+        const Type fieldType = key.index < _fieldtypes.size ()
+                                   ? _fieldtypes[key.index]
+                                   : Type::Variant;
+        schemes.push_back (fieldKeyScheme (*this, key.index, fieldType));
+      }
+
+    const bool numeric = keys.size () == 1
+                         && schemes[0] != internal::KeyScheme::Variant;
+
+    applyOrder (numeric ? numericOrder (*this, keys[0], schemes[0], options)
+                        : normalizedOrder (*this, keys, schemes, options));
+  }
+
+  void
+  Dataset::applyOrder (const std::vector<std::size_t>& order)
+  {
+    container_type sorted;
+    sorted.reserve (order.size ());
+    for (auto idx : order)
+      sorted.emplace_back (std::move (_cont[idx]));
+
+    _indexes.clear ();
+    _cont.swap (sorted);
+  }
+
+  void
+  Dataset::createIndex (const std::vector<std::size_t>& fields,
+                        IndexType                       type,
+                        std::size_t                     threads)
+  {
+    if (fields.empty ())
+      throw ErrOutOfRange ("an index needs at least one field");
+
+    ensureFieldIndexes (*this, fields);
+
+    if (findIndex (fields, type))
+      return;
+
+    _indexes.push_back (
+        std::make_shared<internal::RowIndex> (*this, fields, type, threads));
+  }
+
+  bool
+  Dataset::hasIndex (const std::vector<std::size_t>& fields,
+                     IndexType                       type) const noexcept
+  {
+    return findIndex (fields, type) != nullptr;
+  }
+
+  void
+  Dataset::dropIndexes () noexcept
+  {
+    _indexes.clear ();
+  }
+
+  const internal::RowIndex*
+  Dataset::findIndex (const std::vector<std::size_t>& fields,
+                      IndexType                       type) const noexcept
+  {
+    for (const auto& index : _indexes)
+      {
+        if (index->type () == type && index->fields () == fields)
+          return index.get ();
+      }
+    return nullptr;
+  }
+
+  RowRange
+  Dataset::equalRange (const std::vector<std::size_t>& fields,
+                       const DbValues&                 key) const
+  {
+    const internal::RowIndex* index = nullptr;
+    if (key.size () == fields.size ())
+      index = findIndex (fields, IndexType::Hash);
+    if (!index)
+      index = findIndex (fields, IndexType::Ordered);
+    if (!index)
+      index = findIndex (fields, IndexType::Hash); // reports the key size
+
+    if (!index)
+      throw ErrOutOfRange ("no index for the given fields");
+
+    return index->equalRange (key);
+  }
+
+  const DbValues*
+  Dataset::find (const std::vector<std::size_t>& fields,
+                 const DbValues&                 key) const
+  {
+    const RowRange rows = equalRange (fields, key);
+    return rows.empty () ? nullptr : &_cont[rows[0]];
+  }
+
+  RowRange
+  Dataset::range (const std::vector<std::size_t>& fields,
+                  const DbValues&                 lower,
+                  const DbValues&                 upper) const
+  {
+    const auto* index = findIndex (fields, IndexType::Ordered);
+    if (!index)
+      throw ErrOutOfRange ("no ordered index for the given fields");
+
+    return index->range (lower, upper);
+  }
+
+  ChunkedDataset::ChunkedDataset () noexcept
+  : _fieldtypes ()
+  , _names ()
+  , _nameIndex ()
+  {
+  }
+
+  ChunkedDataset::ChunkedDataset (Types types)
+  : _fieldtypes (std::move (types))
+  , _names ()
+  , _nameIndex ()
+  {
+  }
+
+  void
+  ChunkedDataset::reset ()
+  {
+    _names.clear ();
+    _nameIndex.clear ();
+    _cont.clear ();
+  }
+
+  void
+  ChunkedDataset::reset (const Types& types)
+  {
+    _fieldtypes = types;
+    reset ();
+  }
+
+  void
+  ChunkedDataset::merge (ChunkedDataset&& other)
+  {
+    ensureMergeable (_fieldtypes, _names, other._fieldtypes, other._names);
+
+    if (_cont.empty ())
+      _cont.swap (other._cont);
+    else
+      std::move (
+          other._cont.begin (), other._cont.end (), std::back_inserter (_cont));
+
+    other._cont.clear ();
+  }
+
+  void
+  ChunkedDataset::merge (Dataset&& other)
+  {
+    ensureMergeable (_fieldtypes, _names, other._fieldtypes, other._names);
+
+    std::move (
+        other._cont.begin (), other._cont.end (), std::back_inserter (_cont));
+    other._cont.clear ();
+    other._indexes.clear ();
+  }
+
+  void
+  ChunkedDataset::merge (DbValues&& row)
+  {
+    ensureRowTypes (_fieldtypes, row);
+    _cont.push_back (std::move (row));
+  }
+
+  std::size_t
+  ChunkedDataset::getIndex (const std::string& name) const
+  {
+    return lookupName (_nameIndex, name);
+  }
+
+  Dataset
+  ChunkedDataset::toDataset () &&
+  {
+    Dataset ds{_fieldtypes};
+    ds.setNames (std::move (_names));
+    ds._cont.reserve (_cont.size ());
+    std::move (_cont.begin (), _cont.end (), std::back_inserter (ds._cont));
+    reset ();
+    return ds;
+  }
+
+  bool
+  ChunkedDataset::onRow (Columns columns)
+  {
+    if (_names.empty ())
+      {
+        const int typeCount = static_cast<int> (_fieldtypes.size ());
+
+        if (typeCount == 0)
+          {
+            Types::container_type c (as_size_t (columns.count ()),
+                                     Type::Variant);
+            Types          fieldtypes{c};
+            _fieldtypes.swap (fieldtypes);
+          }
+        else if (typeCount != columns.count ())
+          {
+            throw ErrTypeMisMatch (
+                "DbValuesTypeList.size != queryrow.getColumnCount()");
+          }
+        _names     = columns.getNames ();
+        _nameIndex = nameIndexOf (_names);
+      }
+
+    // this will throw if a type does not match.
+    _cont.emplace_back (columns.getRow (_fieldtypes));
+    return true;
   }
 }
@@ -15,6 +15,7 @@
 #include <limits>
 #include <ostream>
 #include <type_traits>
+#include <utility>
 
 #include <iostream>
 
@@ -186,7 +187,7 @@ namespace sl3
   : DbValue (type)
   {
     ensure (type).oneOf (Type::Text, Type::Variant);
-    _value = val;
+    _value = Value{std::move (val)};
   }
 
   DbValue::DbValue (double val, Type type)
@@ -200,7 +201,7 @@ namespace sl3
   : DbValue (type)
   {
     ensure (type).oneOf (Type::Blob, Type::Variant);
-    _value = val;
+    _value = Value{std::move (val)};
   }
 
   DbValue&
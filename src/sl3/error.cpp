@@ -17,6 +17,7 @@ namespace sl3
   template class LIBSL3_API ErrType<ErrCode::OutOfRange>;
   template class LIBSL3_API ErrType<ErrCode::TypeMisMatch>;
   template class LIBSL3_API ErrType<ErrCode::NullValueAccess>;
+  template class LIBSL3_API ErrType<ErrCode::Interrupted>;
   template class LIBSL3_API ErrType<ErrCode::UNEXPECTED>;
 
   std::ostream&
@@ -0,0 +1,248 @@
+/******************************************************************************
+ ------------- Copyright (c) 2009-2023 H a r a l d  A c h i t z ---------------
+ ---------- < h a r a l d dot a c h i t z at g m a i l dot c o m > ------------
+ ---- This Source Code Form is subject to the terms of the Mozilla Public -----
+ ---- License, v. 2.0. If a copy of the MPL was not distributed with this -----
+ ---------- file, You can obtain one at http://mozilla.org/MPL/2.0/. ----------
+ ******************************************************************************/
+
+#include <sl3/function.hpp>
+
+#include <sqlite3.h>
+
+#include <sl3/database.hpp>
+#include <sl3/error.hpp>
+
+#include "connection.hpp"
+
+namespace sl3
+{
+  namespace internal
+  {
+    bool
+    isNull (sqlite3_value* v) noexcept
+    {
+      return sqlite3_value_type (v) == SQLITE_NULL;
+    }
+
+    int64_t
+    toInt (sqlite3_value* v) noexcept
+    {
+      return sqlite3_value_int64 (v);
+    }
+
+    double
+    toReal (sqlite3_value* v) noexcept
+    {
+      return sqlite3_value_double (v);
+    }
+
+    std::string_view
+    toText (sqlite3_value* v) noexcept
+    {
+      // text first, bytes after, see sqlite3_value_bytes
+      auto text = reinterpret_cast<const char*> (sqlite3_value_text (v));
+      if (text == nullptr)
+        return {};
+      return {text, static_cast<std::size_t> (sqlite3_value_bytes (v))};
+    }
+
+    Blob
+    toBlob (sqlite3_value* v)
+    {
+      auto data = static_cast<const std::byte*> (sqlite3_value_blob (v));
+      if (data == nullptr)
+        return {};
+      return Blob (data, data + sqlite3_value_bytes (v));
+    }
+
+    DbValue
+    toValue (sqlite3_value* v)
+    {
+      switch (sqlite3_value_type (v))
+        {
+        case SQLITE_INTEGER:
+          return DbValue{toInt (v), Type::Variant};
+
+        case SQLITE_FLOAT:
+          return DbValue{toReal (v), Type::Variant};
+
+        case SQLITE_TEXT:
+          return DbValue{std::string{toText (v)}, Type::Variant};
+
+        case SQLITE_BLOB:
+          return DbValue{toBlob (v), Type::Variant};
+
+        default:
+          break;
+        }
+      return DbValue{Type::Variant};
+    }
+
+    void*
+    userData (sqlite3_context* ctx) noexcept
+    {
+      return sqlite3_user_data (ctx);
+    }
+
+    void*
+    aggregateContext (sqlite3_context* ctx, std::size_t bytes) noexcept
+    {
+      return sqlite3_aggregate_context (ctx, static_cast<int> (bytes));
+    }
+
+    void
+    setNoMemory (sqlite3_context* ctx) noexcept
+    {
+      sqlite3_result_error_nomem (ctx);
+    }
+
+    void
+    setNull (sqlite3_context* ctx) noexcept
+    {
+      sqlite3_result_null (ctx);
+    }
+
+    void
+    setInt (sqlite3_context* ctx, int64_t val) noexcept
+    {
+      sqlite3_result_int64 (ctx, val);
+    }
+
+    void
+    setReal (sqlite3_context* ctx, double val) noexcept
+    {
+      sqlite3_result_double (ctx, val);
+    }
+
+    void
+    setText (sqlite3_context* ctx, std::string_view val)
+    {
+      sqlite3_result_text64 (ctx,
+                             val.data () ? val.data () : "",
+                             val.size (),
+                             SQLITE_TRANSIENT,
+                             SQLITE_UTF8);
+    }
+
+    void
+    setBlob (sqlite3_context* ctx, const Blob& val)
+    {
+      if (val.empty ())
+        sqlite3_result_zeroblob (ctx, 0);
+      else
+        sqlite3_result_blob64 (
+            ctx, val.data (), val.size (), SQLITE_TRANSIENT);
+    }
+
+    void
+    setValue (sqlite3_context* ctx, const Value& val)
+    {
+      switch (val.getType ())
+        {
+        case Type::Int:
+          setInt (ctx, val.int64 ());
+          break;
+
+        case Type::Real:
+          setReal (ctx, val.real ());
+          break;
+
+        case Type::Text:
+          setText (ctx, val.text ());
+          break;
+
+        case Type::Blob:
+          setBlob (ctx, val.blob ());
+          break;
+
+        default:
+          setNull (ctx);
+          break;
+        }
+    }
+
+    void
+    setError (sqlite3_context* ctx, const char* msg)
+    {
+      sqlite3_result_error (ctx, msg, -1);
+    }
+  }
+
+  namespace
+  {
+    int
+    functionFlags (const FunctionOptions& options)
+    {
+      int flags = SQLITE_UTF8;
+      if (options.deterministic)
+        flags |= SQLITE_DETERMINISTIC;
+      if (options.innocuous)
+        flags |= SQLITE_INNOCUOUS;
+      if (options.directOnly)
+        flags |= SQLITE_DIRECTONLY;
+      return flags;
+    }
+  }
+
+  void
+  Database::registerFunction (const std::string&     name,
+                              int                    nArgs,
+                              const FunctionOptions& options,
+                              void*                  data,
+                              FunctionCall           call,
+                              void (*destroy) (void*))
+  {
+    if (!_connection->isValid ())
+      {
+        destroy (data);
+        throw ErrNoConnection{};
+      }
+
+    // sqlite calls destroy if this fails
+    const auto rc = sqlite3_create_function_v2 (_connection->db (),
+                                                name.c_str (),
+                                                nArgs,
+                                                functionFlags (options),
+                                                data,
+                                                call,
+                                                nullptr,
+                                                nullptr,
+                                                destroy);
+    if (rc != SQLITE_OK)
+      throw SQLite3Error{rc, sqlite3_errmsg (_connection->db ())};
+  }
+
+  void
+  Database::registerAggregate (const std::string&     name,
+                               int                    nArgs,
+                               const FunctionOptions& options,
+                               void*                  data,
+                               FunctionCall           step,
+                               FunctionFinal          final,
+                               FunctionFinal          value,
+                               FunctionCall           inverse,
+                               void (*destroy) (void*))
+  {
+    if (!_connection->isValid ())
+      {
+        destroy (data);
+        throw ErrNoConnection{};
+      }
+
+    // without value and inverse this is a plain aggregate,
+    // sqlite calls destroy if this fails
+    const auto rc = sqlite3_create_window_function (_connection->db (),
+                                                    name.c_str (),
+                                                    nArgs,
+                                                    functionFlags (options),
+                                                    data,
+                                                    step,
+                                                    final,
+                                                    value,
+                                                    inverse,
+                                                    destroy);
+    if (rc != SQLITE_OK)
+      throw SQLite3Error{rc, sqlite3_errmsg (_connection->db ())};
+  }
+}
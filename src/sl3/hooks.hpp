@@ -0,0 +1,355 @@
+#pragma once
+
+#include <sqlite3.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <sl3/changes.hpp>
+
+namespace sl3
+{
+  namespace internal
+  {
+    /**
+     * \internal
+     * \brief Fans the sqlite hooks of a connection out to multiple listeners
+     *
+     * sqlite has one hook of each kind per connection, this class owns
+     * them, so that independent parts, like a ResultCache and user hooks,
+     * can listen at the same time.
+     * The sqlite hooks are installed with the first listener and removed
+     * with the last.
+     *
+     * Change listeners get the update hook events of a transaction as one
+     * batch when it commits, events of a rollback are dropped.
+     * sqlite has no hook for ROLLBACK TO a savepoint or for a failed
+     * statement in an open transaction, such events stay in the batch.
+     *
+     * The authorizer of the connection is also owned here, so that
+     * authorize listeners, like a ResultCache that looks for the tables a
+     * query reads, can observe it without replacing the user authorizer.
+     *
+     * Listeners must not remove listeners.
+     */
+    class Hooks
+    {
+    public:
+      using UpdateListener = std::function<void (
+          int op, const char* dbName, const char* table, int64_t rowid)>;
+
+      using AuthorizeListener
+          = std::function<void (int action, const char* arg1)>;
+
+      Hooks () = default;
+
+      Hooks (const Hooks&)            = delete;
+      Hooks& operator= (const Hooks&) = delete;
+
+      /// get a new id for adding listeners
+      std::size_t
+      newId ()
+      {
+        return ++_lastId;
+      }
+
+      void
+      addUpdate (sqlite3* db, std::size_t id, UpdateListener listener)
+      {
+        _update.emplace_back (id, std::move (listener));
+        install (db);
+      }
+
+      void
+      addChanges (sqlite3* db, std::size_t id, ChangeHandler listener)
+      {
+        _changes.emplace_back (id, std::move (listener));
+        install (db);
+      }
+
+      void
+      addCommit (sqlite3* db, std::size_t id, CommitHandler listener)
+      {
+        _commit.emplace_back (id, std::move (listener));
+        install (db);
+      }
+
+      void
+      addRollback (sqlite3* db, std::size_t id, RollbackHandler listener)
+      {
+        _rollback.emplace_back (id, std::move (listener));
+        install (db);
+      }
+
+      void
+      addWal (sqlite3* db, std::size_t id, WalHandler listener)
+      {
+        _wal.emplace_back (id, std::move (listener));
+        install (db);
+      }
+
+      void
+      addAuthorize (sqlite3* db, std::size_t id, AuthorizeListener listener)
+      {
+        _authorize.emplace_back (id, std::move (listener));
+        installAuthorizer (db);
+      }
+
+      /// set the authorizer of the connection, an empty one removes it
+      void
+      setAuthorizer (sqlite3* db, Authorizer authorizer)
+      {
+        _authorizer = std::move (authorizer);
+        installAuthorizer (db);
+      }
+
+      /// remove all listeners with the id, db may be null if closed
+      void
+      remove (sqlite3* db, std::size_t id)
+      {
+        const auto authorizers = _authorize.size ();
+        erase (_authorize, id);
+        if (db && authorizers != _authorize.size ())
+          installAuthorizer (db);
+
+        erase (_update, id);
+        erase (_changes, id);
+        erase (_commit, id);
+        erase (_rollback, id);
+        erase (_wal, id);
+        if (_changes.empty ())
+          _batch.clear ();
+        if (db)
+          install (db);
+      }
+
+    private:
+      template <typename List>
+      static void
+      erase (List& listeners, std::size_t id)
+      {
+        for (auto pos = listeners.begin (); pos != listeners.end ();)
+          {
+            if (pos->first == id)
+              pos = listeners.erase (pos);
+            else
+              ++pos;
+          }
+      }
+
+      void
+      install (sqlite3* db)
+      {
+        const bool changes = !_changes.empty ();
+
+        sqlite3_update_hook (db,
+                             changes || !_update.empty () ? &onUpdate
+                                                          : nullptr,
+                             this);
+        sqlite3_commit_hook (
+            db, changes || !_commit.empty () ? &onCommit : nullptr, this);
+        sqlite3_rollback_hook (
+            db, changes || !_rollback.empty () ? &onRollback : nullptr, this);
+
+        // the wal hook is also used by sqlite3_wal_autocheckpoint,
+        // restore the auto checkpoint of the user when the last listener goes
+        if (!_wal.empty ())
+          {
+            if (!_walInstalled)
+              _autoCheckpoint = autoCheckpoint (db);
+            sqlite3_wal_hook (db, &onWal, this);
+            _walInstalled = true;
+          }
+        else if (_walInstalled)
+          {
+            sqlite3_wal_autocheckpoint (db, _autoCheckpoint);
+            _walInstalled = false;
+          }
+      }
+
+      static int
+      autoCheckpoint (sqlite3* db)
+      {
+        int           pages = 1000;
+        sqlite3_stmt* stmt  = nullptr;
+        if (sqlite3_prepare_v2 (
+                db, "PRAGMA wal_autocheckpoint;", -1, &stmt, nullptr)
+                == SQLITE_OK
+            && sqlite3_step (stmt) == SQLITE_ROW)
+          pages = sqlite3_column_int (stmt, 0);
+        sqlite3_finalize (stmt);
+        return pages;
+      }
+
+      void
+      installAuthorizer (sqlite3* db)
+      {
+        sqlite3_set_authorizer (
+            db,
+            _authorizer || !_authorize.empty () ? &onAuthorize : nullptr,
+            this);
+      }
+
+      void
+      record (int op, const char* dbName, const char* table, int64_t rowid)
+      {
+        const auto same = [&] (const TableChanges& changes) {
+          return changes.table == table && changes.database == dbName;
+        };
+
+        if (_current >= _batch.size () || !same (_batch[_current]))
+          {
+            _current = 0;
+            while (_current < _batch.size () && !same (_batch[_current]))
+              ++_current;
+
+            if (_current == _batch.size ())
+              _batch.push_back (TableChanges{dbName, table, {}});
+          }
+
+        const auto kind = op == SQLITE_INSERT   ? ChangeOp::Insert
+                          : op == SQLITE_DELETE ? ChangeOp::Delete
+                                                : ChangeOp::Update;
+        _batch[_current].rows.push_back (RowChange{kind, rowid});
+      }
+
+      static void
+      onUpdate (void*         self,
+                int           op,
+                const char*   dbName,
+                const char*   table,
+                sqlite3_int64 rowid)
+      {
+        auto& hooks = *static_cast<Hooks*> (self);
+        try
+          {
+            for (auto& listener : hooks._update)
+              listener.second (op, dbName, table, rowid);
+
+            if (!hooks._changes.empty ())
+              hooks.record (op, dbName, table, rowid);
+          }
+        catch (...) // LCOV_EXCL_LINE
+          {
+            // can not be reported from here
+          }
+      }
+
+      static int
+      onCommit (void* self)
+      {
+        auto& hooks = *static_cast<Hooks*> (self);
+        try
+          {
+            for (auto& listener : hooks._commit)
+              if (!listener.second ())
+                return 1;
+          }
+        catch (...)
+          {
+            return 1; // roll back
+          }
+
+        // observers of changes can not turn the commit into a rollback
+        if (!hooks._batch.empty ())
+          {
+            ChangeBatch batch;
+            batch.swap (hooks._batch);
+            hooks._current = 0;
+            for (auto& listener : hooks._changes)
+              {
+                try
+                  {
+                    listener.second (batch);
+                  }
+                catch (...)
+                  {
+                    // can not be reported from here
+                  }
+              }
+          }
+        return 0;
+      }
+
+      static void
+      onRollback (void* self)
+      {
+        auto& hooks = *static_cast<Hooks*> (self);
+        hooks._batch.clear ();
+        hooks._current = 0;
+        try
+          {
+            for (auto& listener : hooks._rollback)
+              listener.second ();
+          }
+        catch (...) // LCOV_EXCL_LINE
+          {
+            // can not be reported from here
+          }
+      }
+
+      static int
+      onAuthorize (void*       self,
+                   int         action,
+                   const char* arg1,
+                   const char* arg2,
+                   const char* dbName,
+                   const char* trigger)
+      {
+        auto& hooks = *static_cast<Hooks*> (self);
+        try
+          {
+            for (auto& listener : hooks._authorize)
+              listener.second (action, arg1);
+
+            if (hooks._authorizer)
+              return hooks._authorizer (action, arg1, arg2, dbName, trigger);
+          }
+        catch (...)
+          {
+            return SQLITE_DENY;
+          }
+        return SQLITE_OK;
+      }
+
+      static int
+      onWal (void* self, sqlite3*, const char* dbName, int pages)
+      {
+        auto& hooks = *static_cast<Hooks*> (self);
+        try
+          {
+            const std::string name{dbName};
+            for (auto& listener : hooks._wal)
+              listener.second (name, pages);
+          }
+        catch (...) // LCOV_EXCL_LINE
+          {
+            // can not be reported from here
+          }
+        return SQLITE_OK;
+      }
+
+      template <typename Listener>
+      using Listeners = std::vector<std::pair<std::size_t, Listener>>;
+
+      std::size_t                _lastId = 0;
+      Listeners<UpdateListener>  _update;
+      Listeners<ChangeHandler>   _changes;
+      Listeners<CommitHandler>   _commit;
+      Listeners<RollbackHandler> _rollback;
+      Listeners<WalHandler>      _wal;
+      Listeners<AuthorizeListener> _authorize;
+      Authorizer                   _authorizer;
+      bool                       _walInstalled   = false;
+      int                        _autoCheckpoint = 1000;
+
+      // update events of the current transaction, for _changes
+      ChangeBatch _batch;
+      std::size_t _current = 0;
+    };
+  }
+}
@@ -0,0 +1,212 @@
+/******************************************************************************
+ ------------- Copyright (c) 2009-2023 H a r a l d  A c h i t z ---------------
+ ---------- < h a r a l d dot a c h i t z at g m a i l dot c o m > ------------
+ ---- This Source Code Form is subject to the terms of the Mozilla Public -----
+ ---- License, v. 2.0. If a copy of the MPL was not distributed with this -----
+ ---------- file, You can obtain one at http://mozilla.org/MPL/2.0/. ----------
+ ******************************************************************************/
+
+#include <sl3/cancellation.hpp>
+
+#include <algorithm>
+
+#include <sl3/database.hpp>
+#include <sl3/error.hpp>
+
+#include "connection.hpp"
+#include "interrupt.hpp"
+
+namespace sl3
+{
+  namespace internal
+  {
+    void
+    CancelState::cancel () noexcept
+    {
+      _cancelled.store (true, std::memory_order_release);
+
+      std::lock_guard<std::mutex> lock{_mutex};
+      for (sqlite3* db : _dbs)
+        sqlite3_interrupt (db);
+    }
+
+    void
+    CancelState::attach (sqlite3* db)
+    {
+      std::lock_guard<std::mutex> lock{_mutex};
+      _dbs.push_back (db);
+    }
+
+    void
+    CancelState::detach (sqlite3* db) noexcept
+    {
+      std::lock_guard<std::mutex> lock{_mutex};
+      const auto pos = std::find (_dbs.begin (), _dbs.end (), db);
+      if (pos != _dbs.end ())
+        _dbs.erase (pos);
+    }
+
+    std::size_t
+    Interrupts::add (sqlite3*                     db,
+                     Clock::time_point            deadline,
+                     std::shared_ptr<CancelState> token,
+                     int                          steps)
+    {
+      if (token)
+        token->attach (db);
+
+      _limits.push_back (Limit{++_lastId, deadline, std::move (token), steps});
+      install (db);
+      return _lastId;
+    }
+
+    void
+    Interrupts::remove (sqlite3* db, std::size_t id) noexcept
+    {
+      const auto pos
+          = std::find_if (_limits.begin (), _limits.end (), [id] (auto& l) {
+              return l.id == id;
+            });
+      if (pos == _limits.end ())
+        return;
+
+      if (pos->token && db)
+        pos->token->detach (db);
+      _limits.erase (pos);
+      if (db)
+        install (db);
+    }
+
+    void
+    Interrupts::clear (sqlite3* db) noexcept
+    {
+      for (auto& limit : _limits)
+        {
+          if (limit.token)
+            limit.token->detach (db);
+        }
+      _limits.clear ();
+      install (db);
+    }
+
+    std::string
+    Interrupts::reason () const
+    {
+      const auto now = Clock::now ();
+      for (const auto& limit : _limits)
+        {
+          if (limit.token && limit.token->isCancelled ())
+            return "cancelled";
+          if (now >= limit.deadline)
+            return "deadline exceeded";
+        }
+      return "interrupted";
+    }
+
+    int
+    Interrupts::progress (void* self)
+    {
+      const auto& limits = static_cast<Interrupts*> (self)->_limits;
+
+      // the clock is only read if a limit has a deadline
+      Clock::time_point now{};
+      for (const auto& limit : limits)
+        {
+          if (limit.token && limit.token->isCancelled ())
+            return 1;
+          if (limit.deadline != Clock::time_point::max ())
+            {
+              if (now == Clock::time_point{})
+                now = Clock::now ();
+              if (now >= limit.deadline)
+                return 1;
+            }
+        }
+      return 0;
+    }
+
+    void
+    Interrupts::install (sqlite3* db) noexcept
+    {
+      if (_limits.empty ())
+        {
+          sqlite3_progress_handler (db, 0, nullptr, nullptr);
+          return;
+        }
+
+      const auto steps = std::min_element (
+          _limits.begin (), _limits.end (), [] (auto& a, auto& b) {
+            return a.steps < b.steps;
+          });
+      sqlite3_progress_handler (db, steps->steps, &Interrupts::progress, this);
+    }
+  }
+
+  CancellationToken::CancellationToken ()
+  : _state{std::make_shared<internal::CancelState> ()}
+  {
+  }
+
+  void
+  CancellationToken::cancel () noexcept
+  {
+    _state->cancel ();
+  }
+
+  bool
+  CancellationToken::isCancelled () const noexcept
+  {
+    return _state->isCancelled ();
+  }
+
+  Database::ExecutionLimit
+  Database::limitExecution (std::chrono::steady_clock::time_point deadline,
+                            const CancellationToken&              token,
+                            int                                   steps)
+  {
+    return ExecutionLimit{*this, deadline, token._state, steps};
+  }
+
+  Database::ExecutionLimit
+  Database::limitExecution (std::chrono::steady_clock::duration timeout,
+                            const CancellationToken&            token,
+                            int                                 steps)
+  {
+    return limitExecution (
+        std::chrono::steady_clock::now () + timeout, token, steps);
+  }
+
+  Database::ExecutionLimit
+  Database::limitExecution (const CancellationToken& token, int steps)
+  {
+    return limitExecution (
+        std::chrono::steady_clock::time_point::max (), token, steps);
+  }
+
+  Database::ExecutionLimit::ExecutionLimit (
+      Database&                               db,
+      std::chrono::steady_clock::time_point   deadline,
+      std::shared_ptr<internal::CancelState> token,
+      int                                     steps)
+  : _connection (db._connection)
+  {
+    _connection->ensureValid ();
+    if (steps < 1)
+      throw ErrOutOfRange{"steps must be positive"};
+
+    _id = _connection->interrupts.add (
+        _connection->db (), deadline, std::move (token), steps);
+  }
+
+  Database::ExecutionLimit::ExecutionLimit (ExecutionLimit&& other) noexcept
+  : _connection (std::move (other._connection))
+  , _id (other._id)
+  {
+  }
+
+  Database::ExecutionLimit::~ExecutionLimit ()
+  {
+    if (_connection)
+      _connection->interrupts.remove (_connection->db (), _id);
+  }
+}
@@ -0,0 +1,95 @@
+#pragma once
+
+#include <sqlite3.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace sl3
+{
+  namespace internal
+  {
+    /**
+     * \internal
+     * \brief The shared state of CancellationToken copies
+     *
+     * Connections that run under the token are attached, so that cancel
+     * can sqlite3_interrupt them.
+     */
+    class CancelState
+    {
+    public:
+      void cancel () noexcept;
+
+      bool
+      isCancelled () const noexcept
+      {
+        return _cancelled.load (std::memory_order_acquire);
+      }
+
+      void attach (sqlite3* db);
+
+      void detach (sqlite3* db) noexcept;
+
+    private:
+      std::atomic<bool>     _cancelled{false};
+      std::mutex            _mutex;
+      std::vector<sqlite3*> _dbs;
+    };
+
+    /**
+     * \internal
+     * \brief The execution limits of a connection
+     *
+     * Owns the sqlite progress handler of the connection, it is installed
+     * with the first limit and removed with the last.
+     * Limits can be nested, all of them apply.
+     */
+    class Interrupts
+    {
+    public:
+      using Clock = std::chrono::steady_clock;
+
+      Interrupts () = default;
+
+      Interrupts (const Interrupts&)            = delete;
+      Interrupts& operator= (const Interrupts&) = delete;
+
+      /// add a limit, returns its id for remove
+      std::size_t add (sqlite3*                     db,
+                       Clock::time_point            deadline,
+                       std::shared_ptr<CancelState> token,
+                       int                          steps);
+
+      /// remove the limit with the id, db may be null if closed
+      void remove (sqlite3* db, std::size_t id) noexcept;
+
+      /// remove all limits, called before the connection closes
+      void clear (sqlite3* db) noexcept;
+
+      /// why statements are interrupted, for ErrInterrupted
+      std::string reason () const;
+
+    private:
+      struct Limit
+      {
+        std::size_t                  id;
+        Clock::time_point            deadline;
+        std::shared_ptr<CancelState> token;
+        int                          steps;
+      };
+
+      static int progress (void* self);
+
+      void install (sqlite3* db) noexcept;
+
+      std::vector<Limit> _limits;
+      std::size_t        _lastId = 0;
+    };
+  }
+}
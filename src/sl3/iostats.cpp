@@ -0,0 +1,39 @@
+/******************************************************************************
+ ------------- Copyright (c) 2009-2023 H a r a l d  A c h i t z ---------------
+ ---------- < h a r a l d dot a c h i t z at g m a i l dot c o m > ------------
+ ---- This Source Code Form is subject to the terms of the Mozilla Public -----
+ ---- License, v. 2.0. If a copy of the MPL was not distributed with this -----
+ ---------- file, You can obtain one at http://mozilla.org/MPL/2.0/. ----------
+ ******************************************************************************/
+
+#include <sl3/iostats.hpp>
+
+#include <sl3/database.hpp>
+
+#include "connection.hpp"
+#include "vfsshim.hpp"
+
+namespace sl3
+{
+  const std::string&
+  ioStatsVfs ()
+  {
+    static const std::string name = internal::shimVfs ("sl3_iostats").name;
+    return name;
+  }
+
+  IoStats
+  Database::ioStats ()
+  {
+    _connection->ensureValid ();
+    return _connection->ioStats ? _connection->ioStats->get () : IoStats{};
+  }
+
+  void
+  Database::resetIoStats ()
+  {
+    _connection->ensureValid ();
+    if (_connection->ioStats)
+      _connection->ioStats->reset ();
+  }
+}
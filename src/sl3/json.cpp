@@ -0,0 +1,293 @@
+/******************************************************************************
+ ------------- Copyright (c) 2009-2023 H a r a l d  A c h i t z ---------------
+ ---------- < h a r a l d dot a c h i t z at g m a i l dot c o m > ------------
+ ---- This Source Code Form is subject to the terms of the Mozilla Public -----
+ ---- License, v. 2.0. If a copy of the MPL was not distributed with this -----
+ ---------- file, You can obtain one at http://mozilla.org/MPL/2.0/. ----------
+ ******************************************************************************/
+
+#include <sl3/json.hpp>
+
+#include <sqlite3.h>
+
+#include <cmath>
+#include <ostream>
+#include <string_view>
+
+#include <sl3/columns.hpp>
+#include <sl3/error.hpp>
+
+#include "bufferedoutput.hpp"
+#include "utils.hpp"
+
+namespace sl3
+{
+  namespace
+  {
+    // characters that need an escape sequence in a JSON string
+    bool
+    needsEscape (unsigned char c)
+    {
+      return c < 0x20 || c == '"' || c == '\\';
+    }
+
+    template <typename Out>
+    void
+    appendEscape (Out& out, unsigned char c)
+    {
+      switch (c)
+        {
+        case '"':
+          out.append ("\\\"");
+          break;
+        case '\\':
+          out.append ("\\\\");
+          break;
+        case '\n':
+          out.append ("\\n");
+          break;
+        case '\r':
+          out.append ("\\r");
+          break;
+        case '\t':
+          out.append ("\\t");
+          break;
+        case '\b':
+          out.append ("\\b");
+          break;
+        case '\f':
+          out.append ("\\f");
+          break;
+        default:
+          {
+            static const char digits[] = "0123456789abcdef";
+            const char        esc[]    = {
+                '\\', 'u', '0', '0', digits[c >> 4], digits[c & 0x0F]};
+            out.append (std::string_view{esc, sizeof (esc)});
+            break;
+          }
+        }
+    }
+
+    // appends text as JSON string, runs without escapes in one piece
+    template <typename Out>
+    void
+    appendString (Out& out, std::string_view text)
+    {
+      out.append ('"');
+      std::size_t run = 0;
+      for (std::size_t i = 0; i < text.size (); ++i)
+        {
+          const auto c = static_cast<unsigned char> (text[i]);
+          if (needsEscape (c))
+            {
+              out.append (text.substr (run, i - run));
+              appendEscape (out, c);
+              run = i + 1;
+            }
+        }
+      out.append (text.substr (run));
+      out.append ('"');
+    }
+
+    void
+    appendBase64 (internal::BufferedOutput& out,
+                  const unsigned char*      data,
+                  std::size_t               size)
+    {
+      static const char digits[]
+          = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+      char        buf[256];
+      std::size_t pos = 0;
+      out.append ('"');
+      for (std::size_t i = 0; i < size; i += 3)
+        {
+          const std::size_t n    = size - i < 3 ? size - i : 3;
+          uint32_t          bits = uint32_t{data[i]} << 16;
+          if (n > 1)
+            bits |= uint32_t{data[i + 1]} << 8;
+          if (n > 2)
+            bits |= data[i + 2];
+
+          buf[pos++] = digits[(bits >> 18) & 0x3F];
+          buf[pos++] = digits[(bits >> 12) & 0x3F];
+          buf[pos++] = n > 1 ? digits[(bits >> 6) & 0x3F] : '=';
+          buf[pos++] = n > 2 ? digits[bits & 0x3F] : '=';
+
+          if (pos == sizeof (buf))
+            {
+              out.append (std::string_view{buf, pos});
+              pos = 0;
+            }
+        }
+      out.append (std::string_view{buf, pos});
+      out.append ('"');
+    }
+
+    // a JSON string in a std::string, for the keys
+    std::string
+    quoted (std::string_view text)
+    {
+      struct StringOut
+      {
+        std::string json;
+
+        void
+        append (std::string_view data)
+        {
+          json.append (data.data (), data.size ());
+        }
+
+        void
+        append (char c)
+        {
+          json.push_back (c);
+        }
+      } out;
+
+      appendString (out, text);
+      return std::move (out.json);
+    }
+  }
+
+  JsonWriter::JsonWriter (std::ostream& out,
+                          JsonFormat    format,
+                          std::size_t   bufferSize)
+  : JsonWriter (
+      [&out] (const char* data, std::size_t size) {
+        out.write (data, static_cast<std::streamsize> (size));
+        if (!out)
+          throw ErrUnexpected ("writing JSON output failed");
+      },
+      format,
+      bufferSize)
+  {
+  }
+
+  JsonWriter::JsonWriter (Sink sink, JsonFormat format, std::size_t bufferSize)
+  : _format (format)
+  , _out (std::make_unique<internal::BufferedOutput> (std::move (sink),
+                                                      bufferSize))
+  {
+  }
+
+  JsonWriter::~JsonWriter ()
+  {
+    try
+      {
+        _out->flush ();
+      }
+    catch (...) // LCOV_EXCL_LINE
+      {         // a destructor can not report it
+      }
+  }
+
+  void
+  JsonWriter::flush ()
+  {
+    _out->flush ();
+  }
+
+  std::size_t
+  JsonWriter::rows () const noexcept
+  {
+    return _rows;
+  }
+
+  void
+  JsonWriter::onStart ()
+  {
+    _keys.clear ();
+    _resultRows = 0;
+  }
+
+  bool
+  JsonWriter::onRow (Columns columns)
+  {
+    sqlite3_stmt* const stmt  = columns.get_stmt ();
+    const int           count = columns.count ();
+    auto&               out   = *_out;
+
+    // keys are escaped once per result, with the separator before them
+    if (_format.objects && _keys.empty ())
+      {
+        for (int i = 0; i < count; ++i)
+          {
+            const char* name = sqlite3_column_name (stmt, i);
+            _keys.push_back ((i == 0 ? "{" : ",") + quoted (name ? name : "")
+                             + ":");
+          }
+      }
+
+    if (!_format.lines)
+      out.append (_resultRows == 0 ? "[" : ",\n");
+
+    if (!_format.objects || count == 0)
+      out.append (_format.objects ? '{' : '[');
+
+    for (int i = 0; i < count; ++i)
+      {
+        if (_format.objects)
+          out.append (_keys[as_size_t (i)]);
+        else if (i > 0)
+          out.append (',');
+
+        switch (sqlite3_column_type (stmt, i))
+          {
+          case SQLITE_INTEGER:
+            appendInt (out, sqlite3_column_int64 (stmt, i));
+            break;
+
+          case SQLITE_FLOAT:
+            {
+              const double val = sqlite3_column_double (stmt, i);
+              if (std::isfinite (val))
+                appendReal (out, val);
+              else
+                out.append ("null");
+              break;
+            }
+
+          case SQLITE_TEXT:
+            {
+              const auto* text = reinterpret_cast<const char*> (
+                  sqlite3_column_text (stmt, i));
+              const auto size = as_size_t (sqlite3_column_bytes (stmt, i));
+              appendString (out, std::string_view{text, size});
+              break;
+            }
+
+          case SQLITE_BLOB:
+            {
+              const auto* blob = static_cast<const unsigned char*> (
+                  sqlite3_column_blob (stmt, i));
+              const auto size = as_size_t (sqlite3_column_bytes (stmt, i));
+              appendBase64 (out, blob, size);
+              break;
+            }
+
+          default:
+            out.append ("null");
+            break;
+          }
+      }
+    out.append (_format.objects ? '}' : ']');
+
+    if (_format.lines)
+      out.append ('\n');
+
+    ++_resultRows;
+    ++_rows;
+    return true;
+  }
+
+  void
+  JsonWriter::onEnd ()
+  {
+    if (!_format.lines)
+      _out->append (_resultRows == 0 ? "[]\n" : "]\n");
+
+    _out->flush ();
+  }
+}
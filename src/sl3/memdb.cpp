@@ -0,0 +1,82 @@
+/******************************************************************************
+ ------------- Copyright (c) 2009-2023 H a r a l d  A c h i t z ---------------
+ ---------- < h a r a l d dot a c h i t z at g m a i l dot c o m > ------------
+ ---- This Source Code Form is subject to the terms of the Mozilla Public -----
+ ---- License, v. 2.0. If a copy of the MPL was not distributed with this -----
+ ---------- file, You can obtain one at http://mozilla.org/MPL/2.0/. ----------
+ ******************************************************************************/
+
+#include <sl3/memdb.hpp>
+
+#include <sqlite3.h>
+
+#include <sl3/error.hpp>
+
+namespace sl3
+{
+  namespace
+  {
+    std::string
+    checkedName (std::string name)
+    {
+      if (name.empty ())
+        throw ErrOutOfRange ("a shared in-memory database needs a name");
+      return name;
+    }
+
+    // memdb shares databases whose name starts with a /
+    std::string
+    memdbUri (const std::string& name)
+    {
+      static const char hex[] = "0123456789ABCDEF";
+
+      std::string uri{"file:/"};
+      for (const char c : name)
+        {
+          const auto u = static_cast<unsigned char> (c);
+          if (u == '%' || u == '?' || u == '#' || u == '&' || u == '='
+              || u < 0x21 || u > 0x7e)
+            {
+              uri += '%';
+              uri += hex[u >> 4];
+              uri += hex[u & 0xf];
+            }
+          else
+            {
+              uri += c;
+            }
+        }
+      return uri + "?vfs=memdb";
+    }
+
+    int
+    uriFlags (int flags)
+    {
+      if (flags == 0)
+        flags = SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE;
+      return flags | SQLITE_OPEN_URI;
+    }
+  }
+
+  SharedMemoryDatabase::SharedMemoryDatabase (std::string name)
+  : _name (checkedName (std::move (name)))
+  , _uri (memdbUri (_name))
+  , _anchor (_uri, uriFlags (0))
+  {
+  }
+
+  Database
+  SharedMemoryDatabase::open (int flags) const
+  {
+    return Database{_uri, uriFlags (flags)};
+  }
+
+  std::int64_t
+  SharedMemoryDatabase::memoryUsed ()
+  {
+    return _anchor
+        .selectValue ("SELECT page_count * page_size"
+                      " FROM pragma_page_count (), pragma_page_size ();")
+        .getInt ();
+  }
+}
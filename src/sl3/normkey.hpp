@@ -0,0 +1,309 @@
+#pragma once
+
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <vector>
+
+#include <sl3/dataset.hpp>
+#include <sl3/dbvalue.hpp>
+
+#include "parallel.hpp"
+
+namespace sl3
+{
+  namespace internal
+  {
+    /**
+     * \internal
+     * \brief Normalized, memcmp comparable, keys for DbValue
+     *
+     * A key is a byte sequence so that comparing 2 keys via memcmp (and
+     * the length if one is the prefix of the other) gives the sort order
+     * of sqlite: Null < Int/Real < Text < Blob, numbers compare by value.
+     *
+     * The layout of one encoded value is
+     *  [null marker][class][payload]
+     * where Int/Real typed fields skip the class byte.
+     * Descending order inverts all bytes after the null marker, so the
+     * position of Null values is independent from the order.
+     */
+    enum class KeyScheme
+    {
+      Variant, ///< any storage type, numbers compare exactly across types
+      Int,     ///< Type::Int field, 8 byte payload
+      Real     ///< Type::Real field, 8 byte payload
+    };
+
+    inline KeyScheme
+    keySchemeFor (Type fieldType)
+    {
+      switch (fieldType)
+        {
+        case Type::Int:
+          return KeyScheme::Int;
+        case Type::Real:
+          return KeyScheme::Real;
+        default:
+          return KeyScheme::Variant;
+        }
+    }
+
+    /// order preserving unsigned representation of an int64_t
+    inline uint64_t
+    intBits (int64_t val)
+    {
+      return static_cast<uint64_t> (val) ^ (uint64_t{1} << 63);
+    }
+
+    /// order preserving unsigned representation of a double (no NaN)
+    inline uint64_t
+    realBits (double val)
+    {
+      if (val == 0.0) // -0.0 == 0.0
+        val = 0.0;
+      uint64_t bits;
+      std::memcpy (&bits, &val, sizeof (bits));
+      constexpr uint64_t sign = uint64_t{1} << 63;
+      return (bits & sign) ? ~bits : bits | sign;
+    }
+
+    /// true and the value in ival if val is an integral in int64_t range
+    inline bool
+    asExactInt (double val, int64_t& ival)
+    {
+      constexpr double lower = -9223372036854775808.0; // -2^63
+      if (!(val >= lower && val < -lower) || std::trunc (val) != val)
+        return false;
+
+      ival = static_cast<int64_t> (val);
+      return true;
+    }
+
+    class KeyWriter
+    {
+    public:
+      explicit KeyWriter (std::vector<unsigned char>& out)
+      : _out (out)
+      {
+      }
+
+      void
+      append (const DbValue&   val,
+              KeyScheme        scheme,
+              SortOrder        order,
+              NullsOrder       nulls)
+      {
+        if (val.isNull ())
+          {
+            _out.push_back (nulls == NullsOrder::First ? 0x00 : 0x02);
+            return;
+          }
+
+        _out.push_back (0x01);
+        const std::size_t first = _out.size ();
+
+        const Value& v = val.getValue ();
+        switch (scheme)
+          {
+          case KeyScheme::Int:
+            putBits (v.getType () == Type::Int
+                         ? intBits (v.int64 ())
+                         : intBits (static_cast<int64_t> (v.real ())));
+            break;
+
+          case KeyScheme::Real:
+            putBits (v.getType () == Type::Real
+                         ? realBits (v.real ())
+                         : realBits (static_cast<double> (v.int64 ())));
+            break;
+
+          case KeyScheme::Variant:
+            putVariant (v);
+            break;
+          }
+
+        if (order == SortOrder::Descending)
+          {
+            for (auto i = first; i < _out.size (); ++i)
+              _out[i] = static_cast<unsigned char> (~_out[i]);
+          }
+      }
+
+    private:
+      void
+      putBits (uint64_t bits)
+      {
+        for (int shift = 56; shift >= 0; shift -= 8)
+          _out.push_back (static_cast<unsigned char> (bits >> shift));
+      }
+
+      void
+      putInt (int64_t ival)
+      {
+        _out.push_back (0x10);
+        putBits (realBits (static_cast<double> (ival)));
+        _out.push_back (0x01);
+        putBits (intBits (ival));
+      }
+
+      // escape 0x00 as 0x00 0xFF and terminate with 0x00 0x00, so that
+      // no key is a prefix of a different key
+      template <typename Iter>
+      void
+      putBytes (unsigned char cls, Iter first, Iter last)
+      {
+        _out.push_back (cls);
+        for (; first != last; ++first)
+          {
+            const auto c = static_cast<unsigned char> (*first);
+            _out.push_back (c);
+            if (c == 0x00)
+              _out.push_back (0xFF);
+          }
+        _out.push_back (0x00);
+        _out.push_back (0x00);
+      }
+
+      void
+      putVariant (const Value& v)
+      {
+        switch (v.getType ())
+          {
+          case Type::Int:
+            putInt (v.int64 ());
+            break;
+
+          case Type::Real:
+            {
+              const double real = v.real ();
+              int64_t      ival = 0;
+              if (asExactInt (real, ival))
+                {
+                  putInt (ival);
+                }
+              else
+                { // there is no int with the same double image, or the
+                  // real is out of the int64_t range
+                  _out.push_back (0x10);
+                  putBits (realBits (real));
+                  _out.push_back (real < 0 ? 0x00 : 0x02);
+                }
+              break;
+            }
+
+          case Type::Text:
+            putBytes (0x20, v.text ().begin (), v.text ().end ());
+            break;
+
+          case Type::Blob:
+            putBytes (0x30, v.blob ().begin (), v.blob ().end ());
+            break;
+
+          default:           // LCOV_EXCL_LINE
+            _out.push_back (0x00); // LCOV_EXCL_LINE
+            break;           // LCOV_EXCL_LINE
+          }
+      }
+
+      std::vector<unsigned char>& _out;
+    };
+
+    /// compare 2 normalized keys
+    inline int
+    compareKeys (const unsigned char* a,
+                 std::size_t          asize,
+                 const unsigned char* b,
+                 std::size_t          bsize)
+    {
+      const auto common = asize < bsize ? asize : bsize;
+      const int  c      = common ? std::memcmp (a, b, common) : 0;
+      if (c != 0)
+        return c;
+
+      return asize < bsize ? -1 : (asize > bsize ? 1 : 0);
+    }
+
+    /// a key in a RowKeys arena
+    struct KeyRef
+    {
+      const unsigned char* data;
+      std::size_t          size;
+    };
+
+    /// compare 2 normalized keys
+    inline int
+    compareKeys (const KeyRef& a, const KeyRef& b)
+    {
+      return compareKeys (a.data, a.size, b.data, b.size);
+    }
+
+    /**
+     * \internal
+     * \brief Normalized keys for each row of a Dataset
+     *
+     * Keys are written by multiple threads, each into its own arena.
+     */
+    class RowKeys
+    {
+    public:
+      /**
+       * \param rows number of rows
+       * \param threads number of threads to use, at least 1
+       * \param writeRow called as writeRow(KeyWriter&, row) per row
+       */
+      template <typename WriteRow>
+      RowKeys (std::size_t rows, std::size_t threads, WriteRow&& writeRow)
+      : _arenas (threads)
+      , _refs (rows)
+      {
+        parallelFor (
+            rows,
+            threads,
+            [&] (std::size_t first, std::size_t last, std::size_t part) {
+              auto& arena = _arenas[part];
+              arena.reserve ((last - first) * 16);
+              KeyWriter writer{arena};
+
+              std::vector<std::size_t> ends;
+              ends.reserve (last - first);
+              for (auto r = first; r < last; ++r)
+                {
+                  writeRow (writer, r);
+                  ends.push_back (arena.size ());
+                }
+              // the arena does not grow any more, pointers are stable
+              std::size_t start = 0;
+              for (auto r = first; r < last; ++r)
+                {
+                  const std::size_t end = ends[r - first];
+                  _refs[r] = KeyRef{arena.data () + start, end - start};
+                  start    = end;
+                }
+            });
+      }
+
+      RowKeys (const RowKeys&)            = delete;
+      RowKeys& operator= (const RowKeys&) = delete;
+
+      /// the key of a row
+      const KeyRef&
+      operator[] (std::size_t row) const
+      {
+        return _refs[row];
+      }
+
+      std::size_t
+      size () const noexcept
+      {
+        return _refs.size ();
+      }
+
+    private:
+      std::vector<std::vector<unsigned char>> _arenas;
+      std::vector<KeyRef>                     _refs;
+    };
+
+  }
+}
@@ -0,0 +1,165 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <exception>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace sl3
+{
+  namespace internal
+  {
+    /// below this amount of items per thread, work is not split
+    constexpr std::size_t minItemsPerThread = 1U << 14;
+
+    /**
+     * \internal
+     * \brief how many threads should work on given number of items
+     *
+     * \param requested wanted threads, 0 for hardware concurrency
+     * \param items number of items to process
+     * \return number of threads, at least 1
+     */
+    inline std::size_t
+    threadsFor (std::size_t requested, std::size_t items)
+    {
+      std::size_t threads = requested;
+      if (threads == 0)
+        threads = std::max (1U, std::thread::hardware_concurrency ());
+
+      const std::size_t maxUseful = std::max<std::size_t> (
+          1, items / minItemsPerThread);
+
+      return std::min (threads, maxUseful);
+    }
+
+    /**
+     * \internal
+     * \brief run fn(first, last, part) on threads chunks of [0, count)
+     *
+     * The calling thread handles the first chunk.
+     * The first exception thrown by any chunk is rethrown after all
+     * threads have finished.
+     */
+    template <typename Fn>
+    void
+    parallelFor (std::size_t count, std::size_t threads, Fn&& fn)
+    {
+      if (threads <= 1 || count < 2)
+        {
+          fn (std::size_t{0}, count, std::size_t{0});
+          return;
+        }
+
+      const std::size_t             chunk = (count + threads - 1) / threads;
+      std::vector<std::exception_ptr> errors (threads);
+      std::vector<std::thread>        workers;
+      workers.reserve (threads - 1);
+
+      auto run = [&] (std::size_t part) {
+        const std::size_t first = std::min (count, part * chunk);
+        const std::size_t last  = std::min (count, first + chunk);
+        try
+          {
+            fn (first, last, part);
+          }
+        catch (...)
+          {
+            errors[part] = std::current_exception ();
+          }
+      };
+
+      for (std::size_t part = 1; part < threads; ++part)
+        workers.emplace_back (run, part);
+
+      run (0);
+
+      for (auto& worker : workers)
+        worker.join ();
+
+      for (auto& error : errors)
+        if (error)
+          std::rethrow_exception (error);
+    }
+
+    /**
+     * \internal
+     * \brief Sort, and for large inputs a multi threaded merge sort
+     *
+     * Sorts chunks in parallel and merges them pairwise, each merge round
+     * also in parallel.
+     *
+     * \param values what to sort
+     * \param less a strict weak ordering
+     * \param threads wanted threads, 0 for hardware concurrency
+     */
+    template <typename T, typename Less>
+    void
+    parallelSort (std::vector<T>& values, Less less, std::size_t threads)
+    {
+      threads = threadsFor (threads, values.size ());
+      if (threads <= 1)
+        {
+          std::sort (values.begin (), values.end (), less);
+          return;
+        }
+
+      const std::size_t        count = values.size ();
+      const std::size_t        chunk = (count + threads - 1) / threads;
+      std::vector<std::size_t> bounds;
+      for (std::size_t b = 0; b < count; b += chunk)
+        bounds.push_back (b);
+      bounds.push_back (count);
+
+      using diff_t = typename std::vector<T>::difference_type;
+      auto at      = [] (std::vector<T>& v, std::size_t pos) {
+        return v.begin () + static_cast<diff_t> (pos);
+      };
+
+      parallelFor (bounds.size () - 1,
+                   bounds.size () - 1,
+                   [&] (std::size_t first, std::size_t last, std::size_t) {
+                     for (auto p = first; p < last; ++p)
+                       std::sort (at (values, bounds[p]),
+                                  at (values, bounds[p + 1]),
+                                  less);
+                   });
+
+      std::vector<T> buffer (count);
+      while (bounds.size () > 2)
+        {
+          const std::size_t runs   = bounds.size () - 1;
+          const std::size_t merges = (runs + 1) / 2;
+
+          parallelFor (
+              merges,
+              merges,
+              [&] (std::size_t first, std::size_t last, std::size_t) {
+                for (auto m = first; m < last; ++m)
+                  {
+                    const auto lo  = bounds[2 * m];
+                    const auto mid = bounds[std::min (2 * m + 1, runs)];
+                    const auto hi  = bounds[std::min (2 * m + 2, runs)];
+                    std::merge (at (values, lo),
+                                at (values, mid),
+                                at (values, mid),
+                                at (values, hi),
+                                at (buffer, lo),
+                                less);
+                  }
+              });
+
+          values.swap (buffer);
+
+          std::vector<std::size_t> merged;
+          for (std::size_t b = 0; b < bounds.size (); b += 2)
+            merged.push_back (bounds[b]);
+          if (merged.back () != count)
+            merged.push_back (count);
+          bounds.swap (merged);
+        }
+    }
+  }
+}
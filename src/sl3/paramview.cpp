@@ -0,0 +1,103 @@
+/******************************************************************************
+ ------------- Copyright (c) 2009-2023 H a r a l d  A c h i t z ---------------
+ ---------- < h a r a l d dot a c h i t z at g m a i l dot c o m > ------------
+ ---- This Source Code Form is subject to the terms of the Mozilla Public -----
+ ---- License, v. 2.0. If a copy of the MPL was not distributed with this -----
+ ---------- file, You can obtain one at http://mozilla.org/MPL/2.0/. ----------
+ ******************************************************************************/
+
+#include <sl3/paramview.hpp>
+
+#include <sl3/error.hpp>
+
+namespace sl3
+{
+  BlobView::BlobView (const void* data, std::size_t size) noexcept
+  : _data (static_cast<const std::byte*> (data))
+  , _size (size)
+  {
+  }
+
+  BlobView::BlobView (const Blob& blob) noexcept
+  : _data (blob.data ())
+  , _size (blob.size ())
+  {
+  }
+
+  ParamValue::ParamValue () noexcept
+  : _type (Type::Null)
+  , _int (0)
+  {
+  }
+
+  ParamValue::ParamValue (std::nullptr_t) noexcept
+  : ParamValue ()
+  {
+  }
+
+  ParamValue::ParamValue (int value) noexcept
+  : ParamValue (int64_t{value})
+  {
+  }
+
+  ParamValue::ParamValue (int64_t value) noexcept
+  : _type (Type::Int)
+  , _int (value)
+  {
+  }
+
+  ParamValue::ParamValue (double value) noexcept
+  : _type (Type::Real)
+  , _real (value)
+  {
+  }
+
+  ParamValue::ParamValue (std::string_view text) noexcept
+  : _type (Type::Text)
+  , _int (0)
+  , _data (text.data ())
+  , _size (text.size ())
+  {
+  }
+
+  ParamValue::ParamValue (const char* text) noexcept
+  : ParamValue (std::string_view{text})
+  {
+  }
+
+  ParamValue::ParamValue (const std::string& text) noexcept
+  : ParamValue (std::string_view{text})
+  {
+  }
+
+  ParamValue::ParamValue (BlobView blob) noexcept
+  : _type (Type::Blob)
+  , _int (0)
+  , _data (blob.data ())
+  , _size (blob.size ())
+  {
+  }
+
+  ParamValue::ParamValue (const Blob& blob) noexcept
+  : ParamValue (BlobView{blob})
+  {
+  }
+
+  ParamView::ParamView (std::initializer_list<ParamValue> values)
+  : _values (values)
+  {
+  }
+
+  ParamView::ParamView (std::vector<ParamValue> values) noexcept
+  : _values (std::move (values))
+  {
+  }
+
+  const ParamValue&
+  ParamView::at (std::size_t idx) const
+  {
+    if (idx >= _values.size ())
+      throw ErrOutOfRange{"parameter index"};
+    return _values[idx];
+  }
+}
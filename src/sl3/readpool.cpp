@@ -0,0 +1,348 @@
+/******************************************************************************
+ ------------- Copyright (c) 2009-2023 H a r a l d  A c h i t z ---------------
+ ---------- < h a r a l d dot a c h i t z at g m a i l dot c o m > ------------
+ ---- This Source Code Form is subject to the terms of the Mozilla Public -----
+ ---- License, v. 2.0. If a copy of the MPL was not distributed with this -----
+ ---------- file, You can obtain one at http://mozilla.org/MPL/2.0/. ----------
+ ******************************************************************************/
+
+#include <sl3/readpool.hpp>
+
+#include <sqlite3.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <thread>
+#include <utility>
+
+#include <sl3/error.hpp>
+
+#include "parallel.hpp"
+
+namespace sl3
+{
+  namespace
+  {
+    struct KeyRange
+    {
+      int64_t first;
+      int64_t last;
+    };
+
+    // split [lo, hi] into at most parts ranges of equal width
+    std::vector<KeyRange>
+    splitRange (int64_t lo, int64_t hi, std::size_t parts)
+    {
+      // unsigned arithmetic, the distance might not fit into int64_t
+      const auto     base  = static_cast<uint64_t> (lo);
+      const uint64_t total = static_cast<uint64_t> (hi) - base;
+      const uint64_t step  = total / std::max<uint64_t> (parts, 1) + 1;
+
+      std::vector<KeyRange> ranges;
+      uint64_t              offset = 0;
+      for (;;)
+        {
+          const uint64_t end
+              = total - offset < step ? total : offset + step - 1;
+          ranges.push_back (KeyRange{static_cast<int64_t> (base + offset),
+                                     static_cast<int64_t> (base + end)});
+          if (end == total)
+            break;
+          offset = end + 1;
+        }
+      return ranges;
+    }
+
+    std::string
+    quoted (const std::string& identifier)
+    {
+      std::string q = "\"";
+      for (char c : identifier)
+        {
+          q += c;
+          if (c == '"')
+            q += '"';
+        }
+      return q + "\"";
+    }
+
+    // positions of :first and :last in the parameters of a command
+    struct BoundsPositions
+    {
+      std::size_t first;
+      std::size_t last;
+    };
+
+    BoundsPositions
+    boundsPositions (const Command& cmd)
+    {
+      const auto& names = cmd.getParameterNames ();
+      auto        pos   = [&names] (const char* name) {
+        return static_cast<std::size_t> (
+            std::find (names.begin (), names.end (), name) - names.begin ());
+      };
+
+      const BoundsPositions bounds{pos (":first"), pos (":last")};
+      if (names.size () != 2 || bounds.first == names.size ()
+          || bounds.last == names.size ())
+        throw ErrTypeMisMatch (
+            "a scan needs exactly the parameters :first and :last");
+
+      return bounds;
+    }
+
+    DbValues
+    boundsParameters (const BoundsPositions& pos, const KeyRange& range)
+    {
+      DbValues::container_type values (2, DbValue{Type::Int});
+      values[pos.first] = range.first;
+      values[pos.last]  = range.last;
+      return DbValues{std::move (values)};
+    }
+
+    // ends the read transactions of the scanning connections
+    class ReadTransactions
+    {
+    public:
+      explicit ReadTransactions (std::vector<Database>& readers)
+      : _readers (readers)
+      {
+      }
+
+      ReadTransactions (const ReadTransactions&)            = delete;
+      ReadTransactions& operator= (const ReadTransactions&) = delete;
+
+      ~ReadTransactions ()
+      {
+        for (std::size_t i = 0; i < _begun; ++i)
+          {
+            try
+              {
+                _readers[i].execute ("COMMIT;");
+              }
+            catch (...) // LCOV_EXCL_LINE
+              {         // nothing was written, nothing to handle
+              }
+          }
+      }
+
+      void
+      begin (std::size_t count)
+      {
+        for (; _begun < count; ++_begun)
+          {
+            // a deferred transaction reads its snapshot at the first read
+            _readers[_begun].execute (
+                "BEGIN; SELECT 1 FROM sqlite_schema LIMIT 1;");
+          }
+      }
+
+    private:
+      std::vector<Database>& _readers;
+      std::size_t            _begun = 0;
+    };
+
+    std::size_t
+    connectionCount (std::size_t requested)
+    {
+      return requested > 0
+                 ? requested
+                 : std::max (1U, std::thread::hardware_concurrency ());
+    }
+
+    std::vector<Database>
+    openReaders (const std::string& name,
+                 std::size_t        count,
+                 int                flags,
+                 const BusyPolicy&  busy)
+    {
+      if (flags == 0)
+        flags = SQLITE_OPEN_READONLY | SQLITE_OPEN_URI;
+
+      std::vector<Database> readers;
+      readers.reserve (count);
+      for (std::size_t i = 0; i < count; ++i)
+        {
+          readers.emplace_back (name, flags);
+          readers.back ().setBusyPolicy (busy);
+        }
+      return readers;
+    }
+
+    std::string
+    fileNameOf (Database& db)
+    {
+      auto name = db.getFileName ();
+      if (name.empty ())
+        throw ErrNoConnection ("database has no file to share");
+      return name;
+    }
+
+    // calls start(partitions) and then, in parallel,
+    // fn(partition, reader, range) for each partition of a plan
+    template <typename Start, typename Fn>
+    void
+    scan (const std::string&     name,
+          std::vector<Database>& readers,
+          const BusyPolicy&      busy,
+          const ScanPlan&        plan,
+          Start&&                start,
+          Fn&&                   fn)
+    {
+      if (plan.table.empty ())
+        throw ErrOutOfRange ("a scan needs a table for the key range");
+
+      const std::size_t wanted
+          = plan.partitions > 0 ? plan.partitions : readers.size ();
+      const std::size_t used = std::min (wanted, readers.size ());
+
+      ReadTransactions transactions{readers};
+      if (plan.snapshot)
+        {
+          Database fence{name, SQLITE_OPEN_READWRITE | SQLITE_OPEN_URI};
+          fence.setBusyPolicy (busy);
+
+          // without WAL, a read lock blocks commits, and a write lock can
+          // block readers, like with the memdb VFS, so hold a read lock,
+          // with WAL no writer can commit while the fence holds the write
+          // lock
+          const bool wal
+              = fence.selectValue ("PRAGMA journal_mode;").getText () == "wal";
+          bool fenced = true;
+          try
+            {
+              fence.execute (
+                  wal ? "BEGIN IMMEDIATE;"
+                      : "BEGIN; SELECT 1 FROM sqlite_schema LIMIT 1;");
+            }
+          catch (const SQLite3Error& e)
+            {
+              // a read only database has no writers to fence
+              if ((e.SQLiteErrorCode () & 0xff) != SQLITE_READONLY)
+                throw;
+              fenced = false;
+            }
+
+          transactions.begin (used);
+          if (fenced)
+            fence.execute ("ROLLBACK;");
+        }
+
+      const auto bounds = readers[0].select ("SELECT min("
+                                                 + quoted (plan.key)
+                                                 + "), max("
+                                                 + quoted (plan.key)
+                                                 + ") FROM "
+                                                 + quoted (plan.table)
+                                                 + ";");
+      const DbValue& lo = bounds[0][0];
+      const DbValue& hi = bounds[0][1];
+      if (lo.isNull () || hi.isNull ())
+        return;
+
+      if (lo.type () != Type::Int || hi.type () != Type::Int)
+        throw ErrTypeMisMatch ("scan key " + plan.key + " is not an integer");
+
+      const auto ranges = splitRange (lo.getInt (), hi.getInt (), wanted);
+      start (ranges.size ());
+
+      internal::parallelFor (
+          ranges.size (),
+          std::min (used, ranges.size ()),
+          [&] (std::size_t first, std::size_t last, std::size_t worker) {
+            for (auto p = first; p < last; ++p)
+              fn (p, readers[worker], ranges[p]);
+          });
+    }
+  }
+
+  ReadPool::ReadPool (const std::string& name,
+                      std::size_t        connections,
+                      int                openFlags)
+  : _name (name)
+  , _busy (BusyPolicy::timeout (std::chrono::milliseconds{5000}))
+  , _readers (openReaders (
+        name, connectionCount (connections), openFlags, _busy))
+  {
+  }
+
+  ReadPool::ReadPool (Database& db, std::size_t connections)
+  : ReadPool (fileNameOf (db), connections)
+  {
+  }
+
+  ReadPool::ReadPool (const SharedMemoryDatabase& db, std::size_t connections)
+  : ReadPool (db.getUri (), connections)
+  {
+  }
+
+  std::size_t
+  ReadPool::size () const noexcept
+  {
+    return _readers.size ();
+  }
+
+  void
+  ReadPool::setBusyPolicy (const BusyPolicy& policy)
+  {
+    for (auto& reader : _readers)
+      reader.setBusyPolicy (policy);
+    _busy = policy;
+  }
+
+  void
+  ReadPool::execute (const std::string& sql,
+                     const ScanPlan&    plan,
+                     PartitionCallback  cb)
+  {
+    ASSERT_EXCEPT (cb, ErrNullValueAccess);
+
+    const auto pos = boundsPositions (_readers[0].prepare (sql));
+
+    scan (_name,
+          _readers,
+          _busy,
+          plan,
+          [] (std::size_t) {},
+          [&] (std::size_t part, Database& db, const KeyRange& range) {
+            auto cmd = db.prepare (sql);
+            cmd.execute (
+                [&cb, part] (Columns columns) {
+                  return cb (part, std::move (columns));
+                },
+                boundsParameters (pos, range));
+          });
+  }
+
+  Dataset
+  ReadPool::select (const std::string& sql,
+                    const ScanPlan&    plan,
+                    const Types&       types)
+  {
+    const auto pos = boundsPositions (_readers[0].prepare (sql));
+
+    std::vector<Dataset> parts;
+    scan (
+        _name,
+        _readers,
+        _busy,
+        plan,
+        [&parts] (std::size_t count) { parts.resize (count); },
+        [&] (std::size_t part, Database& db, const KeyRange& range) {
+          parts[part] = db.prepare (sql).select (
+              boundsParameters (pos, range), types);
+        });
+
+    Dataset result{types};
+    for (auto& part : parts)
+      {
+        if (part.size () == 0)
+          continue;
+        if (result.size () == 0)
+          result = std::move (part);
+        else
+          result.merge (std::move (part));
+      }
+    return result;
+  }
+}
@@ -0,0 +1,382 @@
+/******************************************************************************
+ ------------- Copyright (c) 2009-2023 H a r a l d  A c h i t z ---------------
+ ---------- < h a r a l d dot a c h i t z at g m a i l dot c o m > ------------
+ ---- This Source Code Form is subject to the terms of the Mozilla Public -----
+ ---- License, v. 2.0. If a copy of the MPL was not distributed with this -----
+ ---------- file, You can obtain one at http://mozilla.org/MPL/2.0/. ----------
+ ******************************************************************************/
+
+#include <sl3/resultcache.hpp>
+
+#include <sqlite3.h>
+
+#include <algorithm>
+#include <cstring>
+#include <list>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include <sl3/command.hpp>
+#include <sl3/error.hpp>
+
+#include "connection.hpp"
+
+namespace sl3
+{
+  namespace
+  {
+    struct Entry
+    {
+      std::string                    key;
+      std::shared_ptr<const Dataset> result;
+      std::vector<std::string>       tables;
+      std::size_t                    bytes;
+    };
+
+    template <typename T>
+    void
+    appendRaw (std::string& key, const T& val)
+    {
+      key.append (reinterpret_cast<const char*> (&val), sizeof (val));
+    }
+
+    // sql, parameters and types, so that different values give different
+    // keys: each value has its type and, for text and blobs, the size
+    std::string
+    makeKey (const std::string& sql,
+             const DbValues&    parameters,
+             const Types&       types)
+    {
+      std::string key;
+      key.reserve (sql.size () + 16 * parameters.size () + types.size () + 8);
+      appendRaw (key, sql.size ());
+      key += sql;
+
+      for (const auto& param : parameters)
+        {
+          const Value& v = param.getValue ();
+          key.push_back (static_cast<char> (v.getType ()));
+          switch (v.getType ())
+            {
+            case Type::Int:
+              appendRaw (key, v.int64 ());
+              break;
+            case Type::Real:
+              appendRaw (key, v.real ());
+              break;
+            case Type::Text:
+              appendRaw (key, v.text ().size ());
+              key += v.text ();
+              break;
+            case Type::Blob:
+              appendRaw (key, v.blob ().size ());
+              key.append (reinterpret_cast<const char*> (v.blob ().data ()),
+                          v.blob ().size ());
+              break;
+            default:
+              break;
+            }
+        }
+
+      key.push_back ('\0');
+      for (const auto type : types)
+        key.push_back (static_cast<char> (type));
+
+      return key;
+    }
+
+    std::size_t
+    estimateBytes (const Dataset& ds)
+    {
+      std::size_t bytes = sizeof (Dataset);
+      for (const auto& row : ds)
+        {
+          bytes += sizeof (DbValues) + row.size () * sizeof (DbValue);
+          for (const auto& val : row)
+            {
+              const Value& v = val.getValue ();
+              if (v.getType () == Type::Text)
+                bytes += v.text ().capacity ();
+              else if (v.getType () == Type::Blob)
+                bytes += v.blob ().capacity ();
+            }
+        }
+      return bytes;
+    }
+
+    // collects the tables a statement reads while it is prepared
+    struct ReadTables
+    {
+      std::vector<std::string> tables;
+      bool                     readOnly = true;
+
+      void
+      operator() (int action, const char* table)
+      {
+        switch (action)
+          {
+          case SQLITE_READ:
+            if (table
+                && std::find (tables.begin (), tables.end (), table)
+                       == tables.end ())
+              tables.emplace_back (table);
+            break;
+          case SQLITE_SELECT:
+          case SQLITE_FUNCTION:
+          case SQLITE_RECURSIVE:
+            break;
+          default: // writes, pragmas, transactions, ...
+            readOnly = false;
+            break;
+          }
+      }
+    };
+  }
+
+  namespace
+  {
+    // an authorize listener for the scope of a prepare
+    class ListenWhilePreparing
+    {
+    public:
+      ListenWhilePreparing (internal::Hooks& hooks,
+                            sqlite3*         db,
+                            ReadTables&      read)
+      : _hooks (hooks)
+      , _db (db)
+      , _id (hooks.newId ())
+      {
+        _hooks.addAuthorize (_db, _id, [&read] (int action, const char* arg) {
+          read (action, arg);
+        });
+      }
+
+      ListenWhilePreparing (const ListenWhilePreparing&) = delete;
+      ListenWhilePreparing& operator= (const ListenWhilePreparing&) = delete;
+
+      ~ListenWhilePreparing () { _hooks.remove (_db, _id); }
+
+    private:
+      internal::Hooks& _hooks;
+      sqlite3*         _db;
+      std::size_t      _id;
+    };
+  }
+
+  struct ResultCache::State
+  {
+    using Entries = std::list<Entry>;
+
+    State (std::shared_ptr<internal::Connection> conn, CacheOptions opts)
+    : connection (std::move (conn))
+    , options (opts)
+    , versions (connection,
+                "SELECT * FROM pragma_data_version, pragma_schema_version;")
+    {
+    }
+
+    std::shared_ptr<internal::Connection> connection;
+    CacheOptions                          options;
+    CacheStats                            stats;
+
+    Entries                                            lru; // recent first
+    std::unordered_map<std::string, Entries::iterator> byKey;
+
+    // changes reported by the update hook since the last sync
+    std::unordered_set<std::string> changed;
+    std::string                     lastChanged;
+    unsigned                        events = 0;
+
+    std::size_t hookId        = 0;
+    unsigned    totalChanges  = 0;
+    int64_t     dataVersion   = -1;
+    int64_t     schemaVersion = -1;
+    Command     versions;
+
+    void
+    erase (Entries::iterator pos)
+    {
+      stats.bytes -= pos->bytes;
+      byKey.erase (pos->key);
+      lru.erase (pos);
+      stats.entries = lru.size ();
+    }
+
+    void
+    invalidateAll ()
+    {
+      stats.invalidations += lru.size ();
+      lru.clear ();
+      byKey.clear ();
+      stats.entries = 0;
+      stats.bytes   = 0;
+    }
+
+    void
+    invalidate (const std::string& table)
+    {
+      for (auto pos = lru.begin (); pos != lru.end ();)
+        {
+          const auto& tables = pos->tables;
+          if (std::find (tables.begin (), tables.end (), table)
+              != tables.end ())
+            {
+              stats.invalidations += 1;
+              erase (pos++);
+            }
+          else
+            {
+              ++pos;
+            }
+        }
+    }
+
+    // apply the changes since the last call
+    void
+    sync ()
+    {
+      sqlite3* db = connection->db ();
+
+      // rows the update hook did not report, for example a DELETE
+      // without WHERE (truncate) or WITHOUT ROWID tables
+      const auto total = static_cast<unsigned> (sqlite3_total_changes (db));
+      bool       all   = total - totalChanges != events;
+      totalChanges     = total;
+      events           = 0;
+
+      versions.execute ([&] (Columns cols) {
+        const auto data   = cols.getInt64 (0);
+        const auto schema = cols.getInt64 (1);
+        all = all || data != dataVersion || schema != schemaVersion;
+        dataVersion       = data;
+        schemaVersion     = schema;
+        return false;
+      });
+
+      if (all)
+        {
+          invalidateAll ();
+        }
+      else
+        {
+          for (const auto& table : changed)
+            invalidate (table);
+        }
+      changed.clear ();
+      lastChanged.clear ();
+    }
+
+    void
+    evict ()
+    {
+      while (!lru.empty ()
+             && (lru.size () > options.maxEntries
+                 || stats.bytes > options.maxBytes))
+        {
+          stats.evictions += 1;
+          erase (std::prev (lru.end ()));
+        }
+    }
+  };
+
+  ResultCache::ResultCache (Database& db, CacheOptions options)
+  {
+    db._connection->ensureValid ();
+    _state = std::make_unique<State> (db._connection, options);
+
+    State* state  = _state.get ();
+    state->hookId = state->connection->hooks.newId ();
+    state->connection->hooks.addUpdate (
+        state->connection->db (),
+        state->hookId,
+        [state] (int, const char*, const char* table, int64_t) {
+          state->events += 1;
+          if (state->lastChanged != table)
+            {
+              state->lastChanged = table;
+              state->changed.insert (state->lastChanged);
+            }
+        });
+
+    state->sync ();
+  }
+
+  ResultCache::~ResultCache ()
+  {
+    auto& connection = *_state->connection;
+    connection.hooks.remove (connection.db (), _state->hookId);
+  }
+
+  std::shared_ptr<const Dataset>
+  ResultCache::select (const std::string& sql,
+                       const DbValues&    parameters,
+                       const Types&       types)
+  {
+    State& state = *_state;
+    state.connection->ensureValid ();
+    sqlite3* db = state.connection->db ();
+
+    // never cache what a transaction might roll back
+    if (!sqlite3_get_autocommit (db))
+      {
+        state.stats.misses += 1;
+        Command cmd{state.connection, sql};
+        return std::make_shared<const Dataset> (cmd.select (parameters, types));
+      }
+
+    state.sync ();
+
+    auto key   = makeKey (sql, parameters, types);
+    auto found = state.byKey.find (key);
+    if (found != state.byKey.end ())
+      {
+        state.stats.hits += 1;
+        state.lru.splice (state.lru.begin (), state.lru, found->second);
+        return found->second->result;
+      }
+
+    state.stats.misses += 1;
+
+    // observe the authorizer while preparing, a user authorizer stays
+    ReadTables read;
+    Command    cmd = [&] () {
+      ListenWhilePreparing listen{state.connection->hooks, db, read};
+      return Command{state.connection, sql};
+    }();
+
+    auto result
+        = std::make_shared<const Dataset> (cmd.select (parameters, types));
+
+    const auto bytes = estimateBytes (*result) + key.size ();
+    if (!read.readOnly || bytes > state.options.maxBytes)
+      return result;
+
+    state.lru.push_front (
+        Entry{std::move (key), result, std::move (read.tables), bytes});
+    state.byKey.emplace (state.lru.front ().key, state.lru.begin ());
+    state.stats.bytes += bytes;
+    state.stats.entries = state.lru.size ();
+    state.evict ();
+
+    return result;
+  }
+
+  void
+  ResultCache::invalidate ()
+  {
+    _state->invalidateAll ();
+  }
+
+  void
+  ResultCache::invalidate (const std::string& table)
+  {
+    _state->invalidate (table);
+  }
+
+  CacheStats
+  ResultCache::stats () const
+  {
+    return _state->stats;
+  }
+}
@@ -0,0 +1,233 @@
+/******************************************************************************
+ ------------- Copyright (c) 2009-2023 H a r a l d  A c h i t z ---------------
+ ---------- < h a r a l d dot a c h i t z at g m a i l dot c o m > ------------
+ ---- This Source Code Form is subject to the terms of the Mozilla Public -----
+ ---- License, v. 2.0. If a copy of the MPL was not distributed with this -----
+ ---------- file, You can obtain one at http://mozilla.org/MPL/2.0/. ----------
+ ******************************************************************************/
+
+#include <sl3/dataset.hpp>
+
+#include <sqlite3.h>
+
+#include "rowindex.hpp"
+
+#include <sl3/error.hpp>
+
+#include <algorithm>
+#include <functional>
+#include <numeric>
+#include <string_view>
+
+namespace sl3
+{
+  namespace internal
+  {
+    namespace
+    {
+      std::size_t
+      hashKey (const KeyRef& key)
+      {
+        return std::hash<std::string_view>{}(std::string_view{
+            reinterpret_cast<const char*> (key.data), key.size});
+      }
+
+      // compare only the first probe.size() bytes of key
+      int
+      comparePrefix (const KeyRef& key, const std::vector<unsigned char>& probe)
+      {
+        return compareKeys (key.data,
+                            std::min (key.size, probe.size ()),
+                            probe.data (),
+                            probe.size ());
+      }
+    }
+
+    RowIndex::RowIndex (const Dataset&           ds,
+                        std::vector<std::size_t> fields,
+                        IndexType                type,
+                        std::size_t              threads)
+    : _fields (std::move (fields))
+    , _type (type)
+    , _keys ()
+    , _rows ()
+    , _groups ()
+    {
+      const std::size_t rows = ds.size ();
+      threads                = threadsFor (threads, rows);
+
+      _keys = std::make_unique<RowKeys> (
+          rows, threads, [&] (KeyWriter& writer, std::size_t r) {
+            const auto& row = ds[r];
+            for (auto f : _fields)
+              writer.append (row[f],
+                             KeyScheme::Variant,
+                             SortOrder::Ascending,
+                             NullsOrder::First);
+          });
+
+      _rows.resize (rows);
+      std::iota (_rows.begin (), _rows.end (), std::size_t{0});
+
+      const RowKeys& keys = *_keys;
+      if (_type == IndexType::Ordered)
+        {
+          parallelSort (
+              _rows,
+              [&keys] (std::size_t a, std::size_t b) {
+                const int c = compareKeys (keys[a], keys[b]);
+                return c != 0 ? c < 0 : a < b;
+              },
+              threads);
+          return;
+        }
+
+      std::vector<std::size_t> hashes (rows);
+      parallelFor (rows,
+                   threads,
+                   [&] (std::size_t first, std::size_t last, std::size_t) {
+                     for (auto r = first; r < last; ++r)
+                       hashes[r] = hashKey (keys[r]);
+                   });
+
+      parallelSort (
+          _rows,
+          [&keys, &hashes] (std::size_t a, std::size_t b) {
+            if (hashes[a] != hashes[b])
+              return hashes[a] < hashes[b];
+            const int c = compareKeys (keys[a], keys[b]);
+            return c != 0 ? c < 0 : a < b;
+          },
+          threads);
+
+      buildGroups ();
+    }
+
+    void
+    RowIndex::buildGroups ()
+    {
+      std::size_t groupCount = 0;
+      for (std::size_t p = 0; p < _rows.size (); ++p)
+        {
+          if (p == 0 || compareKeys (keyAt (p - 1), keyAt (p)) != 0)
+            ++groupCount;
+        }
+
+      std::size_t slots = 16;
+      while (slots < groupCount * 2)
+        slots *= 2;
+
+      _groups.assign (slots, Group{0, 0});
+      const std::size_t mask = slots - 1;
+
+      std::size_t first = 0;
+      while (first < _rows.size ())
+        {
+          std::size_t last = first + 1;
+          while (last < _rows.size ()
+                 && compareKeys (keyAt (first), keyAt (last)) == 0)
+            ++last;
+
+          std::size_t slot = hashKey (keyAt (first)) & mask;
+          while (_groups[slot].last != 0)
+            slot = (slot + 1) & mask;
+          _groups[slot] = Group{first, last};
+
+          first = last;
+        }
+    }
+
+    std::vector<unsigned char>
+    RowIndex::encode (const DbValues& key) const
+    {
+      if (key.size () == 0 || key.size () > _fields.size ())
+        throw ErrTypeMisMatch ("index key size "
+                               + std::to_string (key.size ()) + " for "
+                               + std::to_string (_fields.size ())
+                               + " fields");
+
+      std::vector<unsigned char> bytes;
+      KeyWriter                  writer{bytes};
+      for (const auto& val : key)
+        writer.append (
+            val, KeyScheme::Variant, SortOrder::Ascending, NullsOrder::First);
+      return bytes;
+    }
+
+    std::size_t
+    RowIndex::lowerBound (const std::vector<unsigned char>& key) const
+    {
+      std::size_t first = 0;
+      std::size_t count = _rows.size ();
+      while (count > 0)
+        {
+          const std::size_t half = count / 2;
+          if (comparePrefix (keyAt (first + half), key) < 0)
+            {
+              first += half + 1;
+              count -= half + 1;
+            }
+          else
+            {
+              count = half;
+            }
+        }
+      return first;
+    }
+
+    std::size_t
+    RowIndex::upperBound (const std::vector<unsigned char>& key) const
+    {
+      std::size_t first = 0;
+      std::size_t count = _rows.size ();
+      while (count > 0)
+        {
+          const std::size_t half = count / 2;
+          if (comparePrefix (keyAt (first + half), key) <= 0)
+            {
+              first += half + 1;
+              count -= half + 1;
+            }
+          else
+            {
+              count = half;
+            }
+        }
+      return first;
+    }
+
+    RowRange
+    RowIndex::equalRange (const DbValues& key) const
+    {
+      const auto bytes = encode (key);
+
+      if (_type == IndexType::Ordered)
+        return slice (lowerBound (bytes), upperBound (bytes));
+
+      if (key.size () != _fields.size ())
+        throw ErrTypeMisMatch ("hash index needs a value for each field");
+
+      const KeyRef      probe{bytes.data (), bytes.size ()};
+      const std::size_t mask = _groups.size () - 1;
+      for (std::size_t slot = hashKey (probe) & mask; _groups[slot].last != 0;
+           slot             = (slot + 1) & mask)
+        {
+          const Group& group = _groups[slot];
+          if (compareKeys (keyAt (group.first), probe) == 0)
+            return slice (group.first, group.last);
+        }
+      return RowRange{};
+    }
+
+    RowRange
+    RowIndex::range (const DbValues& lower, const DbValues& upper) const
+    {
+      if (_type != IndexType::Ordered)
+        throw ErrOutOfRange ("range lookup needs an ordered index");
+
+      const std::size_t first = lowerBound (encode (lower));
+      const std::size_t last  = std::max (first, lowerBound (encode (upper)));
+      return slice (first, last);
+    }
+  }
+}
@@ -0,0 +1,106 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+#include <sl3/dataset.hpp>
+
+#include "normkey.hpp"
+
+namespace sl3
+{
+  namespace internal
+  {
+    /**
+     * \internal
+     * \brief An immutable secondary index over the rows of a Dataset
+     *
+     * Each row gets a normalized key of the indexed fields.
+     * Row numbers are sorted by key, for a hash index by the hash of the
+     * key first, so that rows with equal keys are adjacent.
+     * A hash index has an additional open addressing table that maps a
+     * key to its group of rows.
+     */
+    class RowIndex
+    {
+    public:
+      RowIndex (const Dataset&           ds,
+                std::vector<std::size_t> fields,
+                IndexType                type,
+                std::size_t              threads);
+
+      const std::vector<std::size_t>&
+      fields () const noexcept
+      {
+        return _fields;
+      }
+
+      IndexType
+      type () const noexcept
+      {
+        return _type;
+      }
+
+      /// rows with the given key, for an ordered index also a key prefix
+      RowRange equalRange (const DbValues& key) const;
+
+      /// rows with keys in [lower, upper), ordered index only
+      RowRange range (const DbValues& lower, const DbValues& upper) const;
+
+      /// number of rows
+      std::size_t
+      size () const noexcept
+      {
+        return _rows.size ();
+      }
+
+      /// position of the first key not less than key, ordered index only
+      std::size_t
+      lowerBound (const DbValues& key) const
+      {
+        return lowerBound (encode (key));
+      }
+
+      /// position of the first key greater than key, ordered index only
+      std::size_t
+      upperBound (const DbValues& key) const
+      {
+        return upperBound (encode (key));
+      }
+
+      /// rows at the positions [first, last)
+      RowRange
+      slice (std::size_t first, std::size_t last) const
+      {
+        return RowRange{_rows.data () + first, _rows.data () + last};
+      }
+
+    private:
+      struct Group
+      {
+        std::size_t first;
+        std::size_t last; ///< 0 for an empty slot
+      };
+
+      std::vector<unsigned char> encode (const DbValues& key) const;
+
+      const KeyRef&
+      keyAt (std::size_t pos) const
+      {
+        return (*_keys)[_rows[pos]];
+      }
+
+      std::size_t lowerBound (const std::vector<unsigned char>& key) const;
+      std::size_t upperBound (const std::vector<unsigned char>& key) const;
+
+      void buildGroups ();
+
+      std::vector<std::size_t> _fields;
+      IndexType                _type;
+      std::unique_ptr<RowKeys> _keys;
+      std::vector<std::size_t> _rows;
+      std::vector<Group>       _groups;
+    };
+  }
+}
@@ -0,0 +1,31 @@
+/******************************************************************************
+ ------------- Copyright (c) 2009-2023 H a r a l d  A c h i t z ---------------
+ ---------- < h a r a l d dot a c h i t z at g m a i l dot c o m > ------------
+ ---- This Source Code Form is subject to the terms of the Mozilla Public -----
+ ---- License, v. 2.0. If a copy of the MPL was not distributed with this -----
+ ---------- file, You can obtain one at http://mozilla.org/MPL/2.0/. ----------
+ ******************************************************************************/
+
+#include <sl3/slowio.hpp>
+
+#include <sl3/error.hpp>
+#include <sl3/iostats.hpp>
+
+#include "vfsshim.hpp"
+
+namespace sl3
+{
+  std::string
+  slowIoVfs (const std::string& name, const IoLimits& limits)
+  {
+    // the statistics VFS shall not get delays
+    if (name == ioStatsVfs ())
+      throw ErrOutOfRange{"VFS name in use: " + name};
+
+    internal::ShimVfs& vfs = internal::shimVfs (name);
+    vfs.delay (internal::IoOp::Read).set (limits.read);
+    vfs.delay (internal::IoOp::Write).set (limits.write);
+    vfs.delay (internal::IoOp::Sync).set (limits.sync);
+    return name;
+  }
+}
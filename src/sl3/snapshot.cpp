@@ -0,0 +1,590 @@
+/******************************************************************************
+ ------------- Copyright (c) 2009-2023 H a r a l d  A c h i t z ---------------
+ ---------- < h a r a l d dot a c h i t z at g m a i l dot c o m > ------------
+ ---- This Source Code Form is subject to the terms of the Mozilla Public -----
+ ---- License, v. 2.0. If a copy of the MPL was not distributed with this -----
+ ---------- file, You can obtain one at http://mozilla.org/MPL/2.0/. ----------
+ ******************************************************************************/
+
+#include <sl3/snapshot.hpp>
+
+#include <atomic>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+
+#include <sl3/error.hpp>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace sl3
+{
+  namespace
+  {
+    constexpr char     magic[8]  = {'S', 'L', '3', 'S', 'N', 'A', 'P', '\0'};
+    constexpr uint32_t version   = 1;
+    constexpr uint32_t byteOrder = 0x01020304;
+
+    struct FileHeader
+    {
+      char     magic[8];
+      uint32_t version;
+      uint32_t byteOrder;
+      uint64_t rows;
+      uint64_t fields;
+      uint64_t heapOffset; ///< file offset of the heap
+      uint64_t heapSize;
+    };
+    static_assert (sizeof (FileHeader) == 48);
+
+    struct FieldEntry
+    {
+      uint64_t kinds; ///< file offset of the storage type bytes
+      uint64_t slots; ///< file offset of the 8 byte value slots
+      uint64_t name;  ///< heap offset of the name
+      uint32_t nameSize;
+      uint32_t type;
+    };
+    static_assert (sizeof (FieldEntry) == 32);
+
+    // Slots of text and blob values are heap offsets of an 8 byte size
+    // followed by the bytes.
+
+    constexpr uint64_t
+    align8 (uint64_t size)
+    {
+      return (size + 7) / 8 * 8;
+    }
+
+    class FileWriter
+    {
+    public:
+      explicit FileWriter (const std::string& path)
+      : _out (path, std::ios::binary | std::ios::trunc)
+      {
+        if (!_out)
+          throw ErrUnexpected ("can not create snapshot " + path);
+        _buffer.reserve (bufferSize);
+      }
+
+      void
+      write (const void* data, std::size_t size)
+      {
+        if (_buffer.size () + size > bufferSize)
+          flush ();
+        if (size > bufferSize)
+          {
+            writeOut (static_cast<const char*> (data), size);
+            return;
+          }
+        const auto* bytes = static_cast<const char*> (data);
+        _buffer.insert (_buffer.end (), bytes, bytes + size);
+      }
+
+      template <typename T>
+      void
+      put (const T& val)
+      {
+        write (&val, sizeof (val));
+      }
+
+      void
+      pad (uint64_t size)
+      {
+        static const char zeros[8] = {};
+        write (zeros, align8 (size) - size);
+      }
+
+      void
+      close ()
+      {
+        flush ();
+        _out.close ();
+        if (!_out)
+          throw ErrUnexpected ("writing snapshot failed");
+      }
+
+    private:
+      static constexpr std::size_t bufferSize = std::size_t{1} << 16;
+
+      void
+      flush ()
+      {
+        writeOut (_buffer.data (), _buffer.size ());
+        _buffer.clear ();
+      }
+
+      void
+      writeOut (const char* data, std::size_t size)
+      {
+        _out.write (data, static_cast<std::streamsize> (size));
+        if (!_out)
+          throw ErrUnexpected ("writing snapshot failed");
+      }
+
+      std::ofstream     _out;
+      std::vector<char> _buffer;
+    };
+
+    std::size_t
+    varSize (const Value& v)
+    {
+      return v.getType () == Type::Text ? v.text ().size ()
+                                        : v.blob ().size ();
+    }
+
+    void
+    writeSnapshotFile (const Dataset& ds, const std::string& path)
+    {
+      const uint64_t rows   = ds.size ();
+      Types          types  = ds.getTypes ();
+      const auto     fields = types.size () > 0
+                                  ? types.size ()
+                                  : (rows > 0 ? ds[0].size () : 0);
+      if (types.size () == 0)
+        types = Types{Types::container_type (fields, Type::Variant)};
+
+      // rows of an untyped Dataset can have different sizes
+      for (const auto& row : ds)
+        {
+          if (row.size () != fields)
+            throw ErrTypeMisMatch ("snapshot rows need "
+                                   + std::to_string (fields) + " fields");
+        }
+
+      const auto& names = ds.getNames ();
+      const auto  nameOf
+          = [&names] (std::size_t field) -> const std::string& {
+        static const std::string noName;
+        return field < names.size () ? names[field] : noName;
+      };
+
+      // layout, the heap has the names first, then the text and blob data
+      FileHeader header{};
+      std::memcpy (header.magic, magic, sizeof (magic));
+      header.version   = version;
+      header.byteOrder = byteOrder;
+      header.rows      = rows;
+      header.fields    = fields;
+
+      std::vector<FieldEntry> entries (fields);
+      uint64_t                pos  = sizeof (FileHeader)
+                     + fields * sizeof (FieldEntry);
+      uint64_t                heap = 0;
+      for (std::size_t f = 0; f < fields; ++f)
+        {
+          entries[f].kinds = pos;
+          pos += align8 (rows);
+          entries[f].slots = pos;
+          pos += 8 * rows;
+          entries[f].name     = heap;
+          entries[f].nameSize = static_cast<uint32_t> (nameOf (f).size ());
+          entries[f].type     = static_cast<uint32_t> (types[f]);
+          heap += nameOf (f).size ();
+        }
+      header.heapOffset = pos;
+
+      for (std::size_t f = 0; f < fields; ++f)
+        for (const auto& row : ds)
+          {
+            const Value& v = row[f].getValue ();
+            if (v.getType () == Type::Text || v.getType () == Type::Blob)
+              header.heapSize += 8 + varSize (v);
+          }
+      header.heapSize += heap; // the names
+
+      FileWriter out{path};
+      out.put (header);
+      for (const auto& entry : entries)
+        out.put (entry);
+
+      for (std::size_t f = 0; f < fields; ++f)
+        {
+          for (const auto& row : ds)
+            out.put (static_cast<unsigned char> (row[f].type ()));
+          out.pad (rows);
+
+          for (const auto& row : ds)
+            {
+              uint64_t bits = 0;
+              if (!row[f].isNull ())
+                {
+                  const Value& v = row[f].getValue ();
+                  switch (v.getType ())
+                    {
+                    case Type::Int:
+                      std::memcpy (&bits, &v.int64 (), sizeof (bits));
+                      break;
+                    case Type::Real:
+                      std::memcpy (&bits, &v.real (), sizeof (bits));
+                      break;
+                    default:
+                      bits = heap;
+                      heap += 8 + varSize (v);
+                      break;
+                    }
+                }
+              out.put (bits);
+            }
+        }
+
+      for (std::size_t f = 0; f < fields; ++f)
+        out.write (nameOf (f).data (), nameOf (f).size ());
+
+      for (std::size_t f = 0; f < fields; ++f)
+        {
+          for (const auto& row : ds)
+            {
+              const Value& v    = row[f].getValue ();
+              const Type   type = v.getType ();
+              if (type != Type::Text && type != Type::Blob)
+                continue;
+
+              const uint64_t size = varSize (v);
+              out.put (size);
+              if (type == Type::Text)
+                out.write (v.text ().data (), v.text ().size ());
+              else
+                out.write (v.blob ().data (), v.blob ().size ());
+            }
+        }
+      out.close ();
+    }
+
+    template <typename T>
+    T
+    readAt (const unsigned char* data)
+    {
+      T val;
+      std::memcpy (&val, data, sizeof (val));
+      return val;
+    }
+
+    [[noreturn]] void
+    invalid (const std::string& path)
+    {
+      throw ErrUnexpected ("not a valid snapshot: " + path);
+    }
+
+    // unique per process and call, so concurrent writers do not share it
+    std::string
+    tempName (const std::string& path)
+    {
+      static std::atomic<unsigned long> counter{0};
+#ifdef _WIN32
+      const auto pid = static_cast<unsigned long> (GetCurrentProcessId ());
+#else
+      const auto pid = static_cast<unsigned long> (getpid ());
+#endif
+      return path + "." + std::to_string (pid) + "."
+             + std::to_string (++counter) + ".tmp";
+    }
+  }
+
+  void
+  writeSnapshot (const Dataset& ds, const std::string& path)
+  {
+    // readers of the old file keep their mapping, the new file replaces it
+    const std::string tmp = tempName (path);
+    try
+      {
+        writeSnapshotFile (ds, tmp);
+        std::filesystem::rename (tmp, path);
+      }
+    catch (const std::filesystem::filesystem_error& e)
+      {
+        std::remove (tmp.c_str ());
+        throw ErrUnexpected (e.what ());
+      }
+    catch (...)
+      {
+        std::remove (tmp.c_str ());
+        throw;
+      }
+  }
+
+  struct DatasetView::Mapping
+  {
+    const unsigned char* data = nullptr;
+    std::size_t          size = 0;
+
+    explicit Mapping (const std::string& path)
+    {
+#ifdef _WIN32
+      HANDLE file = CreateFileA (path.c_str (),
+                                 GENERIC_READ,
+                                 FILE_SHARE_READ | FILE_SHARE_DELETE,
+                                 nullptr,
+                                 OPEN_EXISTING,
+                                 FILE_ATTRIBUTE_NORMAL,
+                                 nullptr);
+      if (file == INVALID_HANDLE_VALUE)
+        throw ErrUnexpected ("can not open snapshot " + path);
+
+      LARGE_INTEGER fileSize{};
+      HANDLE        mapping = nullptr;
+      if (GetFileSizeEx (file, &fileSize) && fileSize.QuadPart > 0)
+        mapping = CreateFileMappingA (
+            file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+      CloseHandle (file);
+      if (!mapping)
+        throw ErrUnexpected ("can not map snapshot " + path);
+
+      void* view = MapViewOfFile (mapping, FILE_MAP_READ, 0, 0, 0);
+      CloseHandle (mapping); // the view keeps the mapping
+      if (!view)
+        throw ErrUnexpected ("can not map snapshot " + path);
+
+      data = static_cast<const unsigned char*> (view);
+      size = static_cast<std::size_t> (fileSize.QuadPart);
+#else
+      const int fd = ::open (path.c_str (), O_RDONLY | O_CLOEXEC);
+      if (fd < 0)
+        throw ErrUnexpected ("can not open snapshot " + path);
+
+      struct stat st
+      {
+      };
+      void* view = MAP_FAILED;
+      if (::fstat (fd, &st) == 0 && st.st_size > 0)
+        view = ::mmap (nullptr,
+                       static_cast<std::size_t> (st.st_size),
+                       PROT_READ,
+                       MAP_SHARED,
+                       fd,
+                       0);
+      ::close (fd); // the mapping keeps the file
+      if (view == MAP_FAILED)
+        throw ErrUnexpected ("can not map snapshot " + path);
+
+      data = static_cast<const unsigned char*> (view);
+      size = static_cast<std::size_t> (st.st_size);
+#endif
+    }
+
+    ~Mapping ()
+    {
+#ifdef _WIN32
+      UnmapViewOfFile (data);
+#else
+      ::munmap (const_cast<unsigned char*> (data), size);
+#endif
+    }
+
+    Mapping (const Mapping&)            = delete;
+    Mapping& operator= (const Mapping&) = delete;
+  };
+
+  DatasetView::DatasetView (const std::string& path)
+  : _map (std::make_unique<Mapping> (path))
+  {
+    const unsigned char* data = _map->data;
+    const uint64_t       size = _map->size;
+
+    if (size < sizeof (FileHeader))
+      invalid (path);
+
+    const auto header = readAt<FileHeader> (data);
+    if (std::memcmp (header.magic, magic, sizeof (magic)) != 0
+        || header.version != version || header.byteOrder != byteOrder)
+      invalid (path);
+
+    const uint64_t rows   = header.rows;
+    const uint64_t fields = header.fields;
+    // sizes are limited by the file size, so these products can not wrap
+    if (rows > size || fields > size / sizeof (FieldEntry)
+        || header.heapOffset > size
+        || header.heapSize > size - header.heapOffset)
+      invalid (path);
+
+    const uint64_t sectionsEnd = header.heapOffset;
+    if (sizeof (FileHeader) + fields * sizeof (FieldEntry) > sectionsEnd)
+      invalid (path);
+
+    _rows     = static_cast<std::size_t> (rows);
+    _heap     = data + header.heapOffset;
+    _heapSize = static_cast<std::size_t> (header.heapSize);
+
+    Types::container_type types;
+    for (uint64_t f = 0; f < fields; ++f)
+      {
+        const auto entry = readAt<FieldEntry> (
+            data + sizeof (FileHeader) + f * sizeof (FieldEntry));
+
+        if (entry.kinds > sectionsEnd || rows > sectionsEnd - entry.kinds
+            || entry.slots % 8 != 0 || entry.slots > sectionsEnd
+            || rows > (sectionsEnd - entry.slots) / 8
+            || entry.name > _heapSize
+            || entry.nameSize > _heapSize - entry.name
+            || entry.type > static_cast<uint32_t> (Type::Variant))
+          invalid (path);
+
+        _kinds.push_back (data + entry.kinds);
+        _slots.push_back (data + entry.slots);
+        _names.emplace_back (reinterpret_cast<const char*> (_heap + entry.name),
+                             entry.nameSize);
+        _nameIndex.emplace (_names.back (), _names.size () - 1);
+        types.push_back (static_cast<Type> (entry.type));
+      }
+    _types = Types{std::move (types)};
+  }
+
+  DatasetView::~DatasetView () = default;
+
+  DatasetView::DatasetView (DatasetView&& other) noexcept = default;
+
+  DatasetView& DatasetView::operator= (DatasetView&& other) noexcept
+      = default;
+
+  std::size_t
+  DatasetView::size () const noexcept
+  {
+    return _rows;
+  }
+
+  const std::vector<std::string>&
+  DatasetView::getNames () const noexcept
+  {
+    return _names;
+  }
+
+  const Types&
+  DatasetView::getTypes () const noexcept
+  {
+    return _types;
+  }
+
+  std::size_t
+  DatasetView::getIndex (const std::string& name) const
+  {
+    auto pos = _nameIndex.find (name);
+    if (pos == _nameIndex.end ())
+      throw ErrOutOfRange ("Field name " + name + " not found");
+
+    return pos->second;
+  }
+
+  Type
+  DatasetView::getType (std::size_t row, std::size_t field) const
+  {
+    if (row >= _rows || field >= _kinds.size ())
+      throw ErrOutOfRange ("snapshot value " + std::to_string (row) + ","
+                           + std::to_string (field) + " out of range");
+
+    return static_cast<Type> (_kinds[field][row]);
+  }
+
+  bool
+  DatasetView::isNull (std::size_t row, std::size_t field) const
+  {
+    return getType (row, field) == Type::Null;
+  }
+
+  const unsigned char*
+  DatasetView::slot (std::size_t row, std::size_t field, Type expected) const
+  {
+    const Type type = getType (row, field);
+    if (type == Type::Null)
+      throw ErrNullValueAccess ();
+    if (type != expected)
+      throw ErrTypeMisMatch (typeName (type) + " != " + typeName (expected));
+
+    return _slots[field] + 8 * row;
+  }
+
+  std::string_view
+  DatasetView::bytes (std::size_t row, std::size_t field, Type expected) const
+  {
+    const auto offset = readAt<uint64_t> (slot (row, field, expected));
+    if (offset > _heapSize || _heapSize - offset < 8)
+      throw ErrUnexpected ("corrupt snapshot heap");
+
+    const auto size = readAt<uint64_t> (_heap + offset);
+    if (size > _heapSize - offset - 8)
+      throw ErrUnexpected ("corrupt snapshot heap");
+
+    return std::string_view{reinterpret_cast<const char*> (_heap + offset + 8),
+                            static_cast<std::size_t> (size)};
+  }
+
+  int64_t
+  DatasetView::getInt (std::size_t row, std::size_t field) const
+  {
+    return readAt<int64_t> (slot (row, field, Type::Int));
+  }
+
+  double
+  DatasetView::getReal (std::size_t row, std::size_t field) const
+  {
+    return readAt<double> (slot (row, field, Type::Real));
+  }
+
+  std::string_view
+  DatasetView::getText (std::size_t row, std::size_t field) const
+  {
+    return bytes (row, field, Type::Text);
+  }
+
+  std::string_view
+  DatasetView::getBlob (std::size_t row, std::size_t field) const
+  {
+    return bytes (row, field, Type::Blob);
+  }
+
+  DbValue
+  DatasetView::getValue (std::size_t row, std::size_t field) const
+  {
+    const auto type = getType (row, field);
+    DbValue    val{_types[field]};
+    switch (type)
+      {
+      case Type::Int:
+        val = getInt (row, field);
+        break;
+      case Type::Real:
+        val = getReal (row, field);
+        break;
+      case Type::Text:
+        val = std::string{getText (row, field)};
+        break;
+      case Type::Blob:
+        {
+          const auto blob  = getBlob (row, field);
+          const auto first = reinterpret_cast<const std::byte*> (blob.data ());
+          val              = Blob (first, first + blob.size ());
+          break;
+        }
+      default:
+        break;
+      }
+    return val;
+  }
+
+  Dataset
+  DatasetView::toDataset () const
+  {
+    Dataset ds{_types};
+    ds.setNames (_names);
+    ds._cont.reserve (_rows);
+    for (std::size_t row = 0; row < _rows; ++row)
+      {
+        DbValues::container_type values;
+        values.reserve (_types.size ());
+        for (std::size_t field = 0; field < _types.size (); ++field)
+          values.push_back (getValue (row, field));
+        ds._cont.emplace_back (std::move (values));
+      }
+    return ds;
+  }
+}
@@ -0,0 +1,499 @@
+/******************************************************************************
+ ------------- Copyright (c) 2009-2023 H a r a l d  A c h i t z ---------------
+ ---------- < h a r a l d dot a c h i t z at g m a i l dot c o m > ------------
+ ---- This Source Code Form is subject to the terms of the Mozilla Public -----
+ ---- License, v. 2.0. If a copy of the MPL was not distributed with this -----
+ ---------- file, You can obtain one at http://mozilla.org/MPL/2.0/. ----------
+ ******************************************************************************/
+
+#include "vfsshim.hpp"
+
+#include <chrono>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+
+#include <sl3/error.hpp>
+
+namespace sl3
+{
+  namespace internal
+  {
+    namespace
+    {
+      // stats for the main database that this thread opens
+      thread_local IoStatsState* openingStats = nullptr;
+
+      /*
+       * Main database names, as passed to xOpen, and their stats.
+       * sqlite passes journal and WAL names to xOpen that
+       * sqlite3_filename_database maps back to the name of their main
+       * database, that name is unique per connection.
+       */
+      class Registry
+      {
+      public:
+        void
+        add (const char* name, IoStatsState* stats)
+        {
+          std::lock_guard<std::mutex> lock{_mutex};
+          _stats[name] = stats;
+        }
+
+        void
+        remove (const char* name)
+        {
+          std::lock_guard<std::mutex> lock{_mutex};
+          _stats.erase (name);
+        }
+
+        IoStatsState*
+        find (const char* name)
+        {
+          std::lock_guard<std::mutex> lock{_mutex};
+          const auto pos = _stats.find (name);
+          return pos == _stats.end () ? nullptr : pos->second;
+        }
+
+      private:
+        std::mutex                                     _mutex;
+        std::unordered_map<const char*, IoStatsState*> _stats;
+      };
+
+      Registry&
+      registry ()
+      {
+        static Registry instance;
+        return instance;
+      }
+
+      // the real file follows the ShimFile in memory
+      struct ShimFile
+      {
+        sqlite3_file  base;
+        sqlite3_file* real;
+        ShimVfs*      vfs;
+        IoStatsState* stats;
+        IoFile        kind;
+        const char*   mainName;
+      };
+
+      ShimFile&
+      shimOf (sqlite3_file* file)
+      {
+        return *reinterpret_cast<ShimFile*> (file);
+      }
+
+      sqlite3_file*
+      realOf (sqlite3_file* file)
+      {
+        return shimOf (file).real;
+      }
+
+      template <typename Fn>
+      int
+      counted (sqlite3_file* file, IoOp op, uint64_t bytes, Fn&& fn)
+      {
+        using std::chrono::duration_cast;
+        using std::chrono::nanoseconds;
+        using Clock = std::chrono::steady_clock;
+
+        ShimFile&  shim  = shimOf (file);
+        const auto start = shim.stats ? Clock::now () : Clock::time_point{};
+        const int  rc    = fn (shim.real);
+
+        const auto delay = shim.vfs->delay (op).of (bytes);
+        if (delay.count () > 0)
+          std::this_thread::sleep_for (delay);
+
+        if (shim.stats == nullptr)
+          return rc;
+
+        const auto time = duration_cast<nanoseconds> (Clock::now () - start);
+        shim.stats->counter (shim.kind, op)
+            .add (rc == SQLITE_OK ? bytes : 0,
+                  static_cast<uint64_t> (time.count ()));
+        return rc;
+      }
+
+      int
+      fileClose (sqlite3_file* file)
+      {
+        ShimFile& shim = shimOf (file);
+        if (shim.mainName)
+          registry ().remove (shim.mainName);
+        return shim.real->pMethods->xClose (shim.real);
+      }
+
+      int
+      fileRead (sqlite3_file* file, void* buf, int amount, sqlite3_int64 ofs)
+      {
+        return counted (file,
+                        IoOp::Read,
+                        static_cast<uint64_t> (amount),
+                        [&] (sqlite3_file* real) {
+                          return real->pMethods->xRead (real, buf, amount, ofs);
+                        });
+      }
+
+      int
+      fileWrite (sqlite3_file* file,
+                 const void*   buf,
+                 int           amount,
+                 sqlite3_int64 ofs)
+      {
+        return counted (
+            file,
+            IoOp::Write,
+            static_cast<uint64_t> (amount),
+            [&] (sqlite3_file* real) {
+              return real->pMethods->xWrite (real, buf, amount, ofs);
+            });
+      }
+
+      int
+      fileTruncate (sqlite3_file* file, sqlite3_int64 size)
+      {
+        return realOf (file)->pMethods->xTruncate (realOf (file), size);
+      }
+
+      int
+      fileSync (sqlite3_file* file, int flags)
+      {
+        return counted (file, IoOp::Sync, 0, [&] (sqlite3_file* real) {
+          return real->pMethods->xSync (real, flags);
+        });
+      }
+
+      int
+      fileSize (sqlite3_file* file, sqlite3_int64* size)
+      {
+        return realOf (file)->pMethods->xFileSize (realOf (file), size);
+      }
+
+      int
+      fileLock (sqlite3_file* file, int lock)
+      {
+        return realOf (file)->pMethods->xLock (realOf (file), lock);
+      }
+
+      int
+      fileUnlock (sqlite3_file* file, int lock)
+      {
+        return realOf (file)->pMethods->xUnlock (realOf (file), lock);
+      }
+
+      int
+      fileCheckReservedLock (sqlite3_file* file, int* result)
+      {
+        return realOf (file)->pMethods->xCheckReservedLock (realOf (file),
+                                                            result);
+      }
+
+      int
+      fileControl (sqlite3_file* file, int op, void* arg)
+      {
+        return realOf (file)->pMethods->xFileControl (realOf (file), op, arg);
+      }
+
+      int
+      fileSectorSize (sqlite3_file* file)
+      {
+        return realOf (file)->pMethods->xSectorSize (realOf (file));
+      }
+
+      int
+      fileDeviceCharacteristics (sqlite3_file* file)
+      {
+        return realOf (file)->pMethods->xDeviceCharacteristics (
+            realOf (file));
+      }
+
+      int
+      fileShmMap (sqlite3_file*   file,
+                  int             page,
+                  int             size,
+                  int             extend,
+                  void volatile** map)
+      {
+        return realOf (file)->pMethods->xShmMap (
+            realOf (file), page, size, extend, map);
+      }
+
+      int
+      fileShmLock (sqlite3_file* file, int offset, int n, int flags)
+      {
+        return realOf (file)->pMethods->xShmLock (
+            realOf (file), offset, n, flags);
+      }
+
+      void
+      fileShmBarrier (sqlite3_file* file)
+      {
+        realOf (file)->pMethods->xShmBarrier (realOf (file));
+      }
+
+      int
+      fileShmUnmap (sqlite3_file* file, int deleteFlag)
+      {
+        return realOf (file)->pMethods->xShmUnmap (realOf (file), deleteFlag);
+      }
+
+      int
+      fileFetch (sqlite3_file* file, sqlite3_int64 ofs, int amount, void** p)
+      {
+        return realOf (file)->pMethods->xFetch (realOf (file), ofs, amount, p);
+      }
+
+      int
+      fileUnfetch (sqlite3_file* file, sqlite3_int64 ofs, void* p)
+      {
+        return realOf (file)->pMethods->xUnfetch (realOf (file), ofs, p);
+      }
+
+      // the methods of files that support version iVersion
+      const sqlite3_io_methods*
+      ioMethods (int iVersion)
+      {
+        static const auto make = [] (int version) {
+          sqlite3_io_methods m{};
+          m.iVersion               = version;
+          m.xClose                 = &fileClose;
+          m.xRead                  = &fileRead;
+          m.xWrite                 = &fileWrite;
+          m.xTruncate              = &fileTruncate;
+          m.xSync                  = &fileSync;
+          m.xFileSize              = &fileSize;
+          m.xLock                  = &fileLock;
+          m.xUnlock                = &fileUnlock;
+          m.xCheckReservedLock     = &fileCheckReservedLock;
+          m.xFileControl           = &fileControl;
+          m.xSectorSize            = &fileSectorSize;
+          m.xDeviceCharacteristics = &fileDeviceCharacteristics;
+          if (version >= 2)
+            {
+              m.xShmMap     = &fileShmMap;
+              m.xShmLock    = &fileShmLock;
+              m.xShmBarrier = &fileShmBarrier;
+              m.xShmUnmap   = &fileShmUnmap;
+            }
+          if (version >= 3)
+            {
+              m.xFetch   = &fileFetch;
+              m.xUnfetch = &fileUnfetch;
+            }
+          return m;
+        };
+        static const sqlite3_io_methods v1 = make (1);
+        static const sqlite3_io_methods v2 = make (2);
+        static const sqlite3_io_methods v3 = make (3);
+        return iVersion >= 3 ? &v3 : (iVersion == 2 ? &v2 : &v1);
+      }
+
+      ShimVfs*
+      shimVfsOf (sqlite3_vfs* vfs)
+      {
+        return static_cast<ShimVfs*> (vfs->pAppData);
+      }
+
+      sqlite3_vfs*
+      rootOf (sqlite3_vfs* vfs)
+      {
+        return shimVfsOf (vfs)->root;
+      }
+
+      int
+      vfsOpen (sqlite3_vfs*  vfs,
+               const char*   name,
+               sqlite3_file* file,
+               int           flags,
+               int*          outFlags)
+      {
+        ShimFile& shim = shimOf (file);
+        shim.real      = reinterpret_cast<sqlite3_file*> (&shim + 1);
+        shim.vfs       = shimVfsOf (vfs);
+        shim.stats     = nullptr;
+        shim.mainName  = nullptr;
+        shim.kind      = IoFile::Main;
+
+        sqlite3_vfs* root = rootOf (vfs);
+        const int rc = root->xOpen (root, name, shim.real, flags, outFlags);
+        if (shim.real->pMethods == nullptr)
+          {
+            shim.base.pMethods = nullptr;
+            return rc;
+          }
+        shim.base.pMethods = ioMethods (shim.real->pMethods->iVersion);
+        if (rc != SQLITE_OK)
+          return rc;
+
+        if (flags & SQLITE_OPEN_MAIN_DB)
+          {
+            shim.stats = openingStats;
+            if (shim.stats && name)
+              {
+                shim.mainName = name;
+                registry ().add (name, shim.stats);
+              }
+          }
+        else if (flags & (SQLITE_OPEN_MAIN_JOURNAL | SQLITE_OPEN_WAL))
+          {
+            shim.kind  = flags & SQLITE_OPEN_WAL ? IoFile::Wal
+                                                 : IoFile::Journal;
+            shim.stats = name ? registry ().find (
+                             sqlite3_filename_database (name))
+                              : nullptr;
+          }
+        return rc;
+      }
+
+      int
+      vfsDelete (sqlite3_vfs* vfs, const char* name, int syncDir)
+      {
+        return rootOf (vfs)->xDelete (rootOf (vfs), name, syncDir);
+      }
+
+      int
+      vfsAccess (sqlite3_vfs* vfs, const char* name, int flags, int* result)
+      {
+        return rootOf (vfs)->xAccess (rootOf (vfs), name, flags, result);
+      }
+
+      int
+      vfsFullPathname (sqlite3_vfs* vfs, const char* name, int n, char* out)
+      {
+        return rootOf (vfs)->xFullPathname (rootOf (vfs), name, n, out);
+      }
+
+      void*
+      vfsDlOpen (sqlite3_vfs* vfs, const char* name)
+      {
+        return rootOf (vfs)->xDlOpen (rootOf (vfs), name);
+      }
+
+      void
+      vfsDlError (sqlite3_vfs* vfs, int n, char* msg)
+      {
+        rootOf (vfs)->xDlError (rootOf (vfs), n, msg);
+      }
+
+      void (*vfsDlSym (sqlite3_vfs* vfs, void* lib, const char* symbol)) (
+          void)
+      {
+        return rootOf (vfs)->xDlSym (rootOf (vfs), lib, symbol);
+      }
+
+      void
+      vfsDlClose (sqlite3_vfs* vfs, void* lib)
+      {
+        rootOf (vfs)->xDlClose (rootOf (vfs), lib);
+      }
+
+      int
+      vfsRandomness (sqlite3_vfs* vfs, int n, char* out)
+      {
+        return rootOf (vfs)->xRandomness (rootOf (vfs), n, out);
+      }
+
+      int
+      vfsSleep (sqlite3_vfs* vfs, int microseconds)
+      {
+        return rootOf (vfs)->xSleep (rootOf (vfs), microseconds);
+      }
+
+      int
+      vfsCurrentTime (sqlite3_vfs* vfs, double* now)
+      {
+        return rootOf (vfs)->xCurrentTime (rootOf (vfs), now);
+      }
+
+      int
+      vfsGetLastError (sqlite3_vfs* vfs, int n, char* msg)
+      {
+        return rootOf (vfs)->xGetLastError (rootOf (vfs), n, msg);
+      }
+
+      int
+      vfsCurrentTimeInt64 (sqlite3_vfs* vfs, sqlite3_int64* now)
+      {
+        return rootOf (vfs)->xCurrentTimeInt64 (rootOf (vfs), now);
+      }
+
+      void
+      initVfs (ShimVfs& shim)
+      {
+        sqlite3_vfs* root = shim.root;
+        sqlite3_vfs& vfs  = shim.vfs;
+        vfs               = sqlite3_vfs{};
+        // system call overrides are not forwarded
+        vfs.iVersion = root->iVersion >= 2 ? 2 : 1;
+        vfs.szOsFile
+            = static_cast<int> (sizeof (ShimFile)) + root->szOsFile;
+        vfs.mxPathname    = root->mxPathname;
+        vfs.zName         = shim.name.c_str ();
+        vfs.pAppData      = &shim;
+        vfs.xOpen         = &vfsOpen;
+        vfs.xDelete       = &vfsDelete;
+        vfs.xAccess       = &vfsAccess;
+        vfs.xFullPathname = &vfsFullPathname;
+        vfs.xDlOpen       = &vfsDlOpen;
+        vfs.xDlError      = &vfsDlError;
+        vfs.xDlSym        = &vfsDlSym;
+        vfs.xDlClose      = &vfsDlClose;
+        vfs.xRandomness   = &vfsRandomness;
+        vfs.xSleep        = &vfsSleep;
+        vfs.xCurrentTime  = &vfsCurrentTime;
+        vfs.xGetLastError = &vfsGetLastError;
+        if (vfs.iVersion >= 2)
+          vfs.xCurrentTimeInt64 = &vfsCurrentTimeInt64;
+      }
+    }
+
+    IoStatsScope::IoStatsScope (IoStatsState* stats) noexcept
+    {
+      openingStats = stats;
+    }
+
+    IoStatsScope::~IoStatsScope () { openingStats = nullptr; }
+
+    ShimVfs&
+    shimVfs (const std::string& name)
+    {
+      static std::mutex                                     mutex;
+      static std::map<std::string, std::unique_ptr<ShimVfs>> shims;
+
+      std::lock_guard<std::mutex> lock{mutex};
+      const auto                  pos = shims.find (name);
+      if (pos != shims.end ())
+        return *pos->second;
+
+      if (name.empty ())
+        throw ErrOutOfRange{"empty VFS name"};
+      if (sqlite3_vfs_find (name.c_str ()) != nullptr)
+        throw ErrOutOfRange{"VFS name in use: " + name};
+
+      sqlite3_vfs* root = sqlite3_vfs_find (nullptr);
+      if (root == nullptr)
+        throw SQLite3Error{SQLITE_ERROR, "no default VFS"}; // LCOV_EXCL_LINE
+
+      auto shim  = std::make_unique<ShimVfs> ();
+      shim->name = name;
+      shim->root = root;
+      initVfs (*shim);
+      const int rc = sqlite3_vfs_register (&shim->vfs, 0);
+      if (rc != SQLITE_OK)
+        throw SQLite3Error{rc, "can not register VFS"}; // LCOV_EXCL_LINE
+
+      return *shims.emplace (name, std::move (shim)).first->second;
+    }
+
+    bool
+    isShimVfs (const std::string& name)
+    {
+      const sqlite3_vfs* vfs = sqlite3_vfs_find (name.c_str ());
+      return vfs != nullptr && vfs->xOpen == &vfsOpen;
+    }
+  }
+}
@@ -0,0 +1,212 @@
+#pragma once
+
+#include <sqlite3.h>
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <chrono>
+#include <cstdint>
+#include <string>
+
+#include <sl3/iostats.hpp>
+#include <sl3/slowio.hpp>
+
+namespace sl3
+{
+  namespace internal
+  {
+    /**
+     * \internal
+     * \brief Thread safe counters of one kind of file operation
+     */
+    class IoCounter
+    {
+    public:
+      void
+      add (uint64_t bytes, uint64_t nanoseconds) noexcept
+      {
+        _calls.fetch_add (1, std::memory_order_relaxed);
+        _bytes.fetch_add (bytes, std::memory_order_relaxed);
+        _nanoseconds.fetch_add (nanoseconds, std::memory_order_relaxed);
+
+        std::size_t bucket = 0;
+        for (uint64_t us = nanoseconds / 1000;
+             us > 0 && bucket + 1 < ioLatencyBuckets;
+             us >>= 1)
+          ++bucket;
+        _latency[bucket].fetch_add (1, std::memory_order_relaxed);
+      }
+
+      IoCounters
+      get () const noexcept
+      {
+        IoCounters counters;
+        counters.calls       = _calls.load (std::memory_order_relaxed);
+        counters.bytes       = _bytes.load (std::memory_order_relaxed);
+        counters.nanoseconds = _nanoseconds.load (std::memory_order_relaxed);
+        for (std::size_t i = 0; i < ioLatencyBuckets; ++i)
+          counters.latency[i] = _latency[i].load (std::memory_order_relaxed);
+        return counters;
+      }
+
+      void
+      reset () noexcept
+      {
+        _calls.store (0, std::memory_order_relaxed);
+        _bytes.store (0, std::memory_order_relaxed);
+        _nanoseconds.store (0, std::memory_order_relaxed);
+        for (auto& bucket : _latency)
+          bucket.store (0, std::memory_order_relaxed);
+      }
+
+    private:
+      std::atomic<uint64_t>                                  _calls{0};
+      std::atomic<uint64_t>                                  _bytes{0};
+      std::atomic<uint64_t>                                  _nanoseconds{0};
+      std::array<std::atomic<uint64_t>, ioLatencyBuckets> _latency{};
+    };
+
+    /// the file types of IoStats
+    enum class IoFile
+    {
+      Main,
+      Journal,
+      Wal
+    };
+
+    /// the operations of FileIoStats
+    enum class IoOp
+    {
+      Read,
+      Write,
+      Sync
+    };
+
+    /**
+     * \internal
+     * \brief The I/O counters of one connection
+     */
+    class IoStatsState
+    {
+    public:
+      IoCounter&
+      counter (IoFile file, IoOp op) noexcept
+      {
+        return _counters[static_cast<std::size_t> (file)]
+                        [static_cast<std::size_t> (op)];
+      }
+
+      IoStats
+      get () const noexcept
+      {
+        const auto file = [this] (IoFile kind) {
+          const auto& ops = _counters[static_cast<std::size_t> (kind)];
+          return FileIoStats{ops[0].get (), ops[1].get (), ops[2].get ()};
+        };
+        return IoStats{
+            file (IoFile::Main), file (IoFile::Journal), file (IoFile::Wal)};
+      }
+
+      void
+      reset () noexcept
+      {
+        for (auto& ops : _counters)
+          for (auto& counter : ops)
+            counter.reset ();
+      }
+
+    private:
+      std::array<std::array<IoCounter, 3>, 3> _counters;
+    };
+
+    /**
+     * \internal
+     * \brief Assigns stats to the main database this thread opens next
+     *
+     * Journal and WAL files of that database find the stats through
+     * their main database file.
+     */
+    class IoStatsScope
+    {
+    public:
+      explicit IoStatsScope (IoStatsState* stats) noexcept;
+      ~IoStatsScope ();
+
+      IoStatsScope (const IoStatsScope&)            = delete;
+      IoStatsScope& operator= (const IoStatsScope&) = delete;
+    };
+
+    /**
+     * \internal
+     * \brief Thread safe IoLimit of one kind of operation
+     */
+    class IoDelay
+    {
+    public:
+      void
+      set (const IoLimit& limit) noexcept
+      {
+        const auto latency
+            = std::chrono::duration_cast<std::chrono::nanoseconds> (
+                limit.latency);
+        _latency.store (latency.count () > 0
+                            ? static_cast<uint64_t> (latency.count ())
+                            : 0,
+                        std::memory_order_relaxed);
+        _bytesPerSecond.store (limit.bytesPerSecond,
+                               std::memory_order_relaxed);
+      }
+
+      /// the delay of a call that transfers bytes
+      std::chrono::nanoseconds
+      of (uint64_t bytes) const noexcept
+      {
+        uint64_t   ns  = _latency.load (std::memory_order_relaxed);
+        const auto bps = _bytesPerSecond.load (std::memory_order_relaxed);
+        if (bps > 0)
+          ns += bytes * 1000000000 / bps;
+        return std::chrono::nanoseconds{static_cast<int64_t> (ns)};
+      }
+
+    private:
+      std::atomic<uint64_t> _latency{0};
+      std::atomic<uint64_t> _bytesPerSecond{0};
+    };
+
+    /**
+     * \internal
+     * \brief A registered pass through VFS over the default VFS
+     *
+     * Counts the I/O of connections with IoStatsState and delays the
+     * operations of all files by the delays.
+     */
+    struct ShimVfs
+    {
+      std::string            name;
+      sqlite3_vfs            vfs;
+      sqlite3_vfs*           root;
+      std::array<IoDelay, 3> delays;
+
+      IoDelay&
+      delay (IoOp op) noexcept
+      {
+        return delays[static_cast<std::size_t> (op)];
+      }
+    };
+
+    /**
+     * \internal
+     * \brief The shim VFS named name, registered on the first call
+     *
+     * Registered shim VFS live until the end of the program.
+     *
+     * \throw sl3::ErrOutOfRange if name is empty or used by another VFS
+     * \throw sl3::SQLite3Error if the VFS can not be registered
+     */
+    ShimVfs& shimVfs (const std::string& name);
+
+    /// if the VFS named name is a shim VFS
+    bool isShimVfs (const std::string& name);
+  }
+}
@@ -0,0 +1,609 @@
+/******************************************************************************
+ ------------- Copyright (c) 2009-2023 H a r a l d  A c h i t z ---------------
+ ---------- < h a r a l d dot a c h i t z at g m a i l dot c o m > ------------
+ ---- This Source Code Form is subject to the terms of the Mozilla Public -----
+ ---- License, v. 2.0. If a copy of the MPL was not distributed with this -----
+ ---------- file, You can obtain one at http://mozilla.org/MPL/2.0/. ----------
+ ******************************************************************************/
+
+#include <sl3/vtab.hpp>
+
+#include <sqlite3.h>
+
+#include <algorithm>
+#include <cmath>
+#include <memory>
+#include <string>
+
+#include <sl3/database.hpp>
+#include <sl3/error.hpp>
+
+#include "connection.hpp"
+#include "rowindex.hpp"
+
+namespace sl3
+{
+  namespace internal
+  {
+    TableSource::~TableSource () = default;
+
+    namespace
+    {
+      class DatasetSource final : public TableSource
+      {
+      public:
+        DatasetSource (const Dataset& ds, std::shared_ptr<const Dataset> owner)
+        : _ds (ds)
+        , _owner (std::move (owner))
+        {
+        }
+
+        std::vector<std::string>
+        getNames () const override
+        {
+          auto names = _ds.getNames ();
+          if (names.empty ())
+            {
+              const auto count = _ds.getTypes ().size () > 0
+                                     ? _ds.getTypes ().size ()
+                                     : (_ds.size () > 0 ? _ds[0].size () : 0);
+              for (std::size_t i = 0; i < count; ++i)
+                names.push_back ("column" + std::to_string (i + 1));
+            }
+          return names;
+        }
+
+        Types
+        getTypes () const override
+        {
+          return _ds.getTypes ();
+        }
+
+        std::size_t
+        size () const override
+        {
+          return _ds.size ();
+        }
+
+        void
+        result (sqlite3_context* ctx,
+                std::size_t      row,
+                std::size_t      field) const override
+        {
+          // rows of an untyped Dataset can be shorter than the first
+          const DbValues& values = _ds[row];
+          if (field < values.size ())
+            setValue (ctx, values[field].getValue ());
+          else
+            setNull (ctx);
+        }
+
+        const Dataset*
+        dataset () const override
+        {
+          return &_ds;
+        }
+
+      private:
+        const Dataset&                 _ds;
+        std::shared_ptr<const Dataset> _owner;
+      };
+
+      std::string
+      quoted (const std::string& name)
+      {
+        std::string result{"\""};
+        for (const char c : name)
+          {
+            if (c == '"')
+              result += '"';
+            result += c;
+          }
+        return result + '"';
+      }
+
+      const char*
+      declaredType (Type type)
+      {
+        switch (type)
+          {
+          case Type::Int:
+            return " INTEGER";
+          case Type::Real:
+            return " REAL";
+          case Type::Text:
+            return " TEXT";
+          case Type::Blob:
+            return " BLOB";
+          default:
+            return "";
+          }
+      }
+
+      // if the index order matches the sqlite comparison of a value with
+      // a column of the type, without affinity conversion of the value
+      bool
+      comparable (Type type, int valueType)
+      {
+        switch (type)
+          {
+          case Type::Int:
+          case Type::Real:
+            return valueType == SQLITE_INTEGER || valueType == SQLITE_FLOAT;
+          case Type::Text:
+            return valueType == SQLITE_TEXT;
+          case Type::Blob:
+            return valueType == SQLITE_BLOB;
+          default:
+            return true;
+          }
+      }
+    }
+
+    /**
+     * \internal
+     * \brief A module with one eponymous read only table
+     *
+     * Owns the TableSource, and for sources that are no Dataset an
+     * ordered index for each indexed field.
+     * Constraints on a field with an index are passed to xFilter, and
+     * give a range of rows in the index. sqlite checks the constraints
+     * again for each row, so the range can contain more rows, for example
+     * Null values, or all rows if a value needs a type conversion.
+     */
+    class VirtualTable
+    {
+    public:
+      explicit VirtualTable (std::unique_ptr<TableSource> source)
+      : _source (std::move (source))
+      , _names (_source->getNames ())
+      , _types (_source->getTypes ())
+      , _indexed (_source->indexedFields ())
+      {
+        if (_types.size () != _names.size ())
+          _types = Types{std::vector<Type> (_names.size (), Type::Variant)};
+
+        if (_indexed.empty ())
+          return;
+
+        _keys.reset (
+            Types{std::vector<Type> (_indexed.size (), Type::Variant)});
+        for (std::size_t row = 0; row < _source->size (); ++row)
+          {
+            std::vector<DbValue> key;
+            key.reserve (_indexed.size ());
+            for (const auto field : _indexed)
+              key.push_back (_source->key (row, field));
+            _keys.merge (DbValues{std::move (key)});
+          }
+        for (std::size_t i = 0; i < _indexed.size (); ++i)
+          _keys.createIndex ({i}, IndexType::Ordered);
+      }
+
+      static const sqlite3_module*
+      module ()
+      {
+        static const sqlite3_module mod = [] () {
+          sqlite3_module m{};
+          m.iVersion    = 1;
+          m.xCreate     = nullptr; // eponymous only
+          m.xConnect    = &VirtualTable::connect;
+          m.xBestIndex  = &VirtualTable::bestIndex;
+          m.xDisconnect = &VirtualTable::disconnect;
+          m.xDestroy    = &VirtualTable::disconnect;
+          m.xOpen       = &VirtualTable::open;
+          m.xClose      = &VirtualTable::close;
+          m.xFilter     = &VirtualTable::filter;
+          m.xNext       = &VirtualTable::next;
+          m.xEof        = &VirtualTable::eof;
+          m.xColumn     = &VirtualTable::column;
+          m.xRowid      = &VirtualTable::rowid;
+          return m;
+        }();
+        return &mod;
+      }
+
+      static void
+      destroy (void* table)
+      {
+        delete static_cast<VirtualTable*> (table);
+      }
+
+    private:
+      struct Vtab : sqlite3_vtab
+      {
+        VirtualTable* table = nullptr;
+      };
+
+      struct Cursor : sqlite3_vtab_cursor
+      {
+        bool               scan = true;
+        std::size_t        row  = 0;
+        std::size_t        rows = 0;
+        const std::size_t* pos  = nullptr;
+        const std::size_t* end  = nullptr;
+
+        std::size_t
+        current () const
+        {
+          return scan ? row : *pos;
+        }
+      };
+
+      static VirtualTable&
+      tableOf (sqlite3_vtab* vtab)
+      {
+        return *static_cast<Vtab*> (vtab)->table;
+      }
+
+      // the index on a field, nullptr if there is none
+      const RowIndex*
+      findIndex (std::size_t field, IndexType type) const
+      {
+        if (const Dataset* ds = _source->dataset ())
+          return ds->findIndex ({field}, type);
+
+        const auto pos = std::find (_indexed.begin (), _indexed.end (), field);
+        if (pos == _indexed.end () || type != IndexType::Ordered)
+          return nullptr;
+        return _keys.findIndex (
+            {static_cast<std::size_t> (pos - _indexed.begin ())}, type);
+      }
+
+      // false if the rows can not be looked up in an index
+      bool
+      lookup (std::size_t     field,
+              const char*     ops,
+              int             argc,
+              sqlite3_value** argv,
+              RowRange&       rows) const
+      {
+        bool ranges = false;
+        for (int i = 0; i < argc; ++i)
+          {
+            const int valueType = sqlite3_value_type (argv[i]);
+            if (valueType == SQLITE_NULL)
+              {
+                // no comparison with Null is true
+                rows = RowRange{};
+                return true;
+              }
+            if (!comparable (_types[field], valueType))
+              return false;
+            ranges = ranges || ops[i] != 'e';
+          }
+
+        if (!ranges)
+          {
+            if (const RowIndex* hash = findIndex (field, IndexType::Hash))
+              {
+                rows = hash->equalRange (DbValues{toValue (argv[0])});
+                return true;
+              }
+          }
+
+        const RowIndex* ordered = findIndex (field, IndexType::Ordered);
+        if (ordered == nullptr)
+          return false;
+
+        std::size_t first = 0;
+        std::size_t last  = ordered->size ();
+        for (int i = 0; i < argc; ++i)
+          {
+            const DbValues key{toValue (argv[i])};
+            switch (ops[i])
+              {
+              case 'e':
+                first = std::max (first, ordered->lowerBound (key));
+                last  = std::min (last, ordered->upperBound (key));
+                break;
+              case 'g':
+                first = std::max (first, ordered->upperBound (key));
+                break;
+              case 'G':
+                first = std::max (first, ordered->lowerBound (key));
+                break;
+              case 'l':
+                last = std::min (last, ordered->lowerBound (key));
+                break;
+              default: // 'L'
+                last = std::min (last, ordered->upperBound (key));
+                break;
+              }
+          }
+        rows = ordered->slice (first, std::max (first, last));
+        return true;
+      }
+
+      static int
+      connect (sqlite3*           db,
+               void*              aux,
+               int,
+               const char* const*,
+               sqlite3_vtab** vtab,
+               char**         err)
+      {
+        auto& table = *static_cast<VirtualTable*> (aux);
+
+        std::string sql{"CREATE TABLE x("};
+        for (std::size_t i = 0; i < table._names.size (); ++i)
+          {
+            if (i > 0)
+              sql += ", ";
+            sql += quoted (table._names[i]);
+            sql += declaredType (table._types[i]);
+          }
+        sql += ");";
+
+        const int rc = sqlite3_declare_vtab (db, sql.c_str ());
+        if (rc != SQLITE_OK)
+          {
+            *err = sqlite3_mprintf ("%s", sqlite3_errmsg (db));
+            return rc;
+          }
+
+        auto result   = new (std::nothrow) Vtab ();
+        if (result == nullptr)
+          return SQLITE_NOMEM;
+        result->table = &table;
+        *vtab         = result;
+        return SQLITE_OK;
+      }
+
+      static int
+      disconnect (sqlite3_vtab* vtab)
+      {
+        delete static_cast<Vtab*> (vtab);
+        return SQLITE_OK;
+      }
+
+      static int
+      bestIndex (sqlite3_vtab* vtab, sqlite3_index_info* info)
+      {
+        const VirtualTable& table = tableOf (vtab);
+
+        const auto opCode = [] (unsigned char op) -> char {
+          switch (op)
+            {
+            case SQLITE_INDEX_CONSTRAINT_EQ:
+              return 'e';
+            case SQLITE_INDEX_CONSTRAINT_GT:
+              return 'g';
+            case SQLITE_INDEX_CONSTRAINT_GE:
+              return 'G';
+            case SQLITE_INDEX_CONSTRAINT_LT:
+              return 'l';
+            case SQLITE_INDEX_CONSTRAINT_LE:
+              return 'L';
+            default:
+              return 0;
+            }
+        };
+
+        // the indexes compare text bytewise, like the BINARY collation,
+        // rows an index skips are never checked again by sqlite
+        const auto binary = [&table, info] (int i) {
+          const auto field
+              = static_cast<std::size_t> (info->aConstraint[i].iColumn);
+          const Type type = table._types[field];
+          return type == Type::Int || type == Type::Real
+                 || sqlite3_stricmp (sqlite3_vtab_collation (info, i),
+                                     "BINARY")
+                        == 0;
+        };
+
+        // prefer an equality constraint, then a range
+        int  chosen = -1;
+        bool equal  = false;
+        for (int i = 0; i < info->nConstraint; ++i)
+          {
+            const auto& constraint = info->aConstraint[i];
+            const char  op         = opCode (constraint.op);
+            if (!constraint.usable || constraint.iColumn < 0 || op == 0
+                || !binary (i))
+              continue;
+
+            const auto field = static_cast<std::size_t> (constraint.iColumn);
+            if (op == 'e' && !equal
+                && (table.findIndex (field, IndexType::Hash)
+                    || table.findIndex (field, IndexType::Ordered)))
+              {
+                chosen = constraint.iColumn;
+                equal  = true;
+              }
+            else if (chosen < 0
+                     && table.findIndex (field, IndexType::Ordered))
+              {
+                chosen = constraint.iColumn;
+              }
+          }
+
+        const double rows
+            = std::max (1.0, static_cast<double> (table._source->size ()));
+        if (chosen < 0)
+          {
+            info->idxNum         = 0;
+            info->estimatedCost  = rows;
+            info->estimatedRows  = static_cast<sqlite3_int64> (rows);
+            return SQLITE_OK;
+          }
+
+        const bool ordered
+            = table.findIndex (static_cast<std::size_t> (chosen),
+                               IndexType::Ordered)
+              != nullptr;
+        std::string ops;
+        for (int i = 0; i < info->nConstraint; ++i)
+          {
+            const auto& constraint = info->aConstraint[i];
+            const char  op         = opCode (constraint.op);
+            if (!constraint.usable || constraint.iColumn != chosen || op == 0
+                || (op != 'e' && !ordered) || !binary (i))
+              continue;
+
+            ops += op;
+            info->aConstraintUsage[i].argvIndex
+                = static_cast<int> (ops.size ());
+          }
+
+        info->idxNum           = chosen + 1;
+        info->idxStr           = sqlite3_mprintf ("%s", ops.c_str ());
+        info->needToFreeIdxStr = 1;
+        if (info->idxStr == nullptr)
+          return SQLITE_NOMEM;
+
+        const double lookupCost = std::log2 (rows) + 1.0;
+        info->estimatedCost     = equal ? lookupCost : lookupCost + rows / 4;
+        info->estimatedRows
+            = equal ? 1 : static_cast<sqlite3_int64> (rows / 4) + 1;
+        return SQLITE_OK;
+      }
+
+      static int
+      open (sqlite3_vtab*, sqlite3_vtab_cursor** cursor)
+      {
+        auto result = new (std::nothrow) Cursor ();
+        if (result == nullptr)
+          return SQLITE_NOMEM;
+        *cursor = result;
+        return SQLITE_OK;
+      }
+
+      static int
+      close (sqlite3_vtab_cursor* cursor)
+      {
+        delete static_cast<Cursor*> (cursor);
+        return SQLITE_OK;
+      }
+
+      static int
+      filter (sqlite3_vtab_cursor* base,
+              int                  idxNum,
+              const char*          idxStr,
+              int                  argc,
+              sqlite3_value**      argv)
+      {
+        auto&               cursor = *static_cast<Cursor*> (base);
+        const VirtualTable& table  = tableOf (base->pVtab);
+
+        cursor.scan = true;
+        cursor.row  = 0;
+        cursor.rows = table._source->size ();
+        if (idxNum <= 0 || idxStr == nullptr)
+          return SQLITE_OK;
+
+        try
+          {
+            RowRange rows;
+            if (table.lookup (static_cast<std::size_t> (idxNum - 1),
+                              idxStr,
+                              argc,
+                              argv,
+                              rows))
+              {
+                cursor.scan = false;
+                cursor.pos  = rows.begin ();
+                cursor.end  = rows.end ();
+              }
+          }
+        catch (const std::exception& e)
+          {
+            sqlite3_free (base->pVtab->zErrMsg);
+            base->pVtab->zErrMsg = sqlite3_mprintf ("%s", e.what ());
+            return SQLITE_ERROR;
+          }
+        return SQLITE_OK;
+      }
+
+      static int
+      next (sqlite3_vtab_cursor* base)
+      {
+        auto& cursor = *static_cast<Cursor*> (base);
+        if (cursor.scan)
+          ++cursor.row;
+        else
+          ++cursor.pos;
+        return SQLITE_OK;
+      }
+
+      static int
+      eof (sqlite3_vtab_cursor* base)
+      {
+        const auto& cursor = *static_cast<Cursor*> (base);
+        return cursor.scan ? cursor.row >= cursor.rows
+                           : cursor.pos == cursor.end;
+      }
+
+      static int
+      column (sqlite3_vtab_cursor* base, sqlite3_context* ctx, int field)
+      {
+        const auto& cursor = *static_cast<Cursor*> (base);
+        try
+          {
+            tableOf (base->pVtab)
+                ._source->result (
+                    ctx, cursor.current (), static_cast<std::size_t> (field));
+          }
+        catch (const std::exception& e)
+          {
+            sqlite3_result_error (ctx, e.what (), -1);
+            return SQLITE_ERROR;
+          }
+        return SQLITE_OK;
+      }
+
+      static int
+      rowid (sqlite3_vtab_cursor* base, sqlite3_int64* id)
+      {
+        *id = static_cast<sqlite3_int64> (
+            static_cast<Cursor*> (base)->current ());
+        return SQLITE_OK;
+      }
+
+      std::unique_ptr<TableSource> _source;
+      std::vector<std::string>     _names;
+      Types                        _types;
+      std::vector<std::size_t>     _indexed;
+      Dataset                      _keys;
+    };
+  }
+
+  void
+  Database::createVirtualTable (const std::string& name, const Dataset& ds)
+  {
+    registerTable (name,
+                   std::make_unique<internal::DatasetSource> (ds, nullptr));
+  }
+
+  void
+  Database::createVirtualTable (const std::string&             name,
+                                std::shared_ptr<const Dataset> ds)
+  {
+    if (!ds)
+      throw ErrUnexpected ("no Dataset for virtual table " + name);
+
+    const Dataset& data = *ds;
+    registerTable (name,
+                   std::make_unique<internal::DatasetSource> (data,
+                                                              std::move (ds)));
+  }
+
+  void
+  Database::registerTable (const std::string&                     name,
+                           std::unique_ptr<internal::TableSource> source)
+  {
+    _connection->ensureValid ();
+
+    using internal::VirtualTable;
+    auto table = std::make_unique<VirtualTable> (std::move (source));
+
+    // sqlite calls destroy also if this fails
+    const auto rc = sqlite3_create_module_v2 (_connection->db (),
+                                              name.c_str (),
+                                              VirtualTable::module (),
+                                              table.release (),
+                                              &VirtualTable::destroy);
+    if (rc != SQLITE_OK)
+      throw SQLite3Error{rc, sqlite3_errmsg (_connection->db ())};
+  }
+}
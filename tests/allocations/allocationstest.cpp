@@ -0,0 +1,273 @@
+#include "../testing.hpp"
+#include "alloccounter.hpp"
+
+#include <sl3/database.hpp>
+
+#include <cstddef>
+#include <memory>
+#include <string>
+
+namespace
+{
+  // upper bound for the re-allocations of a growing std::vector of n elements
+  std::size_t
+  growthBudget (std::size_t n)
+  {
+    std::size_t steps = 1;
+    while (n > 1)
+      {
+        n /= 2;
+        ++steps;
+      }
+    return steps;
+  }
+}
+
+SCENARIO ("the allocation counter counts the allocations of this thread")
+{
+  using sl3test::AllocationScope;
+
+  GIVEN ("an allocation scope")
+  {
+    WHEN ("allocating memory")
+    {
+      AllocationScope scope;
+      auto            p     = std::make_unique<std::size_t[]> (4);
+      const auto      calls = scope.calls ();
+      const auto      bytes = scope.bytes ();
+      scope.restart ();
+      const auto restartedCalls = scope.calls ();
+      const auto restartedBytes = scope.bytes ();
+
+      THEN ("calls and bytes are counted")
+      {
+        CHECK_EQ (calls, 1u);
+        CHECK_GE (bytes, 4 * sizeof (std::size_t));
+      }
+      AND_THEN ("a restart sets the counters back to zero")
+      {
+        CHECK_EQ (restartedCalls, 0u);
+        CHECK_EQ (restartedBytes, 0u);
+      }
+    }
+  }
+}
+
+SCENARIO ("allocation budget of reading rows via Columns")
+{
+  using namespace sl3;
+  using sl3test::AllocationScope;
+
+  GIVEN ("a database with integer, real and text data")
+  {
+    Database db{":memory:"};
+    db.execute ("CREATE TABLE t (a INTEGER, b INTEGER, c INTEGER, d REAL);"
+                "INSERT INTO t VALUES (1, 2, 3, 4.5);");
+
+    const std::string longText (64, 'x');
+
+    WHEN ("reading an integer and real only row")
+    {
+      std::size_t calls      = 99;
+      std::size_t typedCalls = 99;
+      db.execute ("SELECT * FROM t;", [&] (Columns cols) {
+        AllocationScope scope;
+        auto            row = cols.getRow ();
+        calls               = scope.calls ();
+
+        const Types types{Type::Int, Type::Int, Type::Int, Type::Real};
+        scope.restart ();
+        auto typedRow = cols.getRow (types);
+        typedCalls    = scope.calls ();
+        return true;
+      });
+
+      THEN ("the row allocates at most once")
+      {
+        CHECK_LE (calls, 1u);
+        CHECK_LE (typedCalls, 1u);
+      }
+    }
+
+    WHEN ("reading a row with a long text value")
+    {
+      std::size_t calls = 99;
+      db.execute ("SELECT 1, '" + longText + "';", [&] (Columns cols) {
+        AllocationScope scope;
+        auto            row = cols.getRow ();
+        calls               = scope.calls ();
+        return true;
+      });
+
+      THEN ("only the row and the text allocate")
+      {
+        CHECK_LE (calls, 2u);
+      }
+    }
+
+    WHEN ("reading single values")
+    {
+      std::size_t calls = 99;
+      db.execute ("SELECT * FROM t;", [&] (Columns cols) {
+        AllocationScope scope;
+        auto            a = cols.getValue (0);
+        auto            d = cols.getValue (3, Type::Real);
+        auto            i = cols.getInt64 (1);
+        calls             = scope.calls ();
+        return a.getInt () + i > 0 && d.getReal () > 0;
+      });
+
+      THEN ("numeric values do not allocate")
+      {
+        CHECK_EQ (calls, 0u);
+      }
+    }
+  }
+}
+
+SCENARIO ("allocation budget of binding parameters")
+{
+  using namespace sl3;
+  using sl3test::AllocationScope;
+
+  GIVEN ("a prepared insert command with numeric parameters")
+  {
+    Database db{":memory:"};
+    db.execute ("CREATE TABLE t (a INTEGER, b REAL, c TEXT);");
+
+    auto cmd = db.prepare ("INSERT INTO t VALUES (?, ?, ?);",
+                           {DbValue{Type::Int},
+                            DbValue{Type::Real},
+                            DbValue{Type::Text}});
+
+    const DbValues numeric{
+        DbValue{1}, DbValue{2.5}, DbValue{std::string{"short"}}};
+
+    WHEN ("executing the command with numeric and short text values")
+    {
+      cmd.execute (numeric); // warm up
+      AllocationScope scope;
+      for (int i = 0; i < 10; ++i)
+        cmd.execute (numeric);
+      const auto calls = scope.calls ();
+
+      THEN ("binding and executing does not allocate")
+      {
+        CHECK_EQ (calls, 0u);
+      }
+    }
+
+    WHEN ("executing the command with already set parameters")
+    {
+      cmd.getParameter (0) = 42;
+      cmd.getParameter (1) = 1.5;
+      cmd.getParameter (2) = std::string (64, 'x');
+      cmd.execute (); // warm up
+      AllocationScope scope;
+      for (int i = 0; i < 10; ++i)
+        cmd.execute ();
+      const auto calls = scope.calls ();
+
+      THEN ("binding does not allocate, also not for long text")
+      {
+        CHECK_EQ (calls, 0u);
+      }
+    }
+  }
+}
+
+SCENARIO ("allocation budget of Command::select and Dataset::merge")
+{
+  using namespace sl3;
+  using sl3test::AllocationScope;
+
+  GIVEN ("a table with integer rows")
+  {
+    constexpr std::size_t rowCount = 1000;
+
+    Database db{":memory:"};
+    db.execute ("CREATE TABLE t (a INTEGER, b INTEGER);"
+                "WITH RECURSIVE c(x) AS (SELECT 1 UNION ALL SELECT x+1 FROM c "
+                "LIMIT 1000) INSERT INTO t SELECT x, x * 2 FROM c;");
+
+    auto cmd = db.prepare ("SELECT a, b FROM t;");
+
+    WHEN ("selecting all rows into a Dataset")
+    {
+      AllocationScope scope;
+      auto            ds    = cmd.select ();
+      auto            calls = scope.calls ();
+
+      REQUIRE_EQ (ds.size (), rowCount);
+
+      THEN ("each row allocates once, plus dataset growth and setup")
+      {
+        CHECK_LE (calls, rowCount + growthBudget (rowCount) + 8);
+      }
+    }
+
+    WHEN ("selecting with typed fields")
+    {
+      const Types     types{Type::Int, Type::Int};
+      AllocationScope scope;
+      auto            ds    = cmd.select (types);
+      auto            calls = scope.calls ();
+
+      REQUIRE_EQ (ds.size (), rowCount);
+
+      THEN ("the typed select has the same budget")
+      {
+        CHECK_LE (calls, rowCount + growthBudget (rowCount) + 8);
+      }
+    }
+
+    WHEN ("merging a dataset into an empty one")
+    {
+      const auto source = cmd.select ();
+      Dataset    target{{Type::Variant, Type::Variant}};
+
+      AllocationScope scope;
+      target.merge (source);
+      auto calls = scope.calls ();
+
+      REQUIRE_EQ (target.size (), rowCount);
+
+      THEN ("each merged row allocates once, the container once")
+      {
+        CHECK_LE (calls, rowCount + 1);
+      }
+    }
+
+    WHEN ("move merging datasets")
+    {
+      auto first  = cmd.select ();
+      auto second = cmd.select ();
+      first.reserve (2 * rowCount);
+
+      AllocationScope scope;
+      first.merge (std::move (second));
+      const auto calls = scope.calls ();
+
+      REQUIRE_EQ (first.size (), 2 * rowCount);
+
+      THEN ("no row is copied")
+      {
+        CHECK_EQ (calls, 0u);
+      }
+    }
+
+    WHEN ("merging a single row")
+    {
+      auto            ds  = cmd.select ();
+      const auto      row = ds.at (0);
+      AllocationScope scope;
+      ds.merge (row);
+      const auto calls = scope.calls ();
+
+      THEN ("the row copy allocates once, plus a possible growth")
+      {
+        CHECK_LE (calls, 2u);
+      }
+    }
+  }
+}
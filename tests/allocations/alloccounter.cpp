@@ -0,0 +1,161 @@
+#include "alloccounter.hpp"
+
+#include <cstdlib>
+#include <new>
+
+// Replaces the global allocation functions of the test binary so that
+// every operator new of the calling thread is counted.
+// The library must be linked into the executable (static) or use the
+// process wide operator new (ELF/Mach-O shared libraries) for the counters
+// to see its allocations.
+
+namespace
+{
+  thread_local sl3test::AllocationCount counter;
+
+  void*
+  countedAlloc (std::size_t size) noexcept
+  {
+    counter.calls += 1;
+    counter.bytes += size;
+    return std::malloc (size == 0 ? 1 : size);
+  }
+
+  void*
+  countedAlignedAlloc (std::size_t size, std::size_t alignment) noexcept
+  {
+    counter.calls += 1;
+    counter.bytes += size;
+    // aligned_alloc requires size to be a multiple of alignment
+    const std::size_t rounded
+        = ((size == 0 ? 1 : size) + alignment - 1) / alignment * alignment;
+#ifdef _MSC_VER
+    return _aligned_malloc (rounded, alignment);
+#else
+    return std::aligned_alloc (alignment, rounded);
+#endif
+  }
+
+  void
+  alignedFree (void* p) noexcept
+  {
+#ifdef _MSC_VER
+    _aligned_free (p);
+#else
+    std::free (p);
+#endif
+  }
+}
+
+namespace sl3test
+{
+  AllocationCount
+  threadAllocations () noexcept
+  {
+    return counter;
+  }
+}
+
+void*
+operator new (std::size_t size)
+{
+  if (void* p = countedAlloc (size))
+    return p;
+  throw std::bad_alloc{};
+}
+
+void*
+operator new[] (std::size_t size)
+{
+  if (void* p = countedAlloc (size))
+    return p;
+  throw std::bad_alloc{};
+}
+
+void*
+operator new (std::size_t size, const std::nothrow_t&) noexcept
+{
+  return countedAlloc (size);
+}
+
+void*
+operator new[] (std::size_t size, const std::nothrow_t&) noexcept
+{
+  return countedAlloc (size);
+}
+
+void*
+operator new (std::size_t size, std::align_val_t al)
+{
+  if (void* p = countedAlignedAlloc (size, static_cast<std::size_t> (al)))
+    return p;
+  throw std::bad_alloc{};
+}
+
+void*
+operator new[] (std::size_t size, std::align_val_t al)
+{
+  if (void* p = countedAlignedAlloc (size, static_cast<std::size_t> (al)))
+    return p;
+  throw std::bad_alloc{};
+}
+
+void
+operator delete (void* p) noexcept
+{
+  std::free (p);
+}
+
+void
+operator delete[] (void* p) noexcept
+{
+  std::free (p);
+}
+
+void
+operator delete (void* p, std::size_t) noexcept
+{
+  std::free (p);
+}
+
+void
+operator delete[] (void* p, std::size_t) noexcept
+{
+  std::free (p);
+}
+
+void
+operator delete (void* p, const std::nothrow_t&) noexcept
+{
+  std::free (p);
+}
+
+void
+operator delete[] (void* p, const std::nothrow_t&) noexcept
+{
+  std::free (p);
+}
+
+void
+operator delete (void* p, std::align_val_t) noexcept
+{
+  alignedFree (p);
+}
+
+void
+operator delete[] (void* p, std::align_val_t) noexcept
+{
+  alignedFree (p);
+}
+
+void
+operator delete (void* p, std::size_t, std::align_val_t) noexcept
+{
+  alignedFree (p);
+}
+
+void
+operator delete[] (void* p, std::size_t, std::align_val_t) noexcept
+{
+  alignedFree (p);
+}
@@ -0,0 +1,66 @@
+#pragma once
+
+#include <cstddef>
+
+namespace sl3test
+{
+  /**
+   * \brief Number of operator new calls and requested bytes.
+   */
+  struct AllocationCount
+  {
+    std::size_t calls{0};
+    std::size_t bytes{0};
+  };
+
+  /**
+   * \brief Allocations done so far by the calling thread.
+   *
+   * Counts every global operator new / new[] variant that is called
+   * by the current thread since the thread started.
+   */
+  AllocationCount threadAllocations () noexcept;
+
+  /**
+   * \brief Measure the allocations of the current thread within a scope.
+   *
+   * \code
+   *  AllocationScope scope;
+   *  auto row = cols.getRow ();
+   *  CHECK (scope.calls () <= 1);
+   * \endcode
+   */
+  class AllocationScope
+  {
+  public:
+    AllocationScope () noexcept
+    : _start (threadAllocations ())
+    {
+    }
+
+    /// operator new calls since construction or the last restart
+    std::size_t
+    calls () const noexcept
+    {
+      return threadAllocations ().calls - _start.calls;
+    }
+
+    /// bytes requested since construction or the last restart
+    std::size_t
+    bytes () const noexcept
+    {
+      return threadAllocations ().bytes - _start.bytes;
+    }
+
+    /// start counting from zero again
+    void
+    restart () noexcept
+    {
+      _start = threadAllocations ();
+    }
+
+  private:
+    AllocationCount _start;
+  };
+
+}
@@ -0,0 +1,132 @@
+#include "../testing.hpp"
+
+#include <sl3/database.hpp>
+
+#include <string>
+#include <string_view>
+#include <vector>
+
+SCENARIO ("binding lists as table valued parameter")
+{
+  using namespace sl3;
+
+  GIVEN ("a table with 100 rows and a prepared IN list query")
+  {
+    Database db{":memory:"};
+    db.execute ("CREATE TABLE t (id INTEGER PRIMARY KEY, name TEXT,"
+                " price REAL);"
+                "WITH RECURSIVE n(i) AS (SELECT 1 UNION ALL"
+                " SELECT i + 1 FROM n WHERE i < 100)"
+                " INSERT INTO t SELECT i, 'n' || i, i * 0.5 FROM n;");
+
+    auto cmd = db.prepare ("SELECT count(*), sum(id) FROM t"
+                           " WHERE id IN sl3_array (?);");
+
+    WHEN ("binding integer lists of different sizes")
+    {
+      THEN ("the same statement returns the matching rows")
+      {
+        std::vector<int64_t> ids{3, 5, 7};
+        cmd.bindArray (0, ids);
+        auto res = cmd.select ();
+        CHECK_EQ (res[0][0].getInt (), 3);
+        CHECK_EQ (res[0][1].getInt (), 15);
+
+        std::vector<int64_t> many;
+        for (int64_t i = 1; i <= 2000; ++i)
+          many.push_back (i);
+        cmd.bindArray (0, many);
+        res = cmd.select ();
+        CHECK_EQ (res[0][0].getInt (), 100);
+        CHECK_EQ (res[0][1].getInt (), 5050);
+
+        std::vector<int64_t> none;
+        cmd.bindArray (0, none);
+        res = cmd.select ();
+        CHECK_EQ (res[0][0].getInt (), 0);
+      }
+    }
+
+    WHEN ("binding reals and texts")
+    {
+      THEN ("they are compared like other values")
+      {
+        auto byPrice = db.prepare ("SELECT id FROM t"
+                                   " WHERE price IN sl3_array (?)"
+                                   " ORDER BY id;");
+        std::vector<double> prices{0.5, 2.0};
+        byPrice.bindArray (0, ArrayParameter{prices.data (), prices.size ()});
+        auto res = byPrice.select ();
+        REQUIRE_EQ (res.size (), 2);
+        CHECK_EQ (res[0][0].getInt (), 1);
+        CHECK_EQ (res[1][0].getInt (), 4);
+
+        auto byName = db.prepare ("SELECT id FROM t"
+                                  " WHERE name IN sl3_array (?)"
+                                  " ORDER BY id;");
+        std::vector<std::string> names{"n10", "n20", "nope"};
+        byName.bindArray (0, names);
+        res = byName.select ();
+        REQUIRE_EQ (res.size (), 2);
+        CHECK_EQ (res[0][0].getInt (), 10);
+        CHECK_EQ (res[1][0].getInt (), 20);
+
+        const std::string text = "n30n40";
+        byName.bindArray (0,
+                          std::vector<std::string_view>{
+                              std::string_view{text}.substr (0, 3),
+                              std::string_view{text}.substr (3)});
+        res = byName.select ();
+        REQUIRE_EQ (res.size (), 2);
+        CHECK_EQ (res[1][0].getInt (), 40);
+      }
+    }
+
+    WHEN ("selecting from the function")
+    {
+      THEN ("the list is a table with a value column")
+      {
+        std::vector<int64_t> ids{4, 2};
+        auto list = db.prepare ("SELECT value FROM sl3_array (?);");
+        list.bindArray (0, ids);
+        auto res = list.select ();
+        REQUIRE_EQ (res.size (), 2);
+        CHECK_EQ (res[0][0].getInt (), 4);
+        CHECK_EQ (res[1][0].getInt (), 2);
+      }
+    }
+
+    WHEN ("the list is cleared or no list is bound")
+    {
+      THEN ("the parameter value gives no rows")
+      {
+        std::vector<int64_t> ids{1};
+        cmd.bindArray (0, ids);
+        cmd.clearArrays ();
+        auto res = cmd.select ({DbValue{int64_t{1}}});
+        CHECK_EQ (res[0][0].getInt (), 0);
+      }
+    }
+
+    WHEN ("binding to an invalid parameter index")
+    {
+      THEN ("this throws")
+      {
+        std::vector<int64_t> ids{1};
+        CHECK_THROWS_AS (cmd.bindArray (1, ids), ErrOutOfRange);
+        CHECK_THROWS_AS (cmd.bindArray (-1, ids), ErrOutOfRange);
+      }
+    }
+
+    WHEN ("the command is moved")
+    {
+      THEN ("the bound list moves with it")
+      {
+        std::vector<int64_t> ids{1, 2};
+        cmd.bindArray (0, ids);
+        Command moved{std::move (cmd)};
+        CHECK_EQ (moved.select ()[0][0].getInt (), 2);
+      }
+    }
+  }
+}
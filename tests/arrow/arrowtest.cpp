@@ -0,0 +1,389 @@
+#include "../testing.hpp"
+
+#include <sl3/arrow.hpp>
+#include <sl3/database.hpp>
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+
+namespace
+{
+  // owns exported batches, as an Arrow consumer would
+  struct Batches
+  {
+    std::vector<ArrowSchema> schemas;
+    std::vector<ArrowArray>  arrays;
+    bool                     more = true;
+
+    Batches ()               = default;
+    Batches (const Batches&) = delete;
+    ~Batches ()
+    {
+      for (auto& s : schemas)
+        if (s.release)
+          s.release (&s);
+      for (auto& a : arrays)
+        if (a.release)
+          a.release (&a);
+    }
+
+    sl3::ArrowBatchCallback
+    callback ()
+    {
+      schemas.reserve (16);
+      arrays.reserve (16);
+      return [this] (ArrowSchema* schema, ArrowArray* batch) {
+        schemas.push_back (*schema); // move, mark the source released
+        schema->release = nullptr;
+        arrays.push_back (*batch);
+        batch->release = nullptr;
+        return more;
+      };
+    }
+  };
+
+  const ArrowArray&
+  column (const ArrowArray& batch, std::size_t idx)
+  {
+    return *batch.children[idx];
+  }
+
+  bool
+  isNull (const ArrowArray& col, int64_t row)
+  {
+    const auto* bits = static_cast<const unsigned char*> (col.buffers[0]);
+    return bits && !((bits[row / 8] >> (row % 8)) & 1);
+  }
+
+  int64_t
+  intAt (const ArrowArray& col, int64_t row)
+  {
+    return static_cast<const int64_t*> (col.buffers[1])[row];
+  }
+
+  std::string
+  bytesAt (const ArrowArray& col, int64_t row)
+  {
+    const auto* offsets = static_cast<const int32_t*> (col.buffers[1]);
+    const auto* data    = static_cast<const char*> (col.buffers[2]);
+    return std::string (data + offsets[row],
+                        static_cast<std::size_t> (offsets[row + 1]
+                                                  - offsets[row]));
+  }
+}
+
+SCENARIO ("exporting query results as Arrow record batches")
+{
+  using namespace sl3;
+
+  GIVEN ("a table with typed columns and Null values")
+  {
+    Database db{":memory:"};
+    db.execute ("CREATE TABLE t (i INTEGER, r REAL, s TEXT, b BLOB);"
+                "INSERT INTO t VALUES (1, 1.5, 'one', x'01');"
+                "INSERT INTO t VALUES (NULL, 2.5, '', x'');"
+                "INSERT INTO t VALUES (3, NULL, 'three', NULL);"
+                "INSERT INTO t VALUES (4, 4.5, NULL, x'0405');"
+                "INSERT INTO t VALUES (5, 5.5, 'five', x'05');");
+
+    WHEN ("exporting with a batch size of 2")
+    {
+      Batches       batches;
+      ArrowExporter arrow{batches.callback (), 2};
+      db.execute ("SELECT * FROM t ORDER BY rowid;", arrow);
+
+      THEN ("there are 3 batches with the declared column types")
+      {
+        CHECK_EQ (arrow.batches (), 3u);
+        CHECK_EQ (arrow.rows (), 5u);
+        REQUIRE_EQ (batches.arrays.size (), 3u);
+        CHECK_EQ (batches.arrays[0].length, 2);
+        CHECK_EQ (batches.arrays[2].length, 1);
+
+        const ArrowSchema& schema = batches.schemas[0];
+        CHECK_EQ (std::string{schema.format}, "+s");
+        REQUIRE_EQ (schema.n_children, 4);
+        CHECK_EQ (std::string{schema.children[0]->format}, "l");
+        CHECK_EQ (std::string{schema.children[1]->format}, "g");
+        CHECK_EQ (std::string{schema.children[2]->format}, "u");
+        CHECK_EQ (std::string{schema.children[3]->format}, "z");
+        CHECK_EQ (std::string{schema.children[2]->name}, "s");
+        CHECK (schema.children[0]->flags & ARROW_FLAG_NULLABLE);
+      }
+
+      AND_THEN ("values and Nulls are in the column buffers")
+      {
+        const ArrowArray& first = batches.arrays[0];
+        CHECK_EQ (column (first, 0).null_count, 1);
+        CHECK_FALSE (isNull (column (first, 0), 0));
+        CHECK (isNull (column (first, 0), 1));
+        CHECK_EQ (intAt (column (first, 0), 0), 1);
+        CHECK_EQ (static_cast<const double*> (column (first, 1).buffers[1])[1],
+                  2.5);
+        CHECK_EQ (bytesAt (column (first, 2), 0), "one");
+        CHECK_EQ (bytesAt (column (first, 2), 1), "");
+        CHECK_FALSE (isNull (column (first, 3), 1));
+        CHECK_EQ (bytesAt (column (first, 3), 1), "");
+
+        const ArrowArray& second = batches.arrays[1];
+        CHECK_EQ (column (second, 0).null_count, 0);
+        CHECK (column (second, 0).buffers[0] == nullptr);
+        CHECK (isNull (column (second, 1), 0));
+        CHECK (isNull (column (second, 2), 1));
+        CHECK_EQ (bytesAt (column (second, 3), 1), std::string{"\x04\x05"});
+      }
+    }
+
+    WHEN ("the callback stops after the first batch")
+    {
+      Batches batches;
+      batches.more = false;
+      ArrowExporter arrow{batches.callback (), 2};
+      db.execute ("SELECT * FROM t;", arrow);
+
+      THEN ("no more rows are read")
+      {
+        CHECK_EQ (arrow.batches (), 1u);
+        CHECK_EQ (arrow.rows (), 2u);
+      }
+    }
+
+    WHEN ("the callback does not take the batches")
+    {
+      std::size_t   calls = 0;
+      ArrowExporter arrow{[&calls] (ArrowSchema*, ArrowArray*) {
+                            ++calls;
+                            return true;
+                          },
+                          3};
+      db.execute ("SELECT * FROM t;", arrow);
+
+      THEN ("the exporter releases them")
+      {
+        CHECK_EQ (calls, 2u);
+      }
+    }
+
+    WHEN ("exporting expressions and given types")
+    {
+      Batches       batches;
+      ArrowExporter arrow{
+          batches.callback (), 10, {Type::Variant, Type::Variant, Type::Real}};
+      db.execute ("SELECT 'x' || i, b, i FROM t WHERE i > 3;", arrow);
+
+      THEN ("types come from the given types or the first value")
+      {
+        REQUIRE_EQ (batches.schemas.size (), 1u);
+        const ArrowSchema& schema = batches.schemas[0];
+        CHECK_EQ (std::string{schema.children[0]->format}, "u");
+        CHECK_EQ (std::string{schema.children[1]->format}, "z");
+        CHECK_EQ (std::string{schema.children[2]->format}, "g");
+        CHECK_EQ (bytesAt (column (batches.arrays[0], 0), 1), "x5");
+      }
+    }
+
+    WHEN ("giving types that do not match the columns")
+    {
+      Batches       batches;
+      ArrowExporter arrow{batches.callback (), 10, {Type::Int}};
+
+      THEN ("the export throws")
+      {
+        CHECK_THROWS_AS (db.execute ("SELECT i, r FROM t;", arrow),
+                         ErrTypeMisMatch);
+      }
+    }
+
+    WHEN ("exporting a Dataset")
+    {
+      auto ds = db.select ("SELECT i, r, s FROM t ORDER BY rowid;",
+                           {Type::Int, Type::Real, Type::Variant});
+
+      Batches     batches;
+      std::size_t rows = exportArrow (ds, batches.callback (), 4);
+
+      THEN ("the batches have the field names and types")
+      {
+        CHECK_EQ (rows, 5u);
+        REQUIRE_EQ (batches.arrays.size (), 2u);
+        CHECK_EQ (std::string{batches.schemas[0].children[0]->name}, "i");
+        CHECK_EQ (std::string{batches.schemas[0].children[1]->format}, "g");
+        CHECK_EQ (std::string{batches.schemas[0].children[2]->format}, "u");
+        CHECK_EQ (intAt (column (batches.arrays[1], 0), 0), 5);
+        CHECK (isNull (column (batches.arrays[0], 2), 3));
+      }
+    }
+  }
+
+  GIVEN ("a Dataset with mixed Variant fields")
+  {
+    Dataset ds{{Type::Variant, Type::Variant}};
+    ds.merge (DbValues{DbValue{1, Type::Variant}, DbValue{1, Type::Variant}});
+    ds.merge (DbValues{DbValue{2.5, Type::Variant},
+                       DbValue{std::string{"x"}, Type::Variant}});
+
+    WHEN ("exporting it")
+    {
+      THEN ("numbers and text do not share a column")
+      {
+        Batches batches;
+        CHECK_THROWS_AS (exportArrow (ds, batches.callback ()),
+                         ErrTypeMisMatch);
+      }
+    }
+  }
+
+  GIVEN ("an untyped Dataset with rows of different sizes")
+  {
+    Dataset ds;
+    ds.merge (DbValues{DbValue{1}, DbValue{2}, DbValue{3}});
+    ds.merge (DbValues{DbValue{4}});
+
+    THEN ("exporting it throws")
+    {
+      Batches batches;
+      CHECK_THROWS_AS (exportArrow (ds, batches.callback ()),
+                       ErrTypeMisMatch);
+      CHECK (batches.arrays.empty ());
+    }
+  }
+}
+
+SCENARIO ("inserting Arrow record batches")
+{
+  using namespace sl3;
+
+  GIVEN ("a source table exported as Arrow batches and an empty copy")
+  {
+    Database db{":memory:"};
+    db.execute ("CREATE TABLE src (i INTEGER, r REAL, s TEXT, b BLOB);"
+                "INSERT INTO src VALUES (1, 1.5, 'one', x'01');"
+                "INSERT INTO src VALUES (NULL, 2.5, '', x'');"
+                "INSERT INTO src VALUES (3, NULL, 'three', NULL);"
+                "CREATE TABLE dst (i INTEGER, r REAL, s TEXT, b BLOB);");
+
+    Batches       batches;
+    ArrowExporter arrow{batches.callback (), 2};
+    db.execute ("SELECT * FROM src ORDER BY rowid;", arrow);
+    REQUIRE_EQ (batches.arrays.size (), 2u);
+
+    WHEN ("inserting all batches via a prepared command")
+    {
+      auto          cmd = db.prepare ("INSERT INTO dst VALUES (?, ?, ?, ?);");
+      ArrowImporter importer{cmd, &batches.schemas[0]};
+
+      std::size_t rows = 0;
+      for (const auto& batch : batches.arrays)
+        rows += importer.insert (&batch);
+
+      THEN ("the copy has the same values, types and Nulls")
+      {
+        CHECK_EQ (rows, 3u);
+        const auto same = db.selectValue (
+            "SELECT count(*) FROM src JOIN dst ON "
+            "src.i IS dst.i AND src.r IS dst.r AND src.s IS dst.s AND "
+            "src.b IS dst.b AND typeof(src.b) = typeof(dst.b);");
+        CHECK_EQ (same.getInt (), 3);
+      }
+    }
+
+    WHEN ("the command has not as many parameters as the schema columns")
+    {
+      auto cmd = db.prepare ("INSERT INTO dst (i) VALUES (?);");
+
+      THEN ("creating the importer throws")
+      {
+        CHECK_THROWS_AS (ArrowImporter (cmd, &batches.schemas[0]),
+                         ErrTypeMisMatch);
+      }
+    }
+  }
+
+  GIVEN ("a hand made batch with an offset, int32, bool and uint64 columns")
+  {
+    Database db{":memory:"};
+    db.execute ("CREATE TABLE t (a, b, c);");
+
+    const int32_t       ints[]  = {10, 20, 30, 40};
+    const unsigned char valid[] = {0x0B}; // row 2 is Null
+    const unsigned char bools[] = {0x02};
+    uint64_t            big[]   = {1, 2, 3, 4};
+
+    const void* intBufs[]  = {valid, ints};
+    const void* boolBufs[] = {nullptr, bools};
+    const void* bigBufs[]  = {nullptr, big};
+
+    ArrowArray cols[3]{};
+    cols[0].length = 4, cols[0].null_count = 1, cols[0].n_buffers = 2;
+    cols[0].buffers = intBufs;
+    cols[1].length = 4, cols[1].n_buffers = 2, cols[1].buffers = boolBufs;
+    cols[2].length = 4, cols[2].n_buffers = 2, cols[2].buffers = bigBufs;
+
+    ArrowArray* children[] = {&cols[0], &cols[1], &cols[2]};
+    ArrowArray  batch{};
+    batch.length     = 3;
+    batch.offset     = 1;
+    batch.n_buffers  = 1;
+    batch.n_children = 3;
+    batch.children   = children;
+    batch.release    = [] (ArrowArray* a) { a->release = nullptr; };
+
+    ArrowSchema  colSchemas[3]{};
+    const char*  formats[] = {"i", "b", "L"};
+    ArrowSchema* schemaChildren[3];
+    for (int i = 0; i < 3; ++i)
+      {
+        colSchemas[i].format = formats[i];
+        schemaChildren[i]    = &colSchemas[i];
+      }
+    ArrowSchema schema{};
+    schema.format     = "+s";
+    schema.n_children = 3;
+    schema.children   = schemaChildren;
+    schema.release    = [] (ArrowSchema* s) { s->release = nullptr; };
+
+    auto          cmd = db.prepare ("INSERT INTO t VALUES (?, ?, ?);");
+    ArrowImporter importer{cmd, &schema};
+
+    WHEN ("inserting the batch")
+    {
+      const auto rows = importer.insert (&batch);
+
+      THEN ("rows start at the offset and Nulls are kept")
+      {
+        CHECK_EQ (rows, 3u);
+        auto ds = db.select ("SELECT a, b, c FROM t ORDER BY rowid;");
+        REQUIRE_EQ (ds.size (), 3u);
+        CHECK_EQ (ds[0][0].getInt (), 20);
+        CHECK_EQ (ds[0][1].getInt (), 1);
+        CHECK (ds[1][0].isNull ());
+        CHECK_EQ (ds[1][1].getInt (), 0);
+        CHECK_EQ (ds[2][0].getInt (), 40);
+        CHECK_EQ (ds[2][2].getInt (), 4);
+      }
+    }
+
+    WHEN ("an unsigned value does not fit into int64_t")
+    {
+      big[2] = uint64_t{1} << 63;
+
+      THEN ("inserting throws")
+      {
+        CHECK_THROWS_AS (importer.insert (&batch), ErrOutOfRange);
+      }
+    }
+
+    WHEN ("the schema has an unsupported format")
+    {
+      formats[2] = "+l";
+      colSchemas[2].format = formats[2];
+
+      THEN ("creating an importer throws")
+      {
+        CHECK_THROWS_AS (ArrowImporter (cmd, &schema), ErrTypeMisMatch);
+      }
+    }
+  }
+}
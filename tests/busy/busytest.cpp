@@ -0,0 +1,178 @@
+#include "../testing.hpp"
+
+#include <sl3/database.hpp>
+
+#include <sqlite3.h>
+
+#include <chrono>
+#include <stdexcept>
+#include <string>
+#include <thread>
+
+namespace
+{
+  int
+  busyCode (sl3::Database& db, const std::string& sql)
+  {
+    try
+      {
+        db.execute (sql);
+      }
+    catch (const sl3::SQLite3Error& e)
+      {
+        return e.SQLiteErrorCode () & 0xff;
+      }
+    return SQLITE_OK;
+  }
+}
+
+SCENARIO ("busy policies")
+{
+  using namespace sl3;
+  using std::chrono::milliseconds;
+
+  GIVEN ("a database locked by another connection")
+  {
+    TempFile file{"sl3busytest.db"};
+    Database holder{file.path};
+    holder.execute ("CREATE TABLE t (x);");
+    Database db{file.path};
+
+    holder.execute ("BEGIN IMMEDIATE;");
+    const std::string insert = "INSERT INTO t VALUES (1);";
+
+    THEN ("by default writes fail immediately")
+    {
+      CHECK_EQ (busyCode (db, insert), SQLITE_BUSY);
+      CHECK_EQ (db.busyStats ().contentions, 0);
+    }
+
+    WHEN ("setting the default policy")
+    {
+      db.setBusyPolicy (BusyPolicy{});
+
+      THEN ("writes fail immediately and are counted")
+      {
+        CHECK_EQ (busyCode (db, insert), SQLITE_BUSY);
+        const auto stats = db.busyStats ();
+        CHECK_EQ (stats.contentions, 1);
+        CHECK_EQ (stats.retries, 0);
+        CHECK_EQ (stats.failures, 1);
+      }
+    }
+
+    WHEN ("using a timeout")
+    {
+      db.setBusyPolicy (BusyPolicy::timeout (milliseconds{50}));
+
+      THEN ("writes fail after the timeout")
+      {
+        CHECK_EQ (busyCode (db, insert), SQLITE_BUSY);
+        const auto stats = db.busyStats ();
+        CHECK_EQ (stats.contentions, 1);
+        CHECK (stats.retries > 1);
+        CHECK_EQ (stats.failures, 1);
+        CHECK (stats.waited >= milliseconds{50});
+      }
+
+      THEN ("reset sets the counters to zero")
+      {
+        CHECK_EQ (busyCode (db, insert), SQLITE_BUSY);
+        db.resetBusyStats ();
+        CHECK_EQ (db.busyStats ().contentions, 0);
+        CHECK_EQ (db.busyStats ().waited.count (), 0);
+      }
+    }
+
+    WHEN ("using backoff and the lock is released while waiting")
+    {
+      db.setBusyPolicy (
+          BusyPolicy::backoff (std::chrono::seconds{10}, milliseconds{1}));
+
+      std::thread releaser{[&holder] {
+        std::this_thread::sleep_for (milliseconds{30});
+        holder.execute ("COMMIT;");
+      }};
+      const int rc = busyCode (db, insert);
+      releaser.join ();
+
+      THEN ("the write succeeds after retries")
+      {
+        CHECK_EQ (rc, SQLITE_OK);
+        const auto stats = db.busyStats ();
+        CHECK_EQ (stats.contentions, 1);
+        CHECK (stats.retries > 0);
+        CHECK_EQ (stats.failures, 0);
+        CHECK (stats.waited >= milliseconds{25});
+      }
+    }
+
+    WHEN ("using a custom handler")
+    {
+      int calls = 0;
+      db.setBusyPolicy (BusyPolicy::custom ([&calls] (int retries) {
+        ++calls;
+        return retries < 3;
+      }));
+
+      THEN ("it decides about the retries")
+      {
+        CHECK_EQ (busyCode (db, insert), SQLITE_BUSY);
+        CHECK_EQ (calls, 4);
+        CHECK_EQ (db.busyStats ().retries, 3);
+        CHECK_EQ (db.busyStats ().failures, 1);
+      }
+
+      THEN ("it applies to transactions")
+      {
+        auto transaction = db.beginTransaction ();
+        CHECK_EQ (busyCode (db, insert), SQLITE_BUSY);
+        CHECK_EQ (calls, 4);
+      }
+    }
+
+    WHEN ("a custom handler throws")
+    {
+      db.setBusyPolicy (BusyPolicy::custom ([] (int) -> bool {
+        throw std::runtime_error{"no"};
+      }));
+
+      THEN ("the lock attempt is given up")
+      {
+        CHECK_EQ (busyCode (db, insert), SQLITE_BUSY);
+        CHECK_EQ (db.busyStats ().failures, 1);
+      }
+    }
+  }
+
+  GIVEN ("invalid policy arguments")
+  {
+    THEN ("creating the policy throws")
+    {
+      CHECK_THROWS_AS (BusyPolicy::timeout (milliseconds{-1}), ErrOutOfRange);
+      CHECK_THROWS_AS (BusyPolicy::backoff (milliseconds{1}, milliseconds{0}),
+                       ErrOutOfRange);
+      CHECK_THROWS_AS (BusyPolicy::backoff (
+                           milliseconds{1}, milliseconds{2}, milliseconds{1}),
+                       ErrOutOfRange);
+      CHECK_THROWS_AS (BusyPolicy::backoff (milliseconds{1},
+                                            milliseconds{1},
+                                            milliseconds{1},
+                                            1.5),
+                       ErrOutOfRange);
+      CHECK_THROWS_AS (BusyPolicy::custom (BusyHandler{}), ErrOutOfRange);
+    }
+  }
+
+  GIVEN ("a closed database")
+  {
+    Database db{":memory:"};
+    Database moved{std::move (db)};
+
+    THEN ("setting a policy throws")
+    {
+      CHECK_THROWS_AS (db.setBusyPolicy (BusyPolicy{}), ErrNoConnection);
+      CHECK_THROWS_AS (db.busyStats (), ErrNoConnection);
+    }
+  }
+}
@@ -0,0 +1,159 @@
+#include "../testing.hpp"
+
+#include <sl3/database.hpp>
+
+#include <chrono>
+#include <string>
+#include <thread>
+
+namespace
+{
+  // never returns a row, counts forever
+  const std::string endless
+      = "WITH RECURSIVE c(x) AS (SELECT 1 UNION ALL SELECT x + 1 FROM c)"
+        " SELECT count(*) FROM c;";
+
+  std::string
+  messageOf (sl3::Database& db, const std::string& sql)
+  {
+    try
+      {
+        db.execute (sql, [] (sl3::Columns) { return true; });
+      }
+    catch (const sl3::ErrInterrupted& e)
+      {
+        return e.what ();
+      }
+    return "";
+  }
+}
+
+SCENARIO ("deadlines and cancellation of statements")
+{
+  using namespace sl3;
+  using std::chrono::milliseconds;
+  using std::chrono::steady_clock;
+
+  GIVEN ("a database")
+  {
+    Database db{":memory:"};
+
+    WHEN ("a statement runs into a deadline")
+    {
+      auto       limit = db.limitExecution (milliseconds{50});
+      const auto start = steady_clock::now ();
+
+      THEN ("it is interrupted before it produced a row")
+      {
+        CHECK_EQ (messageOf (db, endless), "deadline exceeded");
+        CHECK (steady_clock::now () - start >= milliseconds{50});
+      }
+
+      THEN ("execute without callback is interrupted too")
+      {
+        CHECK_THROWS_AS (db.execute (endless), ErrInterrupted);
+      }
+    }
+
+    WHEN ("a token is cancelled from another thread")
+    {
+      CancellationToken token;
+      auto              limit = db.limitExecution (token, 100000);
+
+      std::thread canceller{[token] () mutable {
+        std::this_thread::sleep_for (milliseconds{20});
+        token.cancel ();
+      }};
+      const auto message = messageOf (db, endless);
+      canceller.join ();
+
+      THEN ("the running statement is interrupted")
+      {
+        CHECK (token.isCancelled ());
+        CHECK_EQ (message, "cancelled");
+      }
+
+      THEN ("later statements are interrupted as well")
+      {
+        CHECK_EQ (messageOf (db, endless), "cancelled");
+      }
+    }
+
+    WHEN ("limits are nested")
+    {
+      CancellationToken token;
+      auto              outer = db.limitExecution (token);
+      {
+        auto inner = db.limitExecution (milliseconds{10});
+        CHECK_EQ (messageOf (db, endless), "deadline exceeded");
+      }
+      token.cancel ();
+
+      THEN ("the outer limit still applies")
+      {
+        CHECK_EQ (messageOf (db, endless), "cancelled");
+      }
+    }
+
+    WHEN ("the limit guard is gone")
+    {
+      CancellationToken token;
+      {
+        auto limit = db.limitExecution (token);
+      }
+      token.cancel ();
+
+      THEN ("statements run without limit")
+      {
+        CHECK_EQ (db.selectValue ("SELECT 1;").getInt (), 1);
+      }
+    }
+
+    WHEN ("the deadline is not reached")
+    {
+      auto limit
+          = db.limitExecution (steady_clock::now () + std::chrono::hours{1});
+
+      THEN ("statements complete")
+      {
+        CHECK_EQ (db.selectValue ("WITH RECURSIVE c(x) AS (SELECT 1 UNION ALL"
+                                  " SELECT x + 1 FROM c WHERE x < 10000)"
+                                  " SELECT count(*) FROM c;")
+                      .getInt (),
+                  10000);
+      }
+    }
+
+    THEN ("steps must be positive")
+    {
+      CHECK_THROWS_AS (db.limitExecution (CancellationToken{}, 0),
+                       ErrOutOfRange);
+    }
+  }
+
+  GIVEN ("a closed database")
+  {
+    Database db{":memory:"};
+    Database moved{std::move (db)};
+
+    THEN ("no limit can be set")
+    {
+      CHECK_THROWS_AS (db.limitExecution (milliseconds{1}), ErrNoConnection);
+    }
+  }
+
+  GIVEN ("a limit that outlives its database")
+  {
+    CancellationToken token;
+    auto              limit = [&token] {
+      Database db{":memory:"};
+      return db.limitExecution (token);
+    }();
+
+    THEN ("cancel does not touch the closed connection")
+    {
+      token.cancel ();
+      CHECK (token.isCancelled ());
+    }
+  }
+}
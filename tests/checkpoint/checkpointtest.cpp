@@ -0,0 +1,210 @@
+#include "../testing.hpp"
+
+#include <sl3/database.hpp>
+
+#include <chrono>
+#include <filesystem>
+#include <string>
+#include <thread>
+
+namespace
+{
+  // polls until fn returns true, at most 10 seconds
+  template <typename Fn>
+  bool
+  eventually (Fn&& fn)
+  {
+    const auto end
+        = std::chrono::steady_clock::now () + std::chrono::seconds{10};
+    while (!fn ())
+      {
+        if (std::chrono::steady_clock::now () > end)
+          return false;
+        std::this_thread::sleep_for (std::chrono::milliseconds{5});
+      }
+    return true;
+  }
+
+  void
+  insertRows (sl3::Database& db, int count)
+  {
+    db.execute ("WITH RECURSIVE n(i) AS (SELECT 1 UNION ALL"
+                " SELECT i + 1 FROM n WHERE i < "
+                + std::to_string (count)
+                + ") INSERT INTO t SELECT zeroblob (1000) FROM n;");
+  }
+}
+
+SCENARIO ("checkpoints of the write ahead log")
+{
+  using namespace sl3;
+  using std::chrono::milliseconds;
+
+  GIVEN ("a database in WAL mode")
+  {
+    TempFile file{"sl3checkpointtest.db"};
+    Database db{file.path};
+    db.execute ("PRAGMA journal_mode = WAL; CREATE TABLE t (x);");
+
+    WHEN ("checkpointing it directly")
+    {
+      insertRows (db, 100);
+
+      THEN ("the frames are reported")
+      {
+        const auto passive = db.checkpoint ();
+        CHECK (passive.walFrames > 0);
+        CHECK_EQ (passive.checkpointed, passive.walFrames);
+        CHECK_FALSE (passive.busy);
+
+        const auto truncate = db.checkpoint (CheckpointMode::Truncate);
+        CHECK_EQ (truncate.walFrames, 0);
+        CHECK_EQ (std::filesystem::file_size (file.path + "-wal"), 0);
+      }
+    }
+
+    WHEN ("a scheduler checkpoints by WAL size")
+    {
+      CheckpointPolicy policy;
+      policy.walPages = 50;
+      policy.idle     = milliseconds{0};
+      CheckpointScheduler scheduler{db, policy};
+
+      for (int i = 0; i < 10; ++i)
+        insertRows (db, 20);
+
+      THEN ("checkpoints run in the background")
+      {
+        CHECK (eventually ([&scheduler] {
+          return scheduler.stats ().framesCopied >= 50;
+        }));
+        const auto stats = scheduler.stats ();
+        CHECK (stats.checkpoints > 0);
+        CHECK_EQ (stats.escalations, 0);
+        CHECK (stats.total >= stats.longest);
+      }
+    }
+
+    WHEN ("a scheduler waits for more pages than written")
+    {
+      CheckpointPolicy policy;
+      policy.walPages = 1000000;
+      policy.idle     = milliseconds{0};
+
+      {
+        CheckpointScheduler scheduler{db, policy};
+        insertRows (db, 5000);
+
+        THEN ("the writer does not checkpoint")
+        {
+          CHECK (db.checkpoint ().walFrames > 1000);
+          CHECK_EQ (scheduler.stats ().checkpoints, 0);
+        }
+      }
+
+      THEN ("the auto checkpoint is back when the scheduler is gone")
+      {
+        CHECK_EQ (db.selectValue ("PRAGMA wal_autocheckpoint;").getInt (),
+                  1000);
+      }
+    }
+
+    WHEN ("the database is idle")
+    {
+      CheckpointPolicy policy;
+      policy.walPages = 1000000;
+      policy.idle     = milliseconds{20};
+      policy.idleMode = CheckpointMode::Truncate;
+      CheckpointScheduler scheduler{db, policy};
+
+      insertRows (db, 100);
+
+      THEN ("an idle checkpoint truncates the WAL")
+      {
+        CHECK (eventually ([&scheduler] {
+          return scheduler.stats ().checkpoints > 0;
+        }));
+        CHECK (eventually ([&file] {
+          return std::filesystem::file_size (file.path + "-wal") == 0;
+        }));
+        CHECK_EQ (scheduler.stats ().busy, 0);
+      }
+    }
+
+    WHEN ("a reader keeps frames from being checkpointed")
+    {
+      insertRows (db, 10);
+      Database reader{file.path};
+      reader.execute ("BEGIN; SELECT count(*) FROM t;");
+
+      CheckpointPolicy policy;
+      policy.walPages       = 1;
+      policy.readerLagPages = 1;
+      policy.idle           = milliseconds{0};
+      policy.lockTimeout    = milliseconds{10};
+      CheckpointScheduler scheduler{db, policy};
+
+      insertRows (db, 10);
+
+      THEN ("the scheduler escalates and reports the lag")
+      {
+        CHECK (eventually ([&scheduler] {
+          return scheduler.stats ().escalations > 0;
+        }));
+        const auto stats = scheduler.stats ();
+        CHECK (stats.busy > 0);
+        CHECK (stats.readerLag > 0);
+      }
+
+      reader.execute ("COMMIT;");
+    }
+  }
+
+  GIVEN ("a database not in WAL mode")
+  {
+    TempFile file{"sl3checkpointrollback.db"};
+    Database db{file.path};
+    db.execute ("CREATE TABLE t (x);");
+
+    THEN ("checkpoint reports no WAL")
+    {
+      const auto result = db.checkpoint ();
+      CHECK_EQ (result.walFrames, -1);
+      CHECK_EQ (result.checkpointed, -1);
+    }
+  }
+
+  GIVEN ("an in memory database")
+  {
+    Database db{":memory:"};
+
+    THEN ("a scheduler can not be created")
+    {
+      CHECK_THROWS_AS (CheckpointScheduler{db}, ErrNoConnection);
+    }
+  }
+
+  GIVEN ("an invalid policy")
+  {
+    TempFile file{"sl3checkpointpolicy.db"};
+    Database db{file.path};
+    CheckpointPolicy policy;
+    policy.walPages = 0;
+
+    THEN ("a scheduler can not be created")
+    {
+      CHECK_THROWS_AS ((CheckpointScheduler{db, policy}), ErrOutOfRange);
+    }
+  }
+
+  GIVEN ("a closed database")
+  {
+    Database db{":memory:"};
+    Database moved{std::move (db)};
+
+    THEN ("checkpoint throws")
+    {
+      CHECK_THROWS_AS (db.checkpoint (), ErrNoConnection);
+    }
+  }
+}
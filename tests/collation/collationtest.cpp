@@ -0,0 +1,149 @@
+#include "../testing.hpp"
+
+#include <sl3/database.hpp>
+
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace
+{
+  std::vector<std::string>
+  texts (sl3::Database& db, const std::string& sql)
+  {
+    std::vector<std::string> result;
+    for (const auto& row : db.select (sql))
+      result.push_back (row[0].getText ());
+    return result;
+  }
+}
+
+SCENARIO ("comparators of sl3::collation")
+{
+  using namespace sl3;
+
+  GIVEN ("the natural order")
+  {
+    THEN ("numbers compare by value")
+    {
+      CHECK (collation::natural ("file9", "file10") < 0);
+      CHECK (collation::natural ("file10", "file9") > 0);
+      CHECK (collation::natural ("a2b10", "a2b9") > 0);
+      CHECK (collation::natural ("x", "x1") < 0);
+      CHECK_EQ (collation::natural ("v1.2", "v1.2"), 0);
+    }
+
+    THEN ("leading zeros only decide between otherwise equal texts")
+    {
+      CHECK (collation::natural ("007", "8") < 0);
+      CHECK (collation::natural ("007", "7") != 0);
+      CHECK_EQ (collation::natural ("007", "7"),
+                -collation::natural ("7", "007"));
+    }
+  }
+
+  GIVEN ("the ASCII case-insensitive order")
+  {
+    THEN ("letters compare without case")
+    {
+      CHECK_EQ (collation::asciiNoCase ("Hello", "hELLO"), 0);
+      CHECK (collation::asciiNoCase ("apple", "Banana") < 0);
+      CHECK (collation::asciiNoCase ("ab", "AB_") < 0);
+      CHECK (collation::asciiNoCase ("\xc3\x84", "\xc3\xa4") != 0);
+    }
+  }
+
+  GIVEN ("a prefix order")
+  {
+    const collation::Prefix prefix{3};
+
+    THEN ("only the prefix compares")
+    {
+      CHECK_EQ (prefix ("abcdef", "abcxyz"), 0);
+      CHECK (prefix ("abd", "abcxyz") > 0);
+      CHECK (prefix ("ab", "abc") < 0);
+    }
+  }
+}
+
+SCENARIO ("register collations")
+{
+  using namespace sl3;
+
+  GIVEN ("a database with a table of file names")
+  {
+    Database db{":memory:"};
+    db.execute ("CREATE TABLE f (name TEXT);"
+                "INSERT INTO f VALUES ('file10'), ('File2'), ('file1');");
+
+    WHEN ("registering the natural order")
+    {
+      db.createCollation ("natsort", collation::natural);
+
+      THEN ("ORDER BY uses it")
+      {
+        const std::vector<std::string> expected{"File2", "file1", "file10"};
+        CHECK (texts (db, "SELECT name FROM f ORDER BY name COLLATE natsort;")
+               == expected);
+      }
+
+      THEN ("an index uses it")
+      {
+        db.execute ("CREATE INDEX f_natsort ON f (name COLLATE natsort);"
+                    "INSERT INTO f VALUES ('file9');");
+        const std::vector<std::string> expected{"file9", "file10"};
+        CHECK (texts (db,
+                      "SELECT name FROM f WHERE name > 'file2'"
+                      " COLLATE natsort ORDER BY name COLLATE natsort;")
+               == expected);
+      }
+    }
+
+    WHEN ("registering a less than comparator")
+    {
+      db.createCollation ("nocase_natural",
+                          [] (std::string_view a, std::string_view b) {
+                            const int rc = collation::asciiNoCase (a, b);
+                            return rc != 0 ? rc < 0
+                                           : collation::natural (a, b) < 0;
+                          });
+
+      THEN ("it is used like a comparison")
+      {
+        const std::vector<std::string> expected{"file1", "file10", "File2"};
+        CHECK (texts (db,
+                      "SELECT name FROM f"
+                      " ORDER BY name COLLATE nocase_natural;")
+               == expected);
+        CHECK_EQ (db.selectValue ("SELECT 'A' = 'a' COLLATE nocase_natural;")
+                      .getInt (),
+                  0);
+      }
+    }
+
+    WHEN ("registering a prefix collation")
+    {
+      db.createCollation ("prefix4", collation::Prefix{4});
+
+      THEN ("texts with the same prefix are equal")
+      {
+        CHECK_EQ (db.selectValue ("SELECT count(DISTINCT name COLLATE prefix4)"
+                                  " FROM f;")
+                      .getInt (),
+                  2);
+      }
+    }
+  }
+
+  GIVEN ("a closed database")
+  {
+    Database db{":memory:"};
+    Database moved{std::move (db)};
+
+    THEN ("registering a collation throws")
+    {
+      CHECK_THROWS_AS (db.createCollation ("natsort", collation::natural),
+                       ErrNoConnection);
+    }
+  }
+}
@@ -1,6 +1,7 @@
 #include "../testing.hpp"
 #include <sl3/database.hpp>
 
+#include <cstddef>
 #include <string>
 
 SCENARIO ("using precompiled commands")
@@ -115,6 +116,87 @@ SCENARIO ("using precompiled commands")
       }
     }
 
+    WHEN ("binding named parameters")
+    {
+      auto cmd = db.prepare ("insert into tbl (fld1  , fld2 , fld3)"
+                             " VALUES (:eins , @zwei , $drei); ");
+
+      THEN ("names resolve to their index")
+      {
+        CHECK_EQ (cmd.getParameterIndex (":eins"), 0);
+        CHECK_EQ (cmd.getParameterIndex ("@zwei"), 1);
+        CHECK_EQ (cmd.getParameterIndex ("$drei"), 2);
+        CHECK_THROWS_AS (cmd.getParameterIndex ("eins"), ErrOutOfRange);
+        CHECK_THROWS_AS (cmd.getParameterIndex (":vier"), ErrOutOfRange);
+        CHECK_THROWS_AS (cmd.bind (":vier", 4), ErrOutOfRange);
+      }
+
+      THEN ("values can be bound by name")
+      {
+        cmd.bind (":eins", 1);
+        cmd.bind ("@zwei", "zwei");
+        cmd.bind ("$drei", 3.5);
+        cmd.execute ();
+
+        auto ds = db.select ("SELECT * FROM tbl;");
+        REQUIRE_EQ (ds.size (), 1);
+        CHECK_EQ (ds[0][0].getInt (), 1);
+        CHECK_EQ (ds[0][1].getText (), "zwei");
+        CHECK_EQ (ds[0][2].getReal (), 3.5);
+      }
+
+      THEN ("values can be bound by handles")
+      {
+        const auto eins = cmd.parameter<int64_t> (":eins");
+        const auto zwei = cmd.parameter<std::string> ("@zwei");
+        const auto drei = cmd.parameter<Blob> ("$drei");
+        CHECK_EQ (drei.index (), 2);
+
+        for (int i = 0; i < 3; ++i)
+          {
+            cmd.bind (eins, i);
+            cmd.bind (zwei, std::to_string (i));
+            cmd.bind (drei, Blob (static_cast<std::size_t> (i), std::byte{1}));
+            cmd.execute ();
+          }
+
+        auto ds = db.select ("SELECT fld1, fld2, length (fld3) FROM tbl"
+                             " ORDER BY fld1;");
+        REQUIRE_EQ (ds.size (), 3);
+        CHECK_EQ (ds[2][0].getInt (), 2);
+        CHECK_EQ (ds[2][1].getText (), "2");
+        CHECK_EQ (ds[2][2].getInt (), 2);
+      }
+
+      THEN ("handles must fit typed parameters")
+      {
+        cmd.resetParameters (
+            {DbValue{Type::Int}, DbValue{Type::Text}, DbValue{Type::Real}});
+        CHECK_NOTHROW (cmd.parameter<int64_t> (":eins"));
+        CHECK_THROWS_AS (cmd.parameter<double> (":eins"), ErrTypeMisMatch);
+        CHECK_THROWS_AS (cmd.parameter<Blob> ("@zwei"), ErrTypeMisMatch);
+        CHECK_THROWS_AS (cmd.bind ("$drei", "text"), ErrTypeMisMatch);
+      }
+    }
+
+    WHEN ("binding a numbered parameter used twice")
+    {
+      auto cmd = db.prepare ("insert into tbl (fld1  , fld2 , fld3)"
+                             " VALUES (?1 , ?2 , ?1); ");
+      cmd.bind ("?1", 5);
+      cmd.bind ("?2", 6);
+      cmd.execute ();
+
+      THEN ("the value is used at each position")
+      {
+        auto ds = db.select ("SELECT * FROM tbl;");
+        REQUIRE_EQ (ds.size (), 1);
+        CHECK_EQ (ds[0][0].getInt (), 5);
+        CHECK_EQ (ds[0][1].getInt (), 6);
+        CHECK_EQ (ds[0][2].getInt (), 5);
+      }
+    }
+
     WHEN ("creating a command typed parameters")
     {
       auto sql1 = "insert into tbl (fld1  , fld2 , fld3)"
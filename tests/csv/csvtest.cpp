@@ -0,0 +1,211 @@
+#include "../testing.hpp"
+
+#include <sl3/csv.hpp>
+#include <sl3/database.hpp>
+
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace
+{
+  std::vector<std::string>
+  fields (const sl3::CsvReader& csv)
+  {
+    std::vector<std::string> v;
+    for (std::size_t i = 0; i < csv.size (); ++i)
+      v.emplace_back (csv.isNull (i) ? "<null>" : std::string{csv[i]});
+    return v;
+  }
+}
+
+SCENARIO ("parsing CSV data")
+{
+  using namespace sl3;
+
+  GIVEN ("CSV data with quotes, line breaks and empty fields")
+  {
+    const std::string data = "id,name,note\r\n"
+                             "1,one,\r\n"
+                             "\n"
+                             "2,\"t,w\"\"o\",\"line\nbreak\"\n"
+                             "3,,\"\"\n"
+                             "4,x\"y,last";
+
+    WHEN ("reading it with small blocks")
+    {
+      std::istringstream in{data};
+      CsvReader          csv{in, CsvFormat{}, 4};
+
+      THEN ("all records and fields are parsed")
+      {
+        CHECK (csv.header ()
+               == std::vector<std::string>{"id", "name", "note"});
+
+        REQUIRE (csv.next ());
+        CHECK (fields (csv) == std::vector<std::string>{"1", "one", "<null>"});
+        CHECK_EQ (csv.line (), 2u);
+
+        REQUIRE (csv.next ());
+        CHECK (fields (csv)
+               == std::vector<std::string>{"2", "t,w\"o", "line\nbreak"});
+        CHECK_EQ (csv.line (), 4u);
+
+        REQUIRE (csv.next ());
+        CHECK (fields (csv) == std::vector<std::string>{"3", "<null>", ""});
+
+        REQUIRE (csv.next ());
+        CHECK (fields (csv) == std::vector<std::string>{"4", "x\"y", "last"});
+
+        CHECK_FALSE (csv.next ());
+        CHECK_FALSE (csv.next ());
+      }
+    }
+
+    WHEN ("reading it without a header and with empty text")
+    {
+      std::istringstream in{"a;;\"b;c\"\n"};
+      CsvFormat          format;
+      format.delimiter   = ';';
+      format.header      = false;
+      format.emptyIsNull = false;
+      CsvReader csv{in, format};
+
+      THEN ("the format is used")
+      {
+        CHECK (csv.header ().empty ());
+        REQUIRE (csv.next ());
+        CHECK (fields (csv) == std::vector<std::string>{"a", "", "b;c"});
+      }
+    }
+
+    WHEN ("a quoted field is not terminated")
+    {
+      std::istringstream in{"a,\"b\nc"};
+      CsvFormat          format;
+      format.header = false;
+      CsvReader csv{in, format};
+
+      THEN ("parsing throws")
+      {
+        CHECK_THROWS_AS (csv.next (), ErrTypeMisMatch);
+      }
+    }
+
+    WHEN ("a quoted field is followed by data")
+    {
+      std::istringstream in{"\"a\"b,c\n"};
+      CsvFormat          format;
+      format.header = false;
+      CsvReader csv{in, format};
+
+      THEN ("parsing throws")
+      {
+        CHECK_THROWS_AS (csv.next (), ErrTypeMisMatch);
+      }
+    }
+  }
+}
+
+SCENARIO ("importing and exporting CSV")
+{
+  using namespace sl3;
+
+  GIVEN ("a database with a table")
+  {
+    Database db{":memory:"};
+    db.execute ("CREATE TABLE t (id INTEGER, r REAL, txt TEXT, b BLOB);");
+
+    WHEN ("importing CSV via an insert command")
+    {
+      std::istringstream in{"id,r,txt,b\n"
+                            "1,1.5,\"a,b\",x\n"
+                            "2,,,\n"
+                            "3,-2,\"\",\n"};
+      CsvReader csv{in};
+      auto      cmd   = db.prepare ("INSERT INTO t VALUES (?, ?, ?, ?);");
+      auto      count = csv.importInto (cmd);
+
+      THEN ("all records are inserted, with type affinity")
+      {
+        CHECK_EQ (count, 3u);
+        CHECK_EQ (
+            db.selectValue ("SELECT count(*) FROM t WHERE txt IS NULL;")
+                .getInt (),
+            1);
+        CHECK_EQ (db.selectValue ("SELECT sum(id) FROM t;").getInt (), 6);
+        CHECK_EQ (db.selectValue ("SELECT r FROM t WHERE id = 1;").getReal (),
+                  doctest::Approx (1.5));
+        CHECK_EQ (db.selectValue ("SELECT txt FROM t WHERE id = 1;").getText (),
+                  "a,b");
+        CHECK_EQ (db.selectValue ("SELECT txt FROM t WHERE id = 3;").getText (),
+                  "");
+      }
+    }
+
+    WHEN ("importing a record with a wrong field count")
+    {
+      std::istringstream in{"1,2\n"};
+      CsvFormat          format;
+      format.header = false;
+      CsvReader csv{in, format};
+      auto      cmd = db.prepare ("INSERT INTO t VALUES (?, ?, ?, ?);");
+
+      THEN ("the import throws")
+      {
+        CHECK_THROWS_AS (csv.importInto (cmd), ErrTypeMisMatch);
+      }
+    }
+
+    WHEN ("exporting a query result")
+    {
+      db.execute ("INSERT INTO t VALUES (1, 0.1, 'plain', x'00FF');"
+                  "INSERT INTO t VALUES (-2, 1e300, 'q\"uote', NULL);"
+                  "INSERT INTO t VALUES (3, NULL, '', NULL);"
+                  "INSERT INTO t VALUES (NULL, -0.5, 'line\nbreak', x'');");
+
+      std::ostringstream out;
+      {
+        CsvWriter csv{out, CsvFormat{}, 16};
+        db.execute ("SELECT * FROM t;", csv);
+        CHECK_EQ (csv.rows (), 4u);
+      }
+
+      THEN ("values are formatted and quoted as needed")
+      {
+        CHECK_EQ (out.str (),
+                  "id,r,txt,b\n"
+                  "1,0.1,plain,00FF\n"
+                  "-2,1e+300,\"q\"\"uote\",\n"
+                  "3,,\"\",\n"
+                  ",-0.5,\"line\nbreak\",\n");
+      }
+    }
+
+    WHEN ("exporting and importing many rows")
+    {
+      db.execute ("WITH RECURSIVE c(x) AS (SELECT 1 UNION ALL SELECT x+1 "
+                  "FROM c LIMIT 5000) INSERT INTO t SELECT x, x / 7.0, "
+                  "printf('text \"%d\", more', x), NULL FROM c;");
+
+      std::stringstream io;
+      CsvWriter         writer{io, CsvFormat{}, 1000};
+      db.execute ("SELECT * FROM t ORDER BY id;", writer);
+
+      db.execute ("CREATE TABLE copy (id INTEGER, r REAL, txt TEXT, b BLOB);");
+      CsvReader reader{io, CsvFormat{}, 100};
+      auto      cmd = db.prepare ("INSERT INTO copy VALUES (?, ?, ?, ?);");
+      reader.importInto (cmd);
+
+      THEN ("the copy is identical")
+      {
+        CHECK_EQ (db.selectValue ("SELECT count(*) FROM copy;").getInt (),
+                  5000);
+        CHECK_EQ (db.selectValue ("SELECT count(*) FROM (SELECT * FROM t "
+                                  "EXCEPT SELECT * FROM copy);")
+                      .getInt (),
+                  0);
+      }
+    }
+  }
+}
@@ -1,7 +1,10 @@
 #include "../testing.hpp"
 #include <sl3/database.hpp>
 
+#include <cstddef>
+#include <cstdint>
 #include <string>
+#include <vector>
 
 SCENARIO ("dataset creation and default operators")
 {
@@ -66,6 +69,344 @@ SCENARIO ("dataset creation and default operators")
   }
 }
 
+SCENARIO ("accessing dataset fields by name")
+{
+  using namespace sl3;
+  GIVEN ("a dataset with named fields")
+  {
+    Database db{":memory:"};
+    db.execute ("CREATE TABLE t (id INTEGER, name TEXT, val REAL, v);"
+                "INSERT INTO t VALUES (1, 'eins', 1.5, x'01');"
+                "INSERT INTO t VALUES (2, NULL, NULL, 2);");
+
+    auto ds = db.select ("SELECT id, name, val, v, id AS name FROM t;",
+                         {Type::Int,
+                          Type::Text,
+                          Type::Real,
+                          Type::Variant,
+                          Type::Variant});
+
+    WHEN ("a name is used by multiple fields")
+    {
+      THEN ("the index of the first field is returned")
+      {
+        CHECK_EQ (ds.getIndex ("name"), 1u);
+      }
+    }
+
+    WHEN ("getting a column handle")
+    {
+      const auto name = ds.column ("name");
+
+      THEN ("it has the index and the type of the field")
+      {
+        CHECK_EQ (name.index (), 1u);
+        CHECK_EQ (name.type (), Type::Text);
+        CHECK_EQ (name (ds[0]).getText (), "eins");
+        CHECK (name (ds[1]).isNull ());
+        CHECK_THROWS_AS (ds.column ("abc"), ErrOutOfRange);
+      }
+    }
+
+    WHEN ("getting typed field references")
+    {
+      const auto id   = ds.field<int64_t> ("id");
+      const auto val  = ds.field<double> ("val");
+      const auto name = ds.field<std::string> ("name");
+      const auto v    = ds.field<Blob> ("v");
+
+      THEN ("values are accessible without name lookups")
+      {
+        CHECK_EQ (id.get (ds[1]), 2);
+        CHECK_EQ (val.get (ds[0]), doctest::Approx (1.5));
+        CHECK_EQ (val.get (ds[1], -1.0), doctest::Approx (-1.0));
+        CHECK_EQ (name.get (ds[0]), "eins");
+        CHECK_EQ (name.get (ds[1], "none"), "none");
+        CHECK (name.isNull (ds[1]));
+        CHECK_THROWS_AS (name.get (ds[1]), ErrNullValueAccess);
+        CHECK_EQ (v.get (ds[0]), Blob{std::byte{1}});
+        CHECK_THROWS_AS (v.get (ds[1]), ErrTypeMisMatch);
+        CHECK_EQ (v.column ().index (), 3u);
+      }
+    }
+
+    WHEN ("requesting a field reference with a wrong type")
+    {
+      THEN ("creating it throws")
+      {
+        CHECK_THROWS_AS (ds.field<std::string> ("id"), ErrTypeMisMatch);
+        CHECK_THROWS_AS (ds.field<int64_t> ("val"), ErrTypeMisMatch);
+        CHECK_THROWS_AS (ds.field<int64_t> ("abc"), ErrOutOfRange);
+      }
+    }
+
+    WHEN ("resetting the dataset")
+    {
+      ds.reset ();
+      THEN ("the names are gone")
+      {
+        CHECK_THROWS_AS (ds.getIndex ("id"), ErrOutOfRange);
+      }
+    }
+  }
+}
+
+SCENARIO ("moving rows between datasets")
+{
+  using namespace sl3;
+  GIVEN ("a database with 2 tables of the same layout")
+  {
+    Database db{":memory:"};
+    db.execute ("CREATE TABLE a (id INTEGER, txt TEXT);"
+                "CREATE TABLE b (id INTEGER, txt TEXT);"
+                "INSERT INTO a VALUES (1, 'eins');"
+                "INSERT INTO a VALUES (2, 'zwei');"
+                "INSERT INTO b VALUES (3, 'drei');");
+
+    const Types types{Type::Int, Type::Text};
+
+    WHEN ("move merging into an empty dataset")
+    {
+      Dataset ds{types};
+      auto    a = db.select ("SELECT * FROM a;", types);
+      ds.merge (std::move (a));
+
+      THEN ("the rows are moved")
+      {
+        CHECK_EQ (ds.size (), 2u);
+        CHECK_EQ (a.size (), 0u);
+        CHECK_EQ (ds[1][1].getText (), "zwei");
+      }
+    }
+
+    WHEN ("move merging into a dataset with rows")
+    {
+      auto ds = db.select ("SELECT * FROM a;", types);
+      ds.reserve (10);
+      const auto* first = &ds[0];
+      ds.merge (db.select ("SELECT * FROM b;", types));
+      ds.merge (DbValues{DbValue{4}, DbValue{std::string{"vier"}}});
+
+      THEN ("the rows are appended")
+      {
+        CHECK_EQ (ds.size (), 4u);
+        CHECK_EQ (&ds[0], first);
+        CHECK_EQ (ds[2][1].getText (), "drei");
+        CHECK_EQ (ds[3][0].getInt (), 4);
+      }
+      AND_THEN ("incompatible data is rejected")
+      {
+        CHECK_THROWS_AS (ds.merge (db.select ("SELECT txt, id FROM a;")),
+                         ErrTypeMisMatch);
+        CHECK_THROWS_AS (ds.merge (DbValues{DbValue{1}}), ErrTypeMisMatch);
+        CHECK_EQ (ds.size (), 4u);
+      }
+    }
+
+    WHEN ("loading multiple results into a chunked dataset")
+    {
+      ChunkedDataset rows{types};
+      db.execute ("SELECT * FROM a;", rows);
+      const auto* first = &rows[0];
+      db.execute ("SELECT * FROM b;", rows);
+      rows.merge (db.select ("SELECT * FROM b;", types));
+      rows.merge (DbValues{DbValue{5}, DbValue{std::string{"fuenf"}}});
+
+      THEN ("all rows are there and rows did not move")
+      {
+        REQUIRE_EQ (rows.size (), 5u);
+        CHECK_EQ (&rows[0], first);
+        CHECK_EQ (rows.getIndex ("txt"), 1u);
+        CHECK_THROWS_AS (rows.getIndex ("abc"), ErrOutOfRange);
+        CHECK_EQ (rows[4][1].getText (), "fuenf");
+      }
+      AND_THEN ("they can be moved into a Dataset")
+      {
+        Dataset ds = std::move (rows).toDataset ();
+        CHECK_EQ (ds.size (), 5u);
+        CHECK_EQ (ds.getIndex ("id"), 0u);
+        CHECK_EQ (ds[2][0].getInt (), 3);
+        CHECK_EQ (rows.size (), 0u);
+      }
+      AND_THEN ("other chunked datasets can be moved in")
+      {
+        ChunkedDataset other;
+        db.execute ("SELECT * FROM a;", other);
+        CHECK_THROWS_AS (rows.merge (std::move (other)), ErrTypeMisMatch);
+
+        ChunkedDataset same{types};
+        db.execute ("SELECT * FROM a;", same);
+        rows.merge (std::move (same));
+        CHECK_EQ (rows.size (), 7u);
+        CHECK_EQ (same.size (), 0u);
+      }
+    }
+
+    WHEN ("loading a result with a wrong type into a chunked dataset")
+    {
+      ChunkedDataset rows{{Type::Int}};
+      THEN ("loading throws")
+      {
+        CHECK_THROWS_AS (db.execute ("SELECT * FROM a;", rows),
+                         ErrTypeMisMatch);
+        rows.reset (types);
+        CHECK_THROWS_AS (db.execute ("SELECT txt, id FROM a;", rows),
+                         ErrTypeMisMatch);
+      }
+    }
+  }
+}
+
+SCENARIO ("looking up rows via dataset indexes")
+{
+  using namespace sl3;
+  GIVEN ("a dataset with duplicate keys of different types")
+  {
+    Database db{":memory:"};
+    db.execute ("CREATE TABLE t (k, n INTEGER);"
+                "INSERT INTO t VALUES (1, 10);"
+                "INSERT INTO t VALUES ('a', 20);"
+                "INSERT INTO t VALUES (2.5, 30);"
+                "INSERT INTO t VALUES (1.0, 40);"
+                "INSERT INTO t VALUES (NULL, 50);"
+                "INSERT INTO t VALUES ('a', 10);"
+                "INSERT INTO t VALUES (3, 10);");
+
+    auto ds = db.select ("SELECT * FROM t;");
+
+    auto rows = [] (RowRange range) {
+      return std::vector<std::size_t> (range.begin (), range.end ());
+    };
+
+    WHEN ("there is no index")
+    {
+      THEN ("lookups throw")
+      {
+        CHECK_FALSE (ds.hasIndex ({0}, IndexType::Hash));
+        CHECK_THROWS_AS (ds.find ({0}, {DbValue{1}}), ErrOutOfRange);
+        CHECK_THROWS_AS (ds.range ({0}, {DbValue{1}}, {DbValue{2}}),
+                         ErrOutOfRange);
+        CHECK_THROWS_AS (ds.createIndex ({}), ErrOutOfRange);
+        CHECK_THROWS_AS (ds.createIndex ({2}), ErrOutOfRange);
+      }
+    }
+
+    WHEN ("creating a hash index")
+    {
+      ds.createIndex ({0});
+      ds.createIndex ({0}); // does nothing
+
+      THEN ("equal values of different types are found")
+      {
+        CHECK (ds.hasIndex ({0}, IndexType::Hash));
+        CHECK_FALSE (ds.hasIndex ({0}, IndexType::Ordered));
+        CHECK (rows (ds.equalRange ({0}, {DbValue{1}}))
+               == std::vector<std::size_t>{0, 3});
+        CHECK (rows (ds.equalRange ({0}, {DbValue{1.0}}))
+               == std::vector<std::size_t>{0, 3});
+        CHECK (rows (ds.equalRange ({0}, {DbValue{std::string{"a"}}}))
+               == std::vector<std::size_t>{1, 5});
+        CHECK (rows (ds.equalRange ({0}, {DbValue{Type::Variant}}))
+               == std::vector<std::size_t>{4});
+        CHECK (ds.equalRange ({0}, {DbValue{7}}).empty ());
+
+        const DbValues* row = ds.find ({0}, {DbValue{2.5}});
+        REQUIRE (row != nullptr);
+        CHECK_EQ (row->at (1).getInt (), 30);
+        CHECK (ds.find ({0}, {DbValue{std::string{"b"}}}) == nullptr);
+      }
+      AND_THEN ("range lookups need an ordered index")
+      {
+        CHECK_THROWS_AS (ds.range ({0}, {DbValue{1}}, {DbValue{2}}),
+                         ErrOutOfRange);
+      }
+      AND_THEN ("the key size must match")
+      {
+        CHECK_THROWS_AS (ds.equalRange ({0}, {}), ErrTypeMisMatch);
+      }
+    }
+
+    WHEN ("creating an ordered index on two fields")
+    {
+      ds.createIndex ({1, 0}, IndexType::Ordered, 2);
+
+      THEN ("full keys, key prefixes and ranges are found")
+      {
+        CHECK (rows (ds.equalRange ({1, 0}, {DbValue{10}, DbValue{1}}))
+               == std::vector<std::size_t>{0});
+        CHECK (rows (ds.equalRange ({1, 0}, {DbValue{10}}))
+               == std::vector<std::size_t>{0, 6, 5});
+        CHECK (rows (ds.range ({1, 0}, {DbValue{20}}, {DbValue{50}}))
+               == std::vector<std::size_t>{1, 2, 3});
+        CHECK (rows (ds.range ({1, 0},
+                               {DbValue{10}, DbValue{2}},
+                               {DbValue{10}, DbValue{std::string{"a"}}}))
+               == std::vector<std::size_t>{6});
+        CHECK (ds.range ({1, 0}, {DbValue{50}}, {DbValue{10}}).empty ());
+        CHECK_THROWS_AS (
+            ds.equalRange ({1, 0}, {DbValue{1}, DbValue{1}, DbValue{1}}),
+            ErrTypeMisMatch);
+      }
+    }
+
+    WHEN ("changing the dataset")
+    {
+      ds.createIndex ({0});
+      ds.createIndex ({0}, IndexType::Ordered);
+      auto copy = ds;
+      ds.merge (DbValues{DbValue{1}, DbValue{60}});
+
+      THEN ("the indexes are dropped")
+      {
+        CHECK_FALSE (ds.hasIndex ({0}, IndexType::Hash));
+        CHECK_FALSE (ds.hasIndex ({0}, IndexType::Ordered));
+        CHECK (copy.hasIndex ({0}, IndexType::Hash));
+
+        copy.orderBy ({{1}});
+        CHECK_FALSE (copy.hasIndex ({0}, IndexType::Hash));
+
+        ds.createIndex ({0});
+        CHECK_EQ (ds.equalRange ({0}, {DbValue{1}}).size (), 3u);
+        ds.reset ();
+        CHECK_FALSE (ds.hasIndex ({0}, IndexType::Hash));
+      }
+    }
+  }
+
+  GIVEN ("a large dataset")
+  {
+    Database db{":memory:"};
+    db.execute ("CREATE TABLE big (k INTEGER, t TEXT);"
+                "WITH RECURSIVE c(x) AS (SELECT 0 UNION ALL SELECT x+1 FROM c "
+                "LIMIT 100000) INSERT INTO big SELECT x % 5000, "
+                "printf('%d', x) FROM c;");
+    auto ds = db.select ("SELECT * FROM big;");
+
+    WHEN ("creating indexes with multiple threads")
+    {
+      ds.createIndex ({0}, IndexType::Hash, 4);
+      ds.createIndex ({1}, IndexType::Ordered, 4);
+
+      THEN ("all lookups find the right rows")
+      {
+        bool found = true;
+        for (int64_t k = 0; k < 5000 && found; k += 7)
+          {
+            const auto range = ds.equalRange ({0}, {DbValue{k}});
+            found            = range.size () == 20;
+            for (auto r : range)
+              found = found && ds[r][0].getInt () == k;
+          }
+        CHECK (found);
+
+        const DbValues* row = ds.find ({1}, {DbValue{std::string{"4711"}}});
+        REQUIRE (row != nullptr);
+        CHECK_EQ (row->at (0).getInt (), 4711);
+      }
+    }
+  }
+}
+
 SCENARIO ("merging datasets")
 {
   using namespace sl3;
@@ -195,6 +536,170 @@ SCENARIO ("sorting a dataset")
   }
 }
 
+SCENARIO ("ordering a dataset by sort keys")
+{
+  using namespace sl3;
+  GIVEN ("a table with nulls, mixed types and duplicates")
+  {
+    Database db{":memory:"};
+    db.execute ("CREATE TABLE t (id INTEGER, grp INTEGER, val);"
+                "INSERT INTO t VALUES (1, 2,    'b');"
+                "INSERT INTO t VALUES (2, NULL, 2.5);"
+                "INSERT INTO t VALUES (3, 1,    x'00');"
+                "INSERT INTO t VALUES (4, 2,    NULL);"
+                "INSERT INTO t VALUES (5, 1,    3);"
+                "INSERT INTO t VALUES (6, -7,   'a');"
+                "INSERT INTO t VALUES (7, 2,    2);");
+
+    auto ids = [] (const Dataset& ds) {
+      std::vector<int64_t> v;
+      for (const auto& row : ds)
+        v.push_back (row[0].getInt ());
+      return v;
+    };
+
+    WHEN ("ordering by a typed integer field")
+    {
+      auto ds = db.select ("SELECT * FROM t;",
+                           {Type::Int, Type::Int, Type::Variant});
+
+      THEN ("ascending puts nulls first and keeps equal rows in order")
+      {
+        ds.orderBy ({{1}});
+        CHECK (ids (ds) == std::vector<int64_t>{2, 6, 3, 5, 1, 4, 7});
+      }
+      THEN ("descending with nulls last reverses only the values")
+      {
+        ds.orderBy ({{1, SortOrder::Descending, NullsOrder::Last}});
+        CHECK (ids (ds) == std::vector<int64_t>{1, 4, 7, 3, 5, 6, 2});
+      }
+    }
+
+    WHEN ("ordering by a variant field with different storage types")
+    {
+      auto ds = db.select ("SELECT * FROM t;");
+
+      THEN ("the order follows the sqlite rules like dbval_lt")
+      {
+        ds.orderBy ({{2}});
+        CHECK (ids (ds) == std::vector<int64_t>{4, 7, 2, 5, 6, 1, 3});
+
+        // the values are distinct, so the unstable sort gives one order
+        auto other = db.select ("SELECT * FROM t;");
+        other.sort ({2});
+        CHECK (ids (other) == ids (ds));
+      }
+      THEN ("descending with nulls last")
+      {
+        ds.orderBy ({{2, SortOrder::Descending, NullsOrder::Last}});
+        CHECK (ids (ds) == std::vector<int64_t>{3, 1, 6, 5, 2, 7, 4});
+      }
+    }
+
+    WHEN ("ordering by multiple keys")
+    {
+      auto ds = db.select ("SELECT * FROM t;");
+      ds.orderBy ({{1, SortOrder::Ascending, NullsOrder::Last},
+                   {2, SortOrder::Descending}});
+
+      THEN ("later keys sort rows with equal earlier keys")
+      {
+        CHECK (ids (ds) == std::vector<int64_t>{6, 3, 5, 4, 1, 7, 2});
+      }
+    }
+
+    WHEN ("requesting only the top rows")
+    {
+      auto ds = db.select ("SELECT * FROM t;");
+      ds.orderBy ({{0, SortOrder::Descending}}, SortOptions{3, 1});
+
+      THEN ("the first rows are in order, all rows are still there")
+      {
+        REQUIRE_EQ (ds.size (), 7u);
+        const auto v = ids (ds);
+        CHECK (std::vector<int64_t> (v.begin (), v.begin () + 3)
+               == std::vector<int64_t>{7, 6, 5});
+      }
+    }
+
+    WHEN ("using an invalid field index")
+    {
+      auto ds = db.select ("SELECT * FROM t;");
+      THEN ("ordering throws")
+      {
+        CHECK_THROWS_AS (ds.orderBy ({{3}}), ErrOutOfRange);
+        CHECK_THROWS_AS (ds.sort ({3}), ErrOutOfRange);
+      }
+    }
+  }
+
+  GIVEN ("an untyped dataset with rows of different sizes")
+  {
+    Dataset ds;
+    ds.merge (DbValues{DbValue{2}, DbValue{1}});
+    ds.merge (DbValues{DbValue{1}});
+
+    THEN ("using a field a row does not have throws")
+    {
+      CHECK_THROWS_AS (ds.sort ({1}), ErrOutOfRange);
+      CHECK_THROWS_AS (ds.orderBy ({{1}}), ErrOutOfRange);
+      CHECK_THROWS_AS (ds.createIndex ({1}), ErrOutOfRange);
+    }
+
+    THEN ("fields all rows have can be used")
+    {
+      ds.sort ({0});
+      CHECK_EQ (ds[0][0].getInt (), 1);
+    }
+  }
+
+  GIVEN ("a large dataset")
+  {
+    Database db{":memory:"};
+    db.execute ("CREATE TABLE big (k INTEGER, r REAL, t TEXT);"
+                "WITH RECURSIVE c(x) AS (SELECT 1 UNION ALL SELECT x+1 FROM c "
+                "LIMIT 100000) INSERT INTO big SELECT (x * 7919) % 1000, "
+                "((x * 104729) % 997) / 10.0, printf('%05d', (x * 31) % 50000)"
+                " FROM c;");
+
+    WHEN ("ordering it with multiple threads")
+    {
+      auto ds = db.select ("SELECT * FROM big;");
+      ds.orderBy ({{0}, {2, SortOrder::Descending}}, SortOptions{0, 4});
+
+      THEN ("all rows are in order")
+      {
+        REQUIRE_EQ (ds.size (), 100000u);
+        bool ordered = true;
+        for (std::size_t i = 1; i < ds.size () && ordered; ++i)
+          {
+            const auto& a = ds[i - 1];
+            const auto& b = ds[i];
+            ordered       = a[0].getInt () < b[0].getInt ()
+                      || (a[0].getInt () == b[0].getInt ()
+                          && a[2].getText () >= b[2].getText ());
+          }
+        CHECK (ordered);
+      }
+    }
+
+    WHEN ("ordering a real field with multiple threads")
+    {
+      auto ds = db.select ("SELECT * FROM big;",
+                           {Type::Int, Type::Real, Type::Text});
+      ds.orderBy ({{1, SortOrder::Descending}}, SortOptions{0, 4});
+
+      THEN ("all rows are in order")
+      {
+        bool ordered = true;
+        for (std::size_t i = 1; i < ds.size () && ordered; ++i)
+          ordered = ds[i - 1][1].getReal () >= ds[i][1].getReal ();
+        CHECK (ordered);
+      }
+    }
+  }
+}
+
 SCENARIO ("doing some things via dbvalues on rows of datasets")
 {
   using namespace sl3;
@@ -17,6 +17,7 @@ SCENARIO ("checking error codes")
         {ErrCode::OutOfRange, "OutOfRange"},
         {ErrCode::TypeMisMatch, "TypeMisMatch"},
         {ErrCode::NullValueAccess , "NullValueAccess"},
+        {ErrCode::Interrupted , "Interrupted"},
         {ErrCode::UNEXPECTED , "UNEXPECTED"},
     };
 
@@ -54,6 +55,7 @@ SCENARIO ("checking error codes")
     const ErrOutOfRange outOfRange;
     const ErrTypeMisMatch typeMisMatch;
     const ErrNullValueAccess nullValueAccess;
+    const ErrInterrupted interrupted;
     const ErrUnexpected unexpected;
 
     WHEN ("asking each error for its identifier")
@@ -64,6 +66,7 @@ SCENARIO ("checking error codes")
         CHECK(outOfRange.getId() == sl3::ErrCode::OutOfRange);
         CHECK(typeMisMatch.getId() == sl3::ErrCode::TypeMisMatch);
         CHECK(nullValueAccess.getId() == sl3::ErrCode::NullValueAccess);
+        CHECK(interrupted.getId() == sl3::ErrCode::Interrupted);
         CHECK(unexpected.getId() == sl3::ErrCode::UNEXPECTED);
       }
     }
@@ -0,0 +1,316 @@
+#include "../testing.hpp"
+
+#include <sl3/database.hpp>
+
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace
+{
+  int64_t
+  twice (int64_t val)
+  {
+    return 2 * val;
+  }
+
+  struct WeightedAvg
+  {
+    double sum     = 0;
+    double weights = 0;
+
+    void
+    step (double val, double weight)
+    {
+      sum += val * weight;
+      weights += weight;
+    }
+
+    std::optional<double>
+    value () const
+    {
+      if (weights == 0)
+        return std::nullopt;
+      return sum / weights;
+    }
+  };
+
+  // non trivial state, collects values above a limit
+  struct Above
+  {
+    int64_t              limit = 0;
+    std::vector<int64_t> values{};
+
+    static int alive;
+
+    Above () { ++alive; }
+    explicit Above (int64_t l)
+    : limit (l)
+    {
+      ++alive;
+    }
+    Above (const Above& other)
+    : limit (other.limit)
+    , values (other.values)
+    {
+      ++alive;
+    }
+    ~Above () { --alive; }
+
+    void
+    step (int64_t val)
+    {
+      if (val < 0)
+        throw std::runtime_error ("negative");
+      if (val > limit)
+        values.push_back (val);
+    }
+
+    void
+    inverse (int64_t val)
+    {
+      if (val > limit)
+        values.erase (values.begin ());
+    }
+
+    int64_t
+    value () const
+    {
+      return static_cast<int64_t> (values.size ());
+    }
+
+    std::string
+    final () const
+    {
+      std::string result;
+      for (auto val : values)
+        result += std::to_string (val) + ";";
+      return result;
+    }
+  };
+
+  int Above::alive = 0;
+}
+
+SCENARIO ("user defined scalar functions")
+{
+  using namespace sl3;
+
+  GIVEN ("a database with registered functions")
+  {
+    Database db{":memory:"};
+
+    int calls = 0;
+    db.createFunction ("score", [&calls] (int64_t hits, std::string_view tag) {
+      ++calls;
+      return tag == "top" ? static_cast<double> (hits) * 2.0
+                          : static_cast<double> (hits);
+    });
+    db.createFunction ("twice", &twice);
+    db.createFunction ("greet", [] (const std::string& name) {
+      return "hello " + name;
+    });
+    db.createFunction ("answer", [] () { return 42; });
+    db.createFunction ("orzero", [] (std::optional<int64_t> val) {
+      return val.value_or (0);
+    });
+    db.createFunction ("kind", [] (const DbValue& val) {
+      return typeName (val.type ());
+    });
+    db.createFunction ("noresult",
+                       [] (int64_t) -> std::optional<std::string> {
+                         return std::nullopt;
+                       });
+    db.createFunction ("reversed", [] (const Blob& val) {
+      return Blob (val.rbegin (), val.rend ());
+    });
+    db.createFunction ("fail", [] (int64_t) -> int64_t {
+      throw std::runtime_error ("failed on purpose");
+    });
+
+    WHEN ("calling them from SQL")
+    {
+      THEN ("arguments and results are converted by the signature")
+      {
+        CHECK_EQ (db.selectValue ("SELECT score (21, 'top');").getReal (),
+                  42.0);
+        CHECK_EQ (db.selectValue ("SELECT score (21, 'x');").getReal (),
+                  21.0);
+        CHECK_EQ (db.selectValue ("SELECT twice (4);").getInt (), 8);
+        CHECK_EQ (db.selectValue ("SELECT twice ('5');").getInt (), 10);
+        CHECK_EQ (db.selectValue ("SELECT greet ('you');").getText (),
+                  "hello you");
+        CHECK_EQ (db.selectValue ("SELECT answer ();").getInt (), 42);
+        CHECK_EQ (db.selectValue ("SELECT kind (1.5);").getText (), "Real");
+        CHECK_EQ (db.selectValue ("SELECT kind (NULL);").getText (), "Null");
+        CHECK (db.selectValue ("SELECT noresult (1);").isNull ());
+
+        const auto blob = db.selectValue ("SELECT reversed (x'0102');");
+        REQUIRE_EQ (blob.getBlob ().size (), 2u);
+        CHECK (blob.getBlob ()[0] == std::byte{2});
+      }
+
+      AND_THEN ("Null arguments give Null unless the type accepts Null")
+      {
+        CHECK (db.selectValue ("SELECT score (NULL, 'top');").isNull ());
+        CHECK_EQ (calls, 0);
+        CHECK_EQ (db.selectValue ("SELECT orzero (NULL);").getInt (), 0);
+        CHECK_EQ (db.selectValue ("SELECT orzero (3);").getInt (), 3);
+      }
+
+      AND_THEN ("functions can be used in queries")
+      {
+        db.execute ("CREATE TABLE docs (hits INTEGER, tag TEXT);"
+                    "INSERT INTO docs VALUES (10, 'top'), (15, 'x'),"
+                    " (5, 'top');");
+        const auto ds = db.select (
+            "SELECT hits FROM docs ORDER BY score (hits, tag) DESC;");
+        REQUIRE_EQ (ds.size (), 3u);
+        CHECK_EQ (ds[0][0].getInt (), 10);
+        CHECK_EQ (ds[2][0].getInt (), 5);
+      }
+    }
+
+    WHEN ("a function throws or is called with wrong arguments")
+    {
+      THEN ("the statement fails")
+      {
+        CHECK_THROWS_AS (db.execute ("SELECT fail (1);"), SQLite3Error);
+        CHECK_EQ (db.getMostRecentErrMsg (), "failed on purpose");
+        CHECK_THROWS_AS (db.execute ("SELECT twice (1, 2);"), SQLite3Error);
+      }
+    }
+
+    WHEN ("a function is used in an index expression")
+    {
+      db.execute ("CREATE TABLE nums (x INTEGER);");
+
+      THEN ("it has to be registered as deterministic")
+      {
+        CHECK_THROWS_AS (
+            db.execute ("CREATE INDEX byTwice ON nums (twice (x));"),
+            SQLite3Error);
+
+        FunctionOptions pure;
+        pure.deterministic = true;
+        db.createFunction ("twice", &twice, pure);
+        CHECK_NOTHROW (
+            db.execute ("CREATE INDEX byTwice ON nums (twice (x));"));
+      }
+    }
+
+    WHEN ("a function is replaced")
+    {
+      db.createFunction ("answer", [] () { return std::string{"new"}; });
+
+      THEN ("the new one is used")
+      {
+        CHECK_EQ (db.selectValue ("SELECT answer ();").getText (), "new");
+      }
+    }
+  }
+
+  GIVEN ("a closed database")
+  {
+    Database db{":memory:"};
+    Database moved{std::move (db)};
+
+    THEN ("registering a function throws")
+    {
+      CHECK_THROWS_AS (db.createFunction ("f", [] () { return 1; }),
+                       ErrNoConnection);
+    }
+  }
+}
+
+SCENARIO ("user defined aggregate and window functions")
+{
+  using namespace sl3;
+
+  GIVEN ("a table and registered aggregates")
+  {
+    Database db{":memory:"};
+    db.execute ("CREATE TABLE t (grp TEXT, val INTEGER, weight REAL);"
+                "INSERT INTO t VALUES ('a', 1, 1.0), ('a', 4, 3.0),"
+                " ('b', 10, 1.0), ('b', NULL, 5.0), ('b', 20, 1.0);");
+
+    db.createAggregate<WeightedAvg> ("wavg");
+    db.createAggregate ("above", Above{5});
+    db.createWindowFunction ("countabove", Above{5});
+
+    WHEN ("aggregating groups")
+    {
+      const auto ds = db.select (
+          "SELECT grp, wavg (val, weight), above (val) FROM t"
+          " GROUP BY grp ORDER BY grp;");
+
+      THEN ("each group has its own state and Null rows are skipped")
+      {
+        REQUIRE_EQ (ds.size (), 2u);
+        CHECK_EQ (ds[0][1].getReal (), 3.25);
+        CHECK_EQ (ds[1][1].getReal (), 15.0);
+        CHECK_EQ (ds[0][2].getText (), "");
+        CHECK_EQ (ds[1][2].getText (), "10;20;");
+        CHECK_EQ (Above::alive, 2); // the prototypes
+      }
+    }
+
+    WHEN ("aggregating no rows")
+    {
+      THEN ("the result of a fresh state is returned")
+      {
+        CHECK (db.selectValue ("SELECT wavg (val, weight) FROM t"
+                               " WHERE grp = 'x';")
+                   .isNull ());
+        CHECK_EQ (
+            db.selectValue ("SELECT above (val) FROM t WHERE 0;").getText (),
+            "");
+        CHECK_EQ (Above::alive, 2);
+      }
+    }
+
+    WHEN ("using a window function")
+    {
+      const auto ds = db.select (
+          "SELECT countabove (val) OVER (ORDER BY rowid"
+          " ROWS BETWEEN 1 PRECEDING AND CURRENT ROW) FROM t ORDER BY rowid;");
+
+      THEN ("rows leaving the window are removed via inverse")
+      {
+        REQUIRE_EQ (ds.size (), 5u);
+        CHECK_EQ (ds[0][0].getInt (), 0);
+        CHECK_EQ (ds[2][0].getInt (), 1);
+        CHECK_EQ (ds[3][0].getInt (), 1);
+        CHECK_EQ (ds[4][0].getInt (), 1);
+        CHECK_EQ (Above::alive, 2);
+      }
+    }
+
+    WHEN ("the step throws")
+    {
+      db.execute ("INSERT INTO t VALUES ('c', -1, 1.0);");
+
+      THEN ("the query fails and the state is destroyed")
+      {
+        CHECK_THROWS_AS (db.select ("SELECT above (val) FROM t;"),
+                         SQLite3Error);
+        CHECK_EQ (db.getMostRecentErrMsg (), "negative");
+        CHECK_EQ (Above::alive, 2);
+      }
+    }
+  }
+
+  GIVEN ("a closed database")
+  {
+    Database db{":memory:"};
+    Database moved{std::move (db)};
+
+    THEN ("registering an aggregate throws")
+    {
+      CHECK_THROWS_AS (db.createAggregate<WeightedAvg> ("f"),
+                       ErrNoConnection);
+    }
+  }
+}
@@ -0,0 +1,243 @@
+#include "../testing.hpp"
+
+#include <sl3/database.hpp>
+#include <sl3/resultcache.hpp>
+
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+SCENARIO ("change notification hooks")
+{
+  using namespace sl3;
+
+  GIVEN ("a database with a change, commit and rollback handler")
+  {
+    Database db{":memory:"};
+    db.execute ("CREATE TABLE a (x INTEGER);"
+                "CREATE TABLE b (y INTEGER);"
+                "INSERT INTO b VALUES (1);");
+
+    std::vector<ChangeBatch> batches;
+    int                      commits   = 0;
+    int                      rollbacks = 0;
+
+    const auto changes = db.onChanges (
+        [&] (const ChangeBatch& batch) { batches.push_back (batch); });
+    db.onCommit ([&] () {
+      ++commits;
+      return true;
+    });
+    db.onRollback ([&] () { ++rollbacks; });
+
+    WHEN ("a transaction changes multiple rows and tables")
+    {
+      db.execute ("BEGIN;"
+                  "INSERT INTO a VALUES (1), (2), (3);"
+                  "UPDATE b SET y = 2;"
+                  "DELETE FROM a WHERE x = 2;"
+                  "COMMIT;");
+
+      THEN ("the changes are delivered in one batch, grouped by table")
+      {
+        REQUIRE_EQ (batches.size (), 1u);
+        CHECK_EQ (commits, 1);
+
+        const auto& batch = batches[0];
+        REQUIRE_EQ (batch.size (), 2u);
+        CHECK_EQ (batch[0].database, "main");
+        CHECK_EQ (batch[0].table, "a");
+        REQUIRE_EQ (batch[0].rows.size (), 4u);
+        CHECK (batch[0].rows[0].op == ChangeOp::Insert);
+        CHECK_EQ (batch[0].rows[2].rowid, 3);
+        CHECK (batch[0].rows[3].op == ChangeOp::Delete);
+        CHECK_EQ (batch[0].rows[3].rowid, 2);
+
+        CHECK_EQ (batch[1].table, "b");
+        REQUIRE_EQ (batch[1].rows.size (), 1u);
+        CHECK (batch[1].rows[0].op == ChangeOp::Update);
+      }
+    }
+
+    WHEN ("statements run without explicit transaction")
+    {
+      db.execute ("INSERT INTO a VALUES (1);");
+      db.execute ("INSERT INTO a VALUES (2);");
+
+      THEN ("each statement is a batch")
+      {
+        CHECK_EQ (batches.size (), 2u);
+        CHECK_EQ (commits, 2);
+      }
+    }
+
+    WHEN ("a transaction rolls back")
+    {
+      db.execute ("BEGIN;"
+                  "INSERT INTO a VALUES (1);"
+                  "ROLLBACK;");
+      db.execute ("INSERT INTO b VALUES (5);");
+
+      THEN ("its changes are dropped")
+      {
+        CHECK_EQ (rollbacks, 1);
+        REQUIRE_EQ (batches.size (), 1u);
+        REQUIRE_EQ (batches[0].size (), 1u);
+        CHECK_EQ (batches[0][0].table, "b");
+      }
+    }
+
+    WHEN ("a transaction rolls back to a savepoint")
+    {
+      db.execute ("BEGIN;"
+                  "INSERT INTO a VALUES (1);"
+                  "SAVEPOINT s;"
+                  "INSERT INTO a VALUES (2);"
+                  "INSERT INTO a VALUES (3);"
+                  "ROLLBACK TO s;"
+                  "RELEASE s;"
+                  "COMMIT;");
+
+      THEN ("the batch may contain the rolled back rows")
+      {
+        CHECK_EQ (rollbacks, 0);
+        CHECK_EQ (db.selectValue ("SELECT count(*) FROM a;").getInt (), 1);
+        REQUIRE_EQ (batches.size (), 1u);
+        REQUIRE_EQ (batches[0].size (), 1u);
+        const auto& rows = batches[0][0].rows;
+        REQUIRE_EQ (rows.size (), 3u);
+        CHECK_EQ (rows[0].rowid, 1);
+        CHECK (rows[0].op == ChangeOp::Insert);
+      }
+    }
+
+    WHEN ("a commit handler vetoes")
+    {
+      const auto veto = db.onCommit ([] () { return false; });
+
+      THEN ("the commit becomes a rollback")
+      {
+        CHECK_THROWS_AS (db.execute ("INSERT INTO a VALUES (1);"),
+                         SQLite3Error);
+        CHECK_EQ (rollbacks, 1);
+        CHECK (batches.empty ());
+        CHECK_EQ (db.selectValue ("SELECT count(*) FROM a;").getInt (), 0);
+
+        db.removeHook (veto);
+        db.execute ("INSERT INTO a VALUES (1);");
+        CHECK_EQ (batches.size (), 1u);
+      }
+    }
+
+    WHEN ("a change handler throws")
+    {
+      db.onChanges (
+          [] (const ChangeBatch&) { throw std::runtime_error ("observer"); });
+      db.execute ("INSERT INTO a VALUES (1);");
+
+      THEN ("the transaction commits and other handlers get the changes")
+      {
+        CHECK_EQ (rollbacks, 0);
+        CHECK_EQ (batches.size (), 1u);
+        CHECK_EQ (db.selectValue ("SELECT count(*) FROM a;").getInt (), 1);
+      }
+    }
+
+    WHEN ("the change handler is removed")
+    {
+      db.removeHook (changes);
+      db.removeHook (changes);
+      db.execute ("INSERT INTO a VALUES (1);");
+
+      THEN ("it gets no more changes, the other handlers still run")
+      {
+        CHECK (batches.empty ());
+        CHECK_EQ (commits, 1);
+      }
+    }
+
+    WHEN ("a ResultCache uses the same connection")
+    {
+      ResultCache cache{db};
+      const auto  fromB = cache.select ("SELECT * FROM b;");
+      db.removeHook (changes);
+      db.execute ("INSERT INTO a VALUES (1);");
+
+      THEN ("both share the update hook")
+      {
+        CHECK_EQ (cache.select ("SELECT * FROM b;").get (), fromB.get ());
+      }
+    }
+  }
+
+  GIVEN ("a database in WAL mode with a WAL handler")
+  {
+    TempFile file{"sl3_hooks_test.db"};
+    Database db{file.path};
+    db.execute ("PRAGMA journal_mode=WAL;");
+
+    std::string name;
+    int         pages = 0;
+    const auto  wal   = db.onWal ([&] (const std::string& dbName, int n) {
+      name  = dbName;
+      pages = n;
+    });
+
+    WHEN ("a transaction commits")
+    {
+      db.execute ("CREATE TABLE t (x INTEGER); INSERT INTO t VALUES (1);");
+
+      THEN ("the handler gets the database and the pages in the log")
+      {
+        CHECK_EQ (name, "main");
+        CHECK (pages > 0);
+      }
+    }
+
+    WHEN ("the handler is removed")
+    {
+      db.removeHook (wal);
+      db.execute ("CREATE TABLE t (x INTEGER);");
+
+      THEN ("it is not called and the auto checkpoint is back")
+      {
+        CHECK_EQ (pages, 0);
+        CHECK_EQ (
+            db.selectValue ("PRAGMA wal_autocheckpoint;").getInt (), 1000);
+      }
+    }
+  }
+
+  GIVEN ("a database in WAL mode without auto checkpoint")
+  {
+    TempFile file{"sl3_hooks_test.db"};
+    Database db{file.path};
+    db.execute ("PRAGMA journal_mode=WAL; PRAGMA wal_autocheckpoint=0;");
+
+    WHEN ("a WAL handler is added and removed")
+    {
+      db.removeHook (db.onWal ([] (const std::string&, int) {}));
+
+      THEN ("the auto checkpoint setting of the user is restored")
+      {
+        CHECK_EQ (db.selectValue ("PRAGMA wal_autocheckpoint;").getInt (),
+                  0);
+      }
+    }
+  }
+
+  GIVEN ("a closed database")
+  {
+    Database db{":memory:"};
+    Database moved{std::move (db)};
+
+    THEN ("registering hooks throws")
+    {
+      CHECK_THROWS_AS (db.onChanges ([] (const ChangeBatch&) {}),
+                       ErrNoConnection);
+      CHECK_THROWS_AS (db.onWal ([] (const std::string&, int) {}),
+                       ErrNoConnection);
+      CHECK_NOTHROW (db.removeHook (1));
+    }
+  }
+}
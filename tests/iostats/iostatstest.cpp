@@ -0,0 +1,115 @@
+#include "../testing.hpp"
+
+#include <sl3/database.hpp>
+
+#include <cstdint>
+#include <numeric>
+#include <string>
+
+namespace
+{
+  uint64_t
+  histogramTotal (const sl3::IoCounters& counters)
+  {
+    return std::accumulate (
+        counters.latency.begin (), counters.latency.end (), uint64_t{0});
+  }
+}
+
+SCENARIO ("I/O statistics of a database")
+{
+  using namespace sl3;
+
+  GIVEN ("a database file opened with the statistics VFS")
+  {
+    TempFile file{"sl3iostatstest.db"};
+    Database db{file.path, 0, ioStatsVfs ()};
+
+    WHEN ("writing in rollback journal mode")
+    {
+      db.execute ("PRAGMA journal_mode = DELETE;"
+                  "CREATE TABLE t (x);"
+                  "INSERT INTO t VALUES (zeroblob (100000));");
+
+      THEN ("main file and journal operations are counted")
+      {
+        const IoStats stats = db.ioStats ();
+        CHECK (stats.main.write.calls > 0);
+        CHECK (stats.main.write.bytes >= 100000);
+        CHECK (stats.main.sync.calls > 0);
+        CHECK (stats.journal.write.calls > 0);
+        CHECK (stats.journal.sync.calls > 0);
+        CHECK_EQ (stats.wal.write.calls, 0);
+        CHECK_EQ (histogramTotal (stats.main.write),
+                  stats.main.write.calls);
+        CHECK (stats.main.write.nanoseconds > 0);
+      }
+
+      THEN ("reset sets the counters to zero")
+      {
+        db.resetIoStats ();
+        const IoStats stats = db.ioStats ();
+        CHECK_EQ (stats.main.write.calls, 0);
+        CHECK_EQ (stats.journal.sync.calls, 0);
+        CHECK_EQ (histogramTotal (stats.main.write), 0);
+      }
+    }
+
+    WHEN ("writing in WAL mode")
+    {
+      db.execute ("PRAGMA journal_mode = WAL;"
+                  "CREATE TABLE t (x);"
+                  "INSERT INTO t VALUES (zeroblob (50000));");
+
+      THEN ("the WAL operations are counted")
+      {
+        const IoStats stats = db.ioStats ();
+        CHECK (stats.wal.write.calls > 0);
+        CHECK (stats.wal.write.bytes >= 50000);
+      }
+
+      THEN ("other connections have their own counters")
+      {
+        Database other{file.path, 0, ioStatsVfs ()};
+        db.resetIoStats ();
+
+        CHECK_EQ (other.selectValue ("SELECT x = zeroblob (50000) FROM t;")
+                      .getInt (),
+                  1);
+        CHECK (other.ioStats ().wal.read.bytes >= 50000);
+        CHECK_EQ (db.ioStats ().wal.read.calls, 0);
+      }
+    }
+  }
+
+  GIVEN ("a database without the statistics VFS")
+  {
+    Database db{":memory:"};
+    db.execute ("CREATE TABLE t (x); INSERT INTO t VALUES (1);");
+
+    THEN ("all counters are zero")
+    {
+      CHECK_EQ (db.ioStats ().main.write.calls, 0);
+    }
+  }
+
+  GIVEN ("a closed database")
+  {
+    Database db{":memory:"};
+    Database moved{std::move (db)};
+
+    THEN ("reading the counters throws")
+    {
+      CHECK_THROWS_AS (db.ioStats (), ErrNoConnection);
+    }
+  }
+
+  GIVEN ("an unknown VFS")
+  {
+    THEN ("opening throws")
+    {
+      CHECK_THROWS_AS (Database (":memory:", 0, "sl3_no_such_vfs"),
+                       SQLite3Error);
+    }
+  }
+}
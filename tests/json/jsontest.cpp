@@ -0,0 +1,101 @@
+#include "../testing.hpp"
+
+#include <sl3/database.hpp>
+#include <sl3/json.hpp>
+
+#include <sstream>
+#include <string>
+
+SCENARIO ("writing query results as JSON")
+{
+  using namespace sl3;
+
+  GIVEN ("a table with all value types and text that needs escapes")
+  {
+    Database db{":memory:"};
+    db.execute ("CREATE TABLE t (id INTEGER, r REAL, s TEXT, b BLOB);"
+                "INSERT INTO t VALUES (1, 1.5, 'a \"quoted\" \\ path', "
+                "x'00FF10');"
+                "INSERT INTO t VALUES (2, NULL, 'tab\tnew\nline' || "
+                "char(1), x'');");
+
+    WHEN ("writing rows as a JSON array of objects")
+    {
+      std::ostringstream out;
+      JsonWriter         json{out};
+      db.execute ("SELECT * FROM t ORDER BY id;", json);
+
+      THEN ("keys, escaped strings, numbers and base64 blobs are written")
+      {
+        CHECK_EQ (json.rows (), 2u);
+        CHECK_EQ (out.str (),
+                  "[{\"id\":1,\"r\":1.5,"
+                  "\"s\":\"a \\\"quoted\\\" \\\\ path\",\"b\":\"AP8Q\"},\n"
+                  "{\"id\":2,\"r\":null,"
+                  "\"s\":\"tab\\tnew\\nline\\u0001\",\"b\":\"\"}]\n");
+      }
+    }
+
+    WHEN ("writing rows as NDJSON arrays")
+    {
+      std::ostringstream out;
+      JsonWriter         json{out, JsonFormat{true, false}};
+      db.execute ("SELECT id, s FROM t ORDER BY id;", json);
+
+      THEN ("each row is one line")
+      {
+        CHECK_EQ (out.str (),
+                  "[1,\"a \\\"quoted\\\" \\\\ path\"]\n"
+                  "[2,\"tab\\tnew\\nline\\u0001\"]\n");
+      }
+    }
+
+    WHEN ("a query has no rows")
+    {
+      std::ostringstream out;
+      JsonWriter         json{out};
+      db.execute ("SELECT * FROM t WHERE id > 2;", json);
+
+      THEN ("an empty array is written")
+      {
+        CHECK_EQ (out.str (), "[]\n");
+      }
+    }
+
+    WHEN ("writing a large result into a small buffer and a user sink")
+    {
+      std::string data;
+      std::size_t calls = 0;
+      JsonWriter  json{[&] (const char* p, std::size_t size) {
+                        data.append (p, size);
+                        ++calls;
+                      },
+                      JsonFormat{true, true},
+                      64};
+      db.execute ("WITH RECURSIVE c(x) AS (SELECT 1 UNION ALL SELECT x+1 "
+                  "FROM c LIMIT 1000) SELECT x, 1e308 * 10 AS inf FROM c;",
+                  json);
+
+      THEN ("the output streams through the sink")
+      {
+        CHECK_EQ (json.rows (), 1000u);
+        CHECK_GT (calls, 100u);
+        CHECK_EQ (data.substr (0, 38),
+                  "{\"x\":1,\"inf\":null}\n{\"x\":2,\"inf\":null}\n");
+        CHECK_EQ (data.size (), 9u * 19 + 90 * 20 + 900 * 21 + 22);
+      }
+    }
+
+    WHEN ("the sink throws")
+    {
+      JsonWriter json{[] (const char*, std::size_t) {
+                        throw ErrUnexpected ("sink failure");
+                      }};
+      THEN ("executing the query reports the error")
+      {
+        CHECK_THROWS_AS (db.execute ("SELECT * FROM t;", json),
+                         ErrUnexpected);
+      }
+    }
+  }
+}
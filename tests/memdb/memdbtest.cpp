@@ -0,0 +1,122 @@
+#include "../testing.hpp"
+
+#include <sl3/memdb.hpp>
+#include <sl3/readpool.hpp>
+
+#include <sqlite3.h>
+
+#include <cstdint>
+#include <string>
+#include <thread>
+#include <vector>
+
+SCENARIO ("shared in-memory databases")
+{
+  using namespace sl3;
+
+  GIVEN ("a named shared in-memory database with a table")
+  {
+    SharedMemoryDatabase shared{"sl3 memdb/test?1"};
+    auto                 writer = shared.open ();
+    writer.execute ("CREATE TABLE t (id INTEGER PRIMARY KEY, v TEXT);"
+                    "WITH RECURSIVE n(i) AS (SELECT 1 UNION ALL"
+                    " SELECT i + 1 FROM n WHERE i < 1000)"
+                    " INSERT INTO t SELECT i, 'v' || i FROM n;");
+
+    THEN ("the uri uses the memdb VFS and escapes the name")
+    {
+      CHECK_EQ (shared.getName (), "sl3 memdb/test?1");
+      CHECK_EQ (shared.getUri (), "file:/sl3%20memdb/test%3F1?vfs=memdb");
+    }
+
+    THEN ("other connections see the data")
+    {
+      auto reader = shared.open (SQLITE_OPEN_READONLY);
+      CHECK_EQ (reader.selectValue ("SELECT count(*) FROM t;").getInt (),
+                1000);
+      CHECK_THROWS_AS (reader.execute ("DELETE FROM t;"), SQLite3Error);
+    }
+
+    THEN ("connections in other threads see the data")
+    {
+      std::vector<int64_t>     counts (4, 0);
+      std::vector<std::thread> threads;
+      for (std::size_t i = 0; i < counts.size (); ++i)
+        {
+          threads.emplace_back ([&shared, &counts, i] {
+            auto db = shared.open ();
+            counts[i]
+                = db.selectValue ("SELECT count(*) FROM t;").getInt ();
+          });
+        }
+      for (auto& thread : threads)
+        thread.join ();
+
+      CHECK (counts == std::vector<int64_t> (4, 1000));
+    }
+
+    THEN ("a second instance with the same name uses the same data")
+    {
+      SharedMemoryDatabase same{"sl3 memdb/test?1"};
+      CHECK_EQ (same.open ().selectValue ("SELECT count(*) FROM t;").getInt (),
+                1000);
+    }
+
+    THEN ("the memory usage is reported")
+    {
+      const auto used = shared.memoryUsed ();
+      CHECK (used > 1000 * 4);
+
+      writer.execute ("INSERT INTO t (v) SELECT zeroblob (10000) FROM t;");
+      CHECK (shared.memoryUsed () > used + 1000 * 10000);
+    }
+
+    THEN ("a ReadPool scans it in parallel")
+    {
+      ReadPool pool{shared, 3};
+      ScanPlan plan;
+      plan.table = "t";
+      auto ds    = pool.select (
+          "SELECT id FROM t WHERE id BETWEEN :first AND :last;", plan);
+      CHECK_EQ (ds.size (), 1000);
+    }
+  }
+
+  GIVEN ("a shared database and an open connection to it")
+  {
+    auto connection = [] {
+      SharedMemoryDatabase shared{"sl3memdb-lifetime"};
+      auto                 db = shared.open ();
+      db.execute ("CREATE TABLE t (x); INSERT INTO t VALUES (1);");
+      return db;
+    }();
+
+    THEN ("the data lives while a connection is open")
+    {
+      SharedMemoryDatabase again{"sl3memdb-lifetime"};
+      CHECK_EQ (again.open ().selectValue ("SELECT x FROM t;").getInt (), 1);
+    }
+
+    WHEN ("the last connection closes")
+    {
+      {
+        Database closed{std::move (connection)};
+      }
+
+      THEN ("the data is gone")
+      {
+        SharedMemoryDatabase again{"sl3memdb-lifetime"};
+        CHECK_THROWS_AS (again.open ().execute ("SELECT x FROM t;"),
+                         SQLite3Error);
+      }
+    }
+  }
+
+  GIVEN ("an empty name")
+  {
+    THEN ("construction throws")
+    {
+      CHECK_THROWS_AS (SharedMemoryDatabase{""}, ErrOutOfRange);
+    }
+  }
+}
@@ -0,0 +1,147 @@
+#include "../testing.hpp"
+
+#include <sl3/database.hpp>
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+#include <vector>
+
+SCENARIO ("binding borrowed parameters")
+{
+  using namespace sl3;
+
+  GIVEN ("a table for all types")
+  {
+    Database db{":memory:"};
+    db.execute ("CREATE TABLE t (i, r, s, b);");
+    auto insert = db.prepare ("INSERT INTO t VALUES (?, ?, ?, ?);");
+
+    WHEN ("inserting values from views")
+    {
+      const std::string text{"some text"};
+      const Blob        blob{std::byte{1}, std::byte{2}, std::byte{3}};
+      insert.execute (ParamView{42, 1.5, std::string_view{text}, blob});
+
+      THEN ("the values are stored")
+      {
+        auto ds = db.select ("SELECT i, r, s, b FROM t;");
+        REQUIRE_EQ (ds.size (), 1);
+        CHECK_EQ (ds[0][0].getInt (), 42);
+        CHECK_EQ (ds[0][1].getReal (), 1.5);
+        CHECK_EQ (ds[0][2].getText (), text);
+        CHECK_EQ (ds[0][3].getBlob (), blob);
+      }
+
+      THEN ("the command does not keep the borrowed values")
+      {
+        CHECK_EQ (insert.getParameters ().size (), 4);
+        insert.execute ();
+        auto ds = db.select ("SELECT count(*) FROM t WHERE s IS NULL;");
+        CHECK_EQ (ds[0][0].getInt (), 1);
+      }
+    }
+
+    WHEN ("inserting empty texts and blobs")
+    {
+      const Blob empty{};
+      insert.execute (
+          ParamView{nullptr, ParamValue{}, std::string_view{}, empty});
+      insert.execute (ParamView{1, 2.0, "", BlobView{nullptr, 0}});
+
+      THEN ("they are empty values, not null")
+      {
+        auto ds = db.select ("SELECT typeof (i), typeof (r), typeof (s),"
+                             " typeof (b), length (s), length (b) FROM t;");
+        REQUIRE_EQ (ds.size (), 2);
+        CHECK_EQ (ds[0][0].getText (), "null");
+        CHECK_EQ (ds[0][1].getText (), "null");
+        for (std::size_t row = 0; row < 2; ++row)
+          {
+            CHECK_EQ (ds[row][2].getText (), "text");
+            CHECK_EQ (ds[row][3].getText (), "blob");
+            CHECK_EQ (ds[row][4].getInt (), 0);
+            CHECK_EQ (ds[row][5].getInt (), 0);
+          }
+        CHECK_EQ (db.selectValue ("SELECT count(*) FROM t"
+                                  " WHERE s = '' AND b = X'';")
+                      .getInt (),
+                  2);
+      }
+    }
+
+    WHEN ("inserting an empty blob as DbValue")
+    {
+      insert.execute ({DbValue{1}, DbValue{2.0}, DbValue{""}, DbValue{Blob{}}});
+
+      THEN ("it is an empty blob, not null")
+      {
+        CHECK_EQ (db.selectValue ("SELECT typeof (b) FROM t;").getText (),
+                  "blob");
+      }
+    }
+
+    WHEN ("inserting a large payload")
+    {
+      const std::string payload (1000000, 'x');
+      insert.execute (ParamView{1, 1.0, payload, BlobView{payload.data (),
+                                                          payload.size ()}});
+
+      THEN ("it is stored completely")
+      {
+        CHECK_EQ (
+            db.selectValue ("SELECT length (s) + length (b) FROM t;").getInt (),
+            2000000);
+      }
+    }
+
+    WHEN ("the number of values does not match")
+    {
+      THEN ("binding throws")
+      {
+        CHECK_THROWS_AS (insert.execute (ParamView{1, 2}), ErrTypeMisMatch);
+        CHECK_THROWS_AS (insert.execute (ParamView{1, 2, 3, 4, 5}),
+                         ErrTypeMisMatch);
+      }
+    }
+  }
+
+  GIVEN ("a query")
+  {
+    Database db{":memory:"};
+    auto     cmd = db.prepare ("SELECT ? || ?, ?;");
+
+    WHEN ("selecting with a view")
+    {
+      const std::string a{"ab"};
+      auto ds = cmd.select (ParamView{a, "cd", 3}, {Type::Text, Type::Int});
+
+      THEN ("the parameters are used")
+      {
+        REQUIRE_EQ (ds.size (), 1);
+        CHECK_EQ (ds[0][0].getText (), "abcd");
+        CHECK_EQ (ds[0][1].getInt (), 3);
+      }
+    }
+
+    WHEN ("building the view from a vector")
+    {
+      std::vector<ParamValue> values{"x", "y", 1};
+      ParamView               view{std::move (values)};
+
+      THEN ("it can be used with a callback")
+      {
+        std::string result;
+        cmd.execute (
+            [&result] (Columns cols) {
+              result = cols.getText (0);
+              return true;
+            },
+            view);
+        CHECK_EQ (result, "xy");
+        CHECK_EQ (view.size (), 3);
+        CHECK_THROWS_AS (view.at (3), ErrOutOfRange);
+      }
+    }
+  }
+}
@@ -0,0 +1,212 @@
+#include "../testing.hpp"
+
+#include <sl3/database.hpp>
+#include <sl3/readpool.hpp>
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace
+{
+  const char* const scanSql
+      = "SELECT rowid, v FROM t WHERE rowid BETWEEN :first AND :last"
+        " ORDER BY rowid;";
+}
+
+SCENARIO ("scanning a table in parallel")
+{
+  using namespace sl3;
+
+  GIVEN ("a database file with a table of 10000 rows")
+  {
+    TempFile file{"sl3_readpool_test.db"};
+    Database   db{file.path};
+    db.execute ("PRAGMA journal_mode = WAL;"
+                "CREATE TABLE t (v INTEGER);"
+                "WITH RECURSIVE c(x) AS (SELECT 1 UNION ALL SELECT x+1 FROM c "
+                "LIMIT 10000) INSERT INTO t SELECT x * 2 FROM c;");
+
+    ReadPool pool{db, 4};
+    REQUIRE_EQ (pool.size (), 4u);
+
+    WHEN ("selecting all rows")
+    {
+      auto ds = pool.select (scanSql, ScanPlan{"t"});
+
+      THEN ("the merged result has all rows in key order")
+      {
+        REQUIRE_EQ (ds.size (), 10000u);
+        CHECK_EQ (ds.getIndex ("v"), 1u);
+        bool ordered = true;
+        for (std::size_t i = 0; i < ds.size () && ordered; ++i)
+          ordered = ds[i][0].getInt () == static_cast<int64_t> (i + 1)
+                    && ds[i][1].getInt () == 2 * ds[i][0].getInt ();
+        CHECK (ordered);
+      }
+    }
+
+    WHEN ("using more partitions than connections and typed fields")
+    {
+      ScanPlan plan{"t"};
+      plan.partitions = 7;
+      plan.snapshot   = false;
+      auto ds = pool.select (scanSql, plan, {Type::Int, Type::Int});
+
+      THEN ("all rows are there")
+      {
+        CHECK_EQ (ds.size (), 10000u);
+        CHECK_EQ (ds[9999][0].getInt (), 10000);
+      }
+    }
+
+    WHEN ("streaming to a partition callback")
+    {
+      std::atomic<int64_t> sum{0};
+      std::mutex           mtx;
+      std::set<std::size_t> partitions;
+
+      pool.execute ("SELECT rowid, v FROM t WHERE v >= :first "
+                    "AND v <= :last;",
+                    ScanPlan{"t", "v", 3},
+                    [&] (std::size_t partition, Columns cols) {
+                      sum += cols.getInt64 (1);
+                      std::lock_guard<std::mutex> lock{mtx};
+                      partitions.insert (partition);
+                      return true;
+                    });
+
+      THEN ("each row is seen once, from 3 partitions of the key")
+      {
+        CHECK_EQ (sum.load (), int64_t{10000} * 10001);
+        CHECK (partitions == std::set<std::size_t>{0, 1, 2});
+      }
+    }
+
+    WHEN ("a writer commits during the scan")
+    {
+      std::atomic<bool> written{false};
+      Database          writer{file.path};
+      std::size_t       count = 0;
+      std::mutex        mtx;
+
+      pool.execute (scanSql,
+                    ScanPlan{"t"},
+                    [&] (std::size_t, Columns) {
+                      if (!written.exchange (true))
+                        writer.execute ("DELETE FROM t WHERE rowid > 5000;");
+                      std::lock_guard<std::mutex> lock{mtx};
+                      ++count;
+                      return true;
+                    });
+
+      THEN ("the scan still reads its snapshot")
+      {
+        CHECK_EQ (count, 10000u);
+        CHECK_EQ (db.selectValue ("SELECT count(*) FROM t;").getInt (), 5000);
+      }
+    }
+
+    WHEN ("the keys span the whole integer range")
+    {
+      db.execute ("CREATE TABLE u (k INTEGER PRIMARY KEY);"
+                  "INSERT INTO u VALUES (-9223372036854775808);"
+                  "INSERT INTO u VALUES (0);"
+                  "INSERT INTO u VALUES (9223372036854775807);");
+      ScanPlan plan{"u", "k", 4};
+      auto     ds = pool.select (
+          "SELECT k FROM u WHERE k BETWEEN :first AND :last;", plan);
+
+      THEN ("the partitions do not overflow")
+      {
+        REQUIRE_EQ (ds.size (), 3u);
+        CHECK_EQ (ds[0][0].getInt (), INT64_MIN);
+        CHECK_EQ (ds[2][0].getInt (), INT64_MAX);
+      }
+    }
+
+    WHEN ("the table is empty")
+    {
+      db.execute ("DELETE FROM t;");
+      auto ds = pool.select (scanSql, ScanPlan{"t"});
+
+      THEN ("the result is empty")
+      {
+        CHECK_EQ (ds.size (), 0u);
+      }
+    }
+
+    WHEN ("using invalid queries and plans")
+    {
+      THEN ("the scan throws")
+      {
+        CHECK_THROWS_AS (pool.select ("SELECT * FROM t;", ScanPlan{"t"}),
+                         ErrTypeMisMatch);
+        CHECK_THROWS_AS (pool.select ("SELECT * FROM t WHERE rowid "
+                                      "BETWEEN :first AND :end;",
+                                      ScanPlan{"t"}),
+                         ErrTypeMisMatch);
+        CHECK_THROWS_AS (pool.select (scanSql, ScanPlan{}), ErrOutOfRange);
+        CHECK_THROWS_AS (pool.select (scanSql, ScanPlan{"nope"}),
+                         SQLite3Error);
+        CHECK_THROWS_AS (pool.execute (scanSql, ScanPlan{"t"}, nullptr),
+                         ErrNullValueAccess);
+      }
+    }
+  }
+
+  GIVEN ("a database file in rollback journal mode and a locking writer")
+  {
+    TempFile file{"sl3_readpool_busy_test.db"};
+    Database   db{file.path};
+    db.execute ("CREATE TABLE t (v INTEGER);"
+                "INSERT INTO t VALUES (1), (2), (3);");
+
+    ReadPool pool{db, 2};
+    Database writer{file.path};
+    writer.execute ("BEGIN EXCLUSIVE;");
+
+    WHEN ("the writer commits while the scan waits")
+    {
+      std::thread commit{[&writer] {
+        std::this_thread::sleep_for (std::chrono::milliseconds{100});
+        writer.execute ("COMMIT;");
+      }};
+      auto ds = pool.select (scanSql, ScanPlan{"t"});
+      commit.join ();
+
+      THEN ("the readers waited for the lock")
+      {
+        CHECK_EQ (ds.size (), 3u);
+      }
+    }
+
+    WHEN ("the pool does not wait for locks")
+    {
+      pool.setBusyPolicy (BusyPolicy{});
+      ScanPlan plan{"t"};
+      plan.snapshot = false;
+
+      THEN ("the scan fails with busy")
+      {
+        CHECK_THROWS_AS (pool.select (scanSql, plan), SQLite3Error);
+        writer.execute ("COMMIT;");
+        CHECK_EQ (pool.select (scanSql, plan).size (), 3u);
+      }
+    }
+  }
+
+  GIVEN ("an in memory database")
+  {
+    Database db{":memory:"};
+    THEN ("it can not be shared by a pool")
+    {
+      CHECK_THROWS_AS (ReadPool (db, 2), ErrNoConnection);
+    }
+  }
+}
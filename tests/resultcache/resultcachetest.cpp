@@ -0,0 +1,221 @@
+#include "../testing.hpp"
+
+#include <sl3/database.hpp>
+#include <sl3/resultcache.hpp>
+
+#include <sqlite3.h>
+
+#include <string>
+
+SCENARIO ("caching query results")
+{
+  using namespace sl3;
+
+  GIVEN ("a database with two tables and a cache")
+  {
+    Database db{":memory:"};
+    db.execute ("CREATE TABLE a (x INTEGER);"
+                "CREATE TABLE b (y INTEGER);"
+                "INSERT INTO a VALUES (1), (2);"
+                "INSERT INTO b VALUES (10);");
+
+    ResultCache cache{db};
+
+    const auto countA = [&] () {
+      return cache.select ("SELECT count(*) FROM a;")->at (0).at (0).getInt ();
+    };
+
+    WHEN ("selecting the same query twice")
+    {
+      const auto first  = cache.select ("SELECT * FROM a WHERE x > ?;",
+                                       parameters (0));
+      const auto second = cache.select ("SELECT * FROM a WHERE x > ?;",
+                                        parameters (0));
+      const auto other  = cache.select ("SELECT * FROM a WHERE x > ?;",
+                                       parameters (1));
+
+      THEN ("the second select is served from the cache")
+      {
+        CHECK_EQ (first.get (), second.get ());
+        CHECK_EQ (first->size (), 2u);
+        CHECK_EQ (other->size (), 1u);
+
+        const auto stats = cache.stats ();
+        CHECK_EQ (stats.hits, 1u);
+        CHECK_EQ (stats.misses, 2u);
+        CHECK_EQ (stats.entries, 2u);
+        CHECK (stats.bytes > 0u);
+        CHECK (stats.hitRatio () > 0.3);
+        CHECK (stats.hitRatio () < 0.4);
+      }
+    }
+
+    WHEN ("a table the query reads is changed")
+    {
+      CHECK_EQ (countA (), 2);
+      const auto fromB = cache.select ("SELECT * FROM b;");
+      db.execute ("INSERT INTO a VALUES (3);");
+
+      THEN ("only the entries of that table are invalidated")
+      {
+        CHECK_EQ (countA (), 3);
+        CHECK_EQ (cache.select ("SELECT * FROM b;").get (), fromB.get ());
+        CHECK_EQ (cache.stats ().invalidations, 1u);
+        CHECK_EQ (cache.stats ().hits, 1u);
+      }
+    }
+
+    WHEN ("a view reads the changed table")
+    {
+      db.execute ("CREATE VIEW va AS SELECT x FROM a;");
+      CHECK_EQ (cache.select ("SELECT * FROM va;")->size (), 2u);
+      db.execute ("UPDATE a SET x = 5 WHERE x = 1;");
+
+      THEN ("the entry of the view is invalidated")
+      {
+        const auto rows = cache.select ("SELECT * FROM va ORDER BY x;");
+        REQUIRE_EQ (rows->size (), 2u);
+        CHECK_EQ (rows->at (1).at (0).getInt (), 5);
+      }
+    }
+
+    WHEN ("all rows are deleted without WHERE")
+    {
+      CHECK_EQ (countA (), 2);
+      db.execute ("DELETE FROM a;");
+
+      THEN ("the change is found even without update hook events")
+      {
+        CHECK_EQ (countA (), 0);
+      }
+    }
+
+    WHEN ("a WITHOUT ROWID table is changed")
+    {
+      db.execute ("CREATE TABLE w (k INTEGER PRIMARY KEY) WITHOUT ROWID;");
+      CHECK_EQ (
+          cache.select ("SELECT count(*) FROM w;")->at (0).at (0).getInt (),
+          0);
+      db.execute ("INSERT INTO w VALUES (1);");
+
+      THEN ("the change is found")
+      {
+        CHECK_EQ (
+            cache.select ("SELECT count(*) FROM w;")->at (0).at (0).getInt (),
+            1);
+      }
+    }
+
+    WHEN ("selecting inside a transaction")
+    {
+      CHECK_EQ (countA (), 2);
+      db.execute ("BEGIN;");
+      db.execute ("INSERT INTO a VALUES (3);");
+
+      THEN ("the cache is bypassed and uncommitted data is not cached")
+      {
+        CHECK_EQ (countA (), 3);
+        db.execute ("ROLLBACK;");
+        CHECK_EQ (countA (), 2);
+      }
+    }
+
+    WHEN ("running a statement that writes")
+    {
+      cache.select ("INSERT INTO a VALUES (3);");
+
+      THEN ("it is not cached")
+      {
+        CHECK_EQ (cache.stats ().entries, 0u);
+        cache.select ("INSERT INTO a VALUES (3);");
+        CHECK_EQ (countA (), 4);
+      }
+    }
+
+    WHEN ("invalidating by hand")
+    {
+      CHECK_EQ (countA (), 2);
+      cache.select ("SELECT * FROM b;");
+      cache.invalidate ("a");
+      CHECK_EQ (cache.stats ().entries, 1u);
+      cache.invalidate ();
+
+      THEN ("the entries are gone")
+      {
+        CHECK_EQ (cache.stats ().entries, 0u);
+        CHECK_EQ (cache.stats ().bytes, 0u);
+        CHECK_EQ (cache.stats ().invalidations, 2u);
+      }
+    }
+
+    WHEN ("the database has an authorizer")
+    {
+      db.setAuthorizer ([] (int action, const char* table, const char*,
+                            const char*, const char*) {
+        return action == SQLITE_READ && std::string{table} == "b"
+                   ? SQLITE_DENY
+                   : SQLITE_OK;
+      });
+      CHECK_EQ (countA (), 2);
+
+      THEN ("the cache keeps it")
+      {
+        CHECK_THROWS_AS (cache.select ("SELECT * FROM b;"), SQLite3Error);
+        CHECK_THROWS_AS (db.execute ("SELECT * FROM b;"), SQLite3Error);
+
+        db.execute ("INSERT INTO a VALUES (3);");
+        CHECK_EQ (countA (), 3);
+
+        db.setAuthorizer (nullptr);
+        CHECK_EQ (db.select ("SELECT * FROM b;").size (), 1u);
+      }
+    }
+  }
+
+  GIVEN ("a cache with a limit of two entries")
+  {
+    Database db{":memory:"};
+    CacheOptions options;
+    options.maxEntries = 2;
+    ResultCache cache{db, options};
+
+    WHEN ("selecting three queries")
+    {
+      const auto one = cache.select ("SELECT 1;");
+      cache.select ("SELECT 2;");
+      CHECK_EQ (cache.select ("SELECT 1;").get (), one.get ());
+      cache.select ("SELECT 3;");
+
+      THEN ("the least recently used entry is evicted")
+      {
+        CHECK_EQ (cache.stats ().evictions, 1u);
+        CHECK_EQ (cache.stats ().entries, 2u);
+        CHECK_EQ (cache.select ("SELECT 1;").get (), one.get ());
+        cache.select ("SELECT 2;");
+        CHECK_EQ (cache.stats ().misses, 4u);
+      }
+    }
+  }
+
+  GIVEN ("a database file changed by another connection")
+  {
+    TempFile file{"sl3_resultcache_test.db"};
+    Database db{file.path};
+    db.execute ("CREATE TABLE t (x INTEGER); INSERT INTO t VALUES (1);");
+    ResultCache cache{db};
+    CHECK_EQ (cache.select ("SELECT * FROM t;")->size (), 1u);
+
+    WHEN ("the other connection inserts a row")
+    {
+      {
+        Database other{file.path};
+        other.execute ("INSERT INTO t VALUES (2);");
+      }
+
+      THEN ("the cache notices via data_version")
+      {
+        CHECK_EQ (cache.select ("SELECT * FROM t;")->size (), 2u);
+      }
+    }
+  }
+}
@@ -0,0 +1,97 @@
+#include "../testing.hpp"
+
+#include <sl3/database.hpp>
+#include <sl3/slowio.hpp>
+
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <string>
+
+namespace
+{
+  template <typename Fn>
+  std::chrono::nanoseconds
+  timed (Fn&& fn)
+  {
+    const auto start = std::chrono::steady_clock::now ();
+    fn ();
+    return std::chrono::steady_clock::now () - start;
+  }
+}
+
+SCENARIO ("slow storage simulation")
+{
+  using namespace sl3;
+  using std::chrono::milliseconds;
+  using std::chrono::nanoseconds;
+
+  GIVEN ("a VFS with sync latency and a write throughput limit")
+  {
+    IoLimits limits;
+    limits.sync.latency         = milliseconds{5};
+    limits.write.bytesPerSecond = 10 * 1000 * 1000;
+
+    TempFile file{"sl3slowiotest.db"};
+    Database db{file.path, 0, slowIoVfs ("sl3_slowio_test", limits)};
+    db.execute ("PRAGMA journal_mode = DELETE; CREATE TABLE t (x);");
+    db.resetIoStats ();
+
+    WHEN ("committing a transaction")
+    {
+      const auto elapsed = timed ([&db] {
+        db.execute ("INSERT INTO t VALUES (zeroblob (100000));");
+      });
+
+      THEN ("each sync and each written byte is delayed")
+      {
+        const IoStats stats = db.ioStats ();
+        const auto    syncs = stats.main.sync.calls + stats.journal.sync.calls;
+        const auto    bytes
+            = stats.main.write.bytes + stats.journal.write.bytes;
+        CHECK (syncs > 0);
+        CHECK (bytes >= 100000);
+
+        const auto expected = milliseconds{5} * static_cast<int64_t> (syncs)
+                              + nanoseconds{static_cast<int64_t> (bytes) * 100};
+        CHECK (elapsed >= expected);
+        CHECK (stats.main.sync.nanoseconds
+               >= stats.main.sync.calls * uint64_t{5000000});
+      }
+    }
+  }
+
+  GIVEN ("a VFS with a write latency of seconds")
+  {
+    IoLimits limits;
+    limits.write.latency = std::chrono::seconds{10};
+    slowIoVfs ("sl3_slowio_update", limits);
+
+    TempFile file{"sl3slowioupdate.db"};
+    Database db{file.path, 0, "sl3_slowio_update"};
+
+    WHEN ("the limits are removed")
+    {
+      slowIoVfs ("sl3_slowio_update", IoLimits{});
+
+      THEN ("writes of open databases are not delayed")
+      {
+        const auto elapsed = timed ([&db] {
+          db.execute ("CREATE TABLE t (x); INSERT INTO t VALUES (1);");
+        });
+        CHECK (db.ioStats ().main.write.calls > 0);
+        CHECK (elapsed < std::chrono::seconds{10});
+      }
+    }
+  }
+
+  GIVEN ("names of other VFS")
+  {
+    THEN ("they can not be used")
+    {
+      CHECK_THROWS_AS (slowIoVfs ("", IoLimits{}), ErrOutOfRange);
+      CHECK_THROWS_AS (slowIoVfs ("memdb", IoLimits{}), ErrOutOfRange);
+      CHECK_THROWS_AS (slowIoVfs (ioStatsVfs (), IoLimits{}), ErrOutOfRange);
+    }
+  }
+}
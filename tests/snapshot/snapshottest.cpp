@@ -0,0 +1,162 @@
+#include "../testing.hpp"
+
+#include <sl3/database.hpp>
+#include <sl3/snapshot.hpp>
+
+#include <filesystem>
+#include <fstream>
+#include <string>
+
+SCENARIO ("writing and mapping Dataset snapshots")
+{
+  using namespace sl3;
+
+  GIVEN ("a Dataset with typed and Variant fields and Null values")
+  {
+    Database db{":memory:"};
+    db.execute ("CREATE TABLE t (id INTEGER, r REAL, s TEXT, v);"
+                "INSERT INTO t VALUES (1, 1.5, 'one', x'0001');"
+                "INSERT INTO t VALUES (2, NULL, '', 'text');"
+                "INSERT INTO t VALUES (-9223372036854775808, -0.25, NULL, 7);");
+
+    const auto ds = db.select ("SELECT * FROM t ORDER BY rowid;",
+                               {Type::Int, Type::Real, Type::Text,
+                                Type::Variant});
+
+    TempFile file{"sl3_snapshot_test.bin"};
+    writeSnapshot (ds, file.path);
+
+    WHEN ("mapping the snapshot")
+    {
+      DatasetView view{file.path};
+
+      THEN ("names, types and values are read in place")
+      {
+        REQUIRE_EQ (view.size (), 3u);
+        CHECK (view.getNames ()
+               == std::vector<std::string>{"id", "r", "s", "v"});
+        CHECK_EQ (view.getTypes ().size (), 4u);
+        CHECK_EQ (view.getTypes ()[3], Type::Variant);
+        CHECK_EQ (view.getIndex ("s"), 2u);
+
+        CHECK_EQ (view.getInt (0, 0), 1);
+        CHECK_EQ (view.getInt (2, 0), INT64_MIN);
+        CHECK_EQ (view.getReal (2, 1), -0.25);
+        CHECK (view.isNull (1, 1));
+        CHECK_EQ (view.getText (0, 2), "one");
+        CHECK_EQ (view.getText (1, 2), "");
+        CHECK (view.getBlob (0, 3) == std::string_view{"\0\1", 2});
+        CHECK_EQ (view.getType (1, 3), Type::Text);
+        CHECK_EQ (view.getType (2, 3), Type::Int);
+      }
+
+      AND_THEN ("a copy into a Dataset equals the original")
+      {
+        const auto copy = view.toDataset ();
+        REQUIRE_EQ (copy.size (), ds.size ());
+        for (std::size_t row = 0; row < ds.size (); ++row)
+          for (std::size_t field = 0; field < 4; ++field)
+            {
+              CHECK (value_type_eq (copy[row][field].getValue (),
+                                    ds[row][field].getValue ()));
+              CHECK_EQ (copy[row][field].dbtype (), ds[row][field].dbtype ());
+            }
+        CHECK (copy.getNames () == ds.getNames ());
+        CHECK_EQ (copy.getIndex ("v"), 3u);
+      }
+
+      AND_THEN ("wrong access throws")
+      {
+        CHECK_THROWS_AS (view.getInt (3, 0), ErrOutOfRange);
+        CHECK_THROWS_AS (view.getInt (0, 4), ErrOutOfRange);
+        CHECK_THROWS_AS (view.getValue (0, 5), ErrOutOfRange);
+        CHECK_THROWS_AS (view.getValue (3, 0), ErrOutOfRange);
+        CHECK_THROWS_AS (view.getText (0, 0), ErrTypeMisMatch);
+        CHECK_THROWS_AS (view.getReal (1, 1), ErrNullValueAccess);
+        CHECK_THROWS_AS (view.getIndex ("x"), ErrOutOfRange);
+      }
+    }
+
+    WHEN ("replacing the snapshot while it is mapped")
+    {
+      DatasetView old{file.path};
+      writeSnapshot (db.select ("SELECT 42 AS answer;"), file.path);
+      DatasetView current{file.path};
+
+      THEN ("the open view still sees the old data")
+      {
+        CHECK_EQ (old.size (), 3u);
+        CHECK_EQ (old.getText (0, 2), "one");
+        CHECK_EQ (current.size (), 1u);
+        CHECK_EQ (current.getInt (0, 0), 42);
+      }
+
+      AND_THEN ("no temporary file is left")
+      {
+        const auto name = std::filesystem::path{file.path}.filename ();
+        for (const auto& entry : std::filesystem::directory_iterator{
+                 std::filesystem::path{file.path}.parent_path ()})
+          {
+            const auto other = entry.path ().filename ().string ();
+            CHECK_FALSE (other != name.string ()
+                         && other.rfind (name.string () + ".", 0) == 0);
+          }
+      }
+    }
+  }
+
+  GIVEN ("files that are no snapshots")
+  {
+    TempFile file{"sl3_snapshot_invalid.bin"};
+
+    WHEN ("opening a missing file")
+    {
+      THEN ("the view throws")
+      {
+        CHECK_THROWS_AS (DatasetView{file.path}, ErrUnexpected);
+      }
+    }
+
+    WHEN ("opening a file with other content")
+    {
+      std::ofstream{file.path} << "this is not a snapshot, but long enough "
+                                  "for a header";
+      THEN ("the view throws")
+      {
+        CHECK_THROWS_AS (DatasetView{file.path}, ErrUnexpected);
+      }
+    }
+  }
+
+  GIVEN ("an empty Dataset with types")
+  {
+    TempFile file{"sl3_snapshot_empty.bin"};
+    writeSnapshot (Dataset{{Type::Int, Type::Text}}, file.path);
+
+    WHEN ("mapping it")
+    {
+      DatasetView view{file.path};
+
+      THEN ("it has the types and no rows")
+      {
+        CHECK_EQ (view.size (), 0u);
+        CHECK_EQ (view.getTypes ().size (), 2u);
+        CHECK_EQ (view.toDataset ().size (), 0u);
+      }
+    }
+  }
+
+  GIVEN ("an untyped Dataset with rows of different sizes")
+  {
+    TempFile file{"sl3_snapshot_ragged.bin"};
+    Dataset  ds;
+    ds.merge (DbValues{DbValue{1}, DbValue{2}, DbValue{3}});
+    ds.merge (DbValues{DbValue{4}});
+
+    THEN ("writing a snapshot throws and leaves no file")
+    {
+      CHECK_THROWS_AS (writeSnapshot (ds, file.path), ErrTypeMisMatch);
+      CHECK_FALSE (std::filesystem::exists (file.path));
+    }
+  }
+}
@@ -1,5 +1,32 @@
 #pragma once
 
 #include <doctest/doctest.h>
+#include <filesystem>
 #include <iostream>
 #include <string>
+
+// a file in the temp directory that is removed at the start and the end
+// of a test, together with the journal and WAL files of a database
+struct TempFile
+{
+  explicit TempFile (const std::string& name)
+  : path ((std::filesystem::temp_directory_path () / name).string ())
+  {
+    clean ();
+  }
+
+  ~TempFile () { clean (); }
+
+  TempFile (const TempFile&)            = delete;
+  TempFile& operator= (const TempFile&) = delete;
+
+  void
+  clean ()
+  {
+    std::error_code ec;
+    for (const char* suffix : {"", "-wal", "-shm", "-journal"})
+      std::filesystem::remove (path + suffix, ec);
+  }
+
+  std::string path;
+};
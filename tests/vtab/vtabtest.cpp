@@ -0,0 +1,316 @@
+#include "../testing.hpp"
+
+#include <sl3/database.hpp>
+
+#include <memory>
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace
+{
+  struct Price
+  {
+    int64_t               id;
+    std::string           name;
+    std::optional<double> value;
+  };
+
+  sl3::Dataset
+  numbers (std::size_t count)
+  {
+    sl3::Dataset ds{{sl3::Type::Int, sl3::Type::Text}};
+    for (std::size_t i = 0; i < count; ++i)
+      {
+        const auto id = static_cast<int64_t> (count - i);
+        ds.merge (sl3::DbValues{sl3::DbValue{id},
+                                sl3::DbValue{"n" + std::to_string (id)}});
+      }
+    return ds;
+  }
+
+  int64_t
+  count (sl3::Database& db, const std::string& sql)
+  {
+    return db.selectValue (sql).getInt ();
+  }
+}
+
+SCENARIO ("query a Dataset as table")
+{
+  using namespace sl3;
+
+  GIVEN ("a database and a Dataset without index")
+  {
+    Database db{":memory:"};
+    auto     ds = numbers (10);
+
+    WHEN ("registering it as virtual table")
+    {
+      db.createVirtualTable ("nums", ds);
+
+      THEN ("all rows can be selected without create virtual table")
+      {
+        CHECK_EQ (count (db, "SELECT count(*) FROM nums;"), 10);
+        CHECK_EQ (count (db, "SELECT sum(column1) FROM nums;"), 55);
+      }
+
+      THEN ("columns have the declared types")
+      {
+        auto types = db.select ("SELECT typeof(column1), typeof(column2)"
+                                " FROM nums LIMIT 1;");
+        REQUIRE_EQ (types.size (), 1);
+        CHECK_EQ (types[0][0].getText (), "integer");
+        CHECK_EQ (types[0][1].getText (), "text");
+      }
+
+      THEN ("constraints without index scan all rows")
+      {
+        CHECK_EQ (db.selectValue ("SELECT column2 FROM nums"
+                                  " WHERE column1 = 7;")
+                      .getText (),
+                  "n7");
+      }
+
+      THEN ("it can be joined with a real table")
+      {
+        db.execute ("CREATE TABLE t (id INTEGER, label TEXT);"
+                    "INSERT INTO t VALUES (3, 'three'), (11, 'eleven');");
+        auto rows = db.select ("SELECT label, column2 FROM t"
+                               " JOIN nums ON column1 = id;");
+        REQUIRE_EQ (rows.size (), 1);
+        CHECK_EQ (rows[0][0].getText (), "three");
+        CHECK_EQ (rows[0][1].getText (), "n3");
+      }
+
+      THEN ("the table can not be written")
+      {
+        CHECK_THROWS_AS (db.execute ("DELETE FROM nums;"), SQLite3Error);
+        CHECK_THROWS_AS (db.execute ("INSERT INTO nums VALUES (1, 'x');"),
+                         SQLite3Error);
+      }
+    }
+  }
+
+  GIVEN ("a Dataset with names and indexes")
+  {
+    Database db{":memory:"};
+    auto ds = db.select ("WITH RECURSIVE n(id) AS (SELECT 1 UNION ALL"
+                         " SELECT id + 1 FROM n WHERE id < 100)"
+                         " SELECT id, 'n' || id AS name FROM n;",
+                         {Type::Int, Type::Text});
+    ds.createIndex ({0}, IndexType::Ordered);
+    ds.createIndex ({1}, IndexType::Hash);
+    db.createVirtualTable ("nums", ds);
+
+    THEN ("the Dataset names are the column names")
+    {
+      CHECK_EQ (count (db, "SELECT sum(id) FROM nums;"), 5050);
+    }
+
+    THEN ("equality and ranges use the index with correct results")
+    {
+      CHECK_EQ (count (db, "SELECT count(*) FROM nums WHERE id = 42;"), 1);
+      CHECK_EQ (count (db, "SELECT count(*) FROM nums WHERE id > 90;"), 10);
+      CHECK_EQ (count (db, "SELECT count(*) FROM nums WHERE id >= 90;"), 11);
+      CHECK_EQ (count (db, "SELECT count(*) FROM nums WHERE id < 5;"), 4);
+      CHECK_EQ (count (db, "SELECT count(*) FROM nums WHERE id <= 5;"), 5);
+      CHECK_EQ (count (db,
+                       "SELECT sum(id) FROM nums"
+                       " WHERE id BETWEEN 10 AND 12;"),
+                33);
+      CHECK_EQ (count (db,
+                       "SELECT count(*) FROM nums"
+                       " WHERE id > 50 AND id < 40;"),
+                0);
+      CHECK_EQ (count (db, "SELECT id FROM nums WHERE name = 'n77';"), 77);
+      CHECK_EQ (count (db, "SELECT count(*) FROM nums WHERE id = 2.5;"), 0);
+      CHECK_EQ (count (db, "SELECT count(*) FROM nums WHERE id < 2.5;"), 2);
+      CHECK_EQ (count (db, "SELECT count(*) FROM nums WHERE id = NULL;"), 0);
+    }
+
+    THEN ("the query plan uses the index")
+    {
+      auto plan = db.select ("EXPLAIN QUERY PLAN"
+                             " SELECT * FROM nums WHERE id >= 90;");
+      REQUIRE_EQ (plan.size (), 1);
+      CHECK_EQ (plan[0][3].getText (), "SCAN nums VIRTUAL TABLE INDEX 1:G");
+    }
+
+    THEN ("values that need a conversion give the same result as a table")
+    {
+      CHECK_EQ (count (db, "SELECT count(*) FROM nums WHERE id = '42';"), 1);
+      CHECK_EQ (count (db, "SELECT count(*) FROM nums WHERE id > '90';"),
+                10);
+    }
+
+    THEN ("bound parameters are looked up")
+    {
+      auto cmd = db.prepare ("SELECT name FROM nums WHERE id = ?;");
+      auto res = cmd.select ({DbValue{int64_t{9}}});
+      REQUIRE_EQ (res.size (), 1);
+      CHECK_EQ (res[0][0].getText (), "n9");
+    }
+  }
+
+  GIVEN ("an untyped Dataset with rows of different sizes")
+  {
+    Database db{":memory:"};
+    Dataset  ds;
+    ds.merge (DbValues{DbValue{1}, DbValue{2}, DbValue{3}});
+    ds.merge (DbValues{DbValue{4}});
+    db.createVirtualTable ("ragged", ds);
+
+    THEN ("the missing fields are Null")
+    {
+      CHECK_EQ (count (db, "SELECT count(column3) FROM ragged;"), 1);
+      CHECK_EQ (count (db, "SELECT sum(column1) FROM ragged;"), 5);
+    }
+  }
+
+  GIVEN ("a Dataset with indexed text fields")
+  {
+    Database db{":memory:"};
+    auto     ds = db.select ("SELECT 'abc' AS a, 'abc' AS h"
+                             " UNION ALL SELECT 'ABC', 'ABC'"
+                             " UNION ALL SELECT 'b', 'b';",
+                             {Type::Text, Type::Text});
+    ds.createIndex ({0}, IndexType::Ordered);
+    ds.createIndex ({1}, IndexType::Hash);
+    db.createVirtualTable ("names", ds);
+
+    THEN ("constraints with another collation give all matching rows")
+    {
+      CHECK_EQ (count (db,
+                       "SELECT count(*) FROM names"
+                       " WHERE a = 'abc' COLLATE NOCASE;"),
+                2);
+      CHECK_EQ (count (db,
+                       "SELECT count(*) FROM names"
+                       " WHERE h = 'abc' COLLATE NOCASE;"),
+                2);
+      CHECK_EQ (count (db,
+                       "SELECT count(*) FROM names"
+                       " WHERE a > 'a' COLLATE NOCASE;"),
+                3);
+      CHECK_EQ (count (db, "SELECT count(*) FROM names WHERE a = 'abc';"),
+                1);
+    }
+  }
+}
+
+SCENARIO ("query a range of structs as table")
+{
+  using namespace sl3;
+
+  GIVEN ("a vector of structs and column descriptions")
+  {
+    std::vector<Price> prices;
+    for (int64_t i = 1; i <= 50; ++i)
+      {
+        std::optional<double> value;
+        if (i % 10 != 0)
+          value = static_cast<double> (i) * 1.5;
+        prices.push_back (Price{i, "p" + std::to_string (i), value});
+      }
+
+    Database db{":memory:"};
+    db.createVirtualTable (
+        "prices",
+        prices,
+        {tableColumn ("id", &Price::id, true),
+         tableColumn ("name", &Price::name, true),
+         tableColumn ("value", &Price::value),
+         tableColumn<Price> (
+             "twice", [] (const Price& p) { return p.id * 2; })});
+
+    THEN ("members and getters are the columns")
+    {
+      auto rows = db.select ("SELECT id, name, value, twice FROM prices"
+                             " WHERE id = 3;");
+      REQUIRE_EQ (rows.size (), 1);
+      CHECK_EQ (rows[0][0].getInt (), 3);
+      CHECK_EQ (rows[0][1].getText (), "p3");
+      CHECK_EQ (rows[0][2].getReal (), doctest::Approx (4.5));
+      CHECK_EQ (rows[0][3].getInt (), 6);
+    }
+
+    THEN ("empty optionals are Null")
+    {
+      CHECK_EQ (count (db,
+                       "SELECT count(*) FROM prices WHERE value IS NULL;"),
+                5);
+    }
+
+    THEN ("indexed columns give correct results")
+    {
+      CHECK_EQ (count (db, "SELECT count(*) FROM prices WHERE id >= 41;"),
+                10);
+      CHECK_EQ (count (db, "SELECT id FROM prices WHERE name = 'p17';"), 17);
+      CHECK_EQ (count (db,
+                       "SELECT count(*) FROM prices"
+                       " WHERE name > 'p4' AND name < 'p5';"),
+                10);
+      CHECK_EQ (count (db, "SELECT count(*) FROM prices WHERE twice = 8;"),
+                1);
+    }
+
+    THEN ("a text value against an integer column scans all rows")
+    {
+      CHECK_EQ (count (db, "SELECT count(*) FROM prices WHERE id = '12';"),
+                1);
+    }
+
+    THEN ("registering the name again replaces the table")
+    {
+      auto ds = numbers (3);
+      db.createVirtualTable ("prices", ds);
+      CHECK_EQ (count (db, "SELECT count(*) FROM prices;"), 3);
+    }
+  }
+}
+
+SCENARIO ("lifetime of virtual tables")
+{
+  using namespace sl3;
+
+  GIVEN ("a shared Dataset")
+  {
+    Database db{":memory:"};
+    auto     ds = std::make_shared<const Dataset> (numbers (4));
+
+    WHEN ("the table is registered and the pointer released")
+    {
+      db.createVirtualTable ("nums", ds);
+      ds.reset ();
+
+      THEN ("the table keeps the Dataset alive")
+      {
+        CHECK_EQ (count (db, "SELECT sum(column1) FROM nums;"), 10);
+      }
+    }
+
+    WHEN ("registering a null pointer")
+    {
+      THEN ("this throws")
+      {
+        CHECK_THROWS_AS (
+            db.createVirtualTable ("x", std::shared_ptr<const Dataset>{}),
+            ErrUnexpected);
+      }
+    }
+  }
+
+  GIVEN ("a closed database")
+  {
+    Database db{":memory:"};
+    auto          ds  = numbers (1);
+    Database      moved{std::move (db)};
+
+    THEN ("registering a table throws")
+    {
+      CHECK_THROWS_AS (db.createVirtualTable ("nums", ds),
+                       ErrNoConnection);
+    }
+  }
+}